@@ -14,4 +14,16 @@ fi
 cp -f "$SRC/mpcc_wasm_base.js"   "$DEST/mpcc_wasm_base.js"
 cp -f "$SRC/mpcc_wasm_base.wasm" "$DEST/mpcc_wasm_base.wasm"
 
+# The SIMD and pthreads builds are optional; the playground falls back to the scalar single-threaded module
+# (web/lib/modules.js picks the best one present that the browser supports).
+for variant in mpcc_wasm_simd mpcc_wasm_threaded mpcc_wasm_threaded_simd; do
+  variant_src="$SCRIPT_DIR/bazel-bin/wasm/$variant"
+  if [[ -d "$variant_src" ]]; then
+    cp -f "$variant_src/${variant}_base.js"   "$DEST/${variant}_base.js"
+    cp -f "$variant_src/${variant}_base.wasm" "$DEST/${variant}_base.wasm"
+  else
+    echo "note: no $variant build at $variant_src (bazel build --cpu=wasm //wasm:$variant)" >&2
+  fi
+done
+
 echo "copied wasm artifacts to $DEST"
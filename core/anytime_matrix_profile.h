@@ -0,0 +1,271 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <random>
+#include <utility>
+#include <vector>
+
+#include "core/matrix_profile.h"
+
+namespace MPCC {
+
+/// @brief When matrixProfileAnytime stops, and how it starts.
+struct AnytimeOptions {
+    /// Fraction of the diagonals to process, clamped to [0, 1]. 1 computes the exact profile.
+    double fraction = 1.0;
+
+    /// Wall-clock budget in milliseconds, or 0 for none. It is checked between rounds of diagonals, so a run
+    /// can overshoot it by up to one round.
+    double time_budget_ms = 0.0;
+
+    /// Whether to seed the profile with PreSCRIMP before the diagonals, which gives a good approximation
+    /// after roughly O(n^2 log n / m) work.
+    bool prescrimp = true;
+
+    /// Seed for the order of the diagonals and of the PreSCRIMP samples. A given seed and fraction always
+    /// produce the same profile, for any thread count.
+    uint64_t seed = 0;
+};
+
+/// @brief Called by matrixProfileAnytime on the calling thread whenever mp and mpi hold a new approximation:
+/// after PreSCRIMP (with done == 0) and after each round of diagonals. done counts the diagonals processed
+/// out of the total the run will process. Returning false stops the computation, leaving the current
+/// approximation in mp and mpi.
+using AnytimeCallback = std::function<bool(size_t done, size_t total)>;
+
+namespace detail {
+
+/// @brief Diagonals per worker in each round of matrixProfileAnytime. Every round ends with a reduction of
+/// the per-worker profiles (O(num_workers * n)), which this keeps well below the round's own work
+/// (O(num_workers * n * kAnytimeDiagonalsPerWorker / 2)), while rounds stay short enough to report often.
+constexpr size_t kAnytimeDiagonalsPerWorker = 32;
+
+} // namespace detail
+
+/// @brief Compute an approximate self-join matrix profile that improves the longer it runs (SCRIMP++).
+///
+/// The diagonals of the distance matrix are processed in a random order, each in full with the O(1)
+/// dot-product update of matrixProfileDiagonal (exclusion zone m/4 by default, ties to the lowest index).
+/// Every processed diagonal tightens the profile, so a small fraction of them already gives a usable
+/// approximation, and processing all of them gives exactly matrixProfileDiagonal's result.
+///
+/// With options.prescrimp the diagonals are preceded by PreSCRIMP. For every (m/4)-th subsequence in random
+/// order it runs a MASS search over the whole sequence, offers every distance to both subsequences involved,
+/// and then refines the neighborhood of the best match: starting from the matched pair it walks up to m/4
+/// cells along its diagonal in both directions. Motifs typically already show up after this pass. Its
+/// distances come from the FFT products, so after PreSCRIMP a complete run matches matrixProfileDiagonal
+/// only up to rounding; without it, bit for bit.
+///
+/// The run stops when options.fraction of the diagonals are done, when options.time_budget_ms runs out, or
+/// when on_update returns false, whichever comes first. mp and mpi always hold the latest approximation:
+/// entries with no candidate yet are infinity and -1.
+///
+/// @param sequence     The input time series (1-D).
+/// @param m            Subsequence length.
+/// @param stats        Window statistics of sequence for length m (see SequenceStats). The overload
+///                     without it computes them.
+/// @param mp           Output matrix profile, pre-allocated with size n-m+1.
+/// @param mpi          Output matrix profile index, pre-allocated with size n-m+1.
+/// @param options      Stopping conditions, PreSCRIMP and the random seed.
+/// @param num_threads  Worker threads (0 for one per hardware thread).
+/// @param on_update    Optional callback reporting each new approximation and allowing an early stop.
+/// @param exclusion    Exclusion-zone policy (see QuarterExclusion). The diagonals start at its first
+///                     non-excluded one and PreSCRIMP samples every zone-th subsequence.
+template <class S, class D, class I, class T, class Acc, class Exclusion = QuarterExclusion>
+MatrixProfileStatus matrixProfileAnytime(
+    const xt::xexpression<S>& sequence,
+    size_t m,
+    const BasicSequenceStats<T, Acc>& stats,
+    xt::xexpression<D>& mp,
+    xt::xexpression<I>& mpi,
+    const AnytimeOptions& options = {},
+    size_t num_threads = 1,
+    const AnytimeCallback& on_update = {},
+    Exclusion exclusion = {}
+) {
+    static_assert(xt::get_rank<S>::value == 1 || xt::get_rank<S>::value == SIZE_MAX, "sequence must be 1-dimensional");
+    static_assert(xt::get_rank<D>::value == 1 || xt::get_rank<D>::value == SIZE_MAX, "mp must be 1-dimensional");
+    static_assert(xt::get_rank<I>::value == 1 || xt::get_rank<I>::value == SIZE_MAX, "mpi must be 1-dimensional");
+    static_assert(std::is_same_v<T, detail::compute_t<S>>, "stats must match the precision of the sequence");
+
+    using clock = std::chrono::steady_clock;
+    const auto start = clock::now();
+
+    const auto& seq  = sequence.derived_cast();
+    auto&       mp_  = mp.derived_cast();
+    auto&       mpi_ = mpi.derived_cast();
+
+    if (seq.dimension() != 1) return MatrixProfileStatus::SequenceNotOneDimensional;
+    if (m == 0)               return MatrixProfileStatus::SubsequenceLengthZero;
+    if (m > seq.size())       return MatrixProfileStatus::SubsequenceLongerThanSequence;
+    if (!stats.matches(seq.size(), m)) return MatrixProfileStatus::StatsMismatch;
+
+    const size_t n           = seq.size();
+    const size_t profile_len = n - m + 1;
+
+    if (mp_.size()  != profile_len) return MatrixProfileStatus::DistanceWrongSize;
+    if (mpi_.size() != profile_len) return MatrixProfileStatus::IndexWrongSize;
+
+    using idx_t = typename std::decay_t<decltype(mpi_)>::value_type;
+
+    const size_t first_diag = exclusion.firstDiagonal(m);
+
+    std::fill(mp_.begin(),  mp_.end(),  std::numeric_limits<double>::infinity());
+    std::fill(mpi_.begin(), mpi_.end(), static_cast<idx_t>(-1));
+
+    const auto centered = detail::centerSeries(seq, stats.mean(m));
+    const T*   t        = centered.values.data();
+    const T*   mean     = centered.mean.data();
+    const T*   stddev   = stats.stddev(m).data();
+
+    const auto& kern = kernels::active<T>();
+
+    const size_t num_workers = resolveThreadCount(num_threads);
+    std::mt19937_64 rng(options.seed);
+
+    auto out_of_time = [&] {
+        if (options.time_budget_ms <= 0.0) return false;
+        return std::chrono::duration<double, std::milli>(clock::now() - start).count() >= options.time_budget_ms;
+    };
+
+    // Each worker accumulates into its own profile. After every pass they are min-reduced into best_mp and
+    // best_mpi and copied out; the tie-break makes the reduction order, and so the thread count, irrelevant.
+    const double inf = std::numeric_limits<double>::infinity();
+    std::vector<std::vector<double>> local_mp(num_workers, std::vector<double>(profile_len, inf));
+    std::vector<std::vector<idx_t>>  local_mpi(num_workers, std::vector<idx_t>(profile_len, static_cast<idx_t>(-1)));
+    std::vector<double> best_mp(profile_len, inf);
+    std::vector<idx_t>  best_mpi(profile_len, static_cast<idx_t>(-1));
+
+    auto publish = [&] {
+        for (size_t w = 0; w < num_workers; w++) {
+            for (size_t i = 0; i < profile_len; i++) {
+                if (detail::isBetterNeighbor(local_mp[w][i], local_mpi[w][i], best_mp[i], best_mpi[i])) {
+                    best_mp[i]  = local_mp[w][i];
+                    best_mpi[i] = local_mpi[w][i];
+                }
+            }
+        }
+        for (size_t i = 0; i < profile_len; i++) {
+            mp_[i]  = best_mp[i];
+            mpi_[i] = best_mpi[i];
+        }
+    };
+
+    // Diagonals [first_diag, profile_len) in random order, truncated to the requested fraction.
+    std::vector<size_t> diagonals;
+    for (size_t k = first_diag; k < profile_len; k++) diagonals.push_back(k);
+    std::shuffle(diagonals.begin(), diagonals.end(), rng);
+
+    const double fraction = std::clamp(options.fraction, 0.0, 1.0);
+    const size_t total    = static_cast<size_t>(std::ceil(fraction * static_cast<double>(diagonals.size())));
+
+    if (options.prescrimp && profile_len > first_diag) {
+        std::vector<T> seq_buf;
+        const T* s = detail::contiguousData(seq, seq_buf);
+        const auto seq_xt = xt::adapt(s, n, xt::no_ownership(), std::vector<size_t>{n});
+
+        const size_t stride = std::max<size_t>(first_diag, 2) - 1;
+        std::vector<size_t> samples;
+        for (size_t i = 0; i < profile_len; i += stride) samples.push_back(i);
+        std::shuffle(samples.begin(), samples.end(), rng);
+
+        std::vector<std::vector<T>> profiles(num_workers, std::vector<T>(profile_len));
+
+        detail::parallelFor(samples.size(), num_workers, [&](size_t task, size_t worker) {
+            const size_t i    = samples[task];
+            auto&        lmp  = local_mp[worker];
+            auto&        lmpi = local_mpi[worker];
+            auto&        dist = profiles[worker];
+
+            const auto qry_xt  = xt::adapt(s + i, m, xt::no_ownership(), std::vector<size_t>{m});
+            auto       dist_xt = xt::adapt(dist.data(), profile_len, xt::no_ownership(),
+                                           std::vector<size_t>{profile_len});
+            similaritySearchMass(seq_xt, qry_xt, stats, dist_xt);
+
+            auto offer = [&](size_t a, size_t b, double d) {
+                if (detail::isBetterNeighbor(d, static_cast<idx_t>(b), lmp[a], lmpi[a])) {
+                    lmp[a]  = d;
+                    lmpi[a] = static_cast<idx_t>(b);
+                }
+            };
+
+            const auto [left_end, right_begin] = detail::candidateRanges(i, profile_len, first_diag);
+            for (const auto& [begin, end] : {std::pair{size_t{0}, left_end}, std::pair{right_begin, profile_len}}) {
+                for (size_t j = begin; j < end; j++) {
+                    offer(i, j, dist[j]);
+                    offer(j, i, dist[j]);
+                }
+            }
+
+            const ArgMin best = detail::nearestOutsideExclusion(dist.data(), profile_len, i, first_diag);
+            if (best.index == SIZE_MAX) return;
+
+            // Walk the matched pair's diagonal stride cells either way with the O(1) dot-product update.
+            const size_t a0 = std::min(i, best.index);
+            const size_t b0 = std::max(i, best.index);
+            const double dot0 = kern.dot(t + a0, t + b0, m);
+
+            double dot = dot0;
+            for (size_t step = 1; step < stride && b0 + step < profile_len; step++) {
+                const size_t a = a0 + step, b = b0 + step;
+                dot += static_cast<double>(t[a + m - 1]) * t[b + m - 1] - static_cast<double>(t[a - 1]) * t[b - 1];
+                const double d = detail::zNormalizedDistance(dot, m, mean[a], stddev[a], mean[b], stddev[b]);
+                offer(a, b, d);
+                offer(b, a, d);
+            }
+            dot = dot0;
+            for (size_t step = 1; step < stride && step <= a0; step++) {
+                const size_t a = a0 - step, b = b0 - step;
+                dot += static_cast<double>(t[a]) * t[b] - static_cast<double>(t[a + m]) * t[b + m];
+                const double d = detail::zNormalizedDistance(dot, m, mean[a], stddev[a], mean[b], stddev[b]);
+                offer(a, b, d);
+                offer(b, a, d);
+            }
+        });
+
+        publish();
+        if (on_update && !on_update(0, total)) return MatrixProfileStatus::Success;
+        if (out_of_time()) return MatrixProfileStatus::Success;
+    }
+
+    const size_t round = num_workers * detail::kAnytimeDiagonalsPerWorker;
+    for (size_t begin = 0; begin < total; begin += round) {
+        const size_t end = std::min(begin + round, total);
+
+        detail::parallelFor(end - begin, num_workers, [&](size_t task, size_t worker) {
+            detail::sweepDiagonal(t, mean, stddev, profile_len, m, diagonals[begin + task],
+                                  local_mp[worker].data(), local_mpi[worker].data());
+        });
+
+        publish();
+        if (on_update && !on_update(end, total)) break;
+        if (end < total && out_of_time()) break;
+    }
+
+    return MatrixProfileStatus::Success;
+}
+
+/// @brief matrixProfileAnytime without precomputed statistics; see the overload above.
+template <class S, class D, class I, class Exclusion = QuarterExclusion>
+MatrixProfileStatus matrixProfileAnytime(
+    const xt::xexpression<S>& sequence,
+    size_t m,
+    xt::xexpression<D>& mp,
+    xt::xexpression<I>& mpi,
+    const AnytimeOptions& options = {},
+    size_t num_threads = 1,
+    const AnytimeCallback& on_update = {},
+    Exclusion exclusion = {}
+) {
+    if (m == 0) return MatrixProfileStatus::SubsequenceLengthZero;
+    if (m > sequence.derived_cast().size()) return MatrixProfileStatus::SubsequenceLongerThanSequence;
+    return matrixProfileAnytime(sequence, m, detail::StatsFor<S>(sequence, m), mp, mpi, options, num_threads,
+                                on_update, exclusion);
+}
+
+} // namespace MPCC
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <algorithm>
+#include <span>
+#include <vector>
+
+#include "core/matrix_profile.h"
+#include "core/thread_pool.h"
+
+namespace MPCC {
+
+/// @brief Where each series' profile starts in the output of matrixProfileBatch: for series offsets (count+1
+/// entries, series s is values[offsets[s], offsets[s+1])), entry s of the result is the start of profile s
+/// and the last entry the total length, sum over s of len_s - m + 1. Series must be at least m long.
+inline std::vector<size_t> batchProfileOffsets(std::span<const size_t> offsets, size_t m) {
+    std::vector<size_t> profile_offsets(std::max<size_t>(offsets.size(), 1), 0);
+    for (size_t s = 0; s + 1 < offsets.size(); s++) {
+        profile_offsets[s + 1] = profile_offsets[s] + (offsets[s + 1] - offsets[s] - m + 1);
+    }
+    return profile_offsets;
+}
+
+/// @brief Compute the self-join matrix profiles of many independent series at once. The series are stored
+/// back to back in values (a ragged buffer), series s being values[offsets[s], offsets[s+1]), and their
+/// profiles land back to back in mp/mpi at the positions given by batchProfileOffsets, so a batch of
+/// thousands of series needs one output allocation rather than one per series.
+///
+/// Each series is one task on a persistent ThreadPool (by default the process-wide ThreadPool::shared()),
+/// which balances series of uneven lengths by work stealing, and is computed single-threaded with
+/// matrixProfileDiagonal: profile s is bit-identical to matrixProfileDiagonal of series s alone, for any
+/// num_threads. That suits many short series, where one thread per series beats splitting each one.
+///
+/// @param values       The series, concatenated (1-D).
+/// @param offsets      count+1 non-decreasing positions in values (see above); offsets.back() may be less
+///                     than values.size(), leaving a tail unused.
+/// @param m            Subsequence length, shared by every series.
+/// @param mp           Output profiles, pre-allocated with size batchProfileOffsets(offsets, m).back().
+/// @param mpi          Output indices within each series, with the same size. Entries are -1 where a
+///                     subsequence has no neighbor outside its exclusion zone (m/4).
+/// @param num_threads  Pool workers to use (0 for all of them).
+/// @param progress     Optional progress(done, total) callback counting finished series.
+/// @param pool         The pool to run on.
+/// @return BatchOffsetsInvalid if offsets is empty, decreasing or beyond values; SubsequenceLongerThanSequence
+///         if any series is shorter than m.
+template <class S, class D, class I>
+MatrixProfileStatus matrixProfileBatch(
+    const xt::xexpression<S>& values,
+    std::span<const size_t> offsets,
+    size_t m,
+    xt::xexpression<D>& mp,
+    xt::xexpression<I>& mpi,
+    size_t num_threads = 0,
+    const ProgressCallback& progress = {},
+    ThreadPool& pool = ThreadPool::shared()
+) {
+    static_assert(xt::get_rank<S>::value == 1 || xt::get_rank<S>::value == SIZE_MAX, "values must be 1-dimensional");
+    static_assert(xt::get_rank<D>::value == 1 || xt::get_rank<D>::value == SIZE_MAX, "mp must be 1-dimensional");
+    static_assert(xt::get_rank<I>::value == 1 || xt::get_rank<I>::value == SIZE_MAX, "mpi must be 1-dimensional");
+
+    const auto& vals = values.derived_cast();
+    auto&       mp_  = mp.derived_cast();
+    auto&       mpi_ = mpi.derived_cast();
+
+    if (vals.dimension() != 1) return MatrixProfileStatus::SequenceNotOneDimensional;
+    if (m == 0)                return MatrixProfileStatus::SubsequenceLengthZero;
+    if (offsets.empty() || offsets.back() > vals.size()) return MatrixProfileStatus::BatchOffsetsInvalid;
+    for (size_t s = 0; s + 1 < offsets.size(); s++) {
+        if (offsets[s + 1] < offsets[s])     return MatrixProfileStatus::BatchOffsetsInvalid;
+        if (offsets[s + 1] - offsets[s] < m) return MatrixProfileStatus::SubsequenceLongerThanSequence;
+    }
+
+    const std::vector<size_t> profile_offsets = batchProfileOffsets(offsets, m);
+    const size_t num_series = offsets.size() - 1;
+
+    if (mp_.size()  != profile_offsets.back()) return MatrixProfileStatus::DistanceWrongSize;
+    if (mpi_.size() != profile_offsets.back()) return MatrixProfileStatus::IndexWrongSize;
+
+    // Every check matrixProfileDiagonal makes has passed above, so its status is always Success here.
+    pool.parallelFor(num_series, [&](size_t s, size_t) {
+        const auto series = xt::view(vals, xt::range(offsets[s], offsets[s + 1]));
+        auto       mp_s   = xt::view(mp_,  xt::range(profile_offsets[s], profile_offsets[s + 1]));
+        auto       mpi_s  = xt::view(mpi_, xt::range(profile_offsets[s], profile_offsets[s + 1]));
+        matrixProfileDiagonal(series, m, mp_s, mpi_s, 1);
+    }, progress, num_threads);
+
+    return MatrixProfileStatus::Success;
+}
+
+} // namespace MPCC
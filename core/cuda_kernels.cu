@@ -0,0 +1,173 @@
+#include "core/cuda_kernels.h"
+
+#include <cuda_runtime.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+
+namespace MPCC::detail {
+
+namespace {
+
+/// The packed key of a row without a neighbor: larger than every (distance, index) key.
+constexpr unsigned long long kNoNeighbor = ~0ull;
+
+constexpr unsigned kThreadsPerBlock = 256;
+constexpr unsigned kMaxGridY        = 65535;
+
+/// A device allocation freed on scope exit.
+template <class V>
+class DeviceBuffer {
+public:
+    explicit DeviceBuffer(size_t count) {
+        if (cudaMalloc(&data_, std::max<size_t>(count, 1) * sizeof(V)) != cudaSuccess) data_ = nullptr;
+    }
+    DeviceBuffer(const DeviceBuffer&) = delete;
+    DeviceBuffer& operator=(const DeviceBuffer&) = delete;
+    ~DeviceBuffer() {
+        if (data_) cudaFree(data_);
+    }
+
+    V*   get() const { return data_; }
+    bool ok() const { return data_ != nullptr; }
+
+private:
+    V* data_ = nullptr;
+};
+
+/// zNormalizedDistance of the CPU engines, in T.
+template <class T>
+__device__ T distance(T dot, T md, T mean_a, T std_a, T mean_b, T std_b, T flat) {
+    const bool flat_a = std_a < flat;
+    const bool flat_b = std_b < flat;
+    if (flat_a || flat_b) return (flat_a && flat_b) ? T(0) : sqrt(md);
+
+    const T pearson = (dot - md * mean_a * mean_b) / (md * std_a * std_b);
+    return sqrt(T(2) * md * (T(1) - fmin(fmax(pearson, T(-1)), T(1))));
+}
+
+/// Non-negative floats order like their bit patterns, so (distance bits, index) keys order by distance and
+/// then by index, and one 64-bit atomicMin picks the nearest neighbor with ties to the lowest index.
+__device__ unsigned long long packNeighbor(float d, size_t j) {
+    return (static_cast<unsigned long long>(__float_as_uint(d)) << 32) | static_cast<unsigned long long>(j);
+}
+
+__device__ void offerNeighbor(unsigned long long* key, unsigned long long candidate) {
+    // Most candidates lose; checking first keeps them from contending for the atomic. A stale read only
+    // costs an unnecessary atomicMin.
+    if (candidate < *reinterpret_cast<volatile unsigned long long*>(key)) atomicMin(key, candidate);
+}
+
+/// One thread per (diagonal, segment): threads of a block take adjacent diagonals of the same segment, so
+/// their reads of t[i + k + ...] coalesce and their reads of t[i + ...] broadcast.
+template <class T>
+__global__ void diagonalKernel(const T* __restrict__ t, const T* __restrict__ mean, const T* __restrict__ stddev,
+                               size_t profile_len, size_t m, size_t first_diagonal, size_t segment, T flat,
+                               unsigned long long* keys) {
+    const size_t k = first_diagonal + static_cast<size_t>(blockIdx.x) * blockDim.x + threadIdx.x;
+    if (k >= profile_len) return;
+
+    const size_t diagonal_len = profile_len - k;
+    const T      md           = static_cast<T>(m);
+
+    for (size_t s = blockIdx.y; s * segment < diagonal_len; s += gridDim.y) {
+        const size_t i_begin = s * segment;
+        const size_t i_end   = min(i_begin + segment, diagonal_len);
+
+        T dot = 0;
+        for (size_t q = 0; q < m; q++) dot += t[i_begin + q] * t[i_begin + k + q];
+
+        for (size_t i = i_begin; i < i_end; i++) {
+            const size_t j = i + k;
+            if (i > i_begin) dot += t[i + m - 1] * t[j + m - 1] - t[i - 1] * t[j - 1];
+
+            const T d = distance(dot, md, mean[i], stddev[i], mean[j], stddev[j], flat);
+            if (isnan(d)) continue;  // Never selected, as in the CPU argmin.
+
+            const float d32 = static_cast<float>(d);
+            offerNeighbor(keys + i, packNeighbor(d32, j));
+            offerNeighbor(keys + j, packNeighbor(d32, i));
+        }
+    }
+}
+
+/// Unpack each row's winner and recompute its distance with a direct dot product, so mp carries full
+/// precision of T rather than the float32 of the key.
+template <class T>
+__global__ void finalizeKernel(const T* __restrict__ t, const T* __restrict__ mean, const T* __restrict__ stddev,
+                               size_t profile_len, size_t m, T flat, const unsigned long long* keys, T* mp,
+                               int64_t* mpi) {
+    const size_t i = static_cast<size_t>(blockIdx.x) * blockDim.x + threadIdx.x;
+    if (i >= profile_len) return;
+
+    const unsigned long long key = keys[i];
+    if (key == kNoNeighbor) {
+        mp[i]  = static_cast<T>(INFINITY);
+        mpi[i] = -1;
+        return;
+    }
+
+    const size_t j = static_cast<size_t>(key & 0xffffffffull);
+    T dot = 0;
+    for (size_t q = 0; q < m; q++) dot += t[i + q] * t[j + q];
+    mp[i]  = distance(dot, static_cast<T>(m), mean[i], stddev[i], mean[j], stddev[j], flat);
+    mpi[i] = static_cast<int64_t>(j);
+}
+
+} // namespace
+
+bool cudaDeviceAvailable() {
+    int count = 0;
+    return cudaGetDeviceCount(&count) == cudaSuccess && count > 0;
+}
+
+template <class T>
+bool cudaDiagonalSelfJoin(const T* t, const T* mean, const T* stddev, size_t profile_len, size_t m,
+                          size_t first_diagonal, double flat_threshold, T* mp, int64_t* mpi, int device) {
+    if (profile_len >= std::numeric_limits<uint32_t>::max()) return false;
+    if (cudaSetDevice(device) != cudaSuccess) return false;
+
+    const size_t n = profile_len + m - 1;
+    DeviceBuffer<T>                  t_dev(n), mean_dev(profile_len), std_dev(profile_len), mp_dev(profile_len);
+    DeviceBuffer<int64_t>            mpi_dev(profile_len);
+    DeviceBuffer<unsigned long long> keys(profile_len);
+    if (!t_dev.ok() || !mean_dev.ok() || !std_dev.ok() || !mp_dev.ok() || !mpi_dev.ok() || !keys.ok()) return false;
+
+    if (cudaMemcpy(t_dev.get(),    t,      n * sizeof(T),           cudaMemcpyHostToDevice) != cudaSuccess ||
+        cudaMemcpy(mean_dev.get(), mean,   profile_len * sizeof(T), cudaMemcpyHostToDevice) != cudaSuccess ||
+        cudaMemcpy(std_dev.get(),  stddev, profile_len * sizeof(T), cudaMemcpyHostToDevice) != cudaSuccess ||
+        cudaMemset(keys.get(), 0xff, profile_len * sizeof(unsigned long long)) != cudaSuccess) {
+        return false;
+    }
+
+    const T flat = static_cast<T>(flat_threshold);
+
+    if (first_diagonal < profile_len) {
+        const size_t segment      = std::max(kCudaDiagonalSegment, 4 * m);
+        const size_t diagonals    = profile_len - first_diagonal;
+        const size_t num_segments = (profile_len - first_diagonal + segment - 1) / segment;
+
+        const dim3 grid(static_cast<unsigned>((diagonals + kThreadsPerBlock - 1) / kThreadsPerBlock),
+                        static_cast<unsigned>(std::min<size_t>(num_segments, kMaxGridY)));
+        diagonalKernel<<<grid, kThreadsPerBlock>>>(t_dev.get(), mean_dev.get(), std_dev.get(), profile_len, m,
+                                                   first_diagonal, segment, flat, keys.get());
+        if (cudaGetLastError() != cudaSuccess) return false;
+    }
+
+    const unsigned rows_grid = static_cast<unsigned>((profile_len + kThreadsPerBlock - 1) / kThreadsPerBlock);
+    finalizeKernel<<<rows_grid, kThreadsPerBlock>>>(t_dev.get(), mean_dev.get(), std_dev.get(), profile_len, m,
+                                                    flat, keys.get(), mp_dev.get(), mpi_dev.get());
+    if (cudaGetLastError() != cudaSuccess) return false;
+
+    return cudaMemcpy(mp,  mp_dev.get(),  profile_len * sizeof(T),       cudaMemcpyDeviceToHost) == cudaSuccess &&
+           cudaMemcpy(mpi, mpi_dev.get(), profile_len * sizeof(int64_t), cudaMemcpyDeviceToHost) == cudaSuccess;
+}
+
+template bool cudaDiagonalSelfJoin<double>(const double*, const double*, const double*, size_t, size_t, size_t,
+                                           double, double*, int64_t*, int);
+template bool cudaDiagonalSelfJoin<float>(const float*, const float*, const float*, size_t, size_t, size_t,
+                                          double, float*, int64_t*, int);
+
+} // namespace MPCC::detail
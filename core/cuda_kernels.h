@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Host entry points of the CUDA backend, implemented in cuda_kernels.cu. This header is shared by the .cu file
+// (compiled by nvcc) and by cuda_matrix_profile.h, so it deliberately includes neither xtensor nor the CUDA
+// runtime. Use the wrappers in cuda_matrix_profile.h rather than these directly.
+
+namespace MPCC::detail {
+
+/// @brief Rows of a diagonal swept by one CUDA thread, at least. Each segment starts from a directly computed
+/// dot product, so a segment is made at least 4 * m rows long to keep that O(m) start below a quarter of its
+/// work; segments also bound how far rounding errors of the O(1) update can accumulate.
+constexpr size_t kCudaDiagonalSegment = 1024;
+
+/// @brief Whether the CUDA runtime sees at least one device.
+bool cudaDeviceAvailable();
+
+/// @brief The self-join matrix profile of the centered series t (profile_len + m - 1 values) with window
+/// means mean and standard deviations stddev, on CUDA device `device`. Every diagonal k >= first_diagonal is
+/// split into segments swept by one thread each with the O(1) dot-product update; each cell offers its
+/// distance to both of its rows with a 64-bit atomicMin on (float32 distance bits, index) so ties go to the
+/// lowest index, and the winners' distances are then recomputed exactly in T. Writes mp (inf where there is
+/// no neighbor) and mpi (-1). Returns false on any CUDA error, or if profile_len does not fit the 32-bit
+/// index of the packed key.
+template <class T>
+bool cudaDiagonalSelfJoin(const T* t, const T* mean, const T* stddev, size_t profile_len, size_t m,
+                          size_t first_diagonal, double flat_threshold, T* mp, int64_t* mpi, int device);
+
+extern template bool cudaDiagonalSelfJoin<double>(const double*, const double*, const double*, size_t, size_t,
+                                                  size_t, double, double*, int64_t*, int);
+extern template bool cudaDiagonalSelfJoin<float>(const float*, const float*, const float*, size_t, size_t,
+                                                 size_t, double, float*, int64_t*, int);
+
+} // namespace MPCC::detail
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <cstdint>
+#include <type_traits>
+#include <vector>
+
+#include "core/cuda_kernels.h"
+#include "core/matrix_profile.h"
+
+// The CUDA backend of the diagonal engine. Only available from the //core:cuda target (which defines
+// MPCC_WITH_CUDA for its dependents); //core:core stays header-only and free of the CUDA toolkit.
+
+namespace MPCC {
+
+/// @brief Whether a CUDA device is available to matrixProfileDiagonalCuda.
+inline bool cudaAvailable() { return detail::cudaDeviceAvailable(); }
+
+/// @brief matrixProfileDiagonal on a CUDA device. Takes the same inputs as the CPU engines, with the same
+/// exclusion zone (m/4 by default) and -1 where there is no neighbor. The series is centered and its window
+/// statistics are computed on the host, then one thread per diagonal segment sweeps the distance matrix
+/// with the O(1) dot-product update and offers every distance to both its row and its column through an
+/// atomic min (see detail::cudaDiagonalSelfJoin).
+///
+/// The atomic min compares distances rounded to float32, so the profile is that of the CPU engines only up
+/// to that rounding: each distance is within float32 rounding of the CPU one, but where two neighbors'
+/// distances agree to about seven significant digits the lower index wins even if the other is marginally
+/// closer, so such near-ties may pick a different index than the CPU engines do. The reported distance is
+/// recomputed in T for the chosen neighbor. Float sequences are computed in single precision throughout,
+/// restarting the dot product every segment (detail::kCudaDiagonalSegment rows), which bounds the drift of
+/// the running update.
+///
+/// @param sequence  The input time series (1-D).
+/// @param m         Subsequence length.
+/// @param stats     Window statistics of sequence for length m (see SequenceStats). The overload without it
+///                  computes them.
+/// @param mp        Output matrix profile, pre-allocated with size n-m+1.
+/// @param mpi       Output matrix profile index, pre-allocated with size n-m+1.
+/// @param device    CUDA device ordinal.
+/// @param exclusion Exclusion-zone policy (see QuarterExclusion); the kernel starts at its first
+///                  non-excluded diagonal.
+/// @return DeviceError if a CUDA call fails (no device, out of device memory) or the series has 2^32 - 1 or
+///         more subsequences.
+template <class S, class D, class I, class T, class Acc, class Exclusion = QuarterExclusion>
+MatrixProfileStatus matrixProfileDiagonalCuda(
+    const xt::xexpression<S>& sequence,
+    size_t m,
+    const BasicSequenceStats<T, Acc>& stats,
+    xt::xexpression<D>& mp,
+    xt::xexpression<I>& mpi,
+    int device = 0,
+    Exclusion exclusion = {}
+) {
+    static_assert(xt::get_rank<S>::value == 1 || xt::get_rank<S>::value == SIZE_MAX, "sequence must be 1-dimensional");
+    static_assert(xt::get_rank<D>::value == 1 || xt::get_rank<D>::value == SIZE_MAX, "mp must be 1-dimensional");
+    static_assert(xt::get_rank<I>::value == 1 || xt::get_rank<I>::value == SIZE_MAX, "mpi must be 1-dimensional");
+    static_assert(std::is_same_v<T, detail::compute_t<S>>, "stats must match the precision of the sequence");
+
+    const auto& seq  = sequence.derived_cast();
+    auto&       mp_  = mp.derived_cast();
+    auto&       mpi_ = mpi.derived_cast();
+
+    if (seq.dimension() != 1) return MatrixProfileStatus::SequenceNotOneDimensional;
+    if (m == 0)               return MatrixProfileStatus::SubsequenceLengthZero;
+    if (m > seq.size())       return MatrixProfileStatus::SubsequenceLongerThanSequence;
+    if (!stats.matches(seq.size(), m)) return MatrixProfileStatus::StatsMismatch;
+
+    const size_t profile_len = seq.size() - m + 1;
+
+    if (mp_.size()  != profile_len) return MatrixProfileStatus::DistanceWrongSize;
+    if (mpi_.size() != profile_len) return MatrixProfileStatus::IndexWrongSize;
+
+    using idx_t = typename std::decay_t<decltype(mpi_)>::value_type;
+
+    const auto centered = detail::centerSeries(seq, stats.mean(m));
+
+    // The device writes contiguous T and int64; the outputs may be strided or of other types.
+    std::vector<T>       mp_host(profile_len);
+    std::vector<int64_t> mpi_host(profile_len);
+    if (!detail::cudaDiagonalSelfJoin(centered.values.data(), centered.mean.data(), stats.stddev(m).data(),
+                                      profile_len, m, exclusion.firstDiagonal(m), kFlatStdDevThreshold, mp_host.data(),
+                                      mpi_host.data(), device)) {
+        return MatrixProfileStatus::DeviceError;
+    }
+
+    for (size_t i = 0; i < profile_len; i++) {
+        mp_[i]  = mp_host[i];
+        mpi_[i] = static_cast<idx_t>(mpi_host[i]);
+    }
+    return MatrixProfileStatus::Success;
+}
+
+/// @brief matrixProfileDiagonalCuda without precomputed statistics; see the overload above.
+template <class S, class D, class I, class Exclusion = QuarterExclusion>
+MatrixProfileStatus matrixProfileDiagonalCuda(
+    const xt::xexpression<S>& sequence,
+    size_t m,
+    xt::xexpression<D>& mp,
+    xt::xexpression<I>& mpi,
+    int device = 0,
+    Exclusion exclusion = {}
+) {
+    return matrixProfileDiagonalCuda(sequence, m, detail::StatsFor<S>(sequence, m), mp, mpi, device, exclusion);
+}
+
+} // namespace MPCC
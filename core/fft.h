@@ -0,0 +1,112 @@
+#pragma once
+
+#include <cmath>
+#include <complex>
+#include <cstddef>
+#include <numbers>
+#include <utility>
+#include <vector>
+
+namespace MPCC::detail {
+
+/// @brief Smallest power of two that is greater than or equal to n (n > 0).
+inline size_t nextPowerOfTwo(size_t n) {
+    size_t p = 1;
+    while (p < n) p <<= 1;
+    return p;
+}
+
+/// @brief The twiddle factors of every FFT stage up to length n (a power of two), stage by stage: stage len
+/// holds exp(-2 pi i k / len) for k in [0, len / 2) at [len / 2, len), so each stage reads its factors
+/// contiguously. Each factor is computed directly rather than by repeated multiplication, whose rounding
+/// grows with the transform length. The table is kept per thread and only extended for a longer transform
+/// than any before it.
+inline const std::vector<std::complex<double>>& fftTwiddles(size_t n) {
+    thread_local std::vector<std::complex<double>> table(1);  // Entry 0 is unused.
+    for (size_t len = 2 * table.size(); len <= n; len <<= 1) {
+        for (size_t k = 0; k < len / 2; k++) {
+            const double angle = -2.0 * std::numbers::pi * static_cast<double>(k) / static_cast<double>(len);
+            table.push_back(std::polar(1.0, angle));
+        }
+    }
+    return table;
+}
+
+/// @brief In-place iterative radix-2 Cooley-Tukey FFT. data.size() must be a power of two. The inverse
+/// transform is unscaled; callers divide by data.size() themselves.
+inline void fft(std::vector<std::complex<double>>& data, bool inverse) {
+    const size_t n = data.size();
+
+    // Bit-reversal permutation.
+    for (size_t i = 1, j = 0; i < n; i++) {
+        size_t bit = n >> 1;
+        for (; j & bit; bit >>= 1) j ^= bit;
+        j ^= bit;
+        if (i < j) std::swap(data[i], data[j]);
+    }
+
+    // Raw pointers: through the vectors, the compiler reloads their data pointers after every store.
+    std::complex<double>*       x        = data.data();
+    const std::complex<double>* twiddles = fftTwiddles(n).data();
+
+    for (size_t len = 2; len <= n; len <<= 1) {
+        const size_t                half  = len / 2;
+        const std::complex<double>* stage = twiddles + half;
+
+        for (size_t start = 0; start < n; start += len) {
+            for (size_t k = 0; k < half; k++) {
+                const std::complex<double> w    = inverse ? std::conj(stage[k]) : stage[k];
+                const std::complex<double> even = x[start + k];
+                const std::complex<double> odd  = x[start + k + half] * w;
+                x[start + k]        = even + odd;
+                x[start + k + half] = even - odd;
+            }
+        }
+    }
+}
+
+/// @brief Compute the sliding dot product of qry against every length-m window of seq in O(n log n):
+/// out[i] = <seq[i, i+m), qry>. This is the convolution step of MASS.
+///
+/// Both real inputs are packed into a single complex transform (seq in the real part, the reversed query
+/// in the imaginary part) and separated in the frequency domain, so only one forward and one inverse FFT
+/// are needed. A transform of length >= n is sufficient: circular wrap-around only lands on the first m-1
+/// outputs of the linear convolution, which are not windows we keep.
+///
+/// seq_shift is subtracted from every sample of seq before the transform, i.e. the products are of
+/// seq - seq_shift. Callers use it to keep a large offset out of the FFT, whose rounding error scales with
+/// the magnitude of its input.
+template <class S, class Q>
+void slidingDotProductFft(const S& seq, const Q& qry, std::vector<double>& out, double seq_shift = 0.0) {
+    const size_t n     = seq.size();
+    const size_t m     = qry.size();
+    const size_t n_fft = nextPowerOfTwo(n);
+
+    std::vector<std::complex<double>> x(n_fft, std::complex<double>(0.0, 0.0));
+    for (size_t i = 0; i < n; i++) x[i].real(seq(i) - seq_shift);
+    for (size_t k = 0; k < m; k++) x[k].imag(qry(m - 1 - k));
+
+    fft(x, false);
+
+    // Split X = FFT(s + i q) into S = FFT(s) and Q = FFT(q) using conjugate symmetry of real signals, and
+    // form the product S * Q in place.
+    std::vector<std::complex<double>> prod(n_fft);
+    for (size_t k = 0; k < n_fft; k++) {
+        const std::complex<double> xk  = x[k];
+        const std::complex<double> xnk = std::conj(x[(n_fft - k) & (n_fft - 1)]);
+        const std::complex<double> s_k = 0.5 * (xk + xnk);
+        const std::complex<double> q_k = std::complex<double>(0.0, -0.5) * (xk - xnk);
+        prod[k] = s_k * q_k;
+    }
+
+    fft(prod, true);
+
+    const size_t profile_len = n - m + 1;
+    const double scale       = 1.0 / static_cast<double>(n_fft);
+    out.resize(profile_len);
+    for (size_t i = 0; i < profile_len; i++) {
+        out[i] = prod[i + m - 1].real() * scale;
+    }
+}
+
+} // namespace MPCC::detail
@@ -0,0 +1,198 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace MPCC {
+
+/// @brief The phases of a matrix profile run that ProfileStats times separately.
+enum class Phase {
+    Stats,          ///< Rolling window statistics (only when the engine computes them itself).
+    Centering,      ///< Subtracting the series mean before the sweep (see detail::centerSeries).
+    DotProducts,    ///< Direct and incrementally updated sliding dot products.
+    Distances,      ///< Converting dot products to z-normalized distances.
+    NeighborScan,   ///< The exclusion-aware argmin over each row of distances.
+    Diagonals,      ///< Diagonal sweeps, where dot products, distances and updates are fused per cell.
+    Reduction,      ///< Merging the per-worker profiles.
+};
+
+inline constexpr size_t kNumPhases = 7;
+
+inline const char* phaseName(Phase phase) {
+    switch (phase) {
+        case Phase::Stats:        return "stats";
+        case Phase::Centering:    return "centering";
+        case Phase::DotProducts:  return "dot_products";
+        case Phase::Distances:    return "distances";
+        case Phase::NeighborScan: return "neighbor_scan";
+        case Phase::Diagonals:    return "diagonals";
+        case Phase::Reduction:    return "reduction";
+    }
+    return "unknown";
+}
+
+/// @brief One complete span of a run, in microseconds since the run started, as a Chrome trace "X" event.
+struct TraceEvent {
+    const char* name;
+    size_t      worker;
+    double      start_us;
+    double      duration_us;
+};
+
+/// @brief What one worker thread did: seconds per phase, units of work, and its trace events. Worker 0 is
+/// the calling thread (see detail::parallelFor).
+struct ThreadProfile {
+    std::array<double, kNumPhases> phase_seconds{};
+    double                  busy_seconds = 0.0;  ///< Time spent inside tasks (row blocks, diagonal tiles).
+    size_t                  tasks        = 0;
+    size_t                  rows         = 0;
+    size_t                  diagonals    = 0;
+    std::vector<TraceEvent> events;
+};
+
+/// @brief Timings of one instrumented matrix profile run, filled in through Instrumented. Per-phase times
+/// are summed over threads, so with several workers they add up to more than wall_seconds; comparing the
+/// threads' busy_seconds shows how evenly the work was spread.
+struct ProfileStats {
+    double                     wall_seconds = 0.0;
+    std::vector<ThreadProfile> threads;
+
+    double phaseSeconds(Phase phase) const {
+        double total = 0.0;
+        for (const auto& t : threads) total += t.phase_seconds[static_cast<size_t>(phase)];
+        return total;
+    }
+
+    size_t rows() const {
+        size_t total = 0;
+        for (const auto& t : threads) total += t.rows;
+        return total;
+    }
+
+    size_t diagonals() const {
+        size_t total = 0;
+        for (const auto& t : threads) total += t.diagonals;
+        return total;
+    }
+
+    /// @brief The trace events of every thread in the Chrome trace event format, one tid per worker, for
+    /// chrome://tracing or https://ui.perfetto.dev.
+    std::string chromeTrace() const {
+        std::string out = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+        bool first = true;
+        char buf[256];
+        for (const auto& t : threads) {
+            for (const auto& e : t.events) {
+                std::snprintf(buf, sizeof(buf),
+                              "%s{\"name\":\"%s\",\"ph\":\"X\",\"pid\":0,\"tid\":%zu,\"ts\":%.3f,\"dur\":%.3f}",
+                              first ? "" : ",", e.name, e.worker, e.start_us, e.duration_us);
+                out += buf;
+                first = false;
+            }
+        }
+        out += "]}";
+        return out;
+    }
+};
+
+/// @brief The default instrumentation policy of the engines: every hook is an empty inline function, so
+/// uninstrumented builds compile to exactly the code they had without the hooks.
+struct NoInstrumentation {
+    static constexpr bool enabled = false;
+
+    struct Scope {
+        ~Scope() {}  // User-provided so that unused scopes do not warn.
+    };
+
+    void  workers(size_t) const {}
+    Scope phase(Phase, size_t, bool = false) const { return {}; }
+    Scope task(const char*, size_t) const { return {}; }
+    void  countRows(size_t, size_t) const {}
+    void  countDiagonals(size_t, size_t) const {}
+    void  finish() const {}
+};
+
+/// @brief Instrumentation policy that records into a ProfileStats. Construct it right before the call it
+/// measures, which starts the clock and clears stats, and pass it as the engine's last argument:
+///
+///     MPCC::ProfileStats stats;
+///     MPCC::matrixProfileDiagonal(seq, m, mp, mpi, 8, {}, MPCC::Instrumented(stats));
+///
+/// Each worker only writes its own ThreadProfile, so recording takes no locks. The cost is two clock reads
+/// per scope; scopes are per row at the finest, never per cell.
+class Instrumented {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    static constexpr bool enabled = true;
+
+    explicit Instrumented(ProfileStats& stats) : stats_(&stats), origin_(Clock::now()) {
+        stats.wall_seconds = 0.0;
+        stats.threads.assign(1, ThreadProfile{});
+    }
+
+    /// @brief Times its lifetime into a thread's phase (or busy) seconds, optionally as a trace event.
+    class Scope {
+    public:
+        Scope(ThreadProfile& thread, double* seconds, const char* name, size_t worker, Clock::time_point origin)
+            : thread_(thread), seconds_(seconds), name_(name), worker_(worker), origin_(origin),
+              start_(Clock::now()) {}
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+        ~Scope() {
+            const auto   end     = Clock::now();
+            const double seconds = std::chrono::duration<double>(end - start_).count();
+            *seconds_ += seconds;
+            if (name_) {
+                const double start_us = std::chrono::duration<double, std::micro>(start_ - origin_).count();
+                thread_.events.push_back({name_, worker_, start_us, seconds * 1e6});
+            }
+        }
+
+    private:
+        ThreadProfile&    thread_;
+        double*           seconds_;
+        const char*       name_;
+        size_t            worker_;
+        Clock::time_point origin_;
+        Clock::time_point start_;
+    };
+
+    /// @brief Make room for num_workers threads. Called on the calling thread before a parallel region.
+    void workers(size_t num_workers) const {
+        if (stats_->threads.size() < num_workers) stats_->threads.resize(num_workers);
+    }
+
+    /// @brief Time a phase on worker. trace also records it as a trace event; leave it off for per-row
+    /// scopes, which would flood the trace.
+    Scope phase(Phase phase, size_t worker, bool trace = false) const {
+        auto& thread = stats_->threads[worker];
+        return Scope(thread, &thread.phase_seconds[static_cast<size_t>(phase)], trace ? phaseName(phase) : nullptr,
+                     worker, origin_);
+    }
+
+    /// @brief Time one task (a row block, a diagonal tile) on worker as busy time and a trace event.
+    Scope task(const char* name, size_t worker) const {
+        auto& thread = stats_->threads[worker];
+        thread.tasks++;
+        return Scope(thread, &thread.busy_seconds, name, worker, origin_);
+    }
+
+    void countRows(size_t worker, size_t n) const { stats_->threads[worker].rows += n; }
+    void countDiagonals(size_t worker, size_t n) const { stats_->threads[worker].diagonals += n; }
+
+    /// @brief Record the wall time since construction. Called by the engine once it is done.
+    void finish() const {
+        stats_->wall_seconds = std::chrono::duration<double>(Clock::now() - origin_).count();
+    }
+
+private:
+    ProfileStats*     stats_;
+    Clock::time_point origin_;
+};
+
+} // namespace MPCC
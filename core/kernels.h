@@ -0,0 +1,791 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define MPCC_KERNELS_X86 1
+#include <immintrin.h>
+#endif
+
+#if defined(__aarch64__) && defined(__ARM_NEON)
+#define MPCC_KERNELS_NEON 1
+#include <arm_neon.h>
+#endif
+
+#if defined(__wasm_simd128__)
+#define MPCC_KERNELS_SIMD128 1
+#include <wasm_simd128.h>
+#endif
+
+namespace MPCC {
+
+/// @brief Result of a min/argmin scan. index is SIZE_MAX (and value infinity) when no finite candidate was
+/// found.
+struct ArgMin {
+    double value = std::numeric_limits<double>::infinity();
+    size_t index = SIZE_MAX;
+};
+
+/// @brief Windows with a standard deviation below this are treated as constant, matching stumpy. Their
+/// z-normalization is undefined, so by convention two constant windows are at distance 0 and a constant
+/// window is at distance sqrt(m) from any other window.
+inline constexpr double kFlatStdDevThreshold = 1e-7;
+
+namespace kernels {
+
+// Every kernel exists for double and float and has the same semantics across backends, up to floating-point
+// reassociation:
+//
+//  - dot:       sum of a[k] * b[k] for k in [0, m).
+//  - distances: out[i] = sqrt(2m * (1 - clamp(pearson_i, -1, 1))) with
+//               pearson_i = (dots[i] - m * mean[i] * mean_q) / (m * stddev[i] * std_q). Flat windows
+//               (stddev < kFlatStdDevThreshold) follow its convention instead: 0 when both the window and the
+//               query are flat, sqrt(m) when only one is. NaN (from non-finite data) propagates to the output,
+//               matching std::clamp.
+//  - argmin:    smallest value in values[begin, end) and its index. Ties go to the lowest index and NaN is
+//               never selected, matching a serial scan with a strict <.
+
+namespace scalar {
+
+template <class T>
+inline T dot(const T* a, const T* b, size_t m) {
+    T sum = 0;
+    for (size_t k = 0; k < m; k++) sum += a[k] * b[k];
+    return sum;
+}
+
+/// Distances for a flat query: 0 to flat windows and sqrt(m) to all others. Shared by every backend, since
+/// no dot products are involved.
+template <class T>
+inline void flatQueryDistances(const T* stddev, size_t count, size_t m, T* out) {
+    const T sqrt_m = std::sqrt(static_cast<T>(m));
+    const T flat   = static_cast<T>(kFlatStdDevThreshold);
+    for (size_t i = 0; i < count; i++) {
+        out[i] = (stddev[i] < flat) ? T(0) : (std::isnan(stddev[i]) ? stddev[i] : sqrt_m);
+    }
+}
+
+template <class T>
+inline void distances(
+    const T* dots, const T* mean, const T* stddev, size_t count,
+    size_t m, T mean_q, T std_q, T* out
+) {
+    const T flat = static_cast<T>(kFlatStdDevThreshold);
+    if (std_q < flat) return flatQueryDistances(stddev, count, m, out);
+
+    const T md     = static_cast<T>(m);
+    const T sqrt_m = std::sqrt(md);
+    for (size_t i = 0; i < count; i++) {
+        const T pearson = (dots[i] - md * mean[i] * mean_q) / (md * stddev[i] * std_q);
+        out[i] = (stddev[i] < flat) ? sqrt_m : std::sqrt(T(2) * md * (T(1) - std::clamp(pearson, T(-1), T(1))));
+    }
+}
+
+template <class T>
+inline ArgMin argmin(const T* values, size_t begin, size_t end) {
+    ArgMin best;
+    for (size_t j = begin; j < end; j++) {
+        if (values[j] < best.value) {
+            best.value = values[j];
+            best.index = j;
+        }
+    }
+    return best;
+}
+
+} // namespace scalar
+
+#if MPCC_KERNELS_X86
+
+namespace avx2 {
+
+__attribute__((target("avx2,fma")))
+inline double dot(const double* a, const double* b, size_t m) {
+    __m256d acc0 = _mm256_setzero_pd();
+    __m256d acc1 = _mm256_setzero_pd();
+    size_t k = 0;
+    for (; k + 8 <= m; k += 8) {
+        acc0 = _mm256_fmadd_pd(_mm256_loadu_pd(a + k),     _mm256_loadu_pd(b + k),     acc0);
+        acc1 = _mm256_fmadd_pd(_mm256_loadu_pd(a + k + 4), _mm256_loadu_pd(b + k + 4), acc1);
+    }
+    for (; k + 4 <= m; k += 4) {
+        acc0 = _mm256_fmadd_pd(_mm256_loadu_pd(a + k), _mm256_loadu_pd(b + k), acc0);
+    }
+    const __m256d acc  = _mm256_add_pd(acc0, acc1);
+    const __m128d half = _mm_add_pd(_mm256_castpd256_pd128(acc), _mm256_extractf128_pd(acc, 1));
+    double sum = _mm_cvtsd_f64(_mm_add_sd(half, _mm_unpackhi_pd(half, half)));
+    for (; k < m; k++) sum += a[k] * b[k];
+    return sum;
+}
+
+__attribute__((target("avx2,fma")))
+inline void distances(
+    const double* dots, const double* mean, const double* stddev, size_t count,
+    size_t m, double mean_q, double std_q, double* out
+) {
+    if (std_q < kFlatStdDevThreshold) return scalar::flatQueryDistances(stddev, count, m, out);
+
+    const double  md       = static_cast<double>(m);
+    const __m256d v_mq     = _mm256_set1_pd(md * mean_q);
+    const __m256d v_sq     = _mm256_set1_pd(md * std_q);
+    const __m256d v_two_m  = _mm256_set1_pd(2.0 * md);
+    const __m256d v_one    = _mm256_set1_pd(1.0);
+    const __m256d v_neg    = _mm256_set1_pd(-1.0);
+    const __m256d v_flat   = _mm256_set1_pd(kFlatStdDevThreshold);
+    const __m256d v_sqrt_m = _mm256_set1_pd(std::sqrt(md));
+
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        const __m256d sd      = _mm256_loadu_pd(stddev + i);
+        const __m256d num     = _mm256_fnmadd_pd(_mm256_loadu_pd(mean + i), v_mq, _mm256_loadu_pd(dots + i));
+        const __m256d den     = _mm256_mul_pd(sd, v_sq);
+        // max/min return their second operand when either is NaN, so NaN propagates as with std::clamp.
+        const __m256d pearson = _mm256_min_pd(v_one, _mm256_max_pd(v_neg, _mm256_div_pd(num, den)));
+        const __m256d d       = _mm256_sqrt_pd(_mm256_mul_pd(v_two_m, _mm256_sub_pd(v_one, pearson)));
+        const __m256d flat    = _mm256_cmp_pd(sd, v_flat, _CMP_LT_OQ);
+        _mm256_storeu_pd(out + i, _mm256_blendv_pd(d, v_sqrt_m, flat));
+    }
+    scalar::distances(dots + i, mean + i, stddev + i, count - i, m, mean_q, std_q, out + i);
+}
+
+__attribute__((target("avx2,fma")))
+inline ArgMin argmin(const double* values, size_t begin, size_t end) {
+    ArgMin best;
+    size_t j = begin;
+    if (end - begin >= 4) {
+        __m256d best_v = _mm256_set1_pd(std::numeric_limits<double>::infinity());
+        __m256i best_i = _mm256_set1_epi64x(-1);
+        __m256i idx    = _mm256_setr_epi64x(
+            static_cast<long long>(j), static_cast<long long>(j + 1),
+            static_cast<long long>(j + 2), static_cast<long long>(j + 3));
+        const __m256i step = _mm256_set1_epi64x(4);
+
+        for (; j + 4 <= end; j += 4) {
+            const __m256d v    = _mm256_loadu_pd(values + j);
+            const __m256d less = _mm256_cmp_pd(v, best_v, _CMP_LT_OQ);
+            best_v = _mm256_blendv_pd(best_v, v, less);
+            best_i = _mm256_blendv_epi8(best_i, idx, _mm256_castpd_si256(less));
+            idx    = _mm256_add_epi64(idx, step);
+        }
+
+        alignas(32) double    lane_v[4];
+        alignas(32) long long lane_i[4];
+        _mm256_store_pd(lane_v, best_v);
+        _mm256_store_si256(reinterpret_cast<__m256i*>(lane_i), best_i);
+        for (int lane = 0; lane < 4; lane++) {
+            if (lane_i[lane] < 0) continue;
+            const size_t index = static_cast<size_t>(lane_i[lane]);
+            if (lane_v[lane] < best.value || (lane_v[lane] == best.value && index < best.index)) {
+                best.value = lane_v[lane];
+                best.index = index;
+            }
+        }
+    }
+    const ArgMin tail = scalar::argmin(values, j, end);
+    if (tail.value < best.value) best = tail;
+    return best;
+}
+
+// Single precision: twice the lanes per register. argmin finds the minimum first and then the first index
+// holding it, which keeps lowest-index tie-breaking without carrying 64-bit indices through 32-bit lanes.
+
+__attribute__((target("avx2,fma")))
+inline float dot(const float* a, const float* b, size_t m) {
+    __m256 acc0 = _mm256_setzero_ps();
+    __m256 acc1 = _mm256_setzero_ps();
+    size_t k = 0;
+    for (; k + 16 <= m; k += 16) {
+        acc0 = _mm256_fmadd_ps(_mm256_loadu_ps(a + k),     _mm256_loadu_ps(b + k),     acc0);
+        acc1 = _mm256_fmadd_ps(_mm256_loadu_ps(a + k + 8), _mm256_loadu_ps(b + k + 8), acc1);
+    }
+    for (; k + 8 <= m; k += 8) {
+        acc0 = _mm256_fmadd_ps(_mm256_loadu_ps(a + k), _mm256_loadu_ps(b + k), acc0);
+    }
+    const __m256 acc  = _mm256_add_ps(acc0, acc1);
+    __m128       half = _mm_add_ps(_mm256_castps256_ps128(acc), _mm256_extractf128_ps(acc, 1));
+    half = _mm_add_ps(half, _mm_movehl_ps(half, half));
+    half = _mm_add_ss(half, _mm_shuffle_ps(half, half, 1));
+    float sum = _mm_cvtss_f32(half);
+    for (; k < m; k++) sum += a[k] * b[k];
+    return sum;
+}
+
+__attribute__((target("avx2,fma")))
+inline void distances(
+    const float* dots, const float* mean, const float* stddev, size_t count,
+    size_t m, float mean_q, float std_q, float* out
+) {
+    const float flat_threshold = static_cast<float>(kFlatStdDevThreshold);
+    if (std_q < flat_threshold) return scalar::flatQueryDistances(stddev, count, m, out);
+
+    const float  md       = static_cast<float>(m);
+    const __m256 v_mq     = _mm256_set1_ps(md * mean_q);
+    const __m256 v_sq     = _mm256_set1_ps(md * std_q);
+    const __m256 v_two_m  = _mm256_set1_ps(2.0f * md);
+    const __m256 v_one    = _mm256_set1_ps(1.0f);
+    const __m256 v_neg    = _mm256_set1_ps(-1.0f);
+    const __m256 v_flat   = _mm256_set1_ps(flat_threshold);
+    const __m256 v_sqrt_m = _mm256_set1_ps(std::sqrt(md));
+
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        const __m256 sd      = _mm256_loadu_ps(stddev + i);
+        const __m256 num     = _mm256_fnmadd_ps(_mm256_loadu_ps(mean + i), v_mq, _mm256_loadu_ps(dots + i));
+        const __m256 den     = _mm256_mul_ps(sd, v_sq);
+        const __m256 pearson = _mm256_min_ps(v_one, _mm256_max_ps(v_neg, _mm256_div_ps(num, den)));
+        const __m256 d       = _mm256_sqrt_ps(_mm256_mul_ps(v_two_m, _mm256_sub_ps(v_one, pearson)));
+        const __m256 flat    = _mm256_cmp_ps(sd, v_flat, _CMP_LT_OQ);
+        _mm256_storeu_ps(out + i, _mm256_blendv_ps(d, v_sqrt_m, flat));
+    }
+    scalar::distances(dots + i, mean + i, stddev + i, count - i, m, mean_q, std_q, out + i);
+}
+
+__attribute__((target("avx2,fma")))
+inline ArgMin argmin(const float* values, size_t begin, size_t end) {
+    if (end - begin < 8) return scalar::argmin(values, begin, end);
+
+    // min returns its second operand when either is NaN, so NaN never displaces the running minimum.
+    __m256 best_v = _mm256_set1_ps(std::numeric_limits<float>::infinity());
+    size_t j = begin;
+    for (; j + 8 <= end; j += 8) best_v = _mm256_min_ps(_mm256_loadu_ps(values + j), best_v);
+
+    alignas(32) float lane_v[8];
+    _mm256_store_ps(lane_v, best_v);
+    float min_v = std::numeric_limits<float>::infinity();
+    for (const float v : lane_v) min_v = std::min(min_v, v);
+    for (; j < end; j++) {
+        if (values[j] < min_v) min_v = values[j];
+    }
+    if (!(min_v < std::numeric_limits<float>::infinity())) return {};
+
+    const __m256 target = _mm256_set1_ps(min_v);
+    for (j = begin; j + 8 <= end; j += 8) {
+        const int hits = _mm256_movemask_ps(_mm256_cmp_ps(_mm256_loadu_ps(values + j), target, _CMP_EQ_OQ));
+        if (hits != 0) return {min_v, j + static_cast<size_t>(__builtin_ctz(static_cast<unsigned>(hits)))};
+    }
+    for (; j < end; j++) {
+        if (values[j] == min_v) return {min_v, j};
+    }
+    return {};
+}
+
+} // namespace avx2
+
+namespace avx512 {
+
+__attribute__((target("avx512f")))
+inline double dot(const double* a, const double* b, size_t m) {
+    __m512d acc0 = _mm512_setzero_pd();
+    __m512d acc1 = _mm512_setzero_pd();
+    size_t k = 0;
+    for (; k + 16 <= m; k += 16) {
+        acc0 = _mm512_fmadd_pd(_mm512_loadu_pd(a + k),     _mm512_loadu_pd(b + k),     acc0);
+        acc1 = _mm512_fmadd_pd(_mm512_loadu_pd(a + k + 8), _mm512_loadu_pd(b + k + 8), acc1);
+    }
+    for (; k + 8 <= m; k += 8) {
+        acc0 = _mm512_fmadd_pd(_mm512_loadu_pd(a + k), _mm512_loadu_pd(b + k), acc0);
+    }
+    double sum = _mm512_reduce_add_pd(_mm512_add_pd(acc0, acc1));
+    for (; k < m; k++) sum += a[k] * b[k];
+    return sum;
+}
+
+__attribute__((target("avx512f")))
+inline void distances(
+    const double* dots, const double* mean, const double* stddev, size_t count,
+    size_t m, double mean_q, double std_q, double* out
+) {
+    if (std_q < kFlatStdDevThreshold) return scalar::flatQueryDistances(stddev, count, m, out);
+
+    const double  md       = static_cast<double>(m);
+    const __m512d v_mq     = _mm512_set1_pd(md * mean_q);
+    const __m512d v_sq     = _mm512_set1_pd(md * std_q);
+    const __m512d v_two_m  = _mm512_set1_pd(2.0 * md);
+    const __m512d v_one    = _mm512_set1_pd(1.0);
+    const __m512d v_neg    = _mm512_set1_pd(-1.0);
+    const __m512d v_flat   = _mm512_set1_pd(kFlatStdDevThreshold);
+    const __m512d v_sqrt_m = _mm512_set1_pd(std::sqrt(md));
+
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        const __m512d  sd      = _mm512_loadu_pd(stddev + i);
+        const __m512d  num     = _mm512_fnmadd_pd(_mm512_loadu_pd(mean + i), v_mq, _mm512_loadu_pd(dots + i));
+        const __m512d  den     = _mm512_mul_pd(sd, v_sq);
+        const __m512d  pearson = _mm512_min_pd(v_one, _mm512_max_pd(v_neg, _mm512_div_pd(num, den)));
+        const __m512d  d       = _mm512_sqrt_pd(_mm512_mul_pd(v_two_m, _mm512_sub_pd(v_one, pearson)));
+        const __mmask8 flat    = _mm512_cmp_pd_mask(sd, v_flat, _CMP_LT_OQ);
+        _mm512_storeu_pd(out + i, _mm512_mask_blend_pd(flat, d, v_sqrt_m));
+    }
+    scalar::distances(dots + i, mean + i, stddev + i, count - i, m, mean_q, std_q, out + i);
+}
+
+__attribute__((target("avx512f")))
+inline ArgMin argmin(const double* values, size_t begin, size_t end) {
+    ArgMin best;
+    size_t j = begin;
+    if (end - begin >= 8) {
+        __m512d best_v = _mm512_set1_pd(std::numeric_limits<double>::infinity());
+        __m512i best_i = _mm512_set1_epi64(-1);
+        __m512i idx    = _mm512_add_epi64(_mm512_set1_epi64(static_cast<long long>(j)),
+                                          _mm512_setr_epi64(0, 1, 2, 3, 4, 5, 6, 7));
+        const __m512i step = _mm512_set1_epi64(8);
+
+        for (; j + 8 <= end; j += 8) {
+            const __m512d   v    = _mm512_loadu_pd(values + j);
+            const __mmask8  less = _mm512_cmp_pd_mask(v, best_v, _CMP_LT_OQ);
+            best_v = _mm512_mask_blend_pd(less, best_v, v);
+            best_i = _mm512_mask_blend_epi64(less, best_i, idx);
+            idx    = _mm512_add_epi64(idx, step);
+        }
+
+        alignas(64) double    lane_v[8];
+        alignas(64) long long lane_i[8];
+        _mm512_store_pd(lane_v, best_v);
+        _mm512_store_si512(lane_i, best_i);
+        for (int lane = 0; lane < 8; lane++) {
+            if (lane_i[lane] < 0) continue;
+            const size_t index = static_cast<size_t>(lane_i[lane]);
+            if (lane_v[lane] < best.value || (lane_v[lane] == best.value && index < best.index)) {
+                best.value = lane_v[lane];
+                best.index = index;
+            }
+        }
+    }
+    const ArgMin tail = scalar::argmin(values, j, end);
+    if (tail.value < best.value) best = tail;
+    return best;
+}
+
+__attribute__((target("avx512f")))
+inline float dot(const float* a, const float* b, size_t m) {
+    __m512 acc0 = _mm512_setzero_ps();
+    __m512 acc1 = _mm512_setzero_ps();
+    size_t k = 0;
+    for (; k + 32 <= m; k += 32) {
+        acc0 = _mm512_fmadd_ps(_mm512_loadu_ps(a + k),      _mm512_loadu_ps(b + k),      acc0);
+        acc1 = _mm512_fmadd_ps(_mm512_loadu_ps(a + k + 16), _mm512_loadu_ps(b + k + 16), acc1);
+    }
+    for (; k + 16 <= m; k += 16) {
+        acc0 = _mm512_fmadd_ps(_mm512_loadu_ps(a + k), _mm512_loadu_ps(b + k), acc0);
+    }
+    float sum = _mm512_reduce_add_ps(_mm512_add_ps(acc0, acc1));
+    for (; k < m; k++) sum += a[k] * b[k];
+    return sum;
+}
+
+__attribute__((target("avx512f")))
+inline void distances(
+    const float* dots, const float* mean, const float* stddev, size_t count,
+    size_t m, float mean_q, float std_q, float* out
+) {
+    const float flat_threshold = static_cast<float>(kFlatStdDevThreshold);
+    if (std_q < flat_threshold) return scalar::flatQueryDistances(stddev, count, m, out);
+
+    const float  md       = static_cast<float>(m);
+    const __m512 v_mq     = _mm512_set1_ps(md * mean_q);
+    const __m512 v_sq     = _mm512_set1_ps(md * std_q);
+    const __m512 v_two_m  = _mm512_set1_ps(2.0f * md);
+    const __m512 v_one    = _mm512_set1_ps(1.0f);
+    const __m512 v_neg    = _mm512_set1_ps(-1.0f);
+    const __m512 v_flat   = _mm512_set1_ps(flat_threshold);
+    const __m512 v_sqrt_m = _mm512_set1_ps(std::sqrt(md));
+
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        const __m512    sd      = _mm512_loadu_ps(stddev + i);
+        const __m512    num     = _mm512_fnmadd_ps(_mm512_loadu_ps(mean + i), v_mq, _mm512_loadu_ps(dots + i));
+        const __m512    den     = _mm512_mul_ps(sd, v_sq);
+        const __m512    pearson = _mm512_min_ps(v_one, _mm512_max_ps(v_neg, _mm512_div_ps(num, den)));
+        const __m512    d       = _mm512_sqrt_ps(_mm512_mul_ps(v_two_m, _mm512_sub_ps(v_one, pearson)));
+        const __mmask16 flat    = _mm512_cmp_ps_mask(sd, v_flat, _CMP_LT_OQ);
+        _mm512_storeu_ps(out + i, _mm512_mask_blend_ps(flat, d, v_sqrt_m));
+    }
+    scalar::distances(dots + i, mean + i, stddev + i, count - i, m, mean_q, std_q, out + i);
+}
+
+__attribute__((target("avx512f")))
+inline ArgMin argmin(const float* values, size_t begin, size_t end) {
+    if (end - begin < 16) return scalar::argmin(values, begin, end);
+
+    __m512 best_v = _mm512_set1_ps(std::numeric_limits<float>::infinity());
+    size_t j = begin;
+    for (; j + 16 <= end; j += 16) best_v = _mm512_min_ps(_mm512_loadu_ps(values + j), best_v);
+
+    float min_v = _mm512_reduce_min_ps(best_v);
+    for (; j < end; j++) {
+        if (values[j] < min_v) min_v = values[j];
+    }
+    if (!(min_v < std::numeric_limits<float>::infinity())) return {};
+
+    const __m512 target = _mm512_set1_ps(min_v);
+    for (j = begin; j + 16 <= end; j += 16) {
+        const __mmask16 hits = _mm512_cmp_ps_mask(_mm512_loadu_ps(values + j), target, _CMP_EQ_OQ);
+        if (hits != 0) return {min_v, j + static_cast<size_t>(__builtin_ctz(static_cast<unsigned>(hits)))};
+    }
+    for (; j < end; j++) {
+        if (values[j] == min_v) return {min_v, j};
+    }
+    return {};
+}
+
+} // namespace avx512
+
+#endif // MPCC_KERNELS_X86
+
+#if MPCC_KERNELS_NEON
+
+namespace neon {
+
+inline double dot(const double* a, const double* b, size_t m) {
+    float64x2_t acc0 = vdupq_n_f64(0.0);
+    float64x2_t acc1 = vdupq_n_f64(0.0);
+    size_t k = 0;
+    for (; k + 4 <= m; k += 4) {
+        acc0 = vfmaq_f64(acc0, vld1q_f64(a + k),     vld1q_f64(b + k));
+        acc1 = vfmaq_f64(acc1, vld1q_f64(a + k + 2), vld1q_f64(b + k + 2));
+    }
+    double sum = vaddvq_f64(vaddq_f64(acc0, acc1));
+    for (; k < m; k++) sum += a[k] * b[k];
+    return sum;
+}
+
+inline void distances(
+    const double* dots, const double* mean, const double* stddev, size_t count,
+    size_t m, double mean_q, double std_q, double* out
+) {
+    if (std_q < kFlatStdDevThreshold) return scalar::flatQueryDistances(stddev, count, m, out);
+
+    const double      md       = static_cast<double>(m);
+    const float64x2_t v_mq     = vdupq_n_f64(md * mean_q);
+    const float64x2_t v_sq     = vdupq_n_f64(md * std_q);
+    const float64x2_t v_two_m  = vdupq_n_f64(2.0 * md);
+    const float64x2_t v_one    = vdupq_n_f64(1.0);
+    const float64x2_t v_neg    = vdupq_n_f64(-1.0);
+    const float64x2_t v_flat   = vdupq_n_f64(kFlatStdDevThreshold);
+    const float64x2_t v_sqrt_m = vdupq_n_f64(std::sqrt(md));
+
+    size_t i = 0;
+    for (; i + 2 <= count; i += 2) {
+        const float64x2_t sd      = vld1q_f64(stddev + i);
+        const float64x2_t num     = vfmsq_f64(vld1q_f64(dots + i), vld1q_f64(mean + i), v_mq);
+        const float64x2_t den     = vmulq_f64(sd, v_sq);
+        // vmaxq/vminq propagate NaN, matching std::clamp.
+        const float64x2_t pearson = vminq_f64(v_one, vmaxq_f64(v_neg, vdivq_f64(num, den)));
+        const float64x2_t d       = vsqrtq_f64(vmulq_f64(v_two_m, vsubq_f64(v_one, pearson)));
+        vst1q_f64(out + i, vbslq_f64(vcltq_f64(sd, v_flat), v_sqrt_m, d));
+    }
+    scalar::distances(dots + i, mean + i, stddev + i, count - i, m, mean_q, std_q, out + i);
+}
+
+inline ArgMin argmin(const double* values, size_t begin, size_t end) {
+    ArgMin best;
+    size_t j = begin;
+    if (end - begin >= 2) {
+        float64x2_t best_v = vdupq_n_f64(std::numeric_limits<double>::infinity());
+        uint64x2_t  best_i = vdupq_n_u64(UINT64_MAX);
+        const uint64_t start[2] = {static_cast<uint64_t>(j), static_cast<uint64_t>(j + 1)};
+        uint64x2_t  idx    = vld1q_u64(start);
+        const uint64x2_t step = vdupq_n_u64(2);
+
+        for (; j + 2 <= end; j += 2) {
+            const float64x2_t v    = vld1q_f64(values + j);
+            const uint64x2_t  less = vcltq_f64(v, best_v);
+            best_v = vbslq_f64(less, v, best_v);
+            best_i = vbslq_u64(less, idx, best_i);
+            idx    = vaddq_u64(idx, step);
+        }
+
+        double   lane_v[2];
+        uint64_t lane_i[2];
+        vst1q_f64(lane_v, best_v);
+        vst1q_u64(lane_i, best_i);
+        for (int lane = 0; lane < 2; lane++) {
+            if (lane_i[lane] == UINT64_MAX) continue;
+            const size_t index = static_cast<size_t>(lane_i[lane]);
+            if (lane_v[lane] < best.value || (lane_v[lane] == best.value && index < best.index)) {
+                best.value = lane_v[lane];
+                best.index = index;
+            }
+        }
+    }
+    const ArgMin tail = scalar::argmin(values, j, end);
+    if (tail.value < best.value) best = tail;
+    return best;
+}
+
+inline float dot(const float* a, const float* b, size_t m) {
+    float32x4_t acc0 = vdupq_n_f32(0.0f);
+    float32x4_t acc1 = vdupq_n_f32(0.0f);
+    size_t k = 0;
+    for (; k + 8 <= m; k += 8) {
+        acc0 = vfmaq_f32(acc0, vld1q_f32(a + k),     vld1q_f32(b + k));
+        acc1 = vfmaq_f32(acc1, vld1q_f32(a + k + 4), vld1q_f32(b + k + 4));
+    }
+    float sum = vaddvq_f32(vaddq_f32(acc0, acc1));
+    for (; k < m; k++) sum += a[k] * b[k];
+    return sum;
+}
+
+inline void distances(
+    const float* dots, const float* mean, const float* stddev, size_t count,
+    size_t m, float mean_q, float std_q, float* out
+) {
+    const float flat_threshold = static_cast<float>(kFlatStdDevThreshold);
+    if (std_q < flat_threshold) return scalar::flatQueryDistances(stddev, count, m, out);
+
+    const float       md       = static_cast<float>(m);
+    const float32x4_t v_mq     = vdupq_n_f32(md * mean_q);
+    const float32x4_t v_sq     = vdupq_n_f32(md * std_q);
+    const float32x4_t v_two_m  = vdupq_n_f32(2.0f * md);
+    const float32x4_t v_one    = vdupq_n_f32(1.0f);
+    const float32x4_t v_neg    = vdupq_n_f32(-1.0f);
+    const float32x4_t v_flat   = vdupq_n_f32(flat_threshold);
+    const float32x4_t v_sqrt_m = vdupq_n_f32(std::sqrt(md));
+
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        const float32x4_t sd      = vld1q_f32(stddev + i);
+        const float32x4_t num     = vfmsq_f32(vld1q_f32(dots + i), vld1q_f32(mean + i), v_mq);
+        const float32x4_t den     = vmulq_f32(sd, v_sq);
+        const float32x4_t pearson = vminq_f32(v_one, vmaxq_f32(v_neg, vdivq_f32(num, den)));
+        const float32x4_t d       = vsqrtq_f32(vmulq_f32(v_two_m, vsubq_f32(v_one, pearson)));
+        vst1q_f32(out + i, vbslq_f32(vcltq_f32(sd, v_flat), v_sqrt_m, d));
+    }
+    scalar::distances(dots + i, mean + i, stddev + i, count - i, m, mean_q, std_q, out + i);
+}
+
+inline ArgMin argmin(const float* values, size_t begin, size_t end) {
+    if (end - begin < 4) return scalar::argmin(values, begin, end);
+
+    // vminnmq returns the number when one operand is NaN, so NaN never displaces the running minimum.
+    float32x4_t best_v = vdupq_n_f32(std::numeric_limits<float>::infinity());
+    size_t j = begin;
+    for (; j + 4 <= end; j += 4) best_v = vminnmq_f32(best_v, vld1q_f32(values + j));
+
+    float min_v = vminnmvq_f32(best_v);
+    for (; j < end; j++) {
+        if (values[j] < min_v) min_v = values[j];
+    }
+    if (!(min_v < std::numeric_limits<float>::infinity())) return {};
+
+    const float32x4_t target = vdupq_n_f32(min_v);
+    for (j = begin; j + 4 <= end; j += 4) {
+        if (vmaxvq_u32(vceqq_f32(vld1q_f32(values + j), target)) != 0) break;
+    }
+    for (; j < end; j++) {
+        if (values[j] == min_v) return {min_v, j};
+    }
+    return {};
+}
+
+} // namespace neon
+
+#endif // MPCC_KERNELS_NEON
+
+#if MPCC_KERNELS_SIMD128
+
+// WebAssembly SIMD128 has no fused multiply-add outside relaxed-simd, so products and sums are separate
+// instructions here.
+namespace simd128 {
+
+inline double dot(const double* a, const double* b, size_t m) {
+    v128_t acc0 = wasm_f64x2_splat(0.0);
+    v128_t acc1 = wasm_f64x2_splat(0.0);
+    size_t k = 0;
+    for (; k + 4 <= m; k += 4) {
+        acc0 = wasm_f64x2_add(acc0, wasm_f64x2_mul(wasm_v128_load(a + k),     wasm_v128_load(b + k)));
+        acc1 = wasm_f64x2_add(acc1, wasm_f64x2_mul(wasm_v128_load(a + k + 2), wasm_v128_load(b + k + 2)));
+    }
+    const v128_t acc = wasm_f64x2_add(acc0, acc1);
+    double sum = wasm_f64x2_extract_lane(acc, 0) + wasm_f64x2_extract_lane(acc, 1);
+    for (; k < m; k++) sum += a[k] * b[k];
+    return sum;
+}
+
+inline void distances(
+    const double* dots, const double* mean, const double* stddev, size_t count,
+    size_t m, double mean_q, double std_q, double* out
+) {
+    if (std_q < kFlatStdDevThreshold) return scalar::flatQueryDistances(stddev, count, m, out);
+
+    const double md       = static_cast<double>(m);
+    const v128_t v_mq     = wasm_f64x2_splat(md * mean_q);
+    const v128_t v_sq     = wasm_f64x2_splat(md * std_q);
+    const v128_t v_two_m  = wasm_f64x2_splat(2.0 * md);
+    const v128_t v_one    = wasm_f64x2_splat(1.0);
+    const v128_t v_neg    = wasm_f64x2_splat(-1.0);
+    const v128_t v_flat   = wasm_f64x2_splat(kFlatStdDevThreshold);
+    const v128_t v_sqrt_m = wasm_f64x2_splat(std::sqrt(md));
+
+    size_t i = 0;
+    for (; i + 2 <= count; i += 2) {
+        const v128_t sd      = wasm_v128_load(stddev + i);
+        const v128_t num     = wasm_f64x2_sub(wasm_v128_load(dots + i), wasm_f64x2_mul(wasm_v128_load(mean + i), v_mq));
+        const v128_t den     = wasm_f64x2_mul(sd, v_sq);
+        // f64x2.min/max propagate NaN, matching std::clamp.
+        const v128_t pearson = wasm_f64x2_min(v_one, wasm_f64x2_max(v_neg, wasm_f64x2_div(num, den)));
+        const v128_t d       = wasm_f64x2_sqrt(wasm_f64x2_mul(v_two_m, wasm_f64x2_sub(v_one, pearson)));
+        wasm_v128_store(out + i, wasm_v128_bitselect(v_sqrt_m, d, wasm_f64x2_lt(sd, v_flat)));
+    }
+    scalar::distances(dots + i, mean + i, stddev + i, count - i, m, mean_q, std_q, out + i);
+}
+
+inline ArgMin argmin(const double* values, size_t begin, size_t end) {
+    ArgMin best;
+    size_t j = begin;
+    if (end - begin >= 2) {
+        v128_t       best_v = wasm_f64x2_splat(std::numeric_limits<double>::infinity());
+        v128_t       best_i = wasm_i64x2_splat(-1);
+        v128_t       idx    = wasm_i64x2_make(static_cast<int64_t>(j), static_cast<int64_t>(j + 1));
+        const v128_t step   = wasm_i64x2_splat(2);
+
+        for (; j + 2 <= end; j += 2) {
+            const v128_t v    = wasm_v128_load(values + j);
+            const v128_t less = wasm_f64x2_lt(v, best_v);
+            best_v = wasm_v128_bitselect(v, best_v, less);
+            best_i = wasm_v128_bitselect(idx, best_i, less);
+            idx    = wasm_i64x2_add(idx, step);
+        }
+
+        const double  lane_v[2] = {wasm_f64x2_extract_lane(best_v, 0), wasm_f64x2_extract_lane(best_v, 1)};
+        const int64_t lane_i[2] = {wasm_i64x2_extract_lane(best_i, 0), wasm_i64x2_extract_lane(best_i, 1)};
+        for (int lane = 0; lane < 2; lane++) {
+            if (lane_i[lane] < 0) continue;
+            const size_t index = static_cast<size_t>(lane_i[lane]);
+            if (lane_v[lane] < best.value || (lane_v[lane] == best.value && index < best.index)) {
+                best.value = lane_v[lane];
+                best.index = index;
+            }
+        }
+    }
+    const ArgMin tail = scalar::argmin(values, j, end);
+    if (tail.value < best.value) best = tail;
+    return best;
+}
+
+inline float dot(const float* a, const float* b, size_t m) {
+    v128_t acc0 = wasm_f32x4_splat(0.0f);
+    v128_t acc1 = wasm_f32x4_splat(0.0f);
+    size_t k = 0;
+    for (; k + 8 <= m; k += 8) {
+        acc0 = wasm_f32x4_add(acc0, wasm_f32x4_mul(wasm_v128_load(a + k),     wasm_v128_load(b + k)));
+        acc1 = wasm_f32x4_add(acc1, wasm_f32x4_mul(wasm_v128_load(a + k + 4), wasm_v128_load(b + k + 4)));
+    }
+    const v128_t acc = wasm_f32x4_add(acc0, acc1);
+    float sum = (wasm_f32x4_extract_lane(acc, 0) + wasm_f32x4_extract_lane(acc, 1))
+              + (wasm_f32x4_extract_lane(acc, 2) + wasm_f32x4_extract_lane(acc, 3));
+    for (; k < m; k++) sum += a[k] * b[k];
+    return sum;
+}
+
+inline void distances(
+    const float* dots, const float* mean, const float* stddev, size_t count,
+    size_t m, float mean_q, float std_q, float* out
+) {
+    const float flat_threshold = static_cast<float>(kFlatStdDevThreshold);
+    if (std_q < flat_threshold) return scalar::flatQueryDistances(stddev, count, m, out);
+
+    const float  md       = static_cast<float>(m);
+    const v128_t v_mq     = wasm_f32x4_splat(md * mean_q);
+    const v128_t v_sq     = wasm_f32x4_splat(md * std_q);
+    const v128_t v_two_m  = wasm_f32x4_splat(2.0f * md);
+    const v128_t v_one    = wasm_f32x4_splat(1.0f);
+    const v128_t v_neg    = wasm_f32x4_splat(-1.0f);
+    const v128_t v_flat   = wasm_f32x4_splat(flat_threshold);
+    const v128_t v_sqrt_m = wasm_f32x4_splat(std::sqrt(md));
+
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        const v128_t sd      = wasm_v128_load(stddev + i);
+        const v128_t num     = wasm_f32x4_sub(wasm_v128_load(dots + i), wasm_f32x4_mul(wasm_v128_load(mean + i), v_mq));
+        const v128_t den     = wasm_f32x4_mul(sd, v_sq);
+        const v128_t pearson = wasm_f32x4_min(v_one, wasm_f32x4_max(v_neg, wasm_f32x4_div(num, den)));
+        const v128_t d       = wasm_f32x4_sqrt(wasm_f32x4_mul(v_two_m, wasm_f32x4_sub(v_one, pearson)));
+        wasm_v128_store(out + i, wasm_v128_bitselect(v_sqrt_m, d, wasm_f32x4_lt(sd, v_flat)));
+    }
+    scalar::distances(dots + i, mean + i, stddev + i, count - i, m, mean_q, std_q, out + i);
+}
+
+inline ArgMin argmin(const float* values, size_t begin, size_t end) {
+    if (end - begin < 4) return scalar::argmin(values, begin, end);
+
+    // pmin(a, b) is b < a ? b : a, so NaN never displaces the running minimum.
+    v128_t best_v = wasm_f32x4_splat(std::numeric_limits<float>::infinity());
+    size_t j = begin;
+    for (; j + 4 <= end; j += 4) best_v = wasm_f32x4_pmin(best_v, wasm_v128_load(values + j));
+
+    float min_v = std::min(std::min(wasm_f32x4_extract_lane(best_v, 0), wasm_f32x4_extract_lane(best_v, 1)),
+                           std::min(wasm_f32x4_extract_lane(best_v, 2), wasm_f32x4_extract_lane(best_v, 3)));
+    for (; j < end; j++) {
+        if (values[j] < min_v) min_v = values[j];
+    }
+    if (!(min_v < std::numeric_limits<float>::infinity())) return {};
+
+    const v128_t target = wasm_f32x4_splat(min_v);
+    for (j = begin; j + 4 <= end; j += 4) {
+        if (wasm_v128_any_true(wasm_f32x4_eq(wasm_v128_load(values + j), target))) break;
+    }
+    for (; j < end; j++) {
+        if (values[j] == min_v) return {min_v, j};
+    }
+    return {};
+}
+
+} // namespace simd128
+
+#endif // MPCC_KERNELS_SIMD128
+
+/// @brief The kernel implementations selected for the running CPU, for element type T (double or float).
+template <class T>
+struct KernelTable {
+    const char* name;
+    T      (*dot)(const T* a, const T* b, size_t m);
+    void   (*distances)(const T* dots, const T* mean, const T* stddev, size_t count,
+                        size_t m, T mean_q, T std_q, T* out);
+    ArgMin (*argmin)(const T* values, size_t begin, size_t end);
+};
+
+/// @brief Pick the widest instruction set the running CPU supports. On x86 this is decided at runtime, so
+/// one binary runs everywhere; NEON is mandatory on AArch64 and is selected at compile time, as is SIMD128
+/// for WebAssembly built with -msimd128 (engines without it refuse to load such a module at all).
+template <class T>
+inline KernelTable<T> selectKernels() {
+    static_assert(std::is_same_v<T, double> || std::is_same_v<T, float>, "kernels exist for double and float");
+#if MPCC_KERNELS_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) {
+        return {"avx512", &avx512::dot, &avx512::distances, &avx512::argmin};
+    }
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+        return {"avx2", &avx2::dot, &avx2::distances, &avx2::argmin};
+    }
+#endif
+#if MPCC_KERNELS_NEON
+    return {"neon", &neon::dot, &neon::distances, &neon::argmin};
+#endif
+#if MPCC_KERNELS_SIMD128
+    return {"simd128", &simd128::dot, &simd128::distances, &simd128::argmin};
+#endif
+    return {"scalar", &scalar::dot<T>, &scalar::distances<T>, &scalar::argmin<T>};
+}
+
+/// @brief The dispatch table for element type T, resolved once on first use.
+template <class T = double>
+inline const KernelTable<T>& active() {
+    static const KernelTable<T> table = selectKernels<T>();
+    return table;
+}
+
+} // namespace kernels
+
+/// @brief Name of the SIMD backend in use: "avx512", "avx2", "neon", "simd128", or "scalar".
+inline const char* simdBackend() {
+    return kernels::active().name;
+}
+
+} // namespace MPCC
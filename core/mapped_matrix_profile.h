@@ -0,0 +1,407 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "core/matrix_profile.h"
+
+// Out-of-core self-join over memory-mapped files (POSIX). The series, and the profile it produces, never
+// have to fit in memory: the input is read through a read-only mapping, the profile is written straight
+// into mapped output files, and every worker only holds a few tiles' worth of scratch.
+
+namespace MPCC {
+
+/// @brief Element format of a series file read by matrixProfileMapped.
+enum class MappedFormat {
+    Auto,     ///< .npy by content (the "\x93NUMPY" magic), otherwise raw float64.
+    Float64,  ///< Raw little-endian float64 values, no header.
+    Float32,  ///< Raw little-endian float32 values, no header.
+    Npy,      ///< A 1-D float64 or float32 .npy array in C order.
+};
+
+namespace detail {
+
+/// @brief Windows per side of the square tiles matrixProfileMapped processes. A tile reads two stretches of
+/// the series of kMappedTile + m - 1 values each, so a worker's scratch stays in L2 whatever the series
+/// length, and consecutive tiles touch consecutive pages of the mapping.
+constexpr size_t kMappedTile = 4096;
+
+/// @brief An mmap'ed file: read-only for inputs, read-write (created or truncated to size) for outputs.
+/// Unmapped and closed on destruction.
+class MappedFile {
+public:
+    MappedFile() = default;
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    ~MappedFile() { close(); }
+
+    bool openRead(const std::string& path) {
+        fd_ = ::open(path.c_str(), O_RDONLY);
+        if (fd_ < 0) return false;
+
+        struct stat st;
+        if (::fstat(fd_, &st) != 0) return false;
+        size_ = static_cast<size_t>(st.st_size);
+        if (size_ == 0) return true;
+
+        void* data = ::mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd_, 0);
+        if (data == MAP_FAILED) return false;
+        data_ = static_cast<char*>(data);
+        return true;
+    }
+
+    bool create(const std::string& path, size_t size) {
+        fd_ = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+        if (fd_ < 0) return false;
+        if (::ftruncate(fd_, static_cast<off_t>(size)) != 0) return false;
+        size_ = size;
+        if (size_ == 0) return true;
+
+        void* data = ::mmap(nullptr, size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+        if (data == MAP_FAILED) return false;
+        data_ = static_cast<char*>(data);
+        return true;
+    }
+
+    char*  data() const { return data_; }
+    size_t size() const { return size_; }
+
+private:
+    void close() {
+        if (data_) ::munmap(data_, size_);
+        if (fd_ >= 0) ::close(fd_);
+        data_ = nullptr;
+        fd_   = -1;
+    }
+
+    int    fd_   = -1;
+    char*  data_ = nullptr;
+    size_t size_ = 0;
+};
+
+/// @brief Where the values of a series file start, how many there are and whether they are float32.
+struct SeriesLayout {
+    size_t offset = 0;
+    size_t count  = 0;
+    bool   f32    = false;
+};
+
+inline constexpr std::string_view kNpyMagic = "\x93NUMPY";
+
+/// @brief Parse the header of a 1-D little-endian float64/float32 .npy file (format versions 1 to 3).
+inline bool parseNpyHeader(const char* data, size_t size, SeriesLayout& layout) {
+    if (size < 10 || std::string_view(data, kNpyMagic.size()) != kNpyMagic) return false;
+
+    const auto   major     = static_cast<uint8_t>(data[6]);
+    const size_t len_bytes = major == 1 ? 2 : 4;
+    if (major < 1 || major > 3 || size < 8 + len_bytes) return false;
+
+    size_t header_len = 0;
+    for (size_t b = 0; b < len_bytes; b++) {
+        header_len |= static_cast<size_t>(static_cast<uint8_t>(data[8 + b])) << (8 * b);
+    }
+    const size_t header_begin = 8 + len_bytes;
+    if (size < header_begin + header_len) return false;
+
+    const std::string_view header(data + header_begin, header_len);
+
+    // The header is a Python dict literal: {'descr': '<f8', 'fortran_order': False, 'shape': (n,), }
+    const auto value_of = [&](std::string_view key) -> std::string_view {
+        const size_t k = header.find(key);
+        if (k == std::string_view::npos) return {};
+        const size_t colon = header.find(':', k + key.size());
+        if (colon == std::string_view::npos) return {};
+        size_t begin = colon + 1;
+        while (begin < header.size() && header[begin] == ' ') begin++;
+        return header.substr(begin);
+    };
+
+    const std::string_view descr = value_of("'descr'");
+    if (descr.starts_with("'<f8'"))      layout.f32 = false;
+    else if (descr.starts_with("'<f4'")) layout.f32 = true;
+    else                                 return false;
+
+    if (value_of("'fortran_order'").starts_with("True")) return false;
+
+    const std::string_view shape = value_of("'shape'");
+    if (!shape.starts_with("(")) return false;
+    size_t pos = 1, count = 0, digits = 0;
+    while (pos < shape.size() && shape[pos] >= '0' && shape[pos] <= '9') {
+        count = count * 10 + static_cast<size_t>(shape[pos++] - '0');
+        digits++;
+    }
+    // Exactly one dimension: "(n,)" or "(n)".
+    if (digits == 0) return false;
+    if (pos < shape.size() && shape[pos] == ',') pos++;
+    while (pos < shape.size() && shape[pos] == ' ') pos++;
+    if (pos >= shape.size() || shape[pos] != ')') return false;
+
+    layout.offset = header_begin + header_len;
+    layout.count  = count;
+    return (size - layout.offset) / (layout.f32 ? sizeof(float) : sizeof(double)) >= count;
+}
+
+/// @brief A version 1.0 .npy header for a 1-D array of count values of type descr ("<f8", "<i8"), padded so
+/// that the data starts on a 64-byte boundary as the format requires.
+inline std::string npyHeader(const char* descr, size_t count) {
+    std::string dict = std::string("{'descr': '") + descr + "', 'fortran_order': False, 'shape': (" +
+                       std::to_string(count) + ",), }";
+    const size_t unpadded = 10 + dict.size() + 1;
+    dict.append((64 - unpadded % 64) % 64, ' ');
+    dict.push_back('\n');
+
+    std::string out(kNpyMagic);
+    out.push_back('\x01');
+    out.push_back('\x00');
+    out.push_back(static_cast<char>(dict.size() & 0xff));
+    out.push_back(static_cast<char>(dict.size() >> 8));
+    return out + dict;
+}
+
+/// @brief Create path as an output of count values of type V (double or int64_t), as .npy if the path ends in
+/// ".npy" and raw otherwise, and return a pointer to its values, or nullptr on failure.
+template <class V>
+V* createOutput(MappedFile& file, const std::string& path, size_t count) {
+    const bool        npy    = path.size() >= 4 && path.compare(path.size() - 4, 4, ".npy") == 0;
+    const std::string header = npy ? npyHeader(std::is_same_v<V, double> ? "<f8" : "<i8", count) : std::string();
+
+    if (!file.create(path, header.size() + count * sizeof(V))) return nullptr;
+    std::memcpy(file.data(), header.data(), header.size());
+    return reinterpret_cast<V*>(file.data() + header.size());
+}
+
+/// @brief Per-worker scratch of matrixProfileMapped: the two centered stretches of the series a tile reads,
+/// their window statistics, and the tile's best neighbor for each of its rows and columns.
+struct MappedTileScratch {
+    std::vector<double>  row, col;
+    std::vector<double>  row_mean, row_std, col_mean, col_std;
+    std::vector<double>  row_best, col_best;
+    std::vector<int64_t> row_best_j, col_best_j;
+};
+
+/// @brief Load the windows [begin, end) of the series (values [begin, end + m - 1)) into values as double,
+/// with their window statistics.
+template <class V>
+void loadTileSide(const V* series, size_t begin, size_t end, size_t m, std::vector<double>& values,
+                  std::vector<double>& mean, std::vector<double>& stddev) {
+    const size_t len = end - begin + m - 1;
+    values.resize(len);
+    for (size_t t = 0; t < len; t++) values[t] = static_cast<double>(series[begin + t]);
+
+    const auto values_xt = xt::adapt(values.data(), len, xt::no_ownership(), std::vector<size_t>{len});
+    const BasicSequenceStats<double> stats(values_xt, m);
+    mean.assign(stats.mean(m).begin(), stats.mean(m).end());
+    stddev.assign(stats.stddev(m).begin(), stats.stddev(m).end());
+}
+
+/// @brief Fold one tile's best neighbors for windows [begin, begin + best.size()) into the mapped profile.
+inline void mergeTileSide(const std::vector<double>& best, const std::vector<int64_t>& best_j, size_t begin,
+                          double* mp, int64_t* mpi) {
+    for (size_t x = 0; x < best.size(); x++) {
+        if (isBetterNeighbor(best[x], best_j[x], mp[begin + x], mpi[begin + x])) {
+            mp[begin + x]  = best[x];
+            mpi[begin + x] = best_j[x];
+        }
+    }
+}
+
+/// @brief The (row block, column block) of tile t of the upper triangle, numbered column block by column
+/// block: column block cb holds tiles cb * (cb + 1) / 2 ... cb * (cb + 1) / 2 + cb, one per row block rb <= cb.
+inline std::pair<size_t, size_t> upperTriangleTile(size_t t) {
+    // The floating-point root is exact to within one for any realistic tile count; the loops correct it.
+    auto cb = static_cast<size_t>((std::sqrt(8.0 * static_cast<double>(t) + 1.0) - 1.0) / 2.0);
+    while (cb * (cb + 1) / 2 > t) cb--;
+    while ((cb + 1) * (cb + 2) / 2 <= t) cb++;
+    return {t - cb * (cb + 1) / 2, cb};
+}
+
+/// @brief The self-join of the n values at series, tile by tile, into mp/mpi (profile_len values each).
+template <class V, class Exclusion>
+void mappedSelfJoin(const V* series, size_t n, size_t m, double* mp, int64_t* mpi, size_t num_threads,
+                    const ProgressCallback& progress, Exclusion exclusion) {
+    const size_t profile_len = n - m + 1;
+    const size_t first_diag  = exclusion.firstDiagonal(m);
+    const size_t num_blocks  = (profile_len + kMappedTile - 1) / kMappedTile;
+
+    std::fill(mp,  mp + profile_len,  std::numeric_limits<double>::infinity());
+    std::fill(mpi, mpi + profile_len, int64_t{-1});
+
+    const size_t num_workers = resolveThreadCount(num_threads);
+    std::vector<MappedTileScratch> scratch(num_workers);
+
+    // One lock per block of the output: tiles are merged into the profile under the locks of their row and
+    // column blocks. Merging is O(kMappedTile) against O(kMappedTile^2) work per tile, so they hardly contend.
+    std::vector<std::mutex> block_locks(num_blocks);
+
+    const auto& kern = kernels::active<double>();
+
+    // One task per tile of the upper triangle, decoded from the task index. A tile that lies wholly inside the
+    // exclusion zone has no diagonal to sweep and finishes at once.
+    parallelFor(num_blocks * (num_blocks + 1) / 2, num_workers, [&](size_t task, size_t worker) {
+        auto&      sc       = scratch[worker];
+        const auto [rb, cb] = upperTriangleTile(task);
+        const size_t r0 = rb * kMappedTile, r1 = std::min(r0 + kMappedTile, profile_len);
+        const size_t c0 = cb * kMappedTile, c1 = std::min(c0 + kMappedTile, profile_len);
+        if (c1 - 1 - r0 < first_diag) return;
+
+        loadTileSide(series, r0, r1, m, sc.row, sc.row_mean, sc.row_std);
+        if (rb == cb) {
+            sc.col = sc.row;
+            sc.col_mean = sc.row_mean;
+            sc.col_std = sc.row_std;
+        } else {
+            loadTileSide(series, c0, c1, m, sc.col, sc.col_mean, sc.col_std);
+        }
+
+        // Center both stretches on the row stretch's average window mean, as centerSeries does for the whole
+        // series: the distances do not change, and the dot products no longer cancel catastrophically.
+        double shift = 0.0;
+        for (const double mu : sc.row_mean) shift += mu;
+        shift /= static_cast<double>(sc.row_mean.size());
+        for (auto* side : {&sc.row, &sc.row_mean, &sc.col, &sc.col_mean}) {
+            for (double& v : *side) v -= shift;
+        }
+
+        sc.row_best.assign(r1 - r0, std::numeric_limits<double>::infinity());
+        sc.col_best.assign(c1 - c0, std::numeric_limits<double>::infinity());
+        sc.row_best_j.assign(r1 - r0, -1);
+        sc.col_best_j.assign(c1 - c0, -1);
+
+        // Diagonals j = i + k crossing the tile, outside the exclusion zone. The dot product of the first cell
+        // is computed directly and carried along the diagonal in O(1) per cell.
+        const double* a = sc.row.data();
+        const double* b = sc.col.data();
+        const size_t  k_begin = std::max(first_diag, c0 > r1 - 1 ? c0 - (r1 - 1) : size_t{0});
+        for (size_t k = k_begin; k <= c1 - 1 - r0; k++) {
+            const size_t i_begin = std::max(r0, c0 > k ? c0 - k : size_t{0});
+            const size_t i_end   = std::min(r1, c1 - k);
+            if (i_begin >= i_end) continue;
+
+            double dot = kern.dot(a + (i_begin - r0), b + (i_begin + k - c0), m);
+            for (size_t i = i_begin; i < i_end; i++) {
+                const size_t x = i - r0;
+                const size_t y = i + k - c0;
+                if (i > i_begin) dot += a[x + m - 1] * b[y + m - 1] - a[x - 1] * b[y - 1];
+
+                const double d =
+                    zNormalizedDistance(dot, m, sc.row_mean[x], sc.row_std[x], sc.col_mean[y], sc.col_std[y]);
+                const auto   j = static_cast<int64_t>(i + k);
+                if (isBetterNeighbor(d, j, sc.row_best[x], sc.row_best_j[x])) {
+                    sc.row_best[x]   = d;
+                    sc.row_best_j[x] = j;
+                }
+                if (isBetterNeighbor(d, static_cast<int64_t>(i), sc.col_best[y], sc.col_best_j[y])) {
+                    sc.col_best[y]   = d;
+                    sc.col_best_j[y] = static_cast<int64_t>(i);
+                }
+            }
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(block_locks[rb]);
+            mergeTileSide(sc.row_best, sc.row_best_j, r0, mp, mpi);
+        }
+        {
+            std::lock_guard<std::mutex> lock(block_locks[cb]);
+            mergeTileSide(sc.col_best, sc.col_best_j, c0, mp, mpi);
+        }
+    }, progress);
+}
+
+} // namespace detail
+
+/// @brief Compute the self-join matrix profile of a series stored in a file, without loading either the
+/// series or the profile into memory. The input file is memory-mapped read-only and the profile is written
+/// through writable mappings of mp_path (float64 distances) and mpi_path (int64 indices). An output whose
+/// path ends in ".npy" gets a .npy header, so np.load(path, mmap_mode="r") opens it in place; any other path
+/// is written raw.
+///
+/// The distance matrix is processed in square tiles of detail::kMappedTile windows, upper triangle only:
+/// each tile copies the two stretches of the series it spans into per-worker scratch (converting float32 to
+/// double), computes their window statistics, sweeps its diagonals with the O(1) dot-product update of
+/// matrixProfileDiagonal, and merges its best neighbors into the mapped profile. Memory use is thus
+/// O(num_threads * kMappedTile) beyond the mappings, which the OS pages in and out as tiles move along the
+/// series. Results match matrixProfileDiagonal with the same exclusion policy (ties to the lowest index) up
+/// to floating-point rounding, and are identical for every thread count.
+///
+/// @param sequence_path  The series: raw float64/float32 values or a 1-D .npy array (see MappedFormat).
+/// @param m              Subsequence length.
+/// @param mp_path        Output distances, created or truncated to n-m+1 float64 values.
+/// @param mpi_path       Output indices, created or truncated to n-m+1 int64 values (-1 where no neighbor
+///                       outside the exclusion zone exists).
+/// @param format         How to read sequence_path.
+/// @param num_threads    Worker threads (0 for one per hardware thread).
+/// @param progress       Optional progress(done, total) callback counting finished tiles.
+/// @param exclusion      Exclusion-zone policy (see QuarterExclusion): tiles sweep only the diagonals from
+///                       its first diagonal on, and skip tiles that lie wholly inside the zone.
+/// @return FileError if a file cannot be opened, created or mapped, UnsupportedFileFormat if the input is
+///         not a series in the given format.
+template <class Exclusion = QuarterExclusion>
+MatrixProfileStatus matrixProfileMapped(
+    const std::string& sequence_path,
+    size_t m,
+    const std::string& mp_path,
+    const std::string& mpi_path,
+    MappedFormat format = MappedFormat::Auto,
+    size_t num_threads = 1,
+    const ProgressCallback& progress = {},
+    Exclusion exclusion = {}
+) {
+    detail::MappedFile input;
+    if (!input.openRead(sequence_path)) return MatrixProfileStatus::FileError;
+
+    const char*  data = input.data();
+    const size_t size = input.size();
+    const bool   is_npy = size >= detail::kNpyMagic.size() &&
+                          std::string_view(data, detail::kNpyMagic.size()) == detail::kNpyMagic;
+
+    detail::SeriesLayout layout;
+    if (format == MappedFormat::Npy || (format == MappedFormat::Auto && is_npy)) {
+        if (!detail::parseNpyHeader(data, size, layout)) return MatrixProfileStatus::UnsupportedFileFormat;
+    } else {
+        layout.f32   = format == MappedFormat::Float32;
+        layout.count = size / (layout.f32 ? sizeof(float) : sizeof(double));
+        const size_t value_size = layout.f32 ? sizeof(float) : sizeof(double);
+        if (size % value_size != 0) return MatrixProfileStatus::UnsupportedFileFormat;
+    }
+
+    const size_t n = layout.count;
+    if (m == 0) return MatrixProfileStatus::SubsequenceLengthZero;
+    if (m > n)  return MatrixProfileStatus::SubsequenceLongerThanSequence;
+
+    const size_t profile_len = n - m + 1;
+
+    detail::MappedFile mp_file, mpi_file;
+    double*  mp  = detail::createOutput<double>(mp_file, mp_path, profile_len);
+    int64_t* mpi = detail::createOutput<int64_t>(mpi_file, mpi_path, profile_len);
+    if (!mp || !mpi) return MatrixProfileStatus::FileError;
+
+    // The values of a .npy file start after its header, which need not leave them aligned for V.
+    if (layout.f32) {
+        if (layout.offset % alignof(float) != 0) return MatrixProfileStatus::UnsupportedFileFormat;
+        const auto* series = reinterpret_cast<const float*>(data + layout.offset);
+        detail::mappedSelfJoin(series, n, m, mp, mpi, num_threads, progress, exclusion);
+    } else {
+        if (layout.offset % alignof(double) != 0) return MatrixProfileStatus::UnsupportedFileFormat;
+        const auto* series = reinterpret_cast<const double*>(data + layout.offset);
+        detail::mappedSelfJoin(series, n, m, mp, mpi, num_threads, progress, exclusion);
+    }
+
+    return MatrixProfileStatus::Success;
+}
+
+} // namespace MPCC
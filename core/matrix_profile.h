@@ -1,12 +1,25 @@
 #pragma once
 
 #include <algorithm>
+#include <atomic>
 #include <cmath>
 #include <limits>
+#include <queue>
+#include <span>
+#include <type_traits>
+#include <utility>
+#include <vector>
 #include <xtensor/containers/xadapt.hpp>
 #include <xtensor/containers/xtensor.hpp>
 #include <xtensor/views/xview.hpp>
 
+#include "core/fft.h"
+#include "core/instrumentation.h"
+#include "core/kernels.h"
+#include "core/sequence_stats.h"
+#include "core/thread_pool.h"
+#include "core/workspace.h"
+
 namespace MPCC {
 
 enum class SimilaritySearchStatus {
@@ -16,8 +29,268 @@ enum class SimilaritySearchStatus {
     DistanceNotOneDimensional,
     QueryLongerThanSequence,
     DistanceWrongSize,
+    StatsMismatch,
+    QueriesNotTwoDimensional,
+    DistanceNotTwoDimensional,
+    IndexNotOneDimensional,
+    IndexWrongSize,
+};
+
+namespace detail {
+
+/// @brief Element type the routines compute in for expression E: float sequences are
+/// processed in single precision, everything else (double, integers) in double.
+template <class E>
+using compute_t = std::conditional_t<
+    std::is_same_v<std::remove_cv_t<typename std::decay_t<E>::value_type>, float>, float, double>;
+
+/// @brief Window statistics matching the compute type of expression E.
+template <class E>
+using StatsFor = BasicSequenceStats<compute_t<E>>;
+
+/// @brief StatsFor<S>(sequence, m), timed by instr as Phase::Stats.
+template <class S, class Instr>
+StatsFor<S> timedStats(const xt::xexpression<S>& sequence, size_t m, const Instr& instr) {
+    const auto timer = instr.phase(Phase::Stats, 0, /*trace=*/true);
+    return StatsFor<S>(sequence, m);
+}
+
+/// @brief run(stats) with the window statistics of sequence for length m, timed by instr as Phase::Stats.
+/// With a workspace they are computed into its statistics for series (0, or 1 for the second series of an
+/// AB-join), reusing their storage; otherwise into a temporary.
+template <class S, class Instr, class Run>
+auto withStats(const xt::xexpression<S>& sequence, size_t m, const Instr& instr, Workspace* workspace, size_t series,
+               Run&& run) {
+    if (!workspace) return run(timedStats(sequence, m, instr));
+
+    auto& stats = workspace->stats<compute_t<S>>(series);
+    {
+        const auto timer = instr.phase(Phase::Stats, 0, /*trace=*/true);
+        stats.assign(sequence, m);
+    }
+    return run(std::as_const(stats));
+}
+
+/// @brief Z-normalized Euclidean distance between two windows of length m given their dot product and
+/// statistics. The Pearson correlation is clamped to [-1, 1] to guard against floating-point rounding, and
+/// flat windows follow the kFlatStdDevThreshold convention of the distance kernels.
+inline double zNormalizedDistance(double dot, size_t m, double mean_a, double std_a, double mean_b, double std_b) {
+    const bool flat_a = std_a < kFlatStdDevThreshold;
+    const bool flat_b = std_b < kFlatStdDevThreshold;
+    if (flat_a || flat_b) return (flat_a && flat_b) ? 0.0 : std::sqrt(static_cast<double>(m));
+
+    const double pearson = (dot - static_cast<double>(m) * mean_a * mean_b)
+                         / (static_cast<double>(m) * std_a * std_b);
+    return std::sqrt(2.0 * static_cast<double>(m) * (1.0 - std::clamp(pearson, -1.0, 1.0)));
+}
+
+/// @brief Pointer to the elements of a 1-D expression as contiguous values of type T. Expressions that
+/// already store contiguous T (containers, adaptors, unit-stride views) are used in place; anything else is
+/// converted into scratch.
+template <class E, class T>
+const T* contiguousData(const E& e, std::vector<T>& scratch) {
+    using value_type = std::remove_cv_t<typename E::value_type>;
+    if constexpr (xt::has_data_interface<E>::value && std::is_same_v<value_type, T>) {
+        if (e.size() <= 1 || e.strides()[0] == 1) return e.data() + e.data_offset();
+    }
+    scratch.resize(e.size());
+    for (size_t i = 0; i < e.size(); i++) scratch[i] = static_cast<T>(e(i));
+    return scratch.data();
+}
+
+/// @brief contiguousData converting into the workspace buffer slot instead of a vector.
+template <class T, class E>
+const T* contiguousData(const E& e, Workspace& workspace, WorkspaceSlot slot) {
+    using value_type = std::remove_cv_t<typename E::value_type>;
+    if constexpr (xt::has_data_interface<E>::value && std::is_same_v<value_type, T>) {
+        if (e.size() <= 1 || e.strides()[0] == 1) return e.data() + e.data_offset();
+    }
+    T* scratch = workspace.buffer<T>(slot, e.size());
+    for (size_t i = 0; i < e.size(); i++) scratch[i] = static_cast<T>(e(i));
+    return scratch;
+}
+
+/// @brief Writable counterpart of contiguousData. Returns the expression's own storage when it is contiguous
+/// T, otherwise a scratch buffer of the right size that writeBack copies out afterwards.
+template <class E, class T>
+T* writableContiguousData(E& e, std::vector<T>& scratch) {
+    using value_type = std::remove_cv_t<typename E::value_type>;
+    if constexpr (xt::has_data_interface<E>::value && std::is_same_v<value_type, T>) {
+        if constexpr (!std::is_const_v<std::remove_pointer_t<decltype(e.data())>>) {
+            if (e.size() <= 1 || e.strides()[0] == 1) return e.data() + e.data_offset();
+        }
+    }
+    scratch.resize(e.size());
+    return scratch.data();
+}
+
+/// @brief Copy the results back into e if writableContiguousData had to hand out scratch.
+template <class E, class T>
+void writeBack(E& e, const T* data, const std::vector<T>& scratch) {
+    if (scratch.empty() || data != scratch.data()) return;
+    for (size_t i = 0; i < e.size(); i++) e(i) = scratch[i];
+}
+
+/// @brief A query with its mean removed, as searched by the similarity searches.
+template <class T>
+struct CenteredQuery {
+    std::vector<T> values;  ///< qry - offset, converted to T.
+    double         offset;  ///< The mean that was subtracted.
+    T              mean;    ///< Mean of values (zero up to rounding).
+    T              stddev;  ///< Population standard deviation of the query.
+};
+
+/// @brief The statistics of a query centered into caller-provided storage (see centerQuery).
+template <class T>
+struct QueryMoments {
+    double offset;
+    T      mean;
+    T      stddev;
 };
 
+/// @brief Center the m query values at(0) ... at(m - 1) into values. Dot products against a centered query no
+/// longer carry the query's offset, so the Pearson numerator dot - m * mean_s * mean_q does not cancel two
+/// huge terms when the data sits far from zero. The statistics are accumulated in double whatever T is.
+template <class T, class At>
+QueryMoments<T> centerQuery(At&& at, size_t m, T* values) {
+    QueryMoments<T> out;
+    double m2 = 0.0;
+    windowMeanM2([&at](size_t k) { return static_cast<double>(at(k)); }, 0, m, out.offset, m2);
+
+    double residual = 0.0;
+    for (size_t k = 0; k < m; k++) {
+        values[k] = static_cast<T>(at(k) - out.offset);
+        residual += values[k];
+    }
+    out.mean   = static_cast<T>(residual / static_cast<double>(m));
+    out.stddev = static_cast<T>(std::sqrt(m2 / static_cast<double>(m)));
+    return out;
+}
+
+/// @brief Center qry on its mean; see the overload above.
+template <class T, class Q>
+CenteredQuery<T> centerQuery(const Q& qry) {
+    CenteredQuery<T> out;
+    out.values.resize(qry.size());
+    const auto moments = centerQuery([&qry](size_t k) { return qry(k); }, qry.size(), out.values.data());
+    out.offset = moments.offset;
+    out.mean   = moments.mean;
+    out.stddev = moments.stddev;
+    return out;
+}
+
+/// @brief A series shifted by a constant, with its window means shifted to match. Z-normalized distances do
+/// not change when the whole series is shifted, but dot products between windows of a series with a large
+/// offset cancel catastrophically in the Pearson correlation; centering the series first avoids that.
+template <class T>
+struct CenteredSeries {
+    std::vector<T> values;
+    std::vector<T> mean;
+};
+
+/// @brief Center seq on the average of its window means into storage for seq.size() values and mean.size()
+/// means. The shift is applied in double before converting to T. instr times it as Phase::Centering.
+template <class T, class S, class Instr = NoInstrumentation>
+void centerSeries(const S& seq, std::span<const T> mean, T* values, T* shifted_mean, const Instr& instr = {}) {
+    const auto timer = instr.phase(Phase::Centering, 0, /*trace=*/true);
+
+    double shift = 0.0;
+    for (const T mu : mean) shift += mu;
+    shift /= static_cast<double>(mean.size());
+
+    for (size_t i = 0; i < seq.size(); i++)  values[i]       = static_cast<T>(seq(i) - shift);
+    for (size_t i = 0; i < mean.size(); i++) shifted_mean[i] = static_cast<T>(mean[i] - shift);
+}
+
+/// @brief centerSeries into a CenteredSeries.
+template <class T, class S, class Instr = NoInstrumentation>
+CenteredSeries<T> centerSeries(const S& seq, std::span<const T> mean, const Instr& instr = {}) {
+    CenteredSeries<T> out;
+    out.values.resize(seq.size());
+    out.mean.resize(mean.size());
+    centerSeries(seq, mean, out.values.data(), out.mean.data(), instr);
+    return out;
+}
+
+/// @brief A centered series in workspace buffers.
+template <class T>
+struct CenteredView {
+    const T* values;
+    const T* mean;
+};
+
+/// @brief centerSeries into the workspace buffers values_slot and mean_slot.
+template <class T, class S, class Instr = NoInstrumentation>
+CenteredView<T> centerSeries(const S& seq, std::span<const T> mean, Workspace& workspace, WorkspaceSlot values_slot,
+                             WorkspaceSlot mean_slot, const Instr& instr = {}) {
+    T* values       = workspace.buffer<T>(values_slot, seq.size());
+    T* shifted_mean = workspace.buffer<T>(mean_slot, mean.size());
+    centerSeries(seq, mean, values, shifted_mean, instr);
+    return {values, shifted_mean};
+}
+
+} // namespace detail
+
+/// @brief Run a similarity search for the provided query on the provided sequence, using precomputed
+/// window statistics of the sequence. stats must hold the statistics of sequence for subsequence length
+/// query.size(), otherwise StatsMismatch is returned. The distance profile of the query is set in distance.
+///
+/// Float sequences are searched in single precision (see detail::compute_t) with SequenceStatsF32, which
+/// halves the memory traffic and doubles the SIMD width; everything else is searched in double.
+template <class S, class Q, class D, class T, class Acc>
+SimilaritySearchStatus similaritySearch(
+    const xt::xexpression<S>& sequence,
+    const xt::xexpression<Q>& query,
+    const BasicSequenceStats<T, Acc>& stats,
+    xt::xexpression<D>& distance
+) {
+    // Ensure the inputs are one-dimensional at compile time, if possible.
+    static_assert(xt::get_rank<S>::value == 1 || xt::get_rank<S>::value == SIZE_MAX, "sequence must be 1-dimensional");
+    static_assert(xt::get_rank<Q>::value == 1 || xt::get_rank<Q>::value == SIZE_MAX, "query must be 1-dimensional");
+    static_assert(xt::get_rank<D>::value == 1 || xt::get_rank<D>::value == SIZE_MAX, "distance must be 1-dimensional");
+    static_assert(std::is_same_v<T, detail::compute_t<S>>, "stats must match the precision of the sequence");
+
+    const auto& seq  = sequence.derived_cast();
+    const auto& qry  = query.derived_cast();
+    auto&       dist = distance.derived_cast();
+
+    // Check the dimesnions at runtime if required, and also assert the sizes line up
+    if (seq.dimension() != 1)  return SimilaritySearchStatus::SequenceNotOneDimensional;
+    if (qry.dimension() != 1)  return SimilaritySearchStatus::QueryNotOneDimensional;
+    if (dist.dimension() != 1) return SimilaritySearchStatus::DistanceNotOneDimensional;
+    if (qry.size() > seq.size()) return SimilaritySearchStatus::QueryLongerThanSequence;
+    if (!stats.matches(seq.size(), qry.size())) return SimilaritySearchStatus::StatsMismatch;
+    if (dist.size() != seq.size() - qry.size() + 1) return SimilaritySearchStatus::DistanceWrongSize;
+
+    const size_t m           = qry.size();
+    const size_t profile_len = seq.size() - m + 1;
+
+    const auto& kern = kernels::active<T>();
+
+    // The SIMD kernels need contiguous storage. Most callers pass contiguous arrays, which are used in place;
+    // anything else is gathered into scratch first.
+    std::vector<T> seq_buf, dist_buf;
+    const T* s   = detail::contiguousData(seq, seq_buf);
+    T*       out = detail::writableContiguousData(dist, dist_buf);
+
+    // The query is searched with its mean removed (constant across all windows).
+    const auto q = detail::centerQuery<T>(qry);
+
+    const T* mean_s = stats.mean(m).data();
+    const T* std_s  = stats.stddev(m).data();
+
+    // Dot product of every window with the query, staged in the output buffer and then converted in place to
+    // z-normalized Euclidean distances via the Pearson correlation.
+    for (size_t i = 0; i < profile_len; i++) {
+        out[i] = kern.dot(s + i, q.values.data(), m);
+    }
+    kern.distances(out, mean_s, std_s, profile_len, m, q.mean, q.stddev, out);
+
+    detail::writeBack(dist, out, dist_buf);
+
+    return SimilaritySearchStatus::Success;
+}
+
 /// @brief Run a similarity search for the provided query on the provided sequence. The distance profile
 /// of the query is set in distance.
 template <class S, class Q, class D>
@@ -26,60 +299,433 @@ SimilaritySearchStatus similaritySearch(
     const xt::xexpression<Q>& query,
     xt::xexpression<D>& distance
 ) {
-    // Ensure the inputs are one-dimensional at compile time, if possible.
+    return similaritySearch(sequence, query, detail::StatsFor<S>(sequence, query.derived_cast().size()), distance);
+}
+
+/// @brief Run a similarity search using MASS (Mueen's Algorithm for Similarity Search). All sliding dot
+/// products come from a single FFT convolution, so the cost is O(n log n) regardless of the query length,
+/// versus O(n * m) for similaritySearch. The distance profile is set in distance, with the same contract
+/// and status codes as similaritySearch. The convolution always runs in double; float sequences only
+/// convert the products to single precision for the distance kernel.
+template <class S, class Q, class D, class T, class Acc>
+SimilaritySearchStatus similaritySearchMass(
+    const xt::xexpression<S>& sequence,
+    const xt::xexpression<Q>& query,
+    const BasicSequenceStats<T, Acc>& stats,
+    xt::xexpression<D>& distance
+) {
     static_assert(xt::get_rank<S>::value == 1 || xt::get_rank<S>::value == SIZE_MAX, "sequence must be 1-dimensional");
     static_assert(xt::get_rank<Q>::value == 1 || xt::get_rank<Q>::value == SIZE_MAX, "query must be 1-dimensional");
     static_assert(xt::get_rank<D>::value == 1 || xt::get_rank<D>::value == SIZE_MAX, "distance must be 1-dimensional");
+    static_assert(std::is_same_v<T, detail::compute_t<S>>, "stats must match the precision of the sequence");
 
     const auto& seq  = sequence.derived_cast();
     const auto& qry  = query.derived_cast();
     auto&       dist = distance.derived_cast();
 
-    // Check the dimesnions at runtime if required, and also assert the sizes line up
     if (seq.dimension() != 1)  return SimilaritySearchStatus::SequenceNotOneDimensional;
     if (qry.dimension() != 1)  return SimilaritySearchStatus::QueryNotOneDimensional;
     if (dist.dimension() != 1) return SimilaritySearchStatus::DistanceNotOneDimensional;
     if (qry.size() > seq.size()) return SimilaritySearchStatus::QueryLongerThanSequence;
+    if (!stats.matches(seq.size(), qry.size())) return SimilaritySearchStatus::StatsMismatch;
     if (dist.size() != seq.size() - qry.size() + 1) return SimilaritySearchStatus::DistanceWrongSize;
 
     const size_t m = qry.size();
-    const size_t n = seq.size();
 
-    // Pre-compute query mean and std deviation (constant across all windows).
-    const double mean_q = xt::mean(qry)();
-    const double std_q  = std::sqrt(xt::variance(qry)());
+    auto q = detail::centerQuery<T>(qry);
+
+    // Convolve with the sequence shifted to the query's level, so the FFT rounding error scales with the
+    // spread of the data rather than its offset, then add the shift's contribution back to each product.
+    const double shift = q.offset;
+    std::vector<double> dots;
+    const auto q_xt = xt::adapt(q.values.data(), m, xt::no_ownership(), std::vector<size_t>{m});
+    detail::slidingDotProductFft(seq, q_xt, dots, shift);
+
+    const double shift_term = shift * static_cast<double>(q.mean) * static_cast<double>(m);
+    std::vector<T> prod;
+    if constexpr (std::is_same_v<T, double>) {
+        for (double& d : dots) d += shift_term;
+        prod = std::move(dots);
+    } else {
+        prod.resize(dots.size());
+        for (size_t i = 0; i < dots.size(); i++) prod[i] = static_cast<T>(dots[i] + shift_term);
+    }
+
+    std::vector<T> dist_buf;
+    T* out = detail::writableContiguousData(dist, dist_buf);
+    kernels::active<T>().distances(prod.data(), stats.mean(m).data(), stats.stddev(m).data(), prod.size(), m,
+                                   q.mean, q.stddev, out);
+    detail::writeBack(dist, out, dist_buf);
+
+    return SimilaritySearchStatus::Success;
+}
+
+/// @brief MASS similarity search without precomputed statistics; see the overload above.
+template <class S, class Q, class D>
+SimilaritySearchStatus similaritySearchMass(
+    const xt::xexpression<S>& sequence,
+    const xt::xexpression<Q>& query,
+    xt::xexpression<D>& distance
+) {
+    return similaritySearchMass(sequence, query, detail::StatsFor<S>(sequence, query.derived_cast().size()), distance);
+}
+
+/// @brief Heuristic for whether MASS beats the direct similarity search for a sequence of length n and query
+/// of length m. The direct search costs ~n * m multiply-adds while the FFT path costs a small constant times
+/// N log2 N for the padded length N, so MASS wins once the query is longer than a few multiples of log2 N.
+inline bool preferMass(size_t n, size_t m) {
+    constexpr size_t kFftCostFactor = 8;
+
+    size_t log2_n = 0;
+    for (size_t p = detail::nextPowerOfTwo(n); p > 1; p >>= 1) log2_n++;
+
+    return m > kFftCostFactor * log2_n;
+}
+
+/// @brief Run a similarity search, picking between the direct (similaritySearch) and FFT-based
+/// (similaritySearchMass) implementations based on preferMass.
+template <class S, class Q, class D>
+SimilaritySearchStatus similaritySearchAuto(
+    const xt::xexpression<S>& sequence,
+    const xt::xexpression<Q>& query,
+    xt::xexpression<D>& distance
+) {
+    const size_t n = sequence.derived_cast().size();
+    const size_t m = query.derived_cast().size();
+
+    if (m <= n && preferMass(n, m)) {
+        return similaritySearchMass(sequence, query, distance);
+    }
+    return similaritySearch(sequence, query, distance);
+}
+
+/// @brief similaritySearchAuto with precomputed statistics of the sequence.
+template <class S, class Q, class D, class T, class Acc>
+SimilaritySearchStatus similaritySearchAuto(
+    const xt::xexpression<S>& sequence,
+    const xt::xexpression<Q>& query,
+    const BasicSequenceStats<T, Acc>& stats,
+    xt::xexpression<D>& distance
+) {
+    const size_t n = sequence.derived_cast().size();
+    const size_t m = query.derived_cast().size();
+
+    if (m <= n && preferMass(n, m)) {
+        return similaritySearchMass(sequence, query, stats, distance);
+    }
+    return similaritySearch(sequence, query, stats, distance);
+}
+
+namespace detail {
+
+/// @brief Block sizes of similaritySearchBatch. A block of queries is sized to stay in L2 and a block of
+/// windows spans about 4 KiB of the sequence, which stays in L1 while every query of the block passes over it.
+constexpr size_t kBatchQueryBlockBytes = 256 * 1024;
+constexpr size_t kBatchWindowBlock     = 512;
+
+} // namespace detail
+
+/// @brief Run the similarity search of similaritySearch for k queries of the same length m at once: queries
+/// is k x m with one query per row, and row j of distance (k x (n-m+1)) is set to the distance profile of
+/// query j. stats must hold the statistics of sequence for length m.
+///
+/// The result is bit-identical to k calls to similaritySearch, but the window statistics are shared and the
+/// dot products are computed like a blocked matrix product: the queries are split into blocks that fit in L2
+/// and the windows into blocks that fit in L1, and every query of a block is run over a block of windows
+/// before moving on, so the sequence is streamed from memory once per query block rather than once per
+/// query. The blocks are spread over num_threads threads (0 = one per hardware thread).
+template <class S, class Q, class D, class T, class Acc>
+SimilaritySearchStatus similaritySearchBatch(
+    const xt::xexpression<S>& sequence,
+    const xt::xexpression<Q>& queries,
+    const BasicSequenceStats<T, Acc>& stats,
+    xt::xexpression<D>& distance,
+    size_t num_threads = 1
+) {
+    static_assert(xt::get_rank<S>::value == 1 || xt::get_rank<S>::value == SIZE_MAX, "sequence must be 1-dimensional");
+    static_assert(xt::get_rank<Q>::value == 2 || xt::get_rank<Q>::value == SIZE_MAX, "queries must be 2-dimensional");
+    static_assert(xt::get_rank<D>::value == 2 || xt::get_rank<D>::value == SIZE_MAX, "distance must be 2-dimensional");
+    static_assert(std::is_same_v<T, detail::compute_t<S>>, "stats must match the precision of the sequence");
+
+    const auto& seq  = sequence.derived_cast();
+    const auto& qrys = queries.derived_cast();
+    auto&       dist = distance.derived_cast();
+
+    if (seq.dimension() != 1)  return SimilaritySearchStatus::SequenceNotOneDimensional;
+    if (qrys.dimension() != 2) return SimilaritySearchStatus::QueriesNotTwoDimensional;
+    if (dist.dimension() != 2) return SimilaritySearchStatus::DistanceNotTwoDimensional;
+
+    const size_t k = qrys.shape()[0];
+    const size_t m = qrys.shape()[1];
+    if (m > seq.size()) return SimilaritySearchStatus::QueryLongerThanSequence;
+
+    const size_t profile_len = seq.size() - m + 1;
+    if (dist.shape()[0] != k || dist.shape()[1] != profile_len) return SimilaritySearchStatus::DistanceWrongSize;
+    if (k == 0) return SimilaritySearchStatus::Success;
+    if (!stats.matches(seq.size(), m)) return SimilaritySearchStatus::StatsMismatch;
+
+    const auto& kern = kernels::active<T>();
+
+    std::vector<T> seq_buf;
+    const T* s = detail::contiguousData(seq, seq_buf);
+
+    std::vector<detail::CenteredQuery<T>> centered;
+    centered.reserve(k);
+    for (size_t j = 0; j < k; j++) centered.push_back(detail::centerQuery<T>(xt::view(qrys, j, xt::all())));
+
+    // Row-major contiguous T output is written in place; anything else is staged in scratch.
+    std::vector<T> dist_buf;
+    T* out = nullptr;
+    using dist_value_type = std::remove_cv_t<typename std::decay_t<decltype(dist)>::value_type>;
+    if constexpr (xt::has_data_interface<std::decay_t<decltype(dist)>>::value && std::is_same_v<dist_value_type, T>) {
+        const bool row_major = (k <= 1 || static_cast<size_t>(dist.strides()[0]) == profile_len)
+                            && (profile_len <= 1 || dist.strides()[1] == 1);
+        if (row_major) out = dist.data() + dist.data_offset();
+    }
+    if (out == nullptr) {
+        dist_buf.resize(k * profile_len);
+        out = dist_buf.data();
+    }
+
+    const T* mean_s = stats.mean(m).data();
+    const T* std_s  = stats.stddev(m).data();
+
+    const size_t query_bytes   = std::max<size_t>(m, 1) * sizeof(T);
+    const size_t query_block   = std::max<size_t>(1, detail::kBatchQueryBlockBytes / query_bytes);
+    const size_t query_blocks  = (k + query_block - 1) / query_block;
+    const size_t window_blocks = (profile_len + detail::kBatchWindowBlock - 1) / detail::kBatchWindowBlock;
+
+    // Tasks run query block by query block, so threads working at the same time share one block of queries.
+    detail::parallelFor(query_blocks * window_blocks, resolveThreadCount(num_threads), [&](size_t task, size_t) {
+        const size_t q_begin = (task / window_blocks) * query_block;
+        const size_t q_end   = std::min(q_begin + query_block, k);
+        const size_t i_begin = (task % window_blocks) * detail::kBatchWindowBlock;
+        const size_t count   = std::min(detail::kBatchWindowBlock, profile_len - i_begin);
+
+        for (size_t j = q_begin; j < q_end; j++) {
+            const auto& q   = centered[j];
+            T*          row = out + j * profile_len + i_begin;
+            for (size_t i = 0; i < count; i++) row[i] = kern.dot(s + i_begin + i, q.values.data(), m);
+            kern.distances(row, mean_s + i_begin, std_s + i_begin, count, m, q.mean, q.stddev, row);
+        }
+    });
+
+    if (!dist_buf.empty()) {
+        for (size_t j = 0; j < k; j++) {
+            for (size_t i = 0; i < profile_len; i++) dist(j, i) = dist_buf[j * profile_len + i];
+        }
+    }
+
+    return SimilaritySearchStatus::Success;
+}
+
+/// @brief Batched similarity search without precomputed statistics; see the overload above.
+template <class S, class Q, class D>
+SimilaritySearchStatus similaritySearchBatch(
+    const xt::xexpression<S>& sequence,
+    const xt::xexpression<Q>& queries,
+    xt::xexpression<D>& distance,
+    size_t num_threads = 1
+) {
+    const auto& qrys = queries.derived_cast();
+    if (qrys.dimension() != 2) return SimilaritySearchStatus::QueriesNotTwoDimensional;
+    if (qrys.shape()[1] > sequence.derived_cast().size()) return SimilaritySearchStatus::QueryLongerThanSequence;
+    return similaritySearchBatch(sequence, queries, detail::StatsFor<S>(sequence, qrys.shape()[1]), distance,
+                                 num_threads);
+}
+
+namespace detail {
+
+/// @brief Windows checked per step of the early-abandoning distance in similaritySearchTopK.
+constexpr size_t kAbandonChunk = 16;
+
+/// @brief Whether the z-normalized distance between window s[0, m) (mean mean_s, stddev std_s) and the
+/// normalized query qn is certainly above the threshold whose square is bound_sq. The squared distance is the
+/// sum of (z_s[t] - qn[t])^2, which only grows as terms are added, so the scan stops as soon as a partial sum
+/// passes the bound; for most windows that happens within the first few chunks.
+template <class T>
+bool exceedsDistance(const T* s, const double* qn, size_t m, double mean_s, double std_s, double bound_sq) {
+    const double inv_std = 1.0 / std_s;
+    double acc = 0.0;
+    for (size_t t = 0; t < m;) {
+        const size_t end = std::min(t + kAbandonChunk, m);
+        for (; t < end; t++) {
+            const double z = (static_cast<double>(s[t]) - mean_s) * inv_std - qn[t];
+            acc += z * z;
+        }
+        if (acc > bound_sq) return true;
+    }
+    return false;
+}
+
+/// @brief Entries to retain so that the greedy pick of k matches, each ruling out at most per_pick
+/// entries, only ever looks at retained ones: the j-th pick is among the best (j - 1) * per_pick + 1.
+/// Saturates at profile_len rather than overflowing.
+inline size_t selectionCapacity(size_t k, size_t per_pick, size_t profile_len) {
+    if (k == 0) return 0;
+    if (k - 1 > profile_len / per_pick) return profile_len;
+    return std::min(profile_len, (k - 1) * per_pick + 1);
+}
+
+} // namespace detail
+
+/// @brief Find the k windows of sequence closest to query (z-normalized Euclidean distance), without
+/// materializing the distance profile. Matches are at least exclusion + 1 windows apart: they are chosen
+/// greedily, best first, each one ruling out the windows within exclusion of it, which is the same as
+/// repeatedly taking the argmin of the full profile and masking its exclusion zone. Ties go to the lowest
+/// index. distance and index must both have k elements and receive the matches in ascending order of
+/// distance; if fewer than k matches exist the remaining slots are set to infinity and -1. Windows whose
+/// distance is NaN (non-finite data) are never matched.
+///
+/// The scan keeps the (k - 1) * (2 * exclusion + 1) + 1 best windows in a bounded heap, which always contains
+/// every window the greedy selection can pick, so memory is O(k * exclusion) rather than O(n). Once the heap
+/// is full, windows are first checked with an early-abandoning distance against the worst retained one and
+/// only the survivors get the exact distance, bit-identical to the one similaritySearch reports.
+template <class S, class Q, class D, class I, class T, class Acc>
+SimilaritySearchStatus similaritySearchTopK(
+    const xt::xexpression<S>& sequence,
+    const xt::xexpression<Q>& query,
+    size_t k,
+    size_t exclusion,
+    const BasicSequenceStats<T, Acc>& stats,
+    xt::xexpression<D>& distance,
+    xt::xexpression<I>& index
+) {
+    static_assert(xt::get_rank<S>::value == 1 || xt::get_rank<S>::value == SIZE_MAX, "sequence must be 1-dimensional");
+    static_assert(xt::get_rank<Q>::value == 1 || xt::get_rank<Q>::value == SIZE_MAX, "query must be 1-dimensional");
+    static_assert(xt::get_rank<D>::value == 1 || xt::get_rank<D>::value == SIZE_MAX, "distance must be 1-dimensional");
+    static_assert(xt::get_rank<I>::value == 1 || xt::get_rank<I>::value == SIZE_MAX, "index must be 1-dimensional");
+    static_assert(std::is_same_v<T, detail::compute_t<S>>, "stats must match the precision of the sequence");
+
+    const auto& seq  = sequence.derived_cast();
+    const auto& qry  = query.derived_cast();
+    auto&       dist = distance.derived_cast();
+    auto&       idx  = index.derived_cast();
+
+    if (seq.dimension() != 1)  return SimilaritySearchStatus::SequenceNotOneDimensional;
+    if (qry.dimension() != 1)  return SimilaritySearchStatus::QueryNotOneDimensional;
+    if (dist.dimension() != 1) return SimilaritySearchStatus::DistanceNotOneDimensional;
+    if (idx.dimension() != 1)  return SimilaritySearchStatus::IndexNotOneDimensional;
+    if (qry.size() > seq.size()) return SimilaritySearchStatus::QueryLongerThanSequence;
+    if (!stats.matches(seq.size(), qry.size())) return SimilaritySearchStatus::StatsMismatch;
+    if (dist.size() != k) return SimilaritySearchStatus::DistanceWrongSize;
+    if (idx.size() != k)  return SimilaritySearchStatus::IndexWrongSize;
+
+    using index_type = typename std::decay_t<decltype(idx)>::value_type;
+    for (size_t j = 0; j < k; j++) {
+        dist(j) = std::numeric_limits<typename std::decay_t<decltype(dist)>::value_type>::infinity();
+        idx(j)  = static_cast<index_type>(-1);
+    }
+    if (k == 0) return SimilaritySearchStatus::Success;
+
+    const size_t m           = qry.size();
+    const size_t profile_len = seq.size() - m + 1;
+
+    const auto& kern = kernels::active<T>();
+
+    std::vector<T> seq_buf;
+    const T* s = detail::contiguousData(seq, seq_buf);
+
+    const auto q      = detail::centerQuery<T>(qry);
+    const T*   mean_s = stats.mean(m).data();
+    const T*   std_s  = stats.stddev(m).data();
 
-    // Initialize running sum and sum-of-squares for the first window.
-    const auto first_window = xt::view(seq, xt::range(0ul, m));
-    double sum_s    = xt::sum(first_window)();
-    double sum_sq_s = xt::sum(xt::square(first_window))();
+    // The query normalized once for the early-abandoning check, which needs a non-flat query and window.
+    const bool flat_query = q.stddev < kFlatStdDevThreshold;
+    std::vector<double> qn(flat_query ? 0 : m);
+    for (size_t t = 0; t < qn.size(); t++) {
+        qn[t] = (static_cast<double>(q.values[t]) - static_cast<double>(q.mean)) / static_cast<double>(q.stddev);
+    }
+
+    // Relative margin on the abandoning bound, covering the rounding of the dot-product distance in T.
+    const double slack = std::is_same_v<T, float> ? 1e-4 : 1e-8;
+
+    // Max-heap on (distance, index): the top is the worst retained window, so ties keep the lowest index.
+    using Candidate = std::pair<double, size_t>;
+    // An exclusion past the profile rules out every other window; clamping keeps 2 * exclusion + 1 from wrapping.
+    const size_t zone     = std::min(exclusion, profile_len);
+    const size_t capacity = detail::selectionCapacity(k, 2 * zone + 1, profile_len);
+    std::priority_queue<Candidate> heap;
+
+    // Windows are scanned in blocks aligned like similaritySearchBatch's, so the distances kernel sees the
+    // same lanes and every retained distance is bit-identical to the one similaritySearch reports. Windows
+    // abandoned against the heap as it stood at the start of the block are skipped when merging.
+    const size_t block = std::min(profile_len, detail::kBatchWindowBlock);
+    std::vector<T>    dots(block), block_dist(block);
+    std::vector<char> abandoned(block);
 
-    // We loop through the sequence in order, and incrementally maintain both the mean and std-deviation of the
-    // subsequence being considered.
-    for (size_t i = 0; i < n - m + 1; i++) {
-        const double mean_s = sum_s / static_cast<double>(m);
-        const double std_s  = std::sqrt(sum_sq_s / static_cast<double>(m) - mean_s * mean_s);
+    for (size_t begin = 0; begin < profile_len; begin += block) {
+        const size_t len = std::min(block, profile_len - begin);
 
-        // Compute the dot product of the current window with the query.
-        const auto window  = xt::view(seq, xt::range(i, i + m));
-        const double dot   = xt::sum(window * qry)();
+        const bool   filter   = heap.size() == capacity && !flat_query;
+        const double bound    = filter ? heap.top().first : 0.0;
+        const double bound_sq = bound * bound * (1 + slack) + 2.0 * static_cast<double>(m) * slack;
 
-        // Z-normalized Euclidean distance via Pearson correlation. Clamp to [-1, 1]
-        // to guard against floating-point rounding.
-        const double pearson = (dot - static_cast<double>(m) * mean_s * mean_q)
-                             / (static_cast<double>(m) * std_s * std_q);
-        dist[i] = std::sqrt(2.0 * static_cast<double>(m) * (1.0 - std::clamp(pearson, -1.0, 1.0)));
+        for (size_t b = 0; b < len; b++) {
+            const size_t i = begin + b;
+            abandoned[b] = filter && !(std_s[i] < kFlatStdDevThreshold)
+                        && detail::exceedsDistance(s + i, qn.data(), m, mean_s[i], std_s[i], bound_sq);
+            dots[b] = abandoned[b] ? T(0) : kern.dot(s + i, q.values.data(), m);
+        }
+        kern.distances(dots.data(), mean_s + begin, std_s + begin, len, m, q.mean, q.stddev, block_dist.data());
+
+        for (size_t b = 0; b < len; b++) {
+            const double d = static_cast<double>(block_dist[b]);
+            if (abandoned[b] || std::isnan(d)) continue;
 
-        // Slide the window: drop seq[i], admit seq[i + m].
-        if (i + m < n) {
-            sum_s    += seq(i + m) - seq(i);
-            sum_sq_s += seq(i + m) * seq(i + m) - seq(i) * seq(i);
+            const Candidate candidate{d, begin + b};
+            if (heap.size() < capacity) {
+                heap.push(candidate);
+            } else if (candidate < heap.top()) {
+                heap.pop();
+                heap.push(candidate);
+            }
         }
     }
 
+    // Greedy selection over the retained windows, best first.
+    std::vector<Candidate> ranked;
+    ranked.reserve(heap.size());
+    while (!heap.empty()) {
+        ranked.push_back(heap.top());
+        heap.pop();
+    }
+    std::reverse(ranked.begin(), ranked.end());
+
+    size_t found = 0;
+    std::vector<size_t> chosen;
+    chosen.reserve(k);
+    for (const auto& [d, i] : ranked) {
+        if (found == k) break;
+        const bool excluded = std::any_of(chosen.begin(), chosen.end(), [&](size_t c) {
+            return (i > c ? i - c : c - i) <= exclusion;
+        });
+        if (excluded) continue;
+
+        chosen.push_back(i);
+        dist(found) = static_cast<typename std::decay_t<decltype(dist)>::value_type>(d);
+        idx(found)  = static_cast<index_type>(i);
+        found++;
+    }
+
     return SimilaritySearchStatus::Success;
 }
 
+/// @brief Top-k similarity search without precomputed statistics; see the overload above.
+template <class S, class Q, class D, class I>
+SimilaritySearchStatus similaritySearchTopK(
+    const xt::xexpression<S>& sequence,
+    const xt::xexpression<Q>& query,
+    size_t k,
+    size_t exclusion,
+    xt::xexpression<D>& distance,
+    xt::xexpression<I>& index
+) {
+    const size_t m = query.derived_cast().size();
+    if (m > sequence.derived_cast().size()) return SimilaritySearchStatus::QueryLongerThanSequence;
+    return similaritySearchTopK(sequence, query, k, exclusion, detail::StatsFor<S>(sequence, m), distance, index);
+}
+
 enum class MatrixProfileStatus {
     Success,
     SequenceNotOneDimensional,
@@ -88,29 +734,376 @@ enum class MatrixProfileStatus {
     DistanceWrongSize,
     IndexWrongSize,
     SimilaritySearchFailed,
+    ReferenceNotOneDimensional,
+    SubsequenceLongerThanReference,
+    StatsMismatch,
+    DistanceNotTwoDimensional,
+    IndexNotTwoDimensional,
+    SequenceNotTwoDimensional,
+    FileError,
+    UnsupportedFileFormat,
+    TileOutOfRange,
+    DeviceError,
+    BatchOffsetsInvalid,
+    EncodedProfileInvalid,
+    IndexNotEncodable,
+};
+
+/// @brief Exclusion-zone policies. Subsequences i and j of a self-join are trivial matches, never reported as
+/// each other's neighbor, when |i - j| < firstDiagonal(m), so the engines skip those diagonals of the
+/// distance matrix outright: the diagonal sweeps start at diagonal firstDiagonal(m) and the row sweeps scan
+/// only the two column ranges either side of the zone, with no per-pair test. The engines take a policy as
+/// their trailing exclusion argument; self-joins default to QuarterExclusion, AB-joins to NoExclusion.
+
+/// @brief floor(m / 4) subsequences on each side: the self-join default.
+struct QuarterExclusion {
+    constexpr size_t firstDiagonal(size_t m) const { return m / 4 + 1; }
+};
+
+/// @brief ceil(m / 4) subsequences on each side, as in stumpy.
+struct CeilQuarterExclusion {
+    constexpr size_t firstDiagonal(size_t m) const { return (m + 3) / 4 + 1; }
 };
 
-/// @brief Compute the full matrix profile naively by running similaritySearch for every possible
-/// subsequence of length m. The exclusion zone (m/4) prevents trivial self-matches on the diagonal.
-///
-/// @param sequence  The input time series (1-D).
-/// @param m         Subsequence length.
-/// @param mp        Output matrix profile: mp[i] is the z-normalized distance from subsequence i
-///                  to its nearest non-trivial neighbor. Must be pre-allocated with size n-m+1.
-/// @param mpi       Output matrix profile index: mpi[i] is the starting index of the nearest
-///                  neighbor of subsequence i. Must be pre-allocated with size n-m+1.
-///                  Entries remain at the sentinel value (-1 cast to the index type) if no
-///                  neighbor outside the exclusion zone exists.
-template <class S, class D, class I>
+/// @brief No exclusion zone: every pair is a candidate, including a subsequence and itself. The AB-join
+/// default, where the two series are distinct; the left/right profiles require a zone.
+struct NoExclusion {
+    constexpr size_t firstDiagonal(size_t) const { return 0; }
+};
+
+/// @brief zone subsequences on each side, chosen at run time. Zone 0 excludes only the subsequence itself.
+struct FixedExclusion {
+    size_t zone;
+
+    constexpr size_t firstDiagonal(size_t) const { return zone < SIZE_MAX ? zone + 1 : zone; }
+};
+
+namespace detail {
+
+/// @brief Rows per independent STOMP block. Each block recomputes its first row of dot products directly, so
+/// blocks can run on any thread, and because the block boundaries do not depend on the thread count the
+/// output is bit-identical however many threads are used.
+constexpr size_t kStompRowBlock = 1024;
+
+/// @brief Sweep the rows of the distance matrix between the length-m subsequences of a and b STOMP-style,
+/// calling on_row(i, dist) with the z-normalized distances from subsequence i of a to every subsequence of
+/// b (rows_b values). The dot products of row i follow from row i-1 in O(1) each,
+///
+///     QT_i[j] = QT_{i-1}[j-1] - a[i-1] * b[j-1] + a[i+m-1] * b[j+m-1]
+///
+/// with column 0 computed directly for every row. Rows are processed in blocks of kStompRowBlock that each
+/// start from a directly computed row, so blocks run on any of num_threads workers without changing the
+/// output. on_row may be called concurrently for different rows. progress counts finished blocks, and instr
+/// times the dot products, distances and on_row (as the neighbor scan) of every row. The scratch rows come
+/// from workspace if one is given, and the blocks then run on its pool.
+template <class T, class OnRow, class Instr = NoInstrumentation>
+void stompSweep(
+    const T* a, const T* mean_a, const T* std_a, size_t rows_a,
+    const T* b, const T* mean_b, const T* std_b, size_t rows_b,
+    size_t m, size_t num_threads, OnRow&& on_row, const ProgressCallback& progress = {}, Instr instr = {},
+    Workspace* workspace = nullptr
+) {
+    const auto& kern = kernels::active<T>();
+
+    const size_t num_workers = resolveThreadCount(num_threads);
+    const size_t num_blocks  = (rows_a + kStompRowBlock - 1) / kStompRowBlock;
+    instr.workers(num_workers);
+
+    Workspace  own;
+    Workspace& ws = workspace ? *workspace : own;
+
+    // Column 0 of every row.
+    T* first_col = ws.buffer<T>(WorkspaceSlot::FirstColumn, rows_a);
+    {
+        const auto timer = instr.phase(Phase::DotProducts, 0, /*trace=*/true);
+        for (size_t i = 0; i < rows_a; i++) first_col[i] = kern.dot(a + i, b, m);
+    }
+
+    // Per-worker scratch: the previous and current dot-product rows, and the current distance row.
+    T* rows = ws.buffer<T>(WorkspaceSlot::Rows, 3 * num_workers * rows_b);
+
+    ws.parallelFor(num_blocks, num_workers, [&](size_t block, size_t worker) {
+        T*           prev      = rows + 3 * worker * rows_b;
+        T*           cur       = prev + rows_b;
+        T*           dist      = cur + rows_b;
+        const size_t row_begin = block * kStompRowBlock;
+        const size_t row_end   = std::min(row_begin + kStompRowBlock, rows_a);
+        const auto   task      = instr.task("row block", worker);
+        instr.countRows(worker, row_end - row_begin);
+
+        {
+            const auto timer = instr.phase(Phase::DotProducts, worker);
+            for (size_t j = 0; j < rows_b; j++) cur[j] = kern.dot(a + row_begin, b + j, m);
+        }
+
+        for (size_t i = row_begin; i < row_end; i++) {
+            if (i > row_begin) {
+                const auto timer = instr.phase(Phase::DotProducts, worker);
+                // Ping-pong between two rows so the update has no loop-carried dependency and vectorizes.
+                std::swap(prev, cur);
+                const T drop  = a[i - 1];
+                const T admit = a[i + m - 1];
+                cur[0] = first_col[i];
+                for (size_t j = 1; j < rows_b; j++) {
+                    cur[j] = prev[j - 1] - drop * b[j - 1] + admit * b[j + m - 1];
+                }
+            }
+
+            {
+                const auto timer = instr.phase(Phase::Distances, worker);
+                kern.distances(cur, mean_b, std_b, rows_b, m, mean_a[i], std_a[i], dist);
+            }
+            const auto timer = instr.phase(Phase::NeighborScan, worker);
+            on_row(i, static_cast<const T*>(dist));
+        }
+    }, progress);
+}
+
+/// @brief Diagonal tiles handed out per worker by matrixProfileDiagonal. More tiles than workers keeps the
+/// dynamic scheduling balanced near the end of the sweep.
+constexpr size_t kDiagonalTilesPerWorker = 8;
+
+/// @brief The columns [0, left_end) and [right_begin, cols) of row i that lie outside its excluded diagonals,
+/// |i - j| < first_diag (see the exclusion policies). Without a zone (first_diag 0) the row splits at i,
+/// which then belongs to the right range.
+struct CandidateRanges {
+    size_t left_end, right_begin;
+};
+
+inline CandidateRanges candidateRanges(size_t i, size_t cols, size_t first_diag) {
+    const size_t left_gap    = std::max<size_t>(first_diag, 1) - 1;
+    const size_t left_end    = i >= left_gap ? std::min(i - left_gap, cols) : 0;
+    const size_t right_begin = (i >= cols || first_diag >= cols - i) ? cols : i + first_diag;
+    return {left_end, right_begin};
+}
+
+/// @brief The nearest neighbors of subsequence i before (left, j < i) and after (right, j > i) its excluded
+/// diagonals |i - j| < first_diag in its distance profile, each found with the SIMD argmin kernel. A side
+/// without candidates has index SIZE_MAX.
+struct LeftRightArgMin {
+    ArgMin left, right;
+};
+
+template <class T>
+LeftRightArgMin nearestEitherSide(const T* dist, size_t profile_len, size_t i, size_t first_diag) {
+    const auto& kern                  = kernels::active<T>();
+    const auto  [left_end, right_begin] = candidateRanges(i, profile_len, first_diag);
+
+    return {kern.argmin(dist, 0, left_end), kern.argmin(dist, right_begin, profile_len)};
+}
+
+/// @brief Nearest neighbor of subsequence i in its distance profile, skipping |i - j| < first_diag. The two
+/// ranges either side of the zone are scanned with the SIMD argmin kernel; on ties the left range wins, so
+/// the lowest index is selected as in a serial scan.
+template <class T>
+ArgMin nearestOutsideExclusion(const T* dist, size_t profile_len, size_t i, size_t first_diag) {
+    const auto [left, right] = nearestEitherSide(dist, profile_len, i, first_diag);
+    return right.value < left.value ? right : left;
+}
+
+/// @brief Argument checks shared by the left/right matrix profile overloads: a 1-D sequence, a valid m, stats
+/// matching it, and six 1-D outputs of size n-m+1 (distances before indices, as in the plain engines).
+template <class S, class D, class I, class LD, class LI, class RD, class RI, class T, class Acc>
+MatrixProfileStatus checkLeftRightProfile(
+    const xt::xexpression<S>& sequence, size_t m, const BasicSequenceStats<T, Acc>& stats,
+    const xt::xexpression<D>& mp, const xt::xexpression<I>& mpi,
+    const xt::xexpression<LD>& left_mp, const xt::xexpression<LI>& left_mpi,
+    const xt::xexpression<RD>& right_mp, const xt::xexpression<RI>& right_mpi
+) {
+    static_assert(xt::get_rank<S>::value == 1 || xt::get_rank<S>::value == SIZE_MAX, "sequence must be 1-dimensional");
+    static_assert(xt::get_rank<D>::value == 1 || xt::get_rank<D>::value == SIZE_MAX, "mp must be 1-dimensional");
+    static_assert(xt::get_rank<I>::value == 1 || xt::get_rank<I>::value == SIZE_MAX, "mpi must be 1-dimensional");
+    static_assert(xt::get_rank<LD>::value == 1 || xt::get_rank<LD>::value == SIZE_MAX, "left_mp must be 1-dimensional");
+    static_assert(xt::get_rank<LI>::value == 1 || xt::get_rank<LI>::value == SIZE_MAX, "left_mpi must be 1-dimensional");
+    static_assert(xt::get_rank<RD>::value == 1 || xt::get_rank<RD>::value == SIZE_MAX, "right_mp must be 1-dimensional");
+    static_assert(xt::get_rank<RI>::value == 1 || xt::get_rank<RI>::value == SIZE_MAX, "right_mpi must be 1-dimensional");
+
+    const auto& seq = sequence.derived_cast();
+
+    if (seq.dimension() != 1) return MatrixProfileStatus::SequenceNotOneDimensional;
+    if (m == 0)               return MatrixProfileStatus::SubsequenceLengthZero;
+    if (m > seq.size())       return MatrixProfileStatus::SubsequenceLongerThanSequence;
+    if (!stats.matches(seq.size(), m)) return MatrixProfileStatus::StatsMismatch;
+
+    const size_t profile_len = seq.size() - m + 1;
+
+    for (size_t size : {mp.derived_cast().size(), left_mp.derived_cast().size(), right_mp.derived_cast().size()}) {
+        if (size != profile_len) return MatrixProfileStatus::DistanceWrongSize;
+    }
+    for (size_t size : {mpi.derived_cast().size(), left_mpi.derived_cast().size(), right_mpi.derived_cast().size()}) {
+        if (size != profile_len) return MatrixProfileStatus::IndexWrongSize;
+    }
+    return MatrixProfileStatus::Success;
+}
+
+/// @brief Whether candidate (d, j) should replace the current best (best_d, best_j): the smaller distance
+/// wins, and ties go to the smaller index, which is what a serial ascending scan with a strict < selects.
+template <class Idx>
+inline bool isBetterNeighbor(double d, Idx j, double best_d, Idx best_j) {
+    return d < best_d || (d == best_d && j < best_j);
+}
+
+/// @brief Walk diagonal k of the self-join distance matrix of the centered series t, offering every distance
+/// (i, i + k) to right_mp/right_mpi[i], as a neighbor after i, and to left_mp/left_mpi[i + k], as one before
+/// i + k. Passing the same arrays for both sides tracks the overall nearest neighbor. The dot product of
+/// (i, i + k) follows from (i - 1, i + k - 1) in O(1). It is carried in double even for float data: it is
+/// updated serially along the whole diagonal, and products of floats are exact in double.
+template <class T, class Idx>
+void sweepDiagonal(const T* t, const T* mean, const T* stddev, size_t profile_len, size_t m, size_t k,
+                   double* right_mp, Idx* right_mpi, double* left_mp, Idx* left_mpi) {
+    double dot = kernels::active<T>().dot(t, t + k, m);
+
+    for (size_t i = 0; i + k < profile_len; i++) {
+        const size_t j = i + k;
+        if (i > 0) {
+            dot += static_cast<double>(t[i + m - 1]) * t[j + m - 1] - static_cast<double>(t[i - 1]) * t[j - 1];
+        }
+
+        const double d = zNormalizedDistance(dot, m, mean[i], stddev[i], mean[j], stddev[j]);
+        if (isBetterNeighbor(d, static_cast<Idx>(j), right_mp[i], right_mpi[i])) {
+            right_mp[i]  = d;
+            right_mpi[i] = static_cast<Idx>(j);
+        }
+        if (isBetterNeighbor(d, static_cast<Idx>(i), left_mp[j], left_mpi[j])) {
+            left_mp[j]  = d;
+            left_mpi[j] = static_cast<Idx>(i);
+        }
+    }
+}
+
+/// @brief sweepDiagonal tracking only the overall nearest neighbor in lmp/lmpi.
+template <class T, class Idx>
+void sweepDiagonal(const T* t, const T* mean, const T* stddev, size_t profile_len, size_t m, size_t k,
+                   double* lmp, Idx* lmpi) {
+    sweepDiagonal(t, mean, stddev, profile_len, m, k, lmp, lmpi, lmp, lmpi);
+}
+
+/// @brief The diagonal sweep of matrixProfileDiagonal over the centered series t. Diagonals [first_diag,
+/// profile_len) are grouped into tiles of roughly equal cell counts that num_threads workers pull from, each
+/// sweeping them into its own profile buffers, which are min-reduced at the end; ties go to the lower index
+/// throughout, so the result is bit-identical for every thread count. It is handed over as store(i, distance,
+/// index) per subsequence, or with kLeftRight as store(i, left_distance, left_index, right_distance,
+/// right_index), tracking the neighbors before and after i separately at the cost of a second pair of per-worker
+/// buffers. The tiles and buffers come from workspace, whose pool the tiles run on. instr times each tile and
+/// the reduction.
+template <bool kLeftRight, class Idx, class T, class Store, class Instr>
+void diagonalSelfJoin(const T* t, const T* mean, const T* stddev, size_t profile_len, size_t m, size_t first_diag,
+                      size_t num_threads, const ProgressCallback& progress, const Instr& instr, Workspace& workspace,
+                      Store&& store) {
+    const size_t num_workers = resolveThreadCount(num_threads);
+    instr.workers(num_workers);
+
+    // Split diagonals [first_diag, profile_len) into contiguous tiles of roughly equal cell counts. Diagonal
+    // k holds profile_len - k cells. Every tile holds at least one diagonal, so there are at most profile_len
+    // tile starts plus the end.
+    size_t* tile_starts = workspace.buffer<size_t>(WorkspaceSlot::TileStarts, profile_len + 1);
+    size_t  num_tiles   = 0;
+    if (first_diag < profile_len) {
+        const size_t total_cells = (profile_len - first_diag) * (profile_len - first_diag + 1) / 2;
+        const size_t tile_cells  = std::max<size_t>(total_cells / (num_workers * kDiagonalTilesPerWorker), 1);
+
+        size_t cells = 0;
+        tile_starts[num_tiles++] = first_diag;
+        for (size_t k = first_diag; k < profile_len; k++) {
+            if (cells >= tile_cells) {
+                tile_starts[num_tiles++] = k;
+                cells = 0;
+            }
+            cells += profile_len - k;
+        }
+    }
+    tile_starts[num_tiles] = profile_len;
+
+    // Per-worker profiles, profile_len entries each: the overall (or, with kLeftRight, right) neighbors, plus
+    // the left ones.
+    const size_t local_len = num_workers * profile_len;
+    const size_t left_len  = kLeftRight ? local_len : 0;
+    double* local_mp       = workspace.buffer<double>(WorkspaceSlot::Profiles, local_len);
+    Idx*    local_mpi      = workspace.buffer<Idx>(WorkspaceSlot::Indices, local_len);
+    double* local_left_mp  = workspace.buffer<double>(WorkspaceSlot::LeftProfiles, left_len);
+    Idx*    local_left_mpi = workspace.buffer<Idx>(WorkspaceSlot::LeftIndices, left_len);
+    std::fill_n(local_mp, local_len, std::numeric_limits<double>::infinity());
+    std::fill_n(local_mpi, local_len, static_cast<Idx>(-1));
+    std::fill_n(local_left_mp, left_len, std::numeric_limits<double>::infinity());
+    std::fill_n(local_left_mpi, left_len, static_cast<Idx>(-1));
+
+    workspace.parallelFor(num_tiles, num_workers, [&](size_t tile, size_t worker) {
+        double* rmp  = local_mp + worker * profile_len;
+        Idx*    rmpi = local_mpi + worker * profile_len;
+        double* lmp  = kLeftRight ? local_left_mp + worker * profile_len  : rmp;
+        Idx*    lmpi = kLeftRight ? local_left_mpi + worker * profile_len : rmpi;
+
+        const auto task  = instr.task("diagonal tile", worker);
+        const auto timer = instr.phase(Phase::Diagonals, worker);
+        instr.countDiagonals(worker, tile_starts[tile + 1] - tile_starts[tile]);
+        for (size_t k = tile_starts[tile]; k < tile_starts[tile + 1]; k++) {
+            sweepDiagonal(t, mean, stddev, profile_len, m, k, rmp, rmpi, lmp, lmpi);
+        }
+    }, progress);
+
+    const auto timer = instr.phase(Phase::Reduction, 0, /*trace=*/true);
+
+    // Min-reduce the per-worker profiles. The tie-break makes the reduction order irrelevant.
+    const auto reduce = [num_workers, profile_len](const double* dist, const Idx* index, size_t i) {
+        std::pair<double, Idx> best{dist[i], index[i]};
+        for (size_t w = 1; w < num_workers; w++) {
+            const size_t at = w * profile_len + i;
+            if (isBetterNeighbor(dist[at], index[at], best.first, best.second)) best = {dist[at], index[at]};
+        }
+        return best;
+    };
+
+    for (size_t i = 0; i < profile_len; i++) {
+        const auto [d, j] = reduce(local_mp, local_mpi, i);
+        if constexpr (kLeftRight) {
+            const auto [left_d, left_j] = reduce(local_left_mp, local_left_mpi, i);
+            store(i, left_d, left_j, d, j);
+        } else {
+            store(i, d, j);
+        }
+    }
+}
+
+} // namespace detail
+
+/// @brief Compute the full matrix profile naively by running a similarity search (the computation of
+/// similaritySearch) for every possible subsequence of length m. The exclusion zone (m/4 by default) prevents
+/// trivial self-matches on the diagonal.
+///
+/// @param sequence     The input time series (1-D).
+/// @param m            Subsequence length.
+/// @param stats        Window statistics of sequence for length m (see SequenceStats). The overload
+///                     without it computes them.
+/// @param mp           Output matrix profile: mp[i] is the z-normalized distance from subsequence i
+///                     to its nearest non-trivial neighbor. Must be pre-allocated with size n-m+1.
+/// @param mpi          Output matrix profile index: mpi[i] is the starting index of the nearest
+///                     neighbor of subsequence i. Must be pre-allocated with size n-m+1.
+///                     Entries remain at the sentinel value (-1 cast to the index type) if no
+///                     neighbor outside the exclusion zone exists.
+/// @param num_threads  Worker threads (0 for one per hardware thread). Rows are independent, so the
+///                     output does not depend on the thread count.
+/// @param progress     Optional progress(done, total) callback counting finished rows, called on the
+///                     calling thread only (see ProgressCallback).
+/// @param exclusion    Exclusion-zone policy (see QuarterExclusion): each row's argmin skips the columns
+///                     of its excluded diagonals.
+/// @param workspace    Optional Workspace to take the per-worker queries and distance profiles (and, without
+///                     stats, the window statistics) from, so repeated calls do not allocate.
+template <class S, class D, class I, class T, class Acc, class Exclusion = QuarterExclusion>
 MatrixProfileStatus matrixProfileNaive(
     const xt::xexpression<S>& sequence,
     size_t m,
+    const BasicSequenceStats<T, Acc>& stats,
     xt::xexpression<D>& mp,
-    xt::xexpression<I>& mpi
+    xt::xexpression<I>& mpi,
+    size_t num_threads = 1,
+    const ProgressCallback& progress = {},
+    Exclusion exclusion = {},
+    Workspace* workspace = nullptr
 ) {
     static_assert(xt::get_rank<S>::value == 1 || xt::get_rank<S>::value == SIZE_MAX, "sequence must be 1-dimensional");
     static_assert(xt::get_rank<D>::value == 1 || xt::get_rank<D>::value == SIZE_MAX, "mp must be 1-dimensional");
     static_assert(xt::get_rank<I>::value == 1 || xt::get_rank<I>::value == SIZE_MAX, "mpi must be 1-dimensional");
+    static_assert(std::is_same_v<T, detail::compute_t<S>>, "stats must match the precision of the sequence");
 
     const auto& seq = sequence.derived_cast();
     auto&       mp_ = mp.derived_cast();
@@ -119,6 +1112,7 @@ MatrixProfileStatus matrixProfileNaive(
     if (seq.dimension() != 1) return MatrixProfileStatus::SequenceNotOneDimensional;
     if (m == 0)               return MatrixProfileStatus::SubsequenceLengthZero;
     if (m > seq.size())       return MatrixProfileStatus::SubsequenceLongerThanSequence;
+    if (!stats.matches(seq.size(), m)) return MatrixProfileStatus::StatsMismatch;
 
     const size_t n           = seq.size();
     const size_t profile_len = n - m + 1;
@@ -128,35 +1122,598 @@ MatrixProfileStatus matrixProfileNaive(
 
     using idx_t = typename std::decay_t<decltype(mpi_)>::value_type;
 
-    // Standard exclusion zone: floor(m / 4) on each side of the diagonal.
-    const size_t exclusion_zone = m / 4;
+    const size_t first_diag = exclusion.firstDiagonal(m);
 
     std::fill(mp_.begin(),  mp_.end(),  std::numeric_limits<double>::infinity());
     std::fill(mpi_.begin(), mpi_.end(), static_cast<idx_t>(-1));
 
-    xt::xtensor<double, 1> dist_profile = xt::empty<double>({profile_len});
+    const size_t num_workers = resolveThreadCount(num_threads);
+    const auto&  kern        = kernels::active<T>();
 
-    for (size_t i = 0; i < profile_len; i++) {
-        const auto query = xt::view(seq, xt::range(i, i + m));
+    Workspace  own;
+    Workspace& ws = workspace ? *workspace : own;
 
-        const auto status = similaritySearch(seq, query, dist_profile);
-        if (status != SimilaritySearchStatus::Success) {
-            return MatrixProfileStatus::SimilaritySearchFailed;
-        }
+    const T* s      = detail::contiguousData<T>(seq, ws, detail::WorkspaceSlot::SeriesValues);
+    const T* mean_s = stats.mean(m).data();
+    const T* std_s  = stats.stddev(m).data();
+
+    // One query and distance profile buffer per worker; each row only writes its own mp/mpi entry.
+    T* queries  = ws.buffer<T>(detail::WorkspaceSlot::Queries, num_workers * m);
+    T* profiles = ws.buffer<T>(detail::WorkspaceSlot::Rows, num_workers * profile_len);
+
+    ws.parallelFor(profile_len, num_workers, [&](size_t i, size_t worker) {
+        T* q    = queries + worker * m;
+        T* dist = profiles + worker * profile_len;
+
+        // As in similaritySearch: the dot products with the centered query, converted in place to distances.
+        const auto moments = detail::centerQuery([s, i](size_t k) { return s[i + k]; }, m, q);
+        for (size_t j = 0; j < profile_len; j++) dist[j] = kern.dot(s + j, q, m);
+        kern.distances(dist, mean_s, std_s, profile_len, m, moments.mean, moments.stddev, dist);
 
         // Find the nearest neighbor outside the exclusion zone.
-        for (size_t j = 0; j < profile_len; j++) {
-            const size_t diff = (i > j) ? (i - j) : (j - i);
-            if (diff <= exclusion_zone) continue;
+        const ArgMin best = detail::nearestOutsideExclusion(dist, profile_len, i, first_diag);
+        if (best.index != SIZE_MAX) {
+            mp_[i]  = best.value;
+            mpi_[i] = static_cast<idx_t>(best.index);
+        }
+    }, progress);
+
+    return MatrixProfileStatus::Success;
+}
+
+/// @brief matrixProfileNaive without precomputed statistics; see the overload above.
+template <class S, class D, class I, class Exclusion = QuarterExclusion>
+MatrixProfileStatus matrixProfileNaive(
+    const xt::xexpression<S>& sequence,
+    size_t m,
+    xt::xexpression<D>& mp,
+    xt::xexpression<I>& mpi,
+    size_t num_threads = 1,
+    const ProgressCallback& progress = {},
+    Exclusion exclusion = {},
+    Workspace* workspace = nullptr
+) {
+    return detail::withStats(sequence, m, NoInstrumentation{}, workspace, 0, [&](const auto& stats) {
+        return matrixProfileNaive(sequence, m, stats, mp, mpi, num_threads, progress, exclusion, workspace);
+    });
+}
+
+/// @brief Compute the full matrix profile with STOMP. Rather than running an independent similarity search
+/// per subsequence, the sliding dot products QT_i[j] = <T[i, i+m), T[j, j+m)> of row i are derived from
+/// row i-1 in O(1) each:
+///
+///     QT_i[j] = QT_{i-1}[j-1] - T[i-1] * T[j-1] + T[i+m-1] * T[j+m-1]
+///
+/// which brings the total cost down from O(n^2 * m) to O(n^2). Column 0 of every row comes from the first
+/// row by symmetry (QT_i[0] == QT_0[i]). Results, including the exclusion zone and tie-breaking (the
+/// lowest index wins), match matrixProfileNaive up to floating-point rounding.
+///
+/// Rows are processed in fixed blocks of detail::kStompRowBlock, each starting from a directly computed
+/// row, so blocks can be spread across threads without changing the output.
+///
+/// @param sequence     The input time series (1-D).
+/// @param m            Subsequence length.
+/// @param stats        Window statistics of sequence for length m (see SequenceStats). The overload
+///                     without it computes them.
+/// @param mp           Output matrix profile, pre-allocated with size n-m+1.
+/// @param mpi          Output matrix profile index, pre-allocated with size n-m+1.
+/// @param num_threads  Worker threads (0 for one per hardware thread).
+/// @param progress     Optional progress(done, total) callback counting finished row blocks.
+/// @param instr        Instrumentation policy. The default NoInstrumentation compiles to nothing; pass
+///                     Instrumented(stats) to time each phase of every row into a ProfileStats.
+/// @param exclusion    Exclusion-zone policy (see QuarterExclusion): each row's argmin skips the columns
+///                     of its excluded diagonals.
+/// @param workspace    Optional Workspace to take the centered series and per-worker rows (and, without stats,
+///                     the window statistics) from, so repeated calls do not allocate.
+template <class S, class D, class I, class T, class Acc, class Instr = NoInstrumentation,
+          class Exclusion = QuarterExclusion>
+MatrixProfileStatus matrixProfileStomp(
+    const xt::xexpression<S>& sequence,
+    size_t m,
+    const BasicSequenceStats<T, Acc>& stats,
+    xt::xexpression<D>& mp,
+    xt::xexpression<I>& mpi,
+    size_t num_threads = 1,
+    const ProgressCallback& progress = {},
+    Instr instr = {},
+    Exclusion exclusion = {},
+    Workspace* workspace = nullptr
+) {
+    static_assert(xt::get_rank<S>::value == 1 || xt::get_rank<S>::value == SIZE_MAX, "sequence must be 1-dimensional");
+    static_assert(xt::get_rank<D>::value == 1 || xt::get_rank<D>::value == SIZE_MAX, "mp must be 1-dimensional");
+    static_assert(xt::get_rank<I>::value == 1 || xt::get_rank<I>::value == SIZE_MAX, "mpi must be 1-dimensional");
+    static_assert(std::is_same_v<T, detail::compute_t<S>>, "stats must match the precision of the sequence");
+
+    const auto& seq = sequence.derived_cast();
+    auto&       mp_ = mp.derived_cast();
+    auto&       mpi_= mpi.derived_cast();
+
+    if (seq.dimension() != 1) return MatrixProfileStatus::SequenceNotOneDimensional;
+    if (m == 0)               return MatrixProfileStatus::SubsequenceLengthZero;
+    if (m > seq.size())       return MatrixProfileStatus::SubsequenceLongerThanSequence;
+    if (!stats.matches(seq.size(), m)) return MatrixProfileStatus::StatsMismatch;
+
+    const size_t n           = seq.size();
+    const size_t profile_len = n - m + 1;
+
+    if (mp_.size()  != profile_len) return MatrixProfileStatus::DistanceWrongSize;
+    if (mpi_.size() != profile_len) return MatrixProfileStatus::IndexWrongSize;
 
-            if (dist_profile[j] < mp_[i]) {
-                mp_[i]  = dist_profile[j];
-                mpi_[i] = static_cast<idx_t>(j);
+    using idx_t = typename std::decay_t<decltype(mpi_)>::value_type;
+
+    const size_t first_diag = exclusion.firstDiagonal(m);
+
+    std::fill(mp_.begin(),  mp_.end(),  std::numeric_limits<double>::infinity());
+    std::fill(mpi_.begin(), mpi_.end(), static_cast<idx_t>(-1));
+
+    Workspace  own;
+    Workspace& ws = workspace ? *workspace : own;
+
+    const auto centered = detail::centerSeries(seq, stats.mean(m), ws, detail::WorkspaceSlot::SeriesValues,
+                                               detail::WorkspaceSlot::SeriesMean, instr);
+    const T*   t        = centered.values;
+    const T*   mean     = centered.mean;
+    const T*   stddev   = stats.stddev(m).data();
+
+    detail::stompSweep(
+        t, mean, stddev, profile_len,
+        t, mean, stddev, profile_len,
+        m, num_threads,
+        [&](size_t i, const T* dist) {
+            const ArgMin best = detail::nearestOutsideExclusion(dist, profile_len, i, first_diag);
+            if (best.index != SIZE_MAX) {
+                mp_[i]  = best.value;
+                mpi_[i] = static_cast<idx_t>(best.index);
             }
-        }
+        },
+        progress, instr, &ws);
+
+    instr.finish();
+    return MatrixProfileStatus::Success;
+}
+
+/// @brief matrixProfileStomp without precomputed statistics; see the overload above.
+template <class S, class D, class I, class Instr = NoInstrumentation, class Exclusion = QuarterExclusion>
+MatrixProfileStatus matrixProfileStomp(
+    const xt::xexpression<S>& sequence,
+    size_t m,
+    xt::xexpression<D>& mp,
+    xt::xexpression<I>& mpi,
+    size_t num_threads = 1,
+    const ProgressCallback& progress = {},
+    Instr instr = {},
+    Exclusion exclusion = {},
+    Workspace* workspace = nullptr
+) {
+    return detail::withStats(sequence, m, instr, workspace, 0, [&](const auto& stats) {
+        return matrixProfileStomp(sequence, m, stats, mp, mpi, num_threads, progress, instr, exclusion, workspace);
+    });
+}
+
+/// @brief matrixProfileStomp that also fills the left and right matrix profiles: left_mp[i]/left_mpi[i] is the
+/// nearest neighbor of subsequence i that starts before its exclusion zone (j < i - m/4 by default) and
+/// right_mp[i]/right_mpi[i] the nearest one after it (j > i + m/4). The argmin over each row already scans the
+/// two sides of the exclusion zone separately, so they come at no extra cost. mp/mpi are the better of the two
+/// and equal the overload without them. Entries with no neighbor on that side remain at infinity and -1.
+///
+/// @param left_mp      Output left matrix profile, pre-allocated with size n-m+1.
+/// @param left_mpi     Output left matrix profile index, pre-allocated with size n-m+1.
+/// @param right_mp     Output right matrix profile, pre-allocated with size n-m+1.
+/// @param right_mpi    Output right matrix profile index, pre-allocated with size n-m+1.
+///
+/// The remaining parameters are those of matrixProfileStomp.
+template <class S, class D, class I, class LD, class LI, class RD, class RI, class T, class Acc, class Instr = NoInstrumentation,
+          class Exclusion = QuarterExclusion>
+MatrixProfileStatus matrixProfileStomp(
+    const xt::xexpression<S>& sequence,
+    size_t m,
+    const BasicSequenceStats<T, Acc>& stats,
+    xt::xexpression<D>& mp,
+    xt::xexpression<I>& mpi,
+    xt::xexpression<LD>& left_mp,
+    xt::xexpression<LI>& left_mpi,
+    xt::xexpression<RD>& right_mp,
+    xt::xexpression<RI>& right_mpi,
+    size_t num_threads = 1,
+    const ProgressCallback& progress = {},
+    Instr instr = {},
+    Exclusion exclusion = {},
+    Workspace* workspace = nullptr
+) {
+    static_assert(std::is_same_v<T, detail::compute_t<S>>, "stats must match the precision of the sequence");
+    static_assert(!std::is_same_v<Exclusion, NoExclusion>, "left and right neighbors need an exclusion zone");
+
+    auto& left_mp_   = left_mp.derived_cast();
+    auto& left_mpi_  = left_mpi.derived_cast();
+    auto& right_mp_  = right_mp.derived_cast();
+    auto& right_mpi_ = right_mpi.derived_cast();
+
+    const auto status = detail::checkLeftRightProfile(sequence, m, stats, mp, mpi, left_mp, left_mpi, right_mp, right_mpi);
+    if (status != MatrixProfileStatus::Success) return status;
+
+    const auto&  seq         = sequence.derived_cast();
+    auto&        mp_         = mp.derived_cast();
+    auto&        mpi_        = mpi.derived_cast();
+    const size_t profile_len = seq.size() - m + 1;
+
+    using idx_t = typename std::decay_t<decltype(mpi_)>::value_type;
+
+    const size_t first_diag = exclusion.firstDiagonal(m);
+
+    Workspace  own;
+    Workspace& ws = workspace ? *workspace : own;
+
+    const auto centered = detail::centerSeries(seq, stats.mean(m), ws, detail::WorkspaceSlot::SeriesValues,
+                                               detail::WorkspaceSlot::SeriesMean, instr);
+    const T*   t        = centered.values;
+    const T*   mean     = centered.mean;
+    const T*   stddev   = stats.stddev(m).data();
+
+    // A side without candidates keeps an index of SIZE_MAX and an infinite value.
+    const auto index = [](const ArgMin& best) {
+        return best.index != SIZE_MAX ? static_cast<idx_t>(best.index) : static_cast<idx_t>(-1);
+    };
+
+    detail::stompSweep(
+        t, mean, stddev, profile_len,
+        t, mean, stddev, profile_len,
+        m, num_threads,
+        [&](size_t i, const T* dist) {
+            const auto [left, right] = detail::nearestEitherSide(dist, profile_len, i, first_diag);
+            left_mp_[i]   = left.value;
+            left_mpi_[i]  = index(left);
+            right_mp_[i]  = right.value;
+            right_mpi_[i] = index(right);
+
+            // Same choice as nearestOutsideExclusion: the left side wins ties.
+            const ArgMin& best = right.value < left.value ? right : left;
+            mp_[i]  = best.value;
+            mpi_[i] = index(best);
+        },
+        progress, instr, &ws);
+
+    instr.finish();
+    return MatrixProfileStatus::Success;
+}
+
+/// @brief Left/right matrixProfileStomp without precomputed statistics; see the overload above.
+template <class S, class D, class I, class LD, class LI, class RD, class RI, class Instr = NoInstrumentation,
+          class Exclusion = QuarterExclusion>
+MatrixProfileStatus matrixProfileStomp(
+    const xt::xexpression<S>& sequence,
+    size_t m,
+    xt::xexpression<D>& mp,
+    xt::xexpression<I>& mpi,
+    xt::xexpression<LD>& left_mp,
+    xt::xexpression<LI>& left_mpi,
+    xt::xexpression<RD>& right_mp,
+    xt::xexpression<RI>& right_mpi,
+    size_t num_threads = 1,
+    const ProgressCallback& progress = {},
+    Instr instr = {},
+    Exclusion exclusion = {},
+    Workspace* workspace = nullptr
+) {
+    return detail::withStats(sequence, m, instr, workspace, 0, [&](const auto& stats) {
+        return matrixProfileStomp(sequence, m, stats, mp, mpi, left_mp, left_mpi, right_mp, right_mpi, num_threads,
+                                  progress, instr, exclusion, workspace);
+    });
+}
+
+/// @brief Compute the full matrix profile by sweeping the diagonals of the distance matrix (SCRIMP-style),
+/// in parallel. Along diagonal k the dot product of subsequences (i, i+k) follows from (i-1, i+k-1) in O(1),
+/// and each distance updates both mp[i] and mp[i+k], so only the upper triangle outside the exclusion zone
+/// is ever computed.
+///
+/// Diagonals are grouped into tiles of roughly equal work that a pool of worker threads pulls from. Each
+/// worker keeps its own mp/mpi buffers, which are min-reduced at the end. Every diagonal is always computed
+/// in full by one worker and ties break towards the lower index both inside a worker and in the reduction,
+/// so the output is bit-identical for every thread count.
+///
+/// @param sequence     The input time series (1-D).
+/// @param m            Subsequence length.
+/// @param stats        Window statistics of sequence for length m (see SequenceStats). The overload
+///                     without it computes them.
+/// @param mp           Output matrix profile, pre-allocated with size n-m+1.
+/// @param mpi          Output matrix profile index, pre-allocated with size n-m+1.
+/// @param num_threads  Worker threads (0 for one per hardware thread).
+/// @param progress     Optional progress(done, total) callback counting finished diagonal tiles.
+/// @param instr        Instrumentation policy. The default NoInstrumentation compiles to nothing; pass
+///                     Instrumented(stats) to time the tiles and the reduction into a ProfileStats.
+/// @param exclusion    Exclusion-zone policy (see QuarterExclusion): the sweep starts at its first
+///                     non-excluded diagonal.
+/// @param workspace    Optional Workspace to take the centered series and per-worker profiles (and, without
+///                     stats, the window statistics) from, so repeated calls do not allocate. With a pool
+///                     the tiles run on it.
+template <class S, class D, class I, class T, class Acc, class Instr = NoInstrumentation,
+          class Exclusion = QuarterExclusion>
+MatrixProfileStatus matrixProfileDiagonal(
+    const xt::xexpression<S>& sequence,
+    size_t m,
+    const BasicSequenceStats<T, Acc>& stats,
+    xt::xexpression<D>& mp,
+    xt::xexpression<I>& mpi,
+    size_t num_threads = 1,
+    const ProgressCallback& progress = {},
+    Instr instr = {},
+    Exclusion exclusion = {},
+    Workspace* workspace = nullptr
+) {
+    static_assert(xt::get_rank<S>::value == 1 || xt::get_rank<S>::value == SIZE_MAX, "sequence must be 1-dimensional");
+    static_assert(xt::get_rank<D>::value == 1 || xt::get_rank<D>::value == SIZE_MAX, "mp must be 1-dimensional");
+    static_assert(xt::get_rank<I>::value == 1 || xt::get_rank<I>::value == SIZE_MAX, "mpi must be 1-dimensional");
+    static_assert(std::is_same_v<T, detail::compute_t<S>>, "stats must match the precision of the sequence");
+
+    const auto& seq = sequence.derived_cast();
+    auto&       mp_ = mp.derived_cast();
+    auto&       mpi_= mpi.derived_cast();
+
+    if (seq.dimension() != 1) return MatrixProfileStatus::SequenceNotOneDimensional;
+    if (m == 0)               return MatrixProfileStatus::SubsequenceLengthZero;
+    if (m > seq.size())       return MatrixProfileStatus::SubsequenceLongerThanSequence;
+    if (!stats.matches(seq.size(), m)) return MatrixProfileStatus::StatsMismatch;
+
+    const size_t n           = seq.size();
+    const size_t profile_len = n - m + 1;
+
+    if (mp_.size()  != profile_len) return MatrixProfileStatus::DistanceWrongSize;
+    if (mpi_.size() != profile_len) return MatrixProfileStatus::IndexWrongSize;
+
+    using idx_t = typename std::decay_t<decltype(mpi_)>::value_type;
+
+    Workspace  own;
+    Workspace& ws = workspace ? *workspace : own;
+
+    const auto centered = detail::centerSeries(seq, stats.mean(m), ws, detail::WorkspaceSlot::SeriesValues,
+                                               detail::WorkspaceSlot::SeriesMean, instr);
+    const T*   t        = centered.values;
+    const T*   mean     = centered.mean;
+    const T*   stddev   = stats.stddev(m).data();
+
+    detail::diagonalSelfJoin<false, idx_t>(t, mean, stddev, profile_len, m, exclusion.firstDiagonal(m), num_threads,
+                                           progress, instr, ws, [&](size_t i, double d, idx_t j) {
+        mp_[i]  = d;
+        mpi_[i] = j;
+    });
+
+    instr.finish();
+    return MatrixProfileStatus::Success;
+}
+
+/// @brief matrixProfileDiagonal without precomputed statistics; see the overload above.
+template <class S, class D, class I, class Instr = NoInstrumentation, class Exclusion = QuarterExclusion>
+MatrixProfileStatus matrixProfileDiagonal(
+    const xt::xexpression<S>& sequence,
+    size_t m,
+    xt::xexpression<D>& mp,
+    xt::xexpression<I>& mpi,
+    size_t num_threads = 1,
+    const ProgressCallback& progress = {},
+    Instr instr = {},
+    Exclusion exclusion = {},
+    Workspace* workspace = nullptr
+) {
+    return detail::withStats(sequence, m, instr, workspace, 0, [&](const auto& stats) {
+        return matrixProfileDiagonal(sequence, m, stats, mp, mpi, num_threads, progress, instr, exclusion, workspace);
+    });
+}
+
+/// @brief matrixProfileDiagonal that also fills the left and right matrix profiles in the same sweep:
+/// left_mp[i]/left_mpi[i] is the nearest neighbor of subsequence i that starts before it (j < i - m/4 by
+/// default), as an online detector sees it, and right_mp[i]/right_mpi[i] the nearest one after it (j > i + m/4).
+/// Each cell of a diagonal already updates one subsequence from the right and one from the left, so this only
+/// doubles the per-worker buffers. mp/mpi are the better of the two and bit-identical to the overload without
+/// them. Entries with no neighbor on that side remain at infinity and -1.
+///
+/// @param left_mp      Output left matrix profile, pre-allocated with size n-m+1.
+/// @param left_mpi     Output left matrix profile index, pre-allocated with size n-m+1.
+/// @param right_mp     Output right matrix profile, pre-allocated with size n-m+1.
+/// @param right_mpi    Output right matrix profile index, pre-allocated with size n-m+1.
+///
+/// The remaining parameters are those of matrixProfileDiagonal.
+template <class S, class D, class I, class LD, class LI, class RD, class RI, class T, class Acc, class Instr = NoInstrumentation,
+          class Exclusion = QuarterExclusion>
+MatrixProfileStatus matrixProfileDiagonal(
+    const xt::xexpression<S>& sequence,
+    size_t m,
+    const BasicSequenceStats<T, Acc>& stats,
+    xt::xexpression<D>& mp,
+    xt::xexpression<I>& mpi,
+    xt::xexpression<LD>& left_mp,
+    xt::xexpression<LI>& left_mpi,
+    xt::xexpression<RD>& right_mp,
+    xt::xexpression<RI>& right_mpi,
+    size_t num_threads = 1,
+    const ProgressCallback& progress = {},
+    Instr instr = {},
+    Exclusion exclusion = {},
+    Workspace* workspace = nullptr
+) {
+    static_assert(std::is_same_v<T, detail::compute_t<S>>, "stats must match the precision of the sequence");
+    static_assert(!std::is_same_v<Exclusion, NoExclusion>, "left and right neighbors need an exclusion zone");
+
+    auto& left_mp_   = left_mp.derived_cast();
+    auto& left_mpi_  = left_mpi.derived_cast();
+    auto& right_mp_  = right_mp.derived_cast();
+    auto& right_mpi_ = right_mpi.derived_cast();
+
+    const auto status = detail::checkLeftRightProfile(sequence, m, stats, mp, mpi, left_mp, left_mpi, right_mp, right_mpi);
+    if (status != MatrixProfileStatus::Success) return status;
+
+    const auto&  seq         = sequence.derived_cast();
+    auto&        mp_         = mp.derived_cast();
+    auto&        mpi_        = mpi.derived_cast();
+    const size_t profile_len = seq.size() - m + 1;
+
+    using idx_t = typename std::decay_t<decltype(mpi_)>::value_type;
+
+    Workspace  own;
+    Workspace& ws = workspace ? *workspace : own;
+
+    const auto centered = detail::centerSeries(seq, stats.mean(m), ws, detail::WorkspaceSlot::SeriesValues,
+                                               detail::WorkspaceSlot::SeriesMean, instr);
+    const T*   t        = centered.values;
+    const T*   mean     = centered.mean;
+    const T*   stddev   = stats.stddev(m).data();
+
+    detail::diagonalSelfJoin<true, idx_t>(t, mean, stddev, profile_len, m, exclusion.firstDiagonal(m), num_threads,
+                                          progress, instr, ws,
+                                          [&](size_t i, double left_d, idx_t left_j, double right_d, idx_t right_j) {
+        left_mp_[i]   = left_d;
+        left_mpi_[i]  = left_j;
+        right_mp_[i]  = right_d;
+        right_mpi_[i] = right_j;
+
+        // Left neighbors have the lower index, so they win ties as in the plain sweep.
+        const bool right_better = detail::isBetterNeighbor(right_d, right_j, left_d, left_j);
+        mp_[i]  = right_better ? right_d : left_d;
+        mpi_[i] = right_better ? right_j : left_j;
+    });
+
+    instr.finish();
+    return MatrixProfileStatus::Success;
+}
+
+/// @brief Left/right matrixProfileDiagonal without precomputed statistics; see the overload above.
+template <class S, class D, class I, class LD, class LI, class RD, class RI, class Instr = NoInstrumentation,
+          class Exclusion = QuarterExclusion>
+MatrixProfileStatus matrixProfileDiagonal(
+    const xt::xexpression<S>& sequence,
+    size_t m,
+    xt::xexpression<D>& mp,
+    xt::xexpression<I>& mpi,
+    xt::xexpression<LD>& left_mp,
+    xt::xexpression<LI>& left_mpi,
+    xt::xexpression<RD>& right_mp,
+    xt::xexpression<RI>& right_mpi,
+    size_t num_threads = 1,
+    const ProgressCallback& progress = {},
+    Instr instr = {},
+    Exclusion exclusion = {},
+    Workspace* workspace = nullptr
+) {
+    return detail::withStats(sequence, m, instr, workspace, 0, [&](const auto& stats) {
+        return matrixProfileDiagonal(sequence, m, stats, mp, mpi, left_mp, left_mpi, right_mp, right_mpi, num_threads,
+                                     progress, instr, exclusion, workspace);
+    });
+}
+
+/// @brief Compute the AB-join matrix profile: for every length-m subsequence of sequence_a, the distance to and
+/// index of its nearest neighbor among the subsequences of sequence_b. The two series are distinct, so by
+/// default there is no exclusion zone; an exclusion policy excludes |i - j| < firstDiagonal(m) as in a
+/// self-join, for series whose indices are aligned (a series joined with an altered copy of itself). Uses the
+/// same STOMP row sweep as matrixProfileStomp, so the cost is O(n_a * n_b), and ties go to the lowest index in
+/// sequence_b.
+///
+/// @param sequence_a   The query time series (1-D).
+/// @param sequence_b   The reference time series (1-D).
+/// @param m            Subsequence length.
+/// @param stats_a      Window statistics of sequence_a for length m (see SequenceStats).
+/// @param stats_b      Window statistics of sequence_b for length m.
+/// @param mp           Output matrix profile, pre-allocated with size n_a-m+1.
+/// @param mpi          Output matrix profile index into sequence_b, pre-allocated with size n_a-m+1.
+/// @param num_threads  Worker threads (0 for one per hardware thread).
+/// @param progress     Optional progress(done, total) callback counting finished row blocks.
+/// @param instr        Instrumentation policy, as for matrixProfileStomp.
+/// @param exclusion    Exclusion-zone policy; NoExclusion by default.
+/// @param workspace    Optional Workspace to take the centered series and per-worker rows (and, without stats,
+///                     the window statistics of both series) from, so repeated calls do not allocate.
+template <class A, class B, class D, class I, class T, class AccA, class AccB, class Instr = NoInstrumentation,
+          class Exclusion = NoExclusion>
+MatrixProfileStatus matrixProfileABJoin(
+    const xt::xexpression<A>& sequence_a,
+    const xt::xexpression<B>& sequence_b,
+    size_t m,
+    const BasicSequenceStats<T, AccA>& stats_a,
+    const BasicSequenceStats<T, AccB>& stats_b,
+    xt::xexpression<D>& mp,
+    xt::xexpression<I>& mpi,
+    size_t num_threads = 1,
+    const ProgressCallback& progress = {},
+    Instr instr = {},
+    Exclusion exclusion = {},
+    Workspace* workspace = nullptr
+) {
+    static_assert(xt::get_rank<A>::value == 1 || xt::get_rank<A>::value == SIZE_MAX, "sequence_a must be 1-dimensional");
+    static_assert(xt::get_rank<B>::value == 1 || xt::get_rank<B>::value == SIZE_MAX, "sequence_b must be 1-dimensional");
+    static_assert(xt::get_rank<D>::value == 1 || xt::get_rank<D>::value == SIZE_MAX, "mp must be 1-dimensional");
+    static_assert(xt::get_rank<I>::value == 1 || xt::get_rank<I>::value == SIZE_MAX, "mpi must be 1-dimensional");
+    static_assert(std::is_same_v<T, detail::compute_t<A>> && std::is_same_v<T, detail::compute_t<B>>,
+                  "both sequences and their stats must share one precision");
+
+    const auto& seq_a = sequence_a.derived_cast();
+    const auto& seq_b = sequence_b.derived_cast();
+    auto&       mp_   = mp.derived_cast();
+    auto&       mpi_  = mpi.derived_cast();
+
+    if (seq_a.dimension() != 1) return MatrixProfileStatus::SequenceNotOneDimensional;
+    if (seq_b.dimension() != 1) return MatrixProfileStatus::ReferenceNotOneDimensional;
+    if (m == 0)                 return MatrixProfileStatus::SubsequenceLengthZero;
+    if (m > seq_a.size())       return MatrixProfileStatus::SubsequenceLongerThanSequence;
+    if (m > seq_b.size())       return MatrixProfileStatus::SubsequenceLongerThanReference;
+    if (!stats_a.matches(seq_a.size(), m) || !stats_b.matches(seq_b.size(), m)) {
+        return MatrixProfileStatus::StatsMismatch;
     }
 
+    const size_t profile_len_a = seq_a.size() - m + 1;
+    const size_t profile_len_b = seq_b.size() - m + 1;
+
+    if (mp_.size()  != profile_len_a) return MatrixProfileStatus::DistanceWrongSize;
+    if (mpi_.size() != profile_len_a) return MatrixProfileStatus::IndexWrongSize;
+
+    using idx_t = typename std::decay_t<decltype(mpi_)>::value_type;
+
+    std::fill(mp_.begin(),  mp_.end(),  std::numeric_limits<double>::infinity());
+    std::fill(mpi_.begin(), mpi_.end(), static_cast<idx_t>(-1));
+
+    Workspace  own;
+    Workspace& ws = workspace ? *workspace : own;
+
+    // Shifting each series by its own constant leaves every z-normalized distance unchanged.
+    const auto a = detail::centerSeries(seq_a, stats_a.mean(m), ws, detail::WorkspaceSlot::SeriesValues,
+                                        detail::WorkspaceSlot::SeriesMean, instr);
+    const auto b = detail::centerSeries(seq_b, stats_b.mean(m), ws, detail::WorkspaceSlot::ReferenceValues,
+                                        detail::WorkspaceSlot::ReferenceMean, instr);
+
+    const size_t first_diag = exclusion.firstDiagonal(m);
+
+    detail::stompSweep(
+        a.values, a.mean, stats_a.stddev(m).data(), profile_len_a,
+        b.values, b.mean, stats_b.stddev(m).data(), profile_len_b,
+        m, num_threads,
+        [&](size_t i, const T* dist) {
+            const ArgMin best = detail::nearestOutsideExclusion(dist, profile_len_b, i, first_diag);
+            if (best.index != SIZE_MAX) {
+                mp_[i]  = best.value;
+                mpi_[i] = static_cast<idx_t>(best.index);
+            }
+        },
+        progress, instr, &ws);
+
+    instr.finish();
     return MatrixProfileStatus::Success;
 }
 
-} // namespace MPCC
\ No newline at end of file
+/// @brief matrixProfileABJoin without precomputed statistics; see the overload above.
+template <class A, class B, class D, class I, class Instr = NoInstrumentation, class Exclusion = NoExclusion>
+MatrixProfileStatus matrixProfileABJoin(
+    const xt::xexpression<A>& sequence_a,
+    const xt::xexpression<B>& sequence_b,
+    size_t m,
+    xt::xexpression<D>& mp,
+    xt::xexpression<I>& mpi,
+    size_t num_threads = 1,
+    const ProgressCallback& progress = {},
+    Instr instr = {},
+    Exclusion exclusion = {},
+    Workspace* workspace = nullptr
+) {
+    return detail::withStats(sequence_a, m, instr, workspace, 0, [&](const auto& stats_a) {
+        return detail::withStats(sequence_b, m, instr, workspace, 1, [&](const auto& stats_b) {
+            return matrixProfileABJoin(sequence_a, sequence_b, m, stats_a, stats_b, mp, mpi, num_threads, progress,
+                                       instr, exclusion, workspace);
+        });
+    });
+}
+
+} // namespace MPCC
@@ -0,0 +1,217 @@
+// Benchmarks for the similarity searches and every matrix profile engine, across series lengths, subsequence
+// lengths and thread counts. Run with
+//
+//     bazel run -c opt //core:matrix_profile_bench -- --benchmark_filter=Diagonal
+//
+// Items per second count distance-matrix cells (profile_len^2 for a self-join), so engines of the same
+// complexity are directly comparable and a regression in any kernel shows up as a lower rate.
+
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+#include <random>
+#include <span>
+#include <vector>
+#include <xtensor/containers/xtensor.hpp>
+
+#include "core/anytime_matrix_profile.h"
+#include "core/matrix_profile.h"
+#include "core/multidim_matrix_profile.h"
+#include "core/pan_matrix_profile.h"
+
+namespace {
+
+// A random walk, the usual stand-in for real series: random enough that ties are rare, smooth enough that
+// the windows have realistic statistics.
+xt::xtensor<double, 1> randomWalk(size_t n, uint32_t seed = 42) {
+    std::mt19937                     rng(seed);
+    std::normal_distribution<double> step;
+    xt::xtensor<double, 1>           series = xt::empty<double>({n});
+    double value = 0.0;
+    for (size_t i = 0; i < n; i++) {
+        value += step(rng);
+        series(i) = value;
+    }
+    return series;
+}
+
+void setCells(benchmark::State& state, size_t rows, size_t cols) {
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) * static_cast<int64_t>(rows * cols));
+}
+
+// Arguments: n, m.
+void BM_SimilaritySearch(benchmark::State& state) {
+    const size_t n = state.range(0);
+    const size_t m = state.range(1);
+
+    const auto sequence = randomWalk(n);
+    const auto query    = randomWalk(m, 7);
+    const MPCC::SequenceStats stats(sequence, m);
+    xt::xtensor<double, 1> dist = xt::empty<double>({n - m + 1});
+
+    for (auto _ : state) {
+        MPCC::similaritySearch(sequence, query, stats, dist);
+        benchmark::DoNotOptimize(dist.data());
+    }
+    setCells(state, 1, n - m + 1);
+}
+
+void BM_SimilaritySearchMass(benchmark::State& state) {
+    const size_t n = state.range(0);
+    const size_t m = state.range(1);
+
+    const auto sequence = randomWalk(n);
+    const auto query    = randomWalk(m, 7);
+    const MPCC::SequenceStats stats(sequence, m);
+    xt::xtensor<double, 1> dist = xt::empty<double>({n - m + 1});
+
+    for (auto _ : state) {
+        MPCC::similaritySearchMass(sequence, query, stats, dist);
+        benchmark::DoNotOptimize(dist.data());
+    }
+    setCells(state, 1, n - m + 1);
+}
+
+// Self-join engines sharing the (sequence, m, stats, mp, mpi, num_threads) signature. Arguments: n, m,
+// num_threads.
+template <class Engine>
+void runSelfJoin(benchmark::State& state, Engine engine) {
+    const size_t n           = state.range(0);
+    const size_t m           = state.range(1);
+    const size_t num_threads = state.range(2);
+    const size_t profile_len = n - m + 1;
+
+    const auto sequence = randomWalk(n);
+    const MPCC::SequenceStats stats(sequence, m);
+    xt::xtensor<double, 1>  mp  = xt::empty<double>({profile_len});
+    xt::xtensor<int64_t, 1> mpi = xt::empty<int64_t>({profile_len});
+
+    for (auto _ : state) {
+        engine(sequence, m, stats, mp, mpi, num_threads);
+        benchmark::DoNotOptimize(mp.data());
+        benchmark::DoNotOptimize(mpi.data());
+    }
+    setCells(state, profile_len, profile_len);
+}
+
+void BM_MatrixProfileNaive(benchmark::State& state) {
+    runSelfJoin(state, [](const auto& seq, size_t m, const auto& stats, auto& mp, auto& mpi, size_t threads) {
+        return MPCC::matrixProfileNaive(seq, m, stats, mp, mpi, threads);
+    });
+}
+
+void BM_MatrixProfileStomp(benchmark::State& state) {
+    runSelfJoin(state, [](const auto& seq, size_t m, const auto& stats, auto& mp, auto& mpi, size_t threads) {
+        return MPCC::matrixProfileStomp(seq, m, stats, mp, mpi, threads);
+    });
+}
+
+void BM_MatrixProfileDiagonal(benchmark::State& state) {
+    runSelfJoin(state, [](const auto& seq, size_t m, const auto& stats, auto& mp, auto& mpi, size_t threads) {
+        return MPCC::matrixProfileDiagonal(seq, m, stats, mp, mpi, threads);
+    });
+}
+
+void BM_MatrixProfileAnytime(benchmark::State& state) {
+    runSelfJoin(state, [](const auto& seq, size_t m, const auto& stats, auto& mp, auto& mpi, size_t threads) {
+        return MPCC::matrixProfileAnytime(seq, m, stats, mp, mpi, MPCC::AnytimeOptions{}, threads);
+    });
+}
+
+// Arguments: n (both series), m, num_threads.
+void BM_MatrixProfileABJoin(benchmark::State& state) {
+    const size_t n           = state.range(0);
+    const size_t m           = state.range(1);
+    const size_t num_threads = state.range(2);
+    const size_t profile_len = n - m + 1;
+
+    const auto a = randomWalk(n);
+    const auto b = randomWalk(n, 7);
+    const MPCC::SequenceStats stats_a(a, m);
+    const MPCC::SequenceStats stats_b(b, m);
+    xt::xtensor<double, 1>  mp  = xt::empty<double>({profile_len});
+    xt::xtensor<int64_t, 1> mpi = xt::empty<int64_t>({profile_len});
+
+    for (auto _ : state) {
+        MPCC::matrixProfileABJoin(a, b, m, stats_a, stats_b, mp, mpi, num_threads);
+        benchmark::DoNotOptimize(mp.data());
+    }
+    setCells(state, profile_len, profile_len);
+}
+
+// Eight lengths from m to 2m. Arguments: n, m, num_threads. Items count the cells of the shortest length
+// once per row.
+void BM_PanMatrixProfile(benchmark::State& state) {
+    const size_t n           = state.range(0);
+    const size_t m           = state.range(1);
+    const size_t num_threads = state.range(2);
+
+    std::vector<size_t> lengths;
+    for (size_t r = 0; r < 8; r++) lengths.push_back(m + r * m / 7);
+
+    const auto   sequence    = randomWalk(n);
+    const size_t profile_len = n - lengths.front() + 1;
+    const MPCC::SequenceStats stats(sequence, std::span<const size_t>(lengths));
+    xt::xtensor<double, 2>  mp  = xt::empty<double>({lengths.size(), profile_len});
+    xt::xtensor<int64_t, 2> mpi = xt::empty<int64_t>({lengths.size(), profile_len});
+
+    for (auto _ : state) {
+        MPCC::panMatrixProfile(sequence, std::span<const size_t>(lengths), stats, mp, mpi, num_threads);
+        benchmark::DoNotOptimize(mp.data());
+    }
+    setCells(state, lengths.size() * profile_len, profile_len);
+}
+
+// Eight channels. Arguments: n, m, num_threads.
+void BM_MatrixProfileMultidim(benchmark::State& state) {
+    constexpr size_t d           = 8;
+    const size_t     n           = state.range(0);
+    const size_t     m           = state.range(1);
+    const size_t     num_threads = state.range(2);
+    const size_t     profile_len = n - m + 1;
+
+    xt::xtensor<double, 2> sequences = xt::empty<double>({d, n});
+    for (size_t c = 0; c < d; c++) {
+        const auto channel = randomWalk(n, static_cast<uint32_t>(c));
+        for (size_t t = 0; t < n; t++) sequences(c, t) = channel(t);
+    }
+    xt::xtensor<double, 2>  mp  = xt::empty<double>({d, profile_len});
+    xt::xtensor<int64_t, 2> mpi = xt::empty<int64_t>({d, profile_len});
+
+    for (auto _ : state) {
+        MPCC::matrixProfileMultidim(sequences, m, mp, mpi, MPCC::ChannelLayout::ChannelMajor, num_threads);
+        benchmark::DoNotOptimize(mp.data());
+    }
+    setCells(state, d * profile_len, profile_len);
+}
+
+// n x m grid for the searches.
+void searchArgs(benchmark::internal::Benchmark* b) {
+    for (int64_t n : {1 << 12, 1 << 16, 1 << 20}) {
+        for (int64_t m : {16, 128, 1024}) b->Args({n, m});
+    }
+}
+
+// n x m x threads grid for the O(n^2) engines; MaxN keeps the slower ones to sizes that finish quickly.
+template <int64_t MaxN>
+void profileArgs(benchmark::internal::Benchmark* b) {
+    for (int64_t n : {1 << 12, 1 << 14, 1 << 16}) {
+        if (n > MaxN) continue;
+        for (int64_t m : {16, 128}) {
+            for (int64_t threads : {1, 4, 0}) b->Args({n, m, threads});
+        }
+    }
+    b->ArgNames({"n", "m", "threads"})->Unit(benchmark::kMillisecond)->UseRealTime();
+}
+
+} // namespace
+
+BENCHMARK(BM_SimilaritySearch)->Apply(searchArgs)->ArgNames({"n", "m"});
+BENCHMARK(BM_SimilaritySearchMass)->Apply(searchArgs)->ArgNames({"n", "m"});
+BENCHMARK(BM_MatrixProfileNaive)->Apply(profileArgs<1 << 12>);
+BENCHMARK(BM_MatrixProfileStomp)->Apply(profileArgs<1 << 16>);
+BENCHMARK(BM_MatrixProfileDiagonal)->Apply(profileArgs<1 << 16>);
+BENCHMARK(BM_MatrixProfileAnytime)->Apply(profileArgs<1 << 16>);
+BENCHMARK(BM_MatrixProfileABJoin)->Apply(profileArgs<1 << 16>);
+BENCHMARK(BM_PanMatrixProfile)->Apply(profileArgs<1 << 14>);
+BENCHMARK(BM_MatrixProfileMultidim)->Apply(profileArgs<1 << 14>);
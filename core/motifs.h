@@ -0,0 +1,286 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <mutex>
+#include <queue>
+#include <utility>
+#include <vector>
+
+#include "core/matrix_profile.h"
+
+namespace MPCC {
+
+/// @brief A motif or discord picked from a matrix profile: subsequence index, its nearest neighbor
+/// (mpi[index]) and the distance between them (mp[index]).
+struct ProfileMatch {
+    size_t  index;
+    int64_t neighbor;
+    double  distance;
+};
+
+namespace detail {
+
+/// @brief The capacity best (distance, index) entries offered, kept in a bounded heap: the smallest
+/// distances, or the largest with kLargest, with ties going to the lower index either way.
+template <bool kLargest>
+class BestEntries {
+public:
+    explicit BestEntries(size_t capacity) : capacity_(capacity) {}
+
+    void offer(double d, size_t i) {
+        if (capacity_ == 0) return;
+        // The heap is a max-heap on its key, so its top is the worst retained entry; negating the distance
+        // makes the same heap keep the largest ones.
+        const Key key{kLargest ? -d : d, i};
+        if (heap_.size() < capacity_) {
+            heap_.push(key);
+        } else if (key < heap_.top()) {
+            heap_.pop();
+            heap_.push(key);
+        }
+    }
+
+    /// @brief The retained entries, best first. Empties the heap.
+    std::vector<std::pair<double, size_t>> ranked() {
+        std::vector<std::pair<double, size_t>> entries;
+        entries.reserve(heap_.size());
+        while (!heap_.empty()) {
+            const auto [key, i] = heap_.top();
+            entries.emplace_back(kLargest ? -key : key, i);
+            heap_.pop();
+        }
+        std::reverse(entries.begin(), entries.end());
+        return entries;
+    }
+
+private:
+    using Key = std::pair<double, size_t>;
+
+    size_t                  capacity_;
+    std::priority_queue<Key> heap_;
+};
+
+inline bool withinExclusion(size_t i, size_t c, size_t exclusion) {
+    return (i > c ? i - c : c - i) <= exclusion;
+}
+
+/// @brief The greedy discord selection over ranked entries of mpi: best first, skipping entries within
+/// exclusion of an earlier pick.
+template <class I>
+void pickDiscords(const std::vector<std::pair<double, size_t>>& ranked, const I& mpi, size_t k, size_t exclusion,
+                  std::vector<ProfileMatch>& discords) {
+    for (const auto& [d, i] : ranked) {
+        if (discords.size() == k) break;
+        const bool excluded = std::any_of(discords.begin(), discords.end(), [&](const ProfileMatch& c) {
+            return withinExclusion(i, c.index, exclusion);
+        });
+        if (!excluded) discords.push_back({i, static_cast<int64_t>(mpi[i]), d});
+    }
+}
+
+} // namespace detail
+
+/// @brief The top-k motifs of a matrix profile: the subsequences with the smallest profile distances, best
+/// first, ties to the lowest index. Picks are greedy, each ruling out every subsequence within exclusion of
+/// the pick or of its neighbor, so one motif pair (i, mpi[i]) is reported once, from its first member. This
+/// is the same as repeatedly taking the argmin of mp and masking those two zones, but done in a single pass
+/// over mp with a bounded heap of (k - 1) * 2 * (2 * exclusion + 1) + 1 candidates, the most that k picks
+/// can ever look at. Entries without a neighbor (mpi -1) or with a non-finite distance are never picked.
+///
+/// @param mp         Matrix profile (1-D).
+/// @param mpi        Matrix profile index, the same size as mp.
+/// @param k          Motifs to find. Fewer are returned if the profile runs out of candidates.
+/// @param exclusion  Minimum separation between picks, in subsequences; m / 4 matches the engines'
+///                   exclusion zone, m keeps motifs from overlapping at all.
+/// @param motifs     Output, replaced with up to k motifs.
+/// @return DistanceWrongSize if mp is not 1-D; IndexWrongSize if mpi does not match it.
+template <class D, class I>
+MatrixProfileStatus findMotifs(
+    const xt::xexpression<D>& mp,
+    const xt::xexpression<I>& mpi,
+    size_t k,
+    size_t exclusion,
+    std::vector<ProfileMatch>& motifs
+) {
+    static_assert(xt::get_rank<D>::value == 1 || xt::get_rank<D>::value == SIZE_MAX, "mp must be 1-dimensional");
+    static_assert(xt::get_rank<I>::value == 1 || xt::get_rank<I>::value == SIZE_MAX, "mpi must be 1-dimensional");
+
+    const auto& mp_  = mp.derived_cast();
+    const auto& mpi_ = mpi.derived_cast();
+
+    motifs.clear();
+    if (mp_.dimension() != 1)        return MatrixProfileStatus::DistanceWrongSize;
+    if (mpi_.size() != mp_.size())   return MatrixProfileStatus::IndexWrongSize;
+
+    const size_t profile_len = mp_.size();
+    detail::BestEntries<false> best(detail::selectionCapacity(k, 2 * (2 * exclusion + 1), profile_len));
+    for (size_t i = 0; i < profile_len; i++) {
+        const double d = static_cast<double>(mp_[i]);
+        if (std::isfinite(d) && mpi_[i] >= 0) best.offer(d, i);
+    }
+
+    for (const auto& [d, i] : best.ranked()) {
+        if (motifs.size() == k) break;
+        const bool excluded = std::any_of(motifs.begin(), motifs.end(), [&](const ProfileMatch& c) {
+            return detail::withinExclusion(i, c.index, exclusion)
+                || detail::withinExclusion(i, static_cast<size_t>(c.neighbor), exclusion);
+        });
+        if (!excluded) motifs.push_back({i, static_cast<int64_t>(mpi_[i]), d});
+    }
+    return MatrixProfileStatus::Success;
+}
+
+/// @brief The top-k discords of a matrix profile: the subsequences farthest from their nearest neighbor,
+/// largest distance first, ties to the lowest index, each pick ruling out every subsequence within
+/// exclusion of it. Like findMotifs, a single pass over mp with a bounded heap of
+/// (k - 1) * (2 * exclusion + 1) + 1 candidates. Entries with a non-finite distance (no neighbor) are
+/// never picked.
+///
+/// @param mp         Matrix profile (1-D).
+/// @param mpi        Matrix profile index, the same size as mp.
+/// @param k          Discords to find. Fewer are returned if the profile runs out of candidates.
+/// @param exclusion  Minimum separation between picks, in subsequences.
+/// @param discords   Output, replaced with up to k discords.
+/// @return DistanceWrongSize if mp is not 1-D; IndexWrongSize if mpi does not match it.
+template <class D, class I>
+MatrixProfileStatus findDiscords(
+    const xt::xexpression<D>& mp,
+    const xt::xexpression<I>& mpi,
+    size_t k,
+    size_t exclusion,
+    std::vector<ProfileMatch>& discords
+) {
+    static_assert(xt::get_rank<D>::value == 1 || xt::get_rank<D>::value == SIZE_MAX, "mp must be 1-dimensional");
+    static_assert(xt::get_rank<I>::value == 1 || xt::get_rank<I>::value == SIZE_MAX, "mpi must be 1-dimensional");
+
+    const auto& mp_  = mp.derived_cast();
+    const auto& mpi_ = mpi.derived_cast();
+
+    discords.clear();
+    if (mp_.dimension() != 1)        return MatrixProfileStatus::DistanceWrongSize;
+    if (mpi_.size() != mp_.size())   return MatrixProfileStatus::IndexWrongSize;
+
+    const size_t profile_len = mp_.size();
+    detail::BestEntries<true> best(detail::selectionCapacity(k, 2 * exclusion + 1, profile_len));
+    for (size_t i = 0; i < profile_len; i++) {
+        const double d = static_cast<double>(mp_[i]);
+        if (std::isfinite(d)) best.offer(d, i);
+    }
+
+    detail::pickDiscords(best.ranked(), mpi_, k, exclusion, discords);
+    return MatrixProfileStatus::Success;
+}
+
+/// @brief matrixProfileStomp that also finds the top-k discords while it sweeps, without a second pass over
+/// the profile. STOMP completes one row of the distance matrix at a time, so each row's nearest neighbor is
+/// final as soon as the row is done and goes straight into the discord heap. The profile and the discords
+/// are exactly those of matrixProfileStomp followed by findDiscords.
+///
+/// @param sequence     The input time series (1-D).
+/// @param m            Subsequence length.
+/// @param stats        Window statistics of sequence for length m (see SequenceStats). The overload
+///                     without it computes them.
+/// @param k            Discords to find.
+/// @param exclusion    Minimum separation between discords, in subsequences (see findDiscords).
+/// @param mp           Output matrix profile, pre-allocated with size n-m+1.
+/// @param mpi          Output matrix profile index, pre-allocated with size n-m+1.
+/// @param discords     Output, replaced with up to k discords.
+/// @param num_threads  Worker threads (0 for one per hardware thread).
+/// @param progress     Optional progress(done, total) callback counting finished row blocks.
+/// @param zone         Exclusion-zone policy of the profile (see QuarterExclusion), as for matrixProfileStomp.
+///                     Distinct from exclusion, which only spaces out the discords picked from it.
+template <class S, class D, class I, class T, class Acc, class Exclusion = QuarterExclusion>
+MatrixProfileStatus matrixProfileDiscords(
+    const xt::xexpression<S>& sequence,
+    size_t m,
+    const BasicSequenceStats<T, Acc>& stats,
+    size_t k,
+    size_t exclusion,
+    xt::xexpression<D>& mp,
+    xt::xexpression<I>& mpi,
+    std::vector<ProfileMatch>& discords,
+    size_t num_threads = 1,
+    const ProgressCallback& progress = {},
+    Exclusion zone = {}
+) {
+    static_assert(xt::get_rank<S>::value == 1 || xt::get_rank<S>::value == SIZE_MAX, "sequence must be 1-dimensional");
+    static_assert(xt::get_rank<D>::value == 1 || xt::get_rank<D>::value == SIZE_MAX, "mp must be 1-dimensional");
+    static_assert(xt::get_rank<I>::value == 1 || xt::get_rank<I>::value == SIZE_MAX, "mpi must be 1-dimensional");
+    static_assert(std::is_same_v<T, detail::compute_t<S>>, "stats must match the precision of the sequence");
+
+    const auto& seq = sequence.derived_cast();
+    auto&       mp_ = mp.derived_cast();
+    auto&       mpi_= mpi.derived_cast();
+
+    discords.clear();
+    if (seq.dimension() != 1) return MatrixProfileStatus::SequenceNotOneDimensional;
+    if (m == 0)               return MatrixProfileStatus::SubsequenceLengthZero;
+    if (m > seq.size())       return MatrixProfileStatus::SubsequenceLongerThanSequence;
+    if (!stats.matches(seq.size(), m)) return MatrixProfileStatus::StatsMismatch;
+
+    const size_t profile_len = seq.size() - m + 1;
+
+    if (mp_.size()  != profile_len) return MatrixProfileStatus::DistanceWrongSize;
+    if (mpi_.size() != profile_len) return MatrixProfileStatus::IndexWrongSize;
+
+    using idx_t = typename std::decay_t<decltype(mpi_)>::value_type;
+    using mp_t  = typename std::decay_t<decltype(mp_)>::value_type;
+
+    const size_t first_diag = zone.firstDiagonal(m);
+
+    std::fill(mp_.begin(),  mp_.end(),  std::numeric_limits<double>::infinity());
+    std::fill(mpi_.begin(), mpi_.end(), static_cast<idx_t>(-1));
+
+    const auto centered = detail::centerSeries(seq, stats.mean(m));
+    const T*   t        = centered.values.data();
+    const T*   mean     = centered.mean.data();
+    const T*   stddev   = stats.stddev(m).data();
+
+    // Rows finish on any worker; one offer per O(n) row keeps the lock uncontended.
+    detail::BestEntries<true> best(detail::selectionCapacity(k, 2 * exclusion + 1, profile_len));
+    std::mutex best_mutex;
+
+    detail::stompSweep(
+        t, mean, stddev, profile_len,
+        t, mean, stddev, profile_len,
+        m, num_threads,
+        [&](size_t i, const T* dist) {
+            const ArgMin best_row = detail::nearestOutsideExclusion(dist, profile_len, i, first_diag);
+            if (best_row.index == SIZE_MAX) return;
+            mp_[i]  = best_row.value;
+            mpi_[i] = static_cast<idx_t>(best_row.index);
+
+            // Offer the value as stored, so the ranking matches findDiscords on the finished profile.
+            const double d = static_cast<double>(static_cast<mp_t>(best_row.value));
+            if (!std::isfinite(d)) return;
+            std::lock_guard lock(best_mutex);
+            best.offer(d, i);
+        },
+        progress);
+
+    detail::pickDiscords(best.ranked(), mpi_, k, exclusion, discords);
+    return MatrixProfileStatus::Success;
+}
+
+/// @brief matrixProfileDiscords without precomputed statistics; see the overload above.
+template <class S, class D, class I, class Exclusion = QuarterExclusion>
+MatrixProfileStatus matrixProfileDiscords(
+    const xt::xexpression<S>& sequence,
+    size_t m,
+    size_t k,
+    size_t exclusion,
+    xt::xexpression<D>& mp,
+    xt::xexpression<I>& mpi,
+    std::vector<ProfileMatch>& discords,
+    size_t num_threads = 1,
+    const ProgressCallback& progress = {},
+    Exclusion zone = {}
+) {
+    return matrixProfileDiscords(sequence, m, detail::StatsFor<S>(sequence, m), k, exclusion, mp, mpi, discords,
+                                 num_threads, progress, zone);
+}
+
+} // namespace MPCC
@@ -0,0 +1,224 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <utility>
+#include <vector>
+
+#include "core/matrix_profile.h"
+
+namespace MPCC {
+
+/// @brief Which axis of a multi-channel series is time. ChannelMajor is a (d x n) array with one row per
+/// channel, TimeMajor an (n x d) array with one row per sample, as multi-column CSV files are laid out.
+enum class ChannelLayout {
+    ChannelMajor,
+    TimeMajor,
+};
+
+namespace detail {
+
+/// @brief Columns of the distance matrix combined at a time by matrixProfileMultidim. The per-channel
+/// distances of a block are d * kMultidimColumnBlock values, small enough to stay in cache while each
+/// column's d distances are gathered, sorted and accumulated.
+constexpr size_t kMultidimColumnBlock = 256;
+
+/// @brief Sort the d values of v ascending. d is a few dozen channels at most, where insertion sort beats
+/// std::sort, and it stays well defined when NaNs (non-finite data) are present.
+inline void sortChannels(double* v, size_t d) {
+    for (size_t a = 1; a < d; a++) {
+        const double x = v[a];
+        size_t b = a;
+        for (; b > 0 && x < v[b - 1]; b--) v[b] = v[b - 1];
+        v[b] = x;
+    }
+}
+
+} // namespace detail
+
+/// @brief Compute the multidimensional matrix profile (mSTAMP) of a d-channel series. Row k-1 of mp holds
+/// the k-dimensional profile: mp(k-1, i) is the smallest, over subsequences j outside the exclusion zone
+/// (m/4 by default), of the root mean square of the k smallest per-channel z-normalized distances between windows i
+/// and j, and mpi(k-1, i) is that j (ties to the lowest index). Row 0 is thus the best match on any single
+/// channel and row d-1 the best match across all of them.
+///
+/// All channels are swept together, STOMP-style: every row of the distance matrix updates each channel's
+/// dot products in O(1) per column, converts them to distances with the SIMD kernel into a channel-major
+/// block of kMultidimColumnBlock columns, then takes each column's d distances, sorts them and accumulates
+/// them into all d profiles at once. Rows run in independent blocks across num_threads workers, and the
+/// output is bit-identical for every thread count.
+///
+/// @param sequences    The series, (d x n) for ChannelMajor or (n x d) for TimeMajor. Any strides.
+/// @param m            Subsequence length.
+/// @param mp           Output profiles, pre-allocated with shape (d, n-m+1).
+/// @param mpi          Output profile indices, with the same shape as mp. Entries remain -1 if no neighbor
+///                     outside the exclusion zone exists.
+/// @param layout       Which axis of sequences is time.
+/// @param num_threads  Worker threads (0 for one per hardware thread).
+/// @param progress     Optional progress(done, total) callback counting finished row blocks.
+/// @param exclusion    Exclusion-zone policy (see QuarterExclusion); the columns of each row's excluded
+///                     diagonals are skipped.
+template <class S, class D, class I, class Exclusion = QuarterExclusion>
+MatrixProfileStatus matrixProfileMultidim(
+    const xt::xexpression<S>& sequences,
+    size_t m,
+    xt::xexpression<D>& mp,
+    xt::xexpression<I>& mpi,
+    ChannelLayout layout = ChannelLayout::ChannelMajor,
+    size_t num_threads = 1,
+    const ProgressCallback& progress = {},
+    Exclusion exclusion = {}
+) {
+    static_assert(xt::get_rank<S>::value == 2 || xt::get_rank<S>::value == SIZE_MAX, "sequences must be 2-dimensional");
+    static_assert(xt::get_rank<D>::value == 2 || xt::get_rank<D>::value == SIZE_MAX, "mp must be 2-dimensional");
+    static_assert(xt::get_rank<I>::value == 2 || xt::get_rank<I>::value == SIZE_MAX, "mpi must be 2-dimensional");
+
+    using T = detail::compute_t<S>;
+
+    const auto& seq  = sequences.derived_cast();
+    auto&       mp_  = mp.derived_cast();
+    auto&       mpi_ = mpi.derived_cast();
+
+    if (seq.dimension() != 2)  return MatrixProfileStatus::SequenceNotTwoDimensional;
+    if (mp_.dimension() != 2)  return MatrixProfileStatus::DistanceNotTwoDimensional;
+    if (mpi_.dimension() != 2) return MatrixProfileStatus::IndexNotTwoDimensional;
+
+    const bool   time_major = layout == ChannelLayout::TimeMajor;
+    const size_t d          = seq.shape()[time_major ? 1 : 0];
+    const size_t n          = seq.shape()[time_major ? 0 : 1];
+
+    if (m == 0) return MatrixProfileStatus::SubsequenceLengthZero;
+    if (m > n)  return MatrixProfileStatus::SubsequenceLongerThanSequence;
+
+    const size_t profile_len = n - m + 1;
+
+    if (mp_.shape()[0]  != d || mp_.shape()[1]  != profile_len) return MatrixProfileStatus::DistanceWrongSize;
+    if (mpi_.shape()[0] != d || mpi_.shape()[1] != profile_len) return MatrixProfileStatus::IndexWrongSize;
+
+    using idx_t = typename std::decay_t<decltype(mpi_)>::value_type;
+
+    const size_t first_diag = exclusion.firstDiagonal(m);
+
+    // Each channel gathered into its own contiguous, centered row (see centerSeries), with its statistics.
+    std::vector<std::vector<T>> x(d), mean(d), stddev(d);
+    for (size_t c = 0; c < d; c++) {
+        std::vector<T> channel(n);
+        for (size_t t = 0; t < n; t++) channel[t] = static_cast<T>(time_major ? seq(t, c) : seq(c, t));
+
+        const auto channel_xt = xt::adapt(channel.data(), n, xt::no_ownership(), std::vector<size_t>{n});
+        const BasicSequenceStats<T> stats(channel_xt, m);
+        auto centered = detail::centerSeries(channel_xt, stats.mean(m));
+        x[c]      = std::move(centered.values);
+        mean[c]   = std::move(centered.mean);
+        stddev[c].assign(stats.stddev(m).begin(), stats.stddev(m).end());
+    }
+
+    const auto& kern = kernels::active<T>();
+
+    // Column 0 of every row, per channel.
+    std::vector<std::vector<T>> first_col(d, std::vector<T>(profile_len));
+    for (size_t c = 0; c < d; c++) {
+        for (size_t i = 0; i < profile_len; i++) first_col[c][i] = kern.dot(x[c].data() + i, x[c].data(), m);
+    }
+
+    const size_t num_workers = resolveThreadCount(num_threads);
+    const size_t num_blocks  = (profile_len + detail::kStompRowBlock - 1) / detail::kStompRowBlock;
+    const size_t col_block   = std::min(profile_len, detail::kMultidimColumnBlock);
+
+    // Per-worker scratch: each channel's previous and current dot-product rows, a block of distances
+    // (channel-major, col_block per channel), one column's sorted squared distances, and the row's best
+    // mean squared distance and neighbor for every k.
+    struct Scratch {
+        std::vector<std::vector<T>> prev, cur;
+        std::vector<T>      dist;
+        std::vector<double> column, best;
+        std::vector<idx_t>  best_j;
+    };
+    std::vector<Scratch> scratch(num_workers);
+    for (auto& sc : scratch) {
+        sc.prev.assign(d, std::vector<T>(profile_len));
+        sc.cur.assign(d, std::vector<T>(profile_len));
+        sc.dist.resize(d * col_block);
+        sc.column.resize(d);
+        sc.best.resize(d);
+        sc.best_j.resize(d);
+    }
+
+    detail::parallelFor(num_blocks, num_workers, [&](size_t block, size_t worker) {
+        auto&        sc        = scratch[worker];
+        const size_t row_begin = block * detail::kStompRowBlock;
+        const size_t row_end   = std::min(row_begin + detail::kStompRowBlock, profile_len);
+
+        for (size_t c = 0; c < d; c++) {
+            const T* a = x[c].data();
+            for (size_t j = 0; j < profile_len; j++) sc.cur[c][j] = kern.dot(a + row_begin, a + j, m);
+        }
+
+        for (size_t i = row_begin; i < row_end; i++) {
+            if (i > row_begin) {
+                for (size_t c = 0; c < d; c++) {
+                    std::swap(sc.prev[c], sc.cur[c]);
+                    const T* a     = x[c].data();
+                    const T* prev  = sc.prev[c].data();
+                    T*       cur   = sc.cur[c].data();
+                    const T  drop  = a[i - 1];
+                    const T  admit = a[i + m - 1];
+                    cur[0] = first_col[c][i];
+                    for (size_t j = 1; j < profile_len; j++) {
+                        cur[j] = prev[j - 1] - drop * a[j - 1] + admit * a[j + m - 1];
+                    }
+                }
+            }
+
+            std::fill(sc.best.begin(), sc.best.end(), std::numeric_limits<double>::infinity());
+            std::fill(sc.best_j.begin(), sc.best_j.end(), static_cast<idx_t>(-1));
+
+            const auto [left_end, right_begin] = detail::candidateRanges(i, profile_len, first_diag);
+
+            for (size_t begin = 0; begin < profile_len; begin += col_block) {
+                const size_t end = std::min(begin + col_block, profile_len);
+                // Blocks wholly inside the excluded diagonals are skipped, the others split around them.
+                if (begin >= left_end && end <= right_begin) continue;
+
+                for (size_t c = 0; c < d; c++) {
+                    kern.distances(sc.cur[c].data() + begin, mean[c].data() + begin, stddev[c].data() + begin,
+                                   end - begin, m, mean[c][i], stddev[c][i], sc.dist.data() + c * col_block);
+                }
+
+                for (const auto& [lo, hi] : {std::pair{begin, std::min(end, left_end)},
+                                             std::pair{std::max(begin, right_begin), end}}) {
+                    for (size_t j = lo; j < hi; j++) {
+                        const size_t jj = j - begin;
+                        for (size_t c = 0; c < d; c++) {
+                            const double dist_c = static_cast<double>(sc.dist[c * col_block + jj]);
+                            sc.column[c] = dist_c * dist_c;
+                        }
+                        detail::sortChannels(sc.column.data(), d);
+
+                        // The k-dimensional candidate is the mean of the k smallest squared distances;
+                        // comparing means of squares picks the same neighbor as comparing their roots.
+                        double sum = 0.0;
+                        for (size_t k = 0; k < d; k++) {
+                            sum += sc.column[k];
+                            const double candidate = sum / static_cast<double>(k + 1);
+                            if (candidate < sc.best[k]) {
+                                sc.best[k]   = candidate;
+                                sc.best_j[k] = static_cast<idx_t>(j);
+                            }
+                        }
+                    }
+                }
+            }
+
+            for (size_t k = 0; k < d; k++) {
+                mp_(k, i)  = std::sqrt(sc.best[k]);
+                mpi_(k, i) = sc.best_j[k];
+            }
+        }
+    }, progress);
+
+    return MatrixProfileStatus::Success;
+}
+
+} // namespace MPCC
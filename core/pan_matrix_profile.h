@@ -0,0 +1,289 @@
+#pragma once
+
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <numeric>
+#include <span>
+#include <vector>
+
+#include "core/matrix_profile.h"
+
+namespace MPCC {
+
+/// @brief Called by panMatrixProfile on the calling thread each time a row is complete: row is its index in
+/// lengths, done counts the rows finished so far out of total. Returning false stops the computation;
+/// rows not yet computed are left at infinity and -1.
+using PanProfileCallback = std::function<bool(size_t row, size_t done, size_t total)>;
+
+namespace detail {
+
+/// @brief Lengths computed together in one sweep over the diagonals. The products along each diagonal are
+/// shared by every length in the sweep, but each worker keeps a profile per length, so this bounds the
+/// scratch memory at num_workers * kPanLengthsPerSweep profiles.
+constexpr size_t kPanLengthsPerSweep = 8;
+
+/// @brief Positions along a diagonal covered by one prefix sum of products. Dot products are differences of
+/// the prefix sum, so restarting it every block keeps its magnitude, and with it the cancellation in the
+/// differences, proportional to the block rather than to the whole sequence.
+constexpr size_t kPanPrefixBlock = 1024;
+
+/// @brief Sweeps of rows (indices into lengths) in the order panMatrixProfile computes them. Rows are ranked
+/// by length and visited breadth-first by bisection as in SKIMP: the median length first, then the quartiles,
+/// and so on, so the early rows already span the whole range of lengths. Rows at the same bisection depth
+/// share a sweep, up to kPanLengthsPerSweep of them.
+inline std::vector<std::vector<size_t>> panSweepOrder(std::span<const size_t> lengths) {
+    std::vector<size_t> ranked(lengths.size());
+    std::iota(ranked.begin(), ranked.end(), size_t{0});
+    std::stable_sort(ranked.begin(), ranked.end(), [&](size_t a, size_t b) { return lengths[a] < lengths[b]; });
+
+    std::vector<std::vector<size_t>> sweeps;
+    std::vector<std::pair<size_t, size_t>> level{{0, ranked.size()}}, next;
+    while (!level.empty()) {
+        next.clear();
+        std::vector<size_t> sweep;
+        for (const auto& [lo, hi] : level) {
+            if (lo >= hi) continue;
+            const size_t mid = lo + (hi - lo) / 2;
+            sweep.push_back(ranked[mid]);
+            if (sweep.size() == kPanLengthsPerSweep) {
+                sweeps.push_back(std::move(sweep));
+                sweep.clear();
+            }
+            next.emplace_back(lo, mid);
+            next.emplace_back(mid + 1, hi);
+        }
+        if (!sweep.empty()) sweeps.push_back(std::move(sweep));
+        std::swap(level, next);
+    }
+    return sweeps;
+}
+
+} // namespace detail
+
+/// @brief Compute the self-join matrix profile for every subsequence length in lengths (the pan matrix
+/// profile). Row r of mp and mpi holds the profile for lengths[r] in its first n - lengths[r] + 1 columns,
+/// as matrixProfileDiagonal computes it up to rounding (with the same exclusion policy, lengths[r] / 4 by
+/// default, and ties to the lowest index), and infinity and -1 in the rest.
+///
+/// The work for all lengths is shared rather than repeated per length. The window statistics come from one
+/// SequenceStats holding every length. Lengths are computed a sweep at a time, and a sweep walks each
+/// diagonal once: it forms the products of the (centered) sequence with itself shifted by the diagonal, and
+/// every length in the sweep reads its dot products off their running sum in O(1) each. Sweeps follow
+/// SKIMP's bisection order over the sorted lengths, so a coarse picture across the whole range is available
+/// from the first few rows, which on_row reports as they complete.
+///
+/// Within a sweep diagonals are split into tiles across worker threads, each with its own profiles that are
+/// min-reduced afterwards with the tie-break, so the output is bit-identical for every thread count.
+///
+/// @param sequence     The input time series (1-D).
+/// @param lengths      Subsequence lengths, in any order, each in [1, n].
+/// @param stats        Window statistics of sequence for every length in lengths. The overload without it
+///                     computes them.
+/// @param mp           Output profiles, pre-allocated with shape (lengths.size(), n - min(lengths) + 1).
+/// @param mpi          Output profile indices, with the same shape as mp.
+/// @param num_threads  Worker threads (0 for one per hardware thread).
+/// @param on_row       Optional callback reporting each completed row and allowing an early stop.
+/// @param exclusion    Exclusion-zone policy (see QuarterExclusion), applied to each length.
+template <class S, class D, class I, class T, class Acc, class Exclusion = QuarterExclusion>
+MatrixProfileStatus panMatrixProfile(
+    const xt::xexpression<S>& sequence,
+    std::span<const size_t> lengths,
+    const BasicSequenceStats<T, Acc>& stats,
+    xt::xexpression<D>& mp,
+    xt::xexpression<I>& mpi,
+    size_t num_threads = 1,
+    const PanProfileCallback& on_row = {},
+    Exclusion exclusion = {}
+) {
+    static_assert(xt::get_rank<S>::value == 1 || xt::get_rank<S>::value == SIZE_MAX, "sequence must be 1-dimensional");
+    static_assert(xt::get_rank<D>::value == 2 || xt::get_rank<D>::value == SIZE_MAX, "mp must be 2-dimensional");
+    static_assert(xt::get_rank<I>::value == 2 || xt::get_rank<I>::value == SIZE_MAX, "mpi must be 2-dimensional");
+    static_assert(std::is_same_v<T, detail::compute_t<S>>, "stats must match the precision of the sequence");
+
+    const auto& seq  = sequence.derived_cast();
+    auto&       mp_  = mp.derived_cast();
+    auto&       mpi_ = mpi.derived_cast();
+
+    if (seq.dimension() != 1) return MatrixProfileStatus::SequenceNotOneDimensional;
+    if (mp_.dimension() != 2)  return MatrixProfileStatus::DistanceNotTwoDimensional;
+    if (mpi_.dimension() != 2) return MatrixProfileStatus::IndexNotTwoDimensional;
+
+    const size_t n = seq.size();
+    for (const size_t m : lengths) {
+        if (m == 0) return MatrixProfileStatus::SubsequenceLengthZero;
+        if (m > n)  return MatrixProfileStatus::SubsequenceLongerThanSequence;
+        if (!stats.matches(n, m)) return MatrixProfileStatus::StatsMismatch;
+    }
+
+    const size_t num_rows = lengths.size();
+    const size_t min_m    = num_rows ? *std::min_element(lengths.begin(), lengths.end()) : 0;
+    const size_t max_m    = num_rows ? *std::max_element(lengths.begin(), lengths.end()) : 0;
+    const size_t num_cols = num_rows ? n - min_m + 1 : 0;
+
+    if (mp_.shape()[0]  != num_rows || mp_.shape()[1]  != num_cols) return MatrixProfileStatus::DistanceWrongSize;
+    if (mpi_.shape()[0] != num_rows || mpi_.shape()[1] != num_cols) return MatrixProfileStatus::IndexWrongSize;
+
+    using idx_t = typename std::decay_t<decltype(mpi_)>::value_type;
+
+    for (size_t r = 0; r < num_rows; r++) {
+        for (size_t i = 0; i < num_cols; i++) {
+            mp_(r, i)  = std::numeric_limits<typename std::decay_t<decltype(mp_)>::value_type>::infinity();
+            mpi_(r, i) = static_cast<idx_t>(-1);
+        }
+    }
+    if (num_rows == 0) return MatrixProfileStatus::Success;
+
+    // Every length shares the products, so the sequence is centered once on its overall mean (in double, as
+    // in centerSeries) and each length's window means are shifted to match.
+    double shift = 0.0;
+    for (size_t i = 0; i < n; i++) shift += static_cast<double>(seq(i));
+    shift /= static_cast<double>(n);
+
+    std::vector<double> x(n);
+    for (size_t i = 0; i < n; i++) x[i] = static_cast<double>(static_cast<T>(seq(i) - shift));
+
+    std::vector<std::vector<double>> row_mean(num_rows);
+    std::vector<const T*>            row_std(num_rows);
+    for (size_t r = 0; r < num_rows; r++) {
+        const auto mean = stats.mean(lengths[r]);
+        row_mean[r].resize(mean.size());
+        for (size_t i = 0; i < mean.size(); i++) row_mean[r][i] = static_cast<double>(mean[i]) - shift;
+        row_std[r] = stats.stddev(lengths[r]).data();
+    }
+
+    const size_t num_workers = resolveThreadCount(num_threads);
+    const size_t prefix_len  = detail::kPanPrefixBlock + max_m;
+
+    std::vector<std::vector<double>> prefix(num_workers, std::vector<double>(prefix_len + 1));
+
+    size_t done = 0;
+    for (const auto& sweep : detail::panSweepOrder(lengths)) {
+        const size_t num_lengths = sweep.size();
+
+        // Diagonals (first_diag, last_diag) hold a cell for at least one length of the sweep; diagonal k has
+        // n - k - m + 1 cells for length m, so tiles are balanced on the shortest length.
+        size_t first_diag = std::numeric_limits<size_t>::max();
+        size_t sweep_min_m = n;
+        for (const size_t r : sweep) {
+            first_diag  = std::min(first_diag, exclusion.firstDiagonal(lengths[r]));
+            sweep_min_m = std::min(sweep_min_m, lengths[r]);
+        }
+        const size_t last_diag = n - sweep_min_m + 1;
+
+        std::vector<size_t> tile_starts;
+        if (first_diag < last_diag) {
+            const size_t total_cells = (last_diag - first_diag) * (last_diag - first_diag + 1) / 2;
+            const size_t num_tiles   = num_workers * detail::kDiagonalTilesPerWorker;
+            const size_t tile_cells  = std::max<size_t>(total_cells / num_tiles, 1);
+
+            size_t cells = 0;
+            tile_starts.push_back(first_diag);
+            for (size_t k = first_diag; k < last_diag; k++) {
+                if (cells >= tile_cells) {
+                    tile_starts.push_back(k);
+                    cells = 0;
+                }
+                cells += last_diag - k;
+            }
+        }
+        tile_starts.push_back(last_diag);
+        const size_t num_tiles = tile_starts.size() - 1;
+
+        // local_mp[worker][l] is that worker's profile for the sweep's l-th length.
+        std::vector<std::vector<std::vector<double>>> local_mp(num_workers);
+        std::vector<std::vector<std::vector<idx_t>>>  local_mpi(num_workers);
+        for (size_t w = 0; w < num_workers; w++) {
+            local_mp[w].resize(num_lengths);
+            local_mpi[w].resize(num_lengths);
+            for (size_t l = 0; l < num_lengths; l++) {
+                const size_t profile_len = n - lengths[sweep[l]] + 1;
+                local_mp[w][l].assign(profile_len, std::numeric_limits<double>::infinity());
+                local_mpi[w][l].assign(profile_len, static_cast<idx_t>(-1));
+            }
+        }
+
+        detail::parallelFor(num_tiles, num_workers, [&](size_t tile, size_t worker) {
+            double* p = prefix[worker].data();
+
+            for (size_t k = tile_starts[tile]; k < tile_starts[tile + 1]; k++) {
+                // Cells (i, i + k) for i in [0, n - k - m + 1), taken a block of starting positions at a time.
+                const size_t diag_len = n - k;
+                for (size_t begin = 0; begin + sweep_min_m <= diag_len; begin += detail::kPanPrefixBlock) {
+                    // p[t] is the sum of the products x[begin + u] * x[begin + u + k] for u < t. Products of
+                    // values rounded to T are exact in double for float data.
+                    const size_t span = std::min(prefix_len, diag_len - begin);
+                    p[0] = 0.0;
+                    for (size_t t = 0; t < span; t++) p[t + 1] = p[t] + x[begin + t] * x[begin + t + k];
+
+                    for (size_t l = 0; l < num_lengths; l++) {
+                        const size_t r = sweep[l];
+                        const size_t m = lengths[r];
+                        if (k < exclusion.firstDiagonal(m) || begin + m > diag_len) continue;
+
+                        const size_t  end    = std::min(begin + detail::kPanPrefixBlock, diag_len - m + 1);
+                        const double* mean   = row_mean[r].data();
+                        const T*      stddev = row_std[r];
+                        auto&         lmp    = local_mp[worker][l];
+                        auto&         lmpi   = local_mpi[worker][l];
+
+                        for (size_t i = begin; i < end; i++) {
+                            const size_t j   = i + k;
+                            const double dot = p[i - begin + m] - p[i - begin];
+                            const double d   = detail::zNormalizedDistance(dot, m, mean[i], stddev[i],
+                                                                           mean[j], stddev[j]);
+                            if (detail::isBetterNeighbor(d, static_cast<idx_t>(j), lmp[i], lmpi[i])) {
+                                lmp[i]  = d;
+                                lmpi[i] = static_cast<idx_t>(j);
+                            }
+                            if (detail::isBetterNeighbor(d, static_cast<idx_t>(i), lmp[j], lmpi[j])) {
+                                lmp[j]  = d;
+                                lmpi[j] = static_cast<idx_t>(i);
+                            }
+                        }
+                    }
+                }
+            }
+        });
+
+        // Min-reduce each length's per-worker profiles into its row, then report the rows in sweep order.
+        for (size_t l = 0; l < num_lengths; l++) {
+            const size_t r           = sweep[l];
+            const size_t profile_len = n - lengths[r] + 1;
+            for (size_t i = 0; i < profile_len; i++) {
+                double best_d = local_mp[0][l][i];
+                idx_t  best_j = local_mpi[0][l][i];
+                for (size_t w = 1; w < num_workers; w++) {
+                    if (detail::isBetterNeighbor(local_mp[w][l][i], local_mpi[w][l][i], best_d, best_j)) {
+                        best_d = local_mp[w][l][i];
+                        best_j = local_mpi[w][l][i];
+                    }
+                }
+                mp_(r, i)  = best_d;
+                mpi_(r, i) = best_j;
+            }
+        }
+        for (const size_t r : sweep) {
+            if (on_row && !on_row(r, ++done, num_rows)) return MatrixProfileStatus::Success;
+        }
+    }
+
+    return MatrixProfileStatus::Success;
+}
+
+/// @brief panMatrixProfile without precomputed statistics; see the overload above.
+template <class S, class D, class I, class Exclusion = QuarterExclusion>
+MatrixProfileStatus panMatrixProfile(
+    const xt::xexpression<S>& sequence,
+    std::span<const size_t> lengths,
+    xt::xexpression<D>& mp,
+    xt::xexpression<I>& mpi,
+    size_t num_threads = 1,
+    const PanProfileCallback& on_row = {},
+    Exclusion exclusion = {}
+) {
+    return panMatrixProfile(sequence, lengths, detail::StatsFor<S>(sequence, lengths), mp, mpi, num_threads, on_row,
+                            exclusion);
+}
+
+} // namespace MPCC
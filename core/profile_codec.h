@@ -0,0 +1,262 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <span>
+#include <type_traits>
+#include <vector>
+
+#include "core/matrix_profile.h"
+
+// A compact binary format for storing and shipping matrix profiles: 2-byte distances and 4-byte
+// delta-encoded indices instead of float64 + int64, 6 bytes per entry rather than 16. The layout (all
+// little-endian), with n = length:
+//
+//     offset  size  field
+//          0     4  magic "MPCP"
+//          4     1  version (1)
+//          5     1  distance encoding (ProfileEncoding)
+//          6     2  reserved, 0
+//          8     8  m, the subsequence length (uint64)
+//         16     8  n, the number of entries (uint64)
+//         24    4n  indices: int32 deltas, mpi[0] and then mpi[i] - mpi[i - 1]
+//     24 + 4n   2n  distances, as ProfileEncoding says
+//
+// The indices come first so both arrays are naturally aligned in a buffer read as a whole. web/lib/profile.js
+// decodes the same format.
+
+namespace MPCC {
+
+/// @brief How encodeProfile stores distances.
+enum class ProfileEncoding : uint8_t {
+    Float16 = 0,  ///< IEEE 754 half precision, rounded to nearest even: 11 significant bits at any scale.
+    UInt16  = 1,  ///< Fixed point on [0, 2 sqrt(m)], the range of z-normalized distances: an absolute error
+                  ///< of at most sqrt(m) / 65534. 65535 marks entries without a neighbor (inf).
+};
+
+/// @brief The header of an encoded profile.
+struct EncodedProfileHeader {
+    ProfileEncoding encoding = ProfileEncoding::UInt16;
+    size_t          m        = 0;
+    size_t          length   = 0;
+};
+
+namespace detail {
+
+inline constexpr char     kProfileMagic[4]     = {'M', 'P', 'C', 'P'};
+inline constexpr uint8_t  kProfileVersion      = 1;
+inline constexpr size_t   kProfileHeaderSize   = 24;
+inline constexpr uint16_t kQuantizedNoNeighbor = 0xffff;
+inline constexpr double   kQuantizedMax        = 65534.0;
+
+template <class U>
+void storeLittleEndian(uint8_t* out, U value) {
+    for (size_t b = 0; b < sizeof(U); b++) out[b] = static_cast<uint8_t>(value >> (8 * b));
+}
+
+template <class U>
+U loadLittleEndian(const uint8_t* in) {
+    U value = 0;
+    for (size_t b = 0; b < sizeof(U); b++) value |= static_cast<U>(static_cast<U>(in[b]) << (8 * b));
+    return value;
+}
+
+/// @brief value as IEEE half precision bits, rounded to nearest even (overflowing to inf, NaN kept NaN).
+/// Doubles are rounded to float first, which only matters for values within 2^-29 relative of a tie.
+inline uint16_t toHalf(float value) {
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    const uint16_t sign = static_cast<uint16_t>((bits >> 16) & 0x8000);
+    const uint32_t abs  = bits & 0x7fffffff;
+
+    if (abs >= 0x7f800000) return sign | (abs > 0x7f800000 ? 0x7e00 : 0x7c00);
+    if (abs >= 0x477ff000) return sign | 0x7c00;  // 65520 and up round to inf.
+    if (abs <  0x33000000) return sign;           // Below 2^-25: rounds to zero.
+
+    // Normal halves keep the top 10 of float's 23 mantissa bits; subnormal halves (below 2^-14) count units
+    // of 2^-24, shifting the full significand further. Either way round on the dropped bits, where a carry
+    // into the exponent is still the correctly rounded value.
+    uint32_t kept, dropped, shift;
+    if (abs >= 0x38800000) {
+        shift   = 13;
+        kept    = (abs - 0x38000000) >> shift;
+        dropped = abs & 0x1fff;
+    } else {
+        const uint32_t significand = (abs & 0x7fffff) | 0x800000;
+        shift   = 126 - (abs >> 23);
+        kept    = significand >> shift;
+        dropped = significand & ((1u << shift) - 1);
+    }
+    const uint32_t half_way = 1u << (shift - 1);
+    if (dropped > half_way || (dropped == half_way && (kept & 1))) kept++;
+    return static_cast<uint16_t>(sign | kept);
+}
+
+inline float fromHalf(uint16_t h) {
+    const uint32_t sign     = static_cast<uint32_t>(h & 0x8000) << 16;
+    const uint32_t exponent = (h >> 10) & 0x1f;
+    const uint32_t mantissa = h & 0x3ff;
+
+    if (exponent == 0) {
+        const float magnitude = std::ldexp(static_cast<float>(mantissa), -24);
+        return sign ? -magnitude : magnitude;
+    }
+    const uint32_t bits = exponent == 0x1f ? sign | 0x7f800000 | (mantissa << 13)
+                                           : sign | ((exponent + 112) << 23) | (mantissa << 13);
+    float value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+inline double quantizedScale(size_t m) {
+    return 2.0 * std::sqrt(static_cast<double>(m)) / kQuantizedMax;
+}
+
+} // namespace detail
+
+/// @brief Bytes encodeProfile writes for a profile of length entries.
+inline constexpr size_t encodedProfileSize(size_t length) {
+    return detail::kProfileHeaderSize + 6 * length;
+}
+
+/// @brief Encode the matrix profile (mp, mpi) of subsequence length m in the format described at the top of
+/// this file, replacing the contents of out. Distances are rounded to the encoding's precision; the indices
+/// are exact. UInt16 clamps distances to [0, 2 sqrt(m)] and stores inf and NaN as "no neighbor"; Float16
+/// keeps them as they are.
+///
+/// @return DistanceWrongSize if mp and mpi differ in length, SubsequenceLengthZero if m is 0, and
+///         IndexNotEncodable if an index delta does not fit int32 (indices of a profile shorter than 2^31
+///         always do).
+template <class D, class I>
+MatrixProfileStatus encodeProfile(
+    const xt::xexpression<D>& mp,
+    const xt::xexpression<I>& mpi,
+    size_t m,
+    ProfileEncoding encoding,
+    std::vector<uint8_t>& out
+) {
+    static_assert(xt::get_rank<D>::value == 1 || xt::get_rank<D>::value == SIZE_MAX, "mp must be 1-dimensional");
+    static_assert(xt::get_rank<I>::value == 1 || xt::get_rank<I>::value == SIZE_MAX, "mpi must be 1-dimensional");
+
+    const auto& mp_  = mp.derived_cast();
+    const auto& mpi_ = mpi.derived_cast();
+
+    if (m == 0)                    return MatrixProfileStatus::SubsequenceLengthZero;
+    if (mp_.size() != mpi_.size()) return MatrixProfileStatus::DistanceWrongSize;
+
+    const size_t length = mp_.size();
+    out.resize(encodedProfileSize(length));
+    uint8_t* data = out.data();
+
+    std::memcpy(data, detail::kProfileMagic, sizeof(detail::kProfileMagic));
+    data[4] = detail::kProfileVersion;
+    data[5] = static_cast<uint8_t>(encoding);
+    detail::storeLittleEndian<uint16_t>(data + 6, 0);
+    detail::storeLittleEndian<uint64_t>(data + 8, m);
+    detail::storeLittleEndian<uint64_t>(data + 16, length);
+
+    uint8_t* indices = data + detail::kProfileHeaderSize;
+    int64_t  previous = 0;
+    for (size_t i = 0; i < length; i++) {
+        const int64_t index = static_cast<int64_t>(mpi_[i]);
+        const int64_t delta = index - previous;
+        if (delta < std::numeric_limits<int32_t>::min() || delta > std::numeric_limits<int32_t>::max()) {
+            out.clear();
+            return MatrixProfileStatus::IndexNotEncodable;
+        }
+        detail::storeLittleEndian<uint32_t>(indices + 4 * i, static_cast<uint32_t>(static_cast<int32_t>(delta)));
+        previous = index;
+    }
+
+    uint8_t* distances = indices + 4 * length;
+    if (encoding == ProfileEncoding::Float16) {
+        for (size_t i = 0; i < length; i++) {
+            detail::storeLittleEndian<uint16_t>(distances + 2 * i, detail::toHalf(static_cast<float>(mp_[i])));
+        }
+    } else {
+        const double inv_scale = 1.0 / detail::quantizedScale(m);
+        for (size_t i = 0; i < length; i++) {
+            const double d = static_cast<double>(mp_[i]);
+            const uint16_t q = std::isfinite(d)
+                ? static_cast<uint16_t>(std::lround(std::clamp(d * inv_scale, 0.0, detail::kQuantizedMax)))
+                : detail::kQuantizedNoNeighbor;
+            detail::storeLittleEndian<uint16_t>(distances + 2 * i, q);
+        }
+    }
+    return MatrixProfileStatus::Success;
+}
+
+/// @brief Read the header of an encoded profile, to size the outputs of decodeProfile.
+/// @return EncodedProfileInvalid unless data starts with a version 1 header of a known encoding and holds the
+///         whole profile it describes.
+inline MatrixProfileStatus decodeProfileHeader(std::span<const uint8_t> data, EncodedProfileHeader& header) {
+    if (data.size() < detail::kProfileHeaderSize) return MatrixProfileStatus::EncodedProfileInvalid;
+    if (std::memcmp(data.data(), detail::kProfileMagic, sizeof(detail::kProfileMagic)) != 0 ||
+        data[4] != detail::kProfileVersion || data[5] > static_cast<uint8_t>(ProfileEncoding::UInt16)) {
+        return MatrixProfileStatus::EncodedProfileInvalid;
+    }
+
+    const uint64_t m      = detail::loadLittleEndian<uint64_t>(data.data() + 8);
+    const uint64_t length = detail::loadLittleEndian<uint64_t>(data.data() + 16);
+    if (m == 0 || length > (data.size() - detail::kProfileHeaderSize) / 6 ||
+        data.size() != encodedProfileSize(length)) {
+        return MatrixProfileStatus::EncodedProfileInvalid;
+    }
+
+    header.encoding = static_cast<ProfileEncoding>(data[5]);
+    header.m        = m;
+    header.length   = length;
+    return MatrixProfileStatus::Success;
+}
+
+/// @brief Decode a profile written by encodeProfile into mp and mpi, pre-allocated with the header's length
+/// (see decodeProfileHeader). UInt16 "no neighbor" entries decode to inf.
+template <class D, class I>
+MatrixProfileStatus decodeProfile(
+    std::span<const uint8_t> data,
+    xt::xexpression<D>& mp,
+    xt::xexpression<I>& mpi
+) {
+    static_assert(xt::get_rank<D>::value == 1 || xt::get_rank<D>::value == SIZE_MAX, "mp must be 1-dimensional");
+    static_assert(xt::get_rank<I>::value == 1 || xt::get_rank<I>::value == SIZE_MAX, "mpi must be 1-dimensional");
+
+    auto& mp_  = mp.derived_cast();
+    auto& mpi_ = mpi.derived_cast();
+
+    EncodedProfileHeader header;
+    if (const auto status = decodeProfileHeader(data, header); status != MatrixProfileStatus::Success) {
+        return status;
+    }
+    if (mp_.size()  != header.length) return MatrixProfileStatus::DistanceWrongSize;
+    if (mpi_.size() != header.length) return MatrixProfileStatus::IndexWrongSize;
+
+    using dist_t = typename std::decay_t<decltype(mp_)>::value_type;
+    using idx_t  = typename std::decay_t<decltype(mpi_)>::value_type;
+
+    const uint8_t* indices = data.data() + detail::kProfileHeaderSize;
+    int64_t index = 0;
+    for (size_t i = 0; i < header.length; i++) {
+        index += static_cast<int32_t>(detail::loadLittleEndian<uint32_t>(indices + 4 * i));
+        mpi_[i] = static_cast<idx_t>(index);
+    }
+
+    const uint8_t* distances = indices + 4 * header.length;
+    if (header.encoding == ProfileEncoding::Float16) {
+        for (size_t i = 0; i < header.length; i++) {
+            mp_[i] = static_cast<dist_t>(detail::fromHalf(detail::loadLittleEndian<uint16_t>(distances + 2 * i)));
+        }
+    } else {
+        const double scale = detail::quantizedScale(header.m);
+        for (size_t i = 0; i < header.length; i++) {
+            const uint16_t q = detail::loadLittleEndian<uint16_t>(distances + 2 * i);
+            mp_[i] = q == detail::kQuantizedNoNeighbor ? std::numeric_limits<dist_t>::infinity()
+                                                       : static_cast<dist_t>(q * scale);
+        }
+    }
+    return MatrixProfileStatus::Success;
+}
+
+} // namespace MPCC
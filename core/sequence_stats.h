@@ -0,0 +1,218 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <initializer_list>
+#include <span>
+#include <vector>
+#include <xtensor/containers/xtensor.hpp>
+
+namespace MPCC {
+
+namespace detail {
+
+/// @brief Windows between exact recomputations of the sliding statistics. Each resync costs O(m), so this
+/// bounds the accumulated rounding of the incremental updates at an amortized cost of m / interval per window.
+constexpr size_t kStatsResyncInterval = 1024;
+
+/// @brief Exact mean and sum of squared deviations (M2) of the m values at(begin) ... at(begin + m - 1),
+/// computed in two passes so there is no cancellation between large squares.
+template <class At, class Acc>
+void windowMeanM2(At&& at, size_t begin, size_t m, Acc& mean, Acc& m2) {
+    Acc sum = 0;
+    for (size_t k = 0; k < m; k++) sum += at(begin + k);
+    mean = sum / static_cast<Acc>(m);
+
+    m2 = 0;
+    for (size_t k = 0; k < m; k++) {
+        const Acc d = at(begin + k) - mean;
+        m2 += d * d;
+    }
+}
+
+/// @brief Slide a window's mean and M2 by one sample, dropping x_out and admitting x_in (Welford). Working
+/// with deviations from the mean rather than a raw sum of squares avoids the catastrophic cancellation of
+/// sum_sq / m - mean^2 when the data carries a large offset. M2 is clamped at zero so rounding cannot make
+/// the variance of a flat window negative.
+template <class Acc>
+void slideMeanM2(Acc x_out, Acc x_in, size_t m, Acc& mean, Acc& m2) {
+    const Acc new_mean = mean + (x_in - x_out) / static_cast<Acc>(m);
+    m2   = std::max(Acc(0), m2 + (x_in - x_out) * (x_in - new_mean + x_out - mean));
+    mean = new_mean;
+}
+
+/// @brief Compute the mean and standard deviation of every length-m window of seq. The first window is
+/// computed exactly and later ones incrementally with slideMeanM2, resynchronizing exactly every
+/// kStatsResyncInterval windows. The updates run on seq - seq(0), so the rounding of each step scales with
+/// the spread of the data rather than its offset. The statistics are accumulated in Acc and stored as T.
+///
+/// Flatness is decided exactly rather than left to the sliding M2, whose drift after varying data can leave
+/// a constant window above kFlatStdDevThreshold: the length of the run of equal samples ending at each window
+/// is tracked, and a window lying inside such a run gets its exact mean and a stddev of zero, which also
+/// restarts the sliding updates from exact values.
+template <class Acc = double, class S, class T>
+void rollingMeanStd(const S& seq, size_t m, std::vector<T>& mean, std::vector<T>& stddev) {
+    const size_t n           = seq.size();
+    const size_t profile_len = n - m + 1;
+
+    mean.resize(profile_len);
+    stddev.resize(profile_len);
+    if (n == 0) return;
+
+    const Acc shift = static_cast<Acc>(seq(0));
+    auto at = [&seq, shift](size_t k) { return static_cast<Acc>(seq(k)) - shift; };
+
+    Acc win_mean = 0;
+    Acc win_m2   = 0;
+    windowMeanM2(at, 0, m, win_mean, win_m2);
+
+    // Length of the run of equal samples ending at the last sample of the current window.
+    size_t run = 1;
+    for (size_t k = 1; k < m; k++) run = at(k) == at(k - 1) ? run + 1 : 1;
+
+    for (size_t i = 0; i < profile_len; i++) {
+        if (run >= m) {
+            win_mean = at(i);
+            win_m2   = 0;
+        }
+        mean[i]   = static_cast<T>(shift + win_mean);
+        stddev[i] = static_cast<T>(std::sqrt(win_m2 / static_cast<Acc>(m)));
+
+        if (i + m < n) {
+            run = at(i + m) == at(i + m - 1) ? run + 1 : 1;
+            if ((i + 1) % kStatsResyncInterval == 0) {
+                windowMeanM2(at, i + 1, m, win_mean, win_m2);
+            } else {
+                slideMeanM2(at(i), at(i + m), m, win_mean, win_m2);
+            }
+        }
+    }
+}
+
+} // namespace detail
+
+/// @brief Per-window mean and standard deviation of one sequence, precomputed for one or more subsequence
+/// lengths. Every similarity search and matrix profile routine needs these statistics for the whole
+/// sequence; computing them once and passing the same SequenceStats to repeated calls against the same
+/// sequence saves a full pass over it per call.
+///
+/// The statistics are tied to the values of the sequence they were computed from. The overloads that accept
+/// a SequenceStats check that the sequence length and subsequence length match, but they cannot detect a
+/// different sequence of the same length.
+///
+/// The statistics are stored as T, the element type the routines compute in (double, or float for float
+/// sequences), and accumulated in the wider Acc, so single-precision statistics carry no more rounding than
+/// the float conversion of each result. SequenceStats and SequenceStatsF32 are the two instantiations the
+/// routines accept.
+template <class T, class Acc = double>
+class BasicSequenceStats {
+public:
+    using value_type       = T;
+    using accumulator_type = Acc;
+
+    BasicSequenceStats() = default;
+
+    /// @param sequence  The time series (1-D).
+    /// @param lengths   Subsequence lengths to precompute. Lengths longer than the sequence are skipped.
+    template <class S>
+    BasicSequenceStats(const xt::xexpression<S>& sequence, std::span<const size_t> lengths) {
+        const auto& seq = sequence.derived_cast();
+        if (seq.dimension() != 1) return;
+
+        sequence_length_ = seq.size();
+        for (const size_t m : lengths) add(seq, m);
+    }
+
+    template <class S>
+    BasicSequenceStats(const xt::xexpression<S>& sequence, std::initializer_list<size_t> lengths)
+        : BasicSequenceStats(sequence, std::span<const size_t>(lengths.begin(), lengths.size())) {}
+
+    template <class S>
+    BasicSequenceStats(const xt::xexpression<S>& sequence, size_t m)
+        : BasicSequenceStats(sequence, std::span<const size_t>(&m, 1)) {}
+
+    /// @brief Replace the statistics with those of sequence for the single length m (none if m is longer than
+    /// the sequence), reusing the storage of earlier calls: once it has held a sequence as long as this one,
+    /// refilling it does not allocate.
+    template <class S>
+    void assign(const xt::xexpression<S>& sequence, size_t m) {
+        const auto& seq = sequence.derived_cast();
+        sequence_length_ = seq.dimension() == 1 ? seq.size() : 0;
+        if (seq.dimension() != 1 || m > sequence_length_) {
+            windows_.clear();
+            return;
+        }
+
+        windows_.resize(1);
+        windows_[0].m = m;
+        detail::rollingMeanStd<Acc>(seq, m, windows_[0].mean, windows_[0].stddev);
+    }
+
+    /// @brief Length of the sequence the statistics were computed from.
+    size_t sequenceLength() const { return sequence_length_; }
+
+    /// @brief Whether statistics for subsequence length m are available.
+    bool contains(size_t m) const { return find(m) != nullptr; }
+
+    /// @brief Whether these statistics can stand in for a sequence of length n with subsequence length m.
+    bool matches(size_t n, size_t m) const { return n == sequence_length_ && contains(m); }
+
+    /// @brief Precomputed subsequence lengths, in ascending order.
+    std::vector<size_t> lengths() const {
+        std::vector<size_t> out;
+        out.reserve(windows_.size());
+        for (const auto& w : windows_) out.push_back(w.m);
+        return out;
+    }
+
+    /// @brief Mean of every length-m window (n-m+1 values), or an empty span if m was not precomputed.
+    std::span<const T> mean(size_t m) const {
+        const Windows* w = find(m);
+        return w ? std::span<const T>(w->mean) : std::span<const T>();
+    }
+
+    /// @brief Standard deviation of every length-m window (n-m+1 values), or an empty span if m was not
+    /// precomputed.
+    std::span<const T> stddev(size_t m) const {
+        const Windows* w = find(m);
+        return w ? std::span<const T>(w->stddev) : std::span<const T>();
+    }
+
+private:
+    struct Windows {
+        size_t         m;
+        std::vector<T> mean;
+        std::vector<T> stddev;
+    };
+
+    template <class S>
+    void add(const S& seq, size_t m) {
+        if (m > sequence_length_ || contains(m)) return;
+
+        Windows w{m, {}, {}};
+        detail::rollingMeanStd<Acc>(seq, m, w.mean, w.stddev);
+
+        const auto pos = std::lower_bound(windows_.begin(), windows_.end(), m,
+                                          [](const Windows& a, size_t len) { return a.m < len; });
+        windows_.insert(pos, std::move(w));
+    }
+
+    // Only a handful of lengths are ever precomputed, so a sorted vector beats a map.
+    const Windows* find(size_t m) const {
+        for (const auto& w : windows_) {
+            if (w.m == m) return &w;
+        }
+        return nullptr;
+    }
+
+    size_t               sequence_length_ = 0;
+    std::vector<Windows> windows_;
+};
+
+/// @brief Double-precision window statistics, for double (and integer) sequences.
+using SequenceStats = BasicSequenceStats<double>;
+
+/// @brief Single-precision window statistics, for float sequences.
+using SequenceStatsF32 = BasicSequenceStats<float>;
+
+} // namespace MPCC
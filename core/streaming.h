@@ -0,0 +1,347 @@
+#pragma once
+
+#include <cstdint>
+#include <limits>
+#include <span>
+#include <stdexcept>
+#include <vector>
+
+#include "core/kernels.h"
+#include "core/matrix_profile.h"
+
+namespace MPCC {
+
+/// @brief Incrementally maintained self-join matrix profile for a streaming series (STAMPI).
+///
+/// Each appended sample completes one new subsequence. Its dot products against every retained subsequence are
+/// derived in O(1) each from the previous newest subsequence's row (the same recurrence as STOMP), so an
+/// append costs O(n) rather than the O(n^2) of recomputing the profile. The new subsequence gets its nearest
+/// neighbor from that row, and every earlier subsequence for which it is closer than the current neighbor is
+/// updated. The exclusion zone (floor(m/4) unless another policy is given) and tie-breaking (lowest index
+/// wins) match matrixProfileNaive, so the profile always equals the batch profile of the retained samples,
+/// up to rounding.
+///
+/// The profile is tracked as separate left (nearest neighbor in the past) and right (nearest neighbor in the
+/// future) profiles; the overall profile is the closer of the two.
+///
+/// With a window of W samples only the most recent W are retained. Once full, each append evicts the oldest
+/// sample and with it the oldest subsequence, and memory stays O(W) however long the stream runs. Evicted
+/// data can only ever be a left neighbor, so right neighbors stay valid; any subsequence whose left neighbor
+/// was evicted has it recomputed over the retained window.
+///
+/// Indices, including the values in profileIndex(), are absolute positions in the stream. The first retained
+/// subsequence is offset(), so profile()[i] belongs to subsequence offset() + i. The spans the accessors
+/// return alias internal storage and are invalidated by any append that reallocates it (see reserve) or, in
+/// a windowed stream, compacts it.
+///
+/// Dot products and window statistics are computed on the samples minus the first sample of the stream,
+/// which keeps a large offset in the data from cancelling in the Pearson correlation, and the window
+/// statistics are maintained with Welford updates that are resynchronized exactly every
+/// detail::kStatsResyncInterval windows. A window of m equal samples is recognized exactly, as in
+/// detail::rollingMeanStd, and gets a stddev of zero however far the updates have drifted.
+class StreamingMatrixProfile {
+public:
+    using index_type = int64_t;
+
+    /// @param m          Subsequence length. Must be greater than zero.
+    /// @param window     Number of most recent samples to retain, or 0 to retain everything. When non-zero it
+    ///                   must be at least m.
+    /// @param exclusion  Exclusion-zone policy (see QuarterExclusion). It must exclude at least the
+    ///                   subsequence itself, since the left and right profiles require a zone.
+    /// @throws std::invalid_argument if m is zero, window is non-zero but less than m, or exclusion has no
+    ///         zone. A constructor has no status to return, and a stream built from the first two could never
+    ///         complete a subsequence.
+    template <class Exclusion = QuarterExclusion>
+    explicit StreamingMatrixProfile(size_t m, size_t window = 0, Exclusion exclusion = {})
+        : m_(m), window_(window), first_diag_(exclusion.firstDiagonal(m)) {
+        if (m_ == 0) throw std::invalid_argument("StreamingMatrixProfile: m must be greater than zero");
+        if (window_ != 0 && window_ < m_) {
+            throw std::invalid_argument("StreamingMatrixProfile: window must be zero or at least m");
+        }
+        if (first_diag_ == 0) {
+            throw std::invalid_argument("StreamingMatrixProfile: exclusion must exclude the subsequence itself");
+        }
+        // Compaction keeps storage under two windows, so reserving that up front means a windowed stream never
+        // reallocates.
+        if (window_ != 0) reserve(2 * window_);
+    }
+
+    /// @brief Append one sample, completing a new subsequence once at least m samples are retained.
+    void append(double value) {
+        if (total_ == 0) shift_ = value;
+        values_.push_back(value);
+        centered_.push_back(value - shift_);
+        total_++;
+
+        updateWindowStats();
+        if (total_ < m_) return;
+
+        if (window_ != 0 && total_ - start_ > window_) evictOldest();
+
+        const size_t k = total_ - m_;  // Subsequence completed by this sample.
+        mean_.push_back(win_mean_);
+        stddev_.push_back(std::sqrt(win_m2_ / static_cast<double>(m_)));
+
+        updateDotProducts(k);
+
+        constexpr double inf = std::numeric_limits<double>::infinity();
+        mp_.push_back(inf);
+        mpi_.push_back(-1);
+        left_mp_.push_back(inf);
+        left_mpi_.push_back(-1);
+        right_mp_.push_back(inf);
+        right_mpi_.push_back(-1);
+        updateProfile(k);
+
+        compact();
+    }
+
+    /// @brief Append several samples in order. Equivalent to calling append(value) for each one.
+    void append(std::span<const double> values) {
+        for (const double v : values) append(v);
+    }
+
+    /// @brief Reserve storage for n retained samples so appends up to that length do not reallocate. For an
+    /// unbounded stream this keeps the spans returned by the accessors valid across those appends. A windowed
+    /// stream reserves its working set on its own, but every window of appends it compacts its storage,
+    /// shifting the retained data to the front, which invalidates outstanding spans whatever was reserved.
+    void reserve(size_t n) {
+        values_.reserve(n);
+        centered_.reserve(n);
+        if (n >= m_) {
+            const size_t profile_len = n - m_ + 1;
+            for (auto* v : {&mean_, &stddev_, &qt_, &mp_, &left_mp_, &right_mp_, &dist_}) v->reserve(profile_len);
+            for (auto* v : {&mpi_, &left_mpi_, &right_mpi_}) v->reserve(profile_len);
+        }
+    }
+
+    size_t subsequenceLength() const { return m_; }
+
+    /// @brief Number of retained samples, or 0 for an unbounded stream.
+    size_t window() const { return window_; }
+
+    /// @brief Total number of samples appended over the life of the stream.
+    size_t totalSamples() const { return total_; }
+
+    /// @brief Absolute index of the first retained sample, which is also the first retained subsequence.
+    size_t offset() const { return start_; }
+
+    /// @brief Number of retained complete subsequences, i.e. the current profile length.
+    size_t size() const { return retained(mp_).size(); }
+
+    /// @brief Retained samples, starting at offset().
+    std::span<const double> sequence() const { return retained(values_); }
+
+    /// @brief Current matrix profile: distance from each subsequence to its nearest non-trivial neighbor.
+    std::span<const double> profile() const { return retained(mp_); }
+
+    /// @brief Current matrix profile index: absolute start of each subsequence's nearest neighbor, or -1.
+    std::span<const index_type> profileIndex() const { return retained(mpi_); }
+
+    /// @brief Left matrix profile: distance to the nearest non-trivial neighbor that starts earlier.
+    std::span<const double> leftProfile() const { return retained(left_mp_); }
+
+    /// @brief Left matrix profile index, or -1 where no earlier neighbor exists.
+    std::span<const index_type> leftProfileIndex() const { return retained(left_mpi_); }
+
+    /// @brief Right matrix profile: distance to the nearest non-trivial neighbor that starts later.
+    std::span<const double> rightProfile() const { return retained(right_mp_); }
+
+    /// @brief Right matrix profile index, or -1 where no later neighbor exists yet.
+    std::span<const index_type> rightProfileIndex() const { return retained(right_mpi_); }
+
+private:
+    // All per-sample and per-subsequence vectors are indexed by absolute position minus base_. Entries in
+    // [base_, start_) have been evicted but not yet compacted away.
+    // Centered samples (value minus shift_), which every computation uses.
+    double        sample(size_t abs) const  { return centered_[abs - base_]; }
+    const double* samples(size_t abs) const { return centered_.data() + (abs - base_); }
+
+    template <class T>
+    std::span<const T> retained(const std::vector<T>& v) const {
+        const size_t skip = std::min(start_ - base_, v.size());
+        return std::span<const T>(v.data() + skip, v.size() - skip);
+    }
+
+    /// Fold the newest sample into the running mean and M2 of the newest window: a Welford insertion while the
+    /// first window fills, then a sliding update that drops the sample leaving the window. A window inside a
+    /// run of m equal samples is set to its exact statistics instead.
+    void updateWindowStats() {
+        const double x = sample(total_ - 1);
+        flat_run_ = total_ > 1 && x == sample(total_ - 2) ? flat_run_ + 1 : 1;
+        if (flat_run_ >= m_) {
+            win_mean_ = x;
+            win_m2_   = 0.0;
+            return;
+        }
+        if (total_ <= m_) {
+            const double delta = x - win_mean_;
+            win_mean_ += delta / static_cast<double>(total_);
+            win_m2_   += delta * (x - win_mean_);
+            return;
+        }
+
+        const size_t first = total_ - m_;  // First sample of the newest window.
+        if (first % detail::kStatsResyncInterval == 0) {
+            detail::windowMeanM2([this](size_t abs) { return sample(abs); }, first, m_, win_mean_, win_m2_);
+        } else {
+            detail::slideMeanM2(sample(first - 1), x, m_, win_mean_, win_m2_);
+        }
+    }
+
+    /// Turn qt_ from the row of subsequence k-1 into the row of subsequence k.
+    void updateDotProducts(size_t k) {
+        const auto& kern  = kernels::active();
+        const size_t first = start_;
+
+        qt_.push_back(0.0);
+        if (k > first) {
+            // In place from the back so qt_[p - 1] still holds row k-1 when it is read. p and t are positions
+            // in storage, i.e. absolute index minus base_.
+            const double* t     = centered_.data();
+            const size_t  pk    = k - base_;
+            const double  drop  = t[pk - 1];
+            const double  admit = t[pk + m_ - 1];
+            for (size_t p = pk; p > first - base_; p--) {
+                qt_[p] = qt_[p - 1] - drop * t[p - 1] + admit * t[p + m_ - 1];
+            }
+        }
+        qt_[first - base_] = kern.dot(samples(first), samples(k), m_);
+    }
+
+    /// Fold subsequence k's distances to all retained earlier subsequences into the profile.
+    void updateProfile(size_t k) {
+        const size_t first = start_;
+        if (k - first < first_diag_) return;
+
+        // Only j <= k - first_diag_ can be non-trivial matches; later ones are inside the zone.
+        const size_t count = k - first_diag_ - first + 1;
+        const size_t p0    = first - base_;
+        const size_t pk    = k - base_;
+        const auto&  kern  = kernels::active();
+
+        dist_.resize(count);
+        kern.distances(qt_.data() + p0, mean_.data() + p0, stddev_.data() + p0, count,
+                       m_, mean_[pk], stddev_[pk], dist_.data());
+
+        const ArgMin best = kern.argmin(dist_.data(), 0, count);
+        if (best.index != SIZE_MAX) {
+            left_mp_[pk]  = best.value;
+            left_mpi_[pk] = static_cast<index_type>(first + best.index);
+            mp_[pk]       = left_mp_[pk];
+            mpi_[pk]      = left_mpi_[pk];
+        }
+
+        // k is later than every existing right neighbor, so a strict < keeps the lowest index on ties.
+        for (size_t c = 0; c < count; c++) {
+            const size_t p = p0 + c;
+            if (dist_[c] < right_mp_[p]) {
+                right_mp_[p]  = dist_[c];
+                right_mpi_[p] = static_cast<index_type>(k);
+            }
+            if (dist_[c] < mp_[p]) {
+                mp_[p]  = dist_[c];
+                mpi_[p] = static_cast<index_type>(k);
+            }
+        }
+    }
+
+    /// Drop the oldest retained sample and subsequence, repairing left neighbors that pointed at it.
+    void evictOldest() {
+        const size_t evicted = start_++;
+        const size_t last    = total_ - m_;  // Newest subsequence, not yet added.
+
+        for (size_t j = start_; j < last; j++) {
+            const size_t p = j - base_;
+            if (left_mpi_[p] != static_cast<index_type>(evicted)) continue;
+
+            recomputeLeft(j);
+
+            // The left neighbor only got further away; the overall neighbor is the closer of left and right,
+            // with the earlier (left) one winning ties.
+            if (right_mp_[p] < left_mp_[p]) {
+                mp_[p]  = right_mp_[p];
+                mpi_[p] = right_mpi_[p];
+            } else {
+                mp_[p]  = left_mp_[p];
+                mpi_[p] = left_mpi_[p];
+            }
+        }
+    }
+
+    /// Recompute the left neighbor of retained subsequence j directly over the retained window. This is
+    /// O(W * m), but on average each eviction invalidates about one left neighbor.
+    void recomputeLeft(size_t j) {
+        const auto&  kern = kernels::active();
+        const size_t p    = j - base_;
+
+        left_mp_[p]  = std::numeric_limits<double>::infinity();
+        left_mpi_[p] = -1;
+
+        for (size_t i = start_; i < j && j - i >= first_diag_; i++) {
+            const size_t q = i - base_;
+            const double d = detail::zNormalizedDistance(
+                kern.dot(samples(i), samples(j), m_), m_, mean_[q], stddev_[q], mean_[p], stddev_[p]);
+            if (d < left_mp_[p]) {
+                left_mp_[p]  = d;
+                left_mpi_[p] = static_cast<index_type>(i);
+            }
+        }
+    }
+
+    /// Physically remove evicted entries once they make up a full window, so the amortized cost is O(1)
+    /// per append and storage stays under two windows.
+    void compact() {
+        if (window_ == 0 || start_ - base_ < window_) return;
+
+        const size_t drop = start_ - base_;
+        auto erase_front = [drop](auto& v) { v.erase(v.begin(), v.begin() + std::min(drop, v.size())); };
+        erase_front(values_);
+        erase_front(centered_);
+        for (auto* v : {&mean_, &stddev_, &qt_, &mp_, &left_mp_, &right_mp_}) erase_front(*v);
+        for (auto* v : {&mpi_, &left_mpi_, &right_mpi_}) erase_front(*v);
+        base_ = start_;
+    }
+
+    size_t m_;
+    size_t window_;
+    // First diagonal of the exclusion policy: subsequences with |i - j| < first_diag_ are trivial matches.
+    size_t first_diag_;
+
+    // Absolute index bookkeeping: total_ samples seen, the first retained one, and the first stored one.
+    size_t total_ = 0;
+    size_t start_ = 0;
+    size_t base_  = 0;
+
+    std::vector<double> values_;
+
+    // Samples minus shift_, the first sample of the stream.
+    double              shift_ = 0.0;
+    std::vector<double> centered_;
+
+    // Running mean and sum of squared deviations of the newest (centered) window.
+    double win_mean_ = 0.0;
+    double win_m2_   = 0.0;
+
+    // Length of the run of equal samples ending at the newest one.
+    size_t flat_run_ = 0;
+
+    // Per-subsequence statistics, of the centered samples.
+    std::vector<double> mean_;
+    std::vector<double> stddev_;
+
+    // Dot products of the newest subsequence against every retained subsequence.
+    std::vector<double> qt_;
+
+    std::vector<double>     mp_;
+    std::vector<index_type> mpi_;
+    std::vector<double>     left_mp_;
+    std::vector<index_type> left_mpi_;
+    std::vector<double>     right_mp_;
+    std::vector<index_type> right_mpi_;
+
+    // Scratch distance row.
+    std::vector<double> dist_;
+};
+
+} // namespace MPCC
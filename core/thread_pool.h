@@ -0,0 +1,306 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace MPCC {
+
+/// @brief Resolve a requested thread count. Zero means one thread per hardware thread, and the result is
+/// always at least one.
+inline size_t resolveThreadCount(size_t num_threads) {
+    if (num_threads == 0) num_threads = std::thread::hardware_concurrency();
+    return std::max<size_t>(num_threads, 1);
+}
+
+/// @brief Progress report for long-running routines: progress(done, total) with done out of total units of
+/// work finished. It is only ever called on the thread that started the routine, never concurrently, with
+/// non-decreasing done, finishing with done == total.
+using ProgressCallback = std::function<void(size_t done, size_t total)>;
+
+namespace detail {
+
+/// @brief Run fn(task, worker) for every task in [0, num_tasks) across up to num_workers threads. Tasks are
+/// handed out dynamically through a shared counter, so uneven tasks still balance. The calling thread acts as
+/// worker 0, and worker ids are dense in [0, num_workers), which lets callers index per-worker scratch
+/// buffers. With a single worker everything runs inline on the calling thread.
+///
+/// If progress is set it counts finished tasks. Only the calling thread reports, after each task it runs and
+/// once more after the other workers have joined, so the callback may safely touch thread-affine state (a
+/// Python or JS callback, for example).
+///
+/// If fn or progress throws, on any worker, no further tasks are handed out; once the running ones have
+/// finished and every thread has joined, the first exception is rethrown on the calling thread.
+template <class Fn>
+void parallelFor(size_t num_tasks, size_t num_workers, Fn&& fn, const ProgressCallback& progress = {}) {
+    num_workers = std::min(std::max<size_t>(num_workers, 1), std::max<size_t>(num_tasks, 1));
+
+    if (num_workers == 1) {
+        for (size_t task = 0; task < num_tasks; task++) {
+            fn(task, size_t{0});
+            if (progress) progress(task + 1, num_tasks);
+        }
+        return;
+    }
+
+    std::atomic<size_t> next{0};
+    std::atomic<size_t> done{0};
+    std::atomic<bool>   failed{false};
+    std::mutex          error_lock;
+    std::exception_ptr  error;
+    size_t reported = 0;
+    auto worker_loop = [&](size_t worker) {
+        try {
+            for (size_t task = next.fetch_add(1); task < num_tasks && !failed; task = next.fetch_add(1)) {
+                fn(task, worker);
+                const size_t finished = done.fetch_add(1) + 1;
+                if (worker == 0 && progress) {
+                    reported = finished;
+                    progress(finished, num_tasks);
+                }
+            }
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(error_lock);
+            if (!error) error = std::current_exception();
+            failed = true;
+        }
+    };
+
+    // Joins the workers on every way out of the block below, including a failure to start one of them.
+    struct Joiner {
+        std::vector<std::thread>& threads;
+        ~Joiner() {
+            for (auto& t : threads) t.join();
+        }
+    };
+
+    std::vector<std::thread> threads;
+    {
+        const Joiner joiner{threads};
+        try {
+            threads.reserve(num_workers - 1);
+            for (size_t worker = 1; worker < num_workers; worker++) {
+                threads.emplace_back(worker_loop, worker);
+            }
+        } catch (...) {
+            failed = true;
+            throw;
+        }
+        worker_loop(0);
+    }
+    if (error) std::rethrow_exception(error);
+
+    if (progress && reported != num_tasks) progress(num_tasks, num_tasks);
+}
+
+} // namespace detail
+
+/// @brief A persistent pool of worker threads with work stealing, for callers that run many short parallel
+/// loops (a batch of small series, say) and should not pay detail::parallelFor's thread startup each time.
+///
+/// parallelFor splits its tasks into one contiguous range per worker. Each worker runs its own range front to
+/// back, and a worker whose range runs dry steals the back half of another's, so uneven tasks still balance
+/// while neighboring tasks mostly stay on one thread. As in detail::parallelFor, the calling thread joins in
+/// as worker 0 and worker ids are dense, so callers can index per-worker scratch. One loop runs at a time;
+/// a parallelFor issued from inside one of the pool's tasks runs inline on that worker.
+class ThreadPool {
+public:
+    /// @brief A pool of num_threads workers in all, counting the thread that calls parallelFor (0 for one
+    /// per hardware thread). The other threads start here and sleep between loops.
+    explicit ThreadPool(size_t num_threads = 0) : num_workers_(resolveThreadCount(num_threads)), ranges_(num_workers_) {
+        threads_.reserve(num_workers_ - 1);
+        for (size_t worker = 1; worker < num_workers_; worker++) {
+            threads_.emplace_back([this, worker] { workerMain(worker); });
+        }
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(state_);
+            stop_ = true;
+        }
+        wake_.notify_all();
+        for (auto& t : threads_) t.join();
+    }
+
+    /// @brief Workers in the pool, counting the calling thread.
+    size_t size() const { return num_workers_; }
+
+    /// @brief The process-wide pool with one worker per hardware thread, started on first use.
+    static ThreadPool& shared() {
+        static ThreadPool pool;
+        return pool;
+    }
+
+    /// @brief Run fn(task, worker) for every task in [0, num_tasks) on up to max_workers of the pool's
+    /// workers (0 for all of them), returning once all have finished. progress counts finished tasks and is
+    /// only called on the calling thread, with the semantics of detail::parallelFor, exceptions included: the
+    /// first one thrown by fn or progress stops the loop and is rethrown here once every worker is idle.
+    template <class Fn>
+    void parallelFor(size_t num_tasks, Fn&& fn, const ProgressCallback& progress = {}, size_t max_workers = 0) {
+        const size_t cap     = max_workers == 0 ? num_workers_ : std::min(max_workers, num_workers_);
+        const size_t workers = std::min(cap, std::max<size_t>(num_tasks, 1));
+
+        if (workers == 1 || current_ == this) {
+            detail::parallelFor(num_tasks, 1, fn, progress);
+            return;
+        }
+
+        std::lock_guard<std::mutex> submit(submit_);
+
+        for (size_t w = 0; w < num_workers_; w++) {
+            std::lock_guard<std::mutex> lock(ranges_[w].lock);
+            ranges_[w].begin = w < workers ? w * num_tasks / workers : 0;
+            ranges_[w].end   = w < workers ? (w + 1) * num_tasks / workers : 0;
+        }
+        done_   = 0;
+        failed_ = false;
+
+        {
+            std::lock_guard<std::mutex> lock(state_);
+            job_          = [&fn](size_t task, size_t worker) { fn(task, worker); };
+            error_        = nullptr;
+            participants_ = workers;
+            pending_      = workers - 1;
+            generation_++;
+        }
+        wake_.notify_all();
+
+        // The workers call into fn until they go idle, so every way out of the block below waits for them.
+        struct LoopGuard {
+            ThreadPool& pool;
+            ~LoopGuard() {
+                current_ = nullptr;
+                std::unique_lock<std::mutex> lock(pool.state_);
+                pool.idle_.wait(lock, [this] { return pool.pending_ == 0; });
+                pool.job_ = nullptr;
+            }
+        };
+
+        size_t reported = 0;
+        {
+            const LoopGuard guard{*this};
+            current_ = this;
+            try {
+                for (size_t task; !failed_ && next(0, workers, task);) {
+                    job_(task, 0);
+                    const size_t finished = done_.fetch_add(1) + 1;
+                    if (progress) {
+                        reported = finished;
+                        progress(finished, num_tasks);
+                    }
+                }
+            } catch (...) {
+                fail(std::current_exception());
+            }
+        }
+        if (error_) std::rethrow_exception(std::exchange(error_, nullptr));
+
+        if (progress && reported != num_tasks) progress(num_tasks, num_tasks);
+    }
+
+private:
+    /// @brief A worker's remaining tasks [begin, end), on its own cache line.
+    struct alignas(64) TaskRange {
+        std::mutex lock;
+        size_t     begin = 0;
+        size_t     end   = 0;
+    };
+
+    /// @brief The next task of worker: the front of its own range, or else the first of the back half it
+    /// steals from the first other worker with tasks left. False once every range is empty.
+    bool next(size_t worker, size_t workers, size_t& task) {
+        {
+            std::lock_guard<std::mutex> lock(ranges_[worker].lock);
+            auto& own = ranges_[worker];
+            if (own.begin < own.end) {
+                task = own.begin++;
+                return true;
+            }
+        }
+        for (size_t offset = 1; offset < workers; offset++) {
+            auto&  victim = ranges_[(worker + offset) % workers];
+            size_t begin, end;
+            {
+                std::lock_guard<std::mutex> lock(victim.lock);
+                if (victim.begin >= victim.end) continue;
+                end        = victim.end;
+                begin      = victim.end - (victim.end - victim.begin + 1) / 2;
+                victim.end = begin;
+            }
+            std::lock_guard<std::mutex> lock(ranges_[worker].lock);
+            ranges_[worker].begin = begin + 1;
+            ranges_[worker].end   = end;
+            task = begin;
+            return true;
+        }
+        return false;
+    }
+
+    /// @brief Record the first exception of the current loop and stop handing out its tasks.
+    void fail(std::exception_ptr error) {
+        failed_ = true;
+        std::lock_guard<std::mutex> lock(state_);
+        if (!error_) error_ = std::move(error);
+    }
+
+    void workerMain(size_t worker) {
+        current_ = this;
+        uint64_t seen = 0;
+        for (;;) {
+            size_t workers;
+            {
+                std::unique_lock<std::mutex> lock(state_);
+                wake_.wait(lock, [&] { return stop_ || generation_ != seen; });
+                if (stop_) return;
+                seen    = generation_;
+                workers = participants_;
+            }
+            if (worker >= workers) continue;
+
+            try {
+                for (size_t task; !failed_ && next(worker, workers, task);) {
+                    job_(task, worker);
+                    done_.fetch_add(1);
+                }
+            } catch (...) {
+                fail(std::current_exception());
+            }
+
+            std::lock_guard<std::mutex> lock(state_);
+            if (--pending_ == 0) idle_.notify_one();
+        }
+    }
+
+    size_t                   num_workers_;
+    std::vector<TaskRange>   ranges_;
+    std::vector<std::thread> threads_;
+
+    std::mutex submit_;  // Serializes parallelFor calls from different threads.
+
+    std::mutex                               state_;
+    std::condition_variable                  wake_, idle_;
+    std::function<void(size_t, size_t)>      job_;
+    std::exception_ptr                       error_;  // The first exception of the current loop.
+    bool                                     stop_         = false;
+    uint64_t                                 generation_   = 0;
+    size_t                                   participants_ = 0;
+    size_t                                   pending_      = 0;
+    std::atomic<size_t>                      done_{0};
+    std::atomic<bool>                        failed_{false};
+
+    static inline thread_local const ThreadPool* current_ = nullptr;
+};
+
+} // namespace MPCC
@@ -0,0 +1,337 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <span>
+#include <type_traits>
+#include <vector>
+
+#include "core/matrix_profile.h"
+
+// Matrix profiles computed block by block. matrixProfileTile and matrixProfileABJoinTile produce the partial
+// profile of one rectangular block of the distance matrix, and mergeProfiles min-reduces partial profiles
+// into a full one, so the blocks of a large join can run anywhere (other processes, other machines) and be
+// reassembled in any order.
+
+namespace MPCC {
+
+/// @brief A block of the distance matrix: the distances from subsequences [row_begin, row_end) of the
+/// (first) series to subsequences [col_begin, col_end) of the (second) series. Ranges are half-open and in
+/// window indices, so a series of length n has n-m+1 rows and columns.
+struct ProfileTile {
+    size_t row_begin = 0;
+    size_t row_end   = 0;
+    size_t col_begin = 0;
+    size_t col_end   = 0;
+
+    size_t rows() const { return row_end - row_begin; }
+    size_t cols() const { return col_end - col_begin; }
+
+    /// @brief Whether the tile is a valid block of a rows x cols distance matrix.
+    bool fits(size_t num_rows, size_t num_cols) const {
+        return row_begin <= row_end && row_end <= num_rows && col_begin <= col_end && col_end <= num_cols;
+    }
+};
+
+namespace detail {
+
+/// @brief The count windows of seq starting at begin (values [begin, begin + count + m - 1)) and their means,
+/// shifted by shift as centerSeries does for the whole series. A tile only reads the part of the series it
+/// spans, so it centers just that.
+template <class T, class S>
+CenteredSeries<T> centerWindows(const S& seq, std::span<const T> mean, size_t begin, size_t count, size_t m,
+                                double shift) {
+    CenteredSeries<T> out;
+    out.values.resize(count + m - 1);
+    out.mean.resize(count);
+    for (size_t t = 0; t < out.values.size(); t++) out.values[t] = static_cast<T>(seq(begin + t) - shift);
+    for (size_t i = 0; i < count; i++)             out.mean[i]   = static_cast<T>(mean[begin + i] - shift);
+    return out;
+}
+
+/// @brief The average of the window means [begin, begin + count), the shift centerWindows applies.
+template <class T>
+double averageWindowMean(std::span<const T> mean, size_t begin, size_t count) {
+    double shift = 0.0;
+    for (size_t i = begin; i < begin + count; i++) shift += mean[i];
+    return shift / static_cast<double>(count);
+}
+
+} // namespace detail
+
+/// @brief Compute the partial self-join matrix profile of one block of the distance matrix: for every row i
+/// of tile, the distance to and index of its nearest neighbor among the tile's columns, skipping columns in
+/// the exclusion zone (|i - j| <= m/4 by default) exactly as matrixProfileNaive does. Entries whose columns all lie in
+/// the zone (or whose tile has no columns) are inf and -1.
+///
+/// The full self-join is the mergeProfiles reduction of the tiles of any partition of the columns, for each
+/// partition of the rows: merging every tile (r, c) of a grid into a profile initialised to inf and -1
+/// reproduces matrixProfileNaive up to floating-point rounding, ties included (lowest index wins). Tiles only
+/// read the windows they span, row_begin to row_end + m - 1 and col_begin to col_end + m - 1, and sweep
+/// their rows STOMP-style, so a tile costs O(rows * cols) plus the window statistics its caller provides.
+///
+/// @param sequence     The input time series (1-D).
+/// @param m            Subsequence length.
+/// @param stats        Window statistics of sequence for length m (see SequenceStats). The overload without
+///                     it computes them for the whole series.
+/// @param tile         The block to compute, within the (n-m+1) x (n-m+1) distance matrix.
+/// @param mp           Output partial profile, pre-allocated with size tile.rows(): mp[r] belongs to
+///                     subsequence tile.row_begin + r.
+/// @param mpi          Output neighbor indices, pre-allocated with size tile.rows(). Indices are absolute
+///                     (in [tile.col_begin, tile.col_end)), so partial profiles merge without translation.
+/// @param num_threads  Worker threads (0 for one per hardware thread).
+/// @param progress     Optional progress(done, total) callback counting finished row blocks.
+/// @param exclusion    Exclusion-zone policy (see QuarterExclusion); every tile of a grid must use the same.
+/// @return TileOutOfRange if tile is not a block of the distance matrix.
+template <class S, class D, class I, class T, class Acc, class Exclusion = QuarterExclusion>
+MatrixProfileStatus matrixProfileTile(
+    const xt::xexpression<S>& sequence,
+    size_t m,
+    const BasicSequenceStats<T, Acc>& stats,
+    const ProfileTile& tile,
+    xt::xexpression<D>& mp,
+    xt::xexpression<I>& mpi,
+    size_t num_threads = 1,
+    const ProgressCallback& progress = {},
+    Exclusion exclusion = {}
+) {
+    static_assert(xt::get_rank<S>::value == 1 || xt::get_rank<S>::value == SIZE_MAX, "sequence must be 1-dimensional");
+    static_assert(xt::get_rank<D>::value == 1 || xt::get_rank<D>::value == SIZE_MAX, "mp must be 1-dimensional");
+    static_assert(xt::get_rank<I>::value == 1 || xt::get_rank<I>::value == SIZE_MAX, "mpi must be 1-dimensional");
+    static_assert(std::is_same_v<T, detail::compute_t<S>>, "stats must match the precision of the sequence");
+
+    const auto& seq  = sequence.derived_cast();
+    auto&       mp_  = mp.derived_cast();
+    auto&       mpi_ = mpi.derived_cast();
+
+    if (seq.dimension() != 1) return MatrixProfileStatus::SequenceNotOneDimensional;
+    if (m == 0)               return MatrixProfileStatus::SubsequenceLengthZero;
+    if (m > seq.size())       return MatrixProfileStatus::SubsequenceLongerThanSequence;
+    if (!stats.matches(seq.size(), m)) return MatrixProfileStatus::StatsMismatch;
+
+    const size_t profile_len = seq.size() - m + 1;
+    if (!tile.fits(profile_len, profile_len)) return MatrixProfileStatus::TileOutOfRange;
+
+    const size_t rows = tile.rows();
+    const size_t cols = tile.cols();
+
+    if (mp_.size()  != rows) return MatrixProfileStatus::DistanceWrongSize;
+    if (mpi_.size() != rows) return MatrixProfileStatus::IndexWrongSize;
+
+    using idx_t = typename std::decay_t<decltype(mpi_)>::value_type;
+
+    const size_t first_diag = exclusion.firstDiagonal(m);
+
+    std::fill(mp_.begin(),  mp_.end(),  std::numeric_limits<double>::infinity());
+    std::fill(mpi_.begin(), mpi_.end(), static_cast<idx_t>(-1));
+    if (rows == 0 || cols == 0) return MatrixProfileStatus::Success;
+
+    // Both sides of a self-join tile must share one shift; the rows' average mean serves as well as the
+    // series' and does not require reading the rest of it.
+    const auto   mean   = stats.mean(m);
+    const T*     stddev = stats.stddev(m).data();
+    const double shift  = detail::averageWindowMean(mean, tile.row_begin, rows);
+    const auto   a      = detail::centerWindows(seq, mean, tile.row_begin, rows, m, shift);
+    const auto   b      = detail::centerWindows(seq, mean, tile.col_begin, cols, m, shift);
+
+    const auto& kern = kernels::active<T>();
+
+    detail::stompSweep(
+        a.values.data(), a.mean.data(), stddev + tile.row_begin, rows,
+        b.values.data(), b.mean.data(), stddev + tile.col_begin, cols,
+        m, num_threads,
+        [&](size_t r, const T* dist) {
+            // The columns of row i's exclusion zone, clamped to the tile, in tile coordinates.
+            const size_t i                      = tile.row_begin + r;
+            const auto   [left_end, right_begin] = detail::candidateRanges(i, profile_len, first_diag);
+            const size_t zone_begin = std::clamp(left_end, tile.col_begin, tile.col_end) - tile.col_begin;
+            const size_t zone_end   = std::clamp(right_begin, tile.col_begin, tile.col_end) - tile.col_begin;
+
+            const ArgMin left  = kern.argmin(dist, 0, zone_begin);
+            const ArgMin right = kern.argmin(dist, zone_end, cols);
+            const ArgMin best  = right.value < left.value ? right : left;
+            if (best.index != SIZE_MAX) {
+                mp_[r]  = best.value;
+                mpi_[r] = static_cast<idx_t>(tile.col_begin + best.index);
+            }
+        },
+        progress);
+
+    return MatrixProfileStatus::Success;
+}
+
+/// @brief matrixProfileTile without precomputed statistics; see the overload above.
+template <class S, class D, class I, class Exclusion = QuarterExclusion>
+MatrixProfileStatus matrixProfileTile(
+    const xt::xexpression<S>& sequence,
+    size_t m,
+    const ProfileTile& tile,
+    xt::xexpression<D>& mp,
+    xt::xexpression<I>& mpi,
+    size_t num_threads = 1,
+    const ProgressCallback& progress = {},
+    Exclusion exclusion = {}
+) {
+    return matrixProfileTile(sequence, m, detail::StatsFor<S>(sequence, m), tile, mp, mpi, num_threads, progress,
+                             exclusion);
+}
+
+/// @brief Compute the partial AB-join matrix profile of one block of the distance matrix between the
+/// subsequences of sequence_a (rows) and sequence_b (columns): for every row of tile, the nearest neighbor
+/// among the tile's columns. There is no exclusion zone, as in matrixProfileABJoin, which the mergeProfiles
+/// reduction of the tiles of any grid reproduces up to floating-point rounding.
+///
+/// @param sequence_a   The query time series (1-D).
+/// @param sequence_b   The reference time series (1-D).
+/// @param m            Subsequence length.
+/// @param stats_a      Window statistics of sequence_a for length m (see SequenceStats).
+/// @param stats_b      Window statistics of sequence_b for length m.
+/// @param tile         The block to compute, within the (n_a-m+1) x (n_b-m+1) distance matrix.
+/// @param mp           Output partial profile, pre-allocated with size tile.rows().
+/// @param mpi          Output absolute indices into sequence_b, pre-allocated with size tile.rows().
+/// @param num_threads  Worker threads (0 for one per hardware thread).
+/// @param progress     Optional progress(done, total) callback counting finished row blocks.
+/// @return TileOutOfRange if tile is not a block of the distance matrix.
+template <class A, class B, class D, class I, class T, class AccA, class AccB>
+MatrixProfileStatus matrixProfileABJoinTile(
+    const xt::xexpression<A>& sequence_a,
+    const xt::xexpression<B>& sequence_b,
+    size_t m,
+    const BasicSequenceStats<T, AccA>& stats_a,
+    const BasicSequenceStats<T, AccB>& stats_b,
+    const ProfileTile& tile,
+    xt::xexpression<D>& mp,
+    xt::xexpression<I>& mpi,
+    size_t num_threads = 1,
+    const ProgressCallback& progress = {}
+) {
+    static_assert(xt::get_rank<A>::value == 1 || xt::get_rank<A>::value == SIZE_MAX, "sequence_a must be 1-dimensional");
+    static_assert(xt::get_rank<B>::value == 1 || xt::get_rank<B>::value == SIZE_MAX, "sequence_b must be 1-dimensional");
+    static_assert(xt::get_rank<D>::value == 1 || xt::get_rank<D>::value == SIZE_MAX, "mp must be 1-dimensional");
+    static_assert(xt::get_rank<I>::value == 1 || xt::get_rank<I>::value == SIZE_MAX, "mpi must be 1-dimensional");
+    static_assert(std::is_same_v<T, detail::compute_t<A>> && std::is_same_v<T, detail::compute_t<B>>,
+                  "both sequences and their stats must share one precision");
+
+    const auto& seq_a = sequence_a.derived_cast();
+    const auto& seq_b = sequence_b.derived_cast();
+    auto&       mp_   = mp.derived_cast();
+    auto&       mpi_  = mpi.derived_cast();
+
+    if (seq_a.dimension() != 1) return MatrixProfileStatus::SequenceNotOneDimensional;
+    if (seq_b.dimension() != 1) return MatrixProfileStatus::ReferenceNotOneDimensional;
+    if (m == 0)                 return MatrixProfileStatus::SubsequenceLengthZero;
+    if (m > seq_a.size())       return MatrixProfileStatus::SubsequenceLongerThanSequence;
+    if (m > seq_b.size())       return MatrixProfileStatus::SubsequenceLongerThanReference;
+    if (!stats_a.matches(seq_a.size(), m) || !stats_b.matches(seq_b.size(), m)) {
+        return MatrixProfileStatus::StatsMismatch;
+    }
+    if (!tile.fits(seq_a.size() - m + 1, seq_b.size() - m + 1)) return MatrixProfileStatus::TileOutOfRange;
+
+    const size_t rows = tile.rows();
+    const size_t cols = tile.cols();
+
+    if (mp_.size()  != rows) return MatrixProfileStatus::DistanceWrongSize;
+    if (mpi_.size() != rows) return MatrixProfileStatus::IndexWrongSize;
+
+    using idx_t = typename std::decay_t<decltype(mpi_)>::value_type;
+
+    std::fill(mp_.begin(),  mp_.end(),  std::numeric_limits<double>::infinity());
+    std::fill(mpi_.begin(), mpi_.end(), static_cast<idx_t>(-1));
+    if (rows == 0 || cols == 0) return MatrixProfileStatus::Success;
+
+    // Each series may take its own shift, as in matrixProfileABJoin.
+    const auto mean_a = stats_a.mean(m);
+    const auto mean_b = stats_b.mean(m);
+    const auto a = detail::centerWindows(seq_a, mean_a, tile.row_begin, rows, m,
+                                         detail::averageWindowMean(mean_a, tile.row_begin, rows));
+    const auto b = detail::centerWindows(seq_b, mean_b, tile.col_begin, cols, m,
+                                         detail::averageWindowMean(mean_b, tile.col_begin, cols));
+
+    const auto& kern = kernels::active<T>();
+
+    detail::stompSweep(
+        a.values.data(), a.mean.data(), stats_a.stddev(m).data() + tile.row_begin, rows,
+        b.values.data(), b.mean.data(), stats_b.stddev(m).data() + tile.col_begin, cols,
+        m, num_threads,
+        [&](size_t r, const T* dist) {
+            const ArgMin best = kern.argmin(dist, 0, cols);
+            if (best.index != SIZE_MAX) {
+                mp_[r]  = best.value;
+                mpi_[r] = static_cast<idx_t>(tile.col_begin + best.index);
+            }
+        },
+        progress);
+
+    return MatrixProfileStatus::Success;
+}
+
+/// @brief matrixProfileABJoinTile without precomputed statistics; see the overload above.
+template <class A, class B, class D, class I>
+MatrixProfileStatus matrixProfileABJoinTile(
+    const xt::xexpression<A>& sequence_a,
+    const xt::xexpression<B>& sequence_b,
+    size_t m,
+    const ProfileTile& tile,
+    xt::xexpression<D>& mp,
+    xt::xexpression<I>& mpi,
+    size_t num_threads = 1,
+    const ProgressCallback& progress = {}
+) {
+    return matrixProfileABJoinTile(sequence_a, sequence_b, m,
+                                   detail::StatsFor<A>(sequence_a, m), detail::StatsFor<B>(sequence_b, m),
+                                   tile, mp, mpi, num_threads, progress);
+}
+
+/// @brief Min-reduce a partial profile into mp/mpi: for every r, entry offset + r takes (partial_mp[r],
+/// partial_mpi[r]) if that is a nearer neighbor, with ties going to the lower index. Partial entries
+/// without a neighbor (index -1) are skipped. The reduction is commutative and associative, so tiles may be
+/// merged in any order, and partial profiles may themselves be merged before reaching the full one.
+///
+/// @param mp           Profile merged into, initialised to inf (and mpi to -1) before the first merge.
+/// @param mpi          Neighbor indices of mp, with the same size.
+/// @param partial_mp   A partial profile, such as the output of matrixProfileTile.
+/// @param partial_mpi  Its neighbor indices, with the same size.
+/// @param offset       Entry of mp that partial_mp[0] belongs to (the tile's row_begin).
+template <class D, class I, class PD, class PI>
+MatrixProfileStatus mergeProfiles(
+    xt::xexpression<D>& mp,
+    xt::xexpression<I>& mpi,
+    const xt::xexpression<PD>& partial_mp,
+    const xt::xexpression<PI>& partial_mpi,
+    size_t offset = 0
+) {
+    static_assert(xt::get_rank<D>::value == 1 || xt::get_rank<D>::value == SIZE_MAX, "mp must be 1-dimensional");
+    static_assert(xt::get_rank<I>::value == 1 || xt::get_rank<I>::value == SIZE_MAX, "mpi must be 1-dimensional");
+    static_assert(xt::get_rank<PD>::value == 1 || xt::get_rank<PD>::value == SIZE_MAX,
+                  "partial_mp must be 1-dimensional");
+    static_assert(xt::get_rank<PI>::value == 1 || xt::get_rank<PI>::value == SIZE_MAX,
+                  "partial_mpi must be 1-dimensional");
+
+    auto&       mp_   = mp.derived_cast();
+    auto&       mpi_  = mpi.derived_cast();
+    const auto& pmp_  = partial_mp.derived_cast();
+    const auto& pmpi_ = partial_mpi.derived_cast();
+
+    if (mpi_.size() != mp_.size())  return MatrixProfileStatus::IndexWrongSize;
+    if (offset > mp_.size() || pmp_.size() > mp_.size() - offset) return MatrixProfileStatus::DistanceWrongSize;
+    if (pmpi_.size() != pmp_.size()) return MatrixProfileStatus::IndexWrongSize;
+
+    using idx_t = typename std::decay_t<decltype(mpi_)>::value_type;
+
+    for (size_t r = 0; r < pmp_.size(); r++) {
+        const auto j = static_cast<int64_t>(pmpi_[r]);
+        if (j < 0) continue;
+
+        const size_t k      = offset + r;
+        const double d      = pmp_[r];
+        const auto   best_j = static_cast<int64_t>(mpi_[k]);
+        if (best_j < 0 || detail::isBetterNeighbor(d, j, static_cast<double>(mp_[k]), best_j)) {
+            mp_[k]  = d;
+            mpi_[k] = static_cast<idx_t>(j);
+        }
+    }
+    return MatrixProfileStatus::Success;
+}
+
+} // namespace MPCC
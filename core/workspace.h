@@ -0,0 +1,151 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <type_traits>
+
+#include "core/sequence_stats.h"
+#include "core/thread_pool.h"
+
+namespace MPCC {
+
+namespace detail {
+
+/// @brief The scratch buffers of a Workspace, one per role. An engine only touches the slots it needs, and
+/// every call reuses them from the start.
+enum class WorkspaceSlot : size_t {
+    SeriesValues,    ///< The centered series (n values), or a contiguous copy of a strided one.
+    SeriesMean,      ///< Its shifted window means (n - m + 1).
+    ReferenceValues, ///< The same for the second series of an AB-join.
+    ReferenceMean,
+    FirstColumn,     ///< Column 0 of every STOMP row.
+    Rows,            ///< Per-worker distance-matrix rows: STOMP's two dot-product rows and distances, the
+                     ///< naive engine's distance profile.
+    Queries,         ///< Per-worker centered queries of the naive engine (m values each).
+    TileStarts,      ///< The diagonal engine's tile boundaries.
+    Profiles,        ///< Per-worker distances of the diagonal engine (the right ones with left/right).
+    Indices,         ///< Their indices.
+    LeftProfiles,    ///< Per-worker left distances of the left/right diagonal engine.
+    LeftIndices,     ///< Their indices.
+};
+
+inline constexpr size_t kNumWorkspaceSlots = 12;
+
+/// @brief Alignment of every workspace buffer: a cache line, which also suits any SIMD width the kernels use.
+inline constexpr size_t kWorkspaceAlignment = 64;
+
+} // namespace detail
+
+/// @brief Reusable scratch memory for the matrix profile engines, so that a loop computing profile after
+/// profile (a service handling a stream of requests, say) stops allocating once it has warmed up. Pass a
+/// pointer to it as the trailing workspace argument of matrixProfileNaive, matrixProfileStomp,
+/// matrixProfileDiagonal or matrixProfileABJoin: the engine then takes its centered series, dot-product and
+/// distance rows, per-worker profiles and (for the overloads without stats) window statistics from here
+/// instead of the heap. Buffers grow to the largest call seen and never shrink; reserve sizes them up front
+/// so even the first call does not allocate. Results are bit-identical to calls without a workspace.
+///
+/// Multi-threaded calls normally start their threads per call. A workspace constructed over a ThreadPool runs
+/// them on that pool's persistent workers instead, which is what makes multi-threaded steady-state calls
+/// allocation-free too (the pool runs one loop at a time, so give concurrent callers their own pools).
+///
+/// A workspace serves one call at a time: use one per calling thread.
+class Workspace {
+public:
+    /// @brief A workspace whose multi-threaded calls start threads per call, as calls without one do.
+    Workspace() = default;
+
+    /// @brief A workspace whose calls run on pool (for example ThreadPool::shared()), which must outlive it.
+    explicit Workspace(ThreadPool& pool) : pool_(&pool) {}
+
+    Workspace(const Workspace&) = delete;
+    Workspace& operator=(const Workspace&) = delete;
+
+    /// @brief Size the buffers for any self-join or AB-join of series of up to max_n values on num_threads
+    /// workers (0 for one per hardware thread), in either precision. The window statistics of the overloads
+    /// without stats still grow on first use.
+    void reserve(size_t max_n, size_t num_threads = 1) {
+        using detail::WorkspaceSlot;
+        const size_t workers = resolveThreadCount(num_threads);
+
+        reserveBytes(WorkspaceSlot::SeriesValues,    max_n * sizeof(double));
+        reserveBytes(WorkspaceSlot::SeriesMean,      max_n * sizeof(double));
+        reserveBytes(WorkspaceSlot::ReferenceValues, max_n * sizeof(double));
+        reserveBytes(WorkspaceSlot::ReferenceMean,   max_n * sizeof(double));
+        reserveBytes(WorkspaceSlot::FirstColumn,     max_n * sizeof(double));
+        reserveBytes(WorkspaceSlot::Rows,            3 * workers * max_n * sizeof(double));
+        reserveBytes(WorkspaceSlot::Queries,         workers * max_n * sizeof(double));
+        reserveBytes(WorkspaceSlot::TileStarts,      (max_n + 1) * sizeof(size_t));
+        reserveBytes(WorkspaceSlot::Profiles,        workers * max_n * sizeof(double));
+        reserveBytes(WorkspaceSlot::Indices,         workers * max_n * sizeof(int64_t));
+        reserveBytes(WorkspaceSlot::LeftProfiles,    workers * max_n * sizeof(double));
+        reserveBytes(WorkspaceSlot::LeftIndices,     workers * max_n * sizeof(int64_t));
+    }
+
+    /// @brief Bytes currently held by the scratch buffers (not counting the window statistics).
+    size_t capacityBytes() const {
+        size_t total = 0;
+        for (const auto& buffer : buffers_) total += buffer.capacity;
+        return total;
+    }
+
+    /// @brief The pool calls run on, or nullptr if they start their own threads.
+    ThreadPool* pool() const { return pool_; }
+
+    /// @brief count values of type T in slot, grown (discarding its contents) if it is smaller. Used by the
+    /// engines; the pointer is valid until the slot is next requested larger.
+    template <class T>
+    T* buffer(detail::WorkspaceSlot slot, size_t count) {
+        static_assert(std::is_trivially_copyable_v<T> && alignof(T) <= detail::kWorkspaceAlignment);
+        reserveBytes(slot, count * sizeof(T));
+        return reinterpret_cast<T*>(buffers_[static_cast<size_t>(slot)].data.get());
+    }
+
+    /// @brief Window statistics the overloads without stats compute into, recomputed in place each call: series
+    /// 0 for a self-join or the first series of an AB-join, 1 for its second.
+    template <class T>
+    BasicSequenceStats<T>& stats(size_t series = 0) {
+        if constexpr (std::is_same_v<T, float>) return stats_f32_[series];
+        else return stats_[series];
+    }
+
+    /// @brief detail::parallelFor, on the pool if there is one.
+    template <class Fn>
+    void parallelFor(size_t num_tasks, size_t num_workers, Fn&& fn, const ProgressCallback& progress = {}) {
+        if (pool_) {
+            pool_->parallelFor(num_tasks, fn, progress, num_workers);
+        } else {
+            detail::parallelFor(num_tasks, num_workers, fn, progress);
+        }
+    }
+
+private:
+    struct AlignedDelete {
+        void operator()(std::byte* p) const { ::operator delete[](p, std::align_val_t(detail::kWorkspaceAlignment)); }
+    };
+
+    struct Buffer {
+        std::unique_ptr<std::byte[], AlignedDelete> data;
+        size_t                                      capacity = 0;
+    };
+
+    void reserveBytes(detail::WorkspaceSlot slot, size_t bytes) {
+        Buffer& buffer = buffers_[static_cast<size_t>(slot)];
+        if (bytes <= buffer.capacity) return;
+
+        // Whole cache lines, so no other allocation shares the buffer's last one.
+        constexpr size_t align = detail::kWorkspaceAlignment;
+        bytes = (bytes + align - 1) / align * align;
+        buffer.data.reset(static_cast<std::byte*>(::operator new[](bytes, std::align_val_t(align))));
+        buffer.capacity = bytes;
+    }
+
+    ThreadPool*                                    pool_ = nullptr;
+    std::array<Buffer, detail::kNumWorkspaceSlots> buffers_;
+    std::array<BasicSequenceStats<double>, 2>      stats_;
+    std::array<BasicSequenceStats<float>, 2>       stats_f32_;
+};
+
+} // namespace MPCC
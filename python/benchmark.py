@@ -0,0 +1,98 @@
+"""Time the mpcc bindings against stumpy on the same inputs.
+
+Run with
+
+    bazel run -c opt //python:benchmark -- --sizes 4096 16384 --m 64 --threads 1 0
+
+Each case reports the best of --repeat runs for both libraries and the speedup of mpcc over stumpy. stumpy
+compiles its kernels with numba on first use, so every function is called once on a small input before
+anything is timed. --json writes the results to a file for tracking regressions between commits.
+"""
+
+import argparse
+import json
+import os
+import time
+
+import numpy as np
+import stumpy
+
+from python import mpcc_py as mpcc
+
+
+def best_time(fn, repeat):
+    """The fastest of repeat calls of fn, in seconds."""
+    best = float("inf")
+    for _ in range(repeat):
+        start = time.perf_counter()
+        fn()
+        best = min(best, time.perf_counter() - start)
+    return best
+
+
+def warm_up():
+    """Trigger stumpy's numba compilation so that it is not timed."""
+    sequence = np.random.default_rng(0).standard_normal(256)
+    stumpy.stump(sequence, 16)
+    stumpy.mass(sequence[:16], sequence)
+
+
+def cases(sizes, m, threads):
+    """(name, n, num_threads, mpcc callable, stumpy callable) for every benchmarked pair."""
+    for n in sizes:
+        rng = np.random.default_rng(n)
+        sequence = np.cumsum(rng.standard_normal(n))
+        other = np.cumsum(rng.standard_normal(n))
+        query = sequence[n // 3:n // 3 + m].copy()
+
+        yield ("similarity_search", n, 1,
+               lambda: mpcc.similarity_search(sequence, query),
+               lambda: stumpy.mass(query, sequence))
+        yield ("similarity_search_mass", n, 1,
+               lambda: mpcc.similarity_search_mass(sequence, query),
+               lambda: stumpy.mass(query, sequence))
+
+        # stumpy.stump runs on every core through numba; set NUMBA_NUM_THREADS to pin it.
+        for num_threads in threads:
+            for engine in ("stomp", "diagonal"):
+                fn = getattr(mpcc, "matrix_profile_" + engine)
+                yield ("matrix_profile_" + engine, n, num_threads,
+                       lambda fn=fn, t=num_threads: fn(sequence, m, num_threads=t),
+                       lambda: stumpy.stump(sequence, m))
+            yield ("matrix_profile_ab_join", n, num_threads,
+                   lambda t=num_threads: mpcc.matrix_profile_ab_join(sequence, other, m, num_threads=t),
+                   lambda: stumpy.stump(sequence, m, other, ignore_trivial=False))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--sizes", type=int, nargs="+", default=[4096, 16384, 65536],
+                        help="series lengths")
+    parser.add_argument("--m", type=int, default=64, help="subsequence length")
+    parser.add_argument("--threads", type=int, nargs="+", default=[1, 0],
+                        help="mpcc thread counts (0 for one per hardware thread)")
+    parser.add_argument("--repeat", type=int, default=3, help="runs per case; the fastest is reported")
+    parser.add_argument("--json", help="also write the results to this file")
+    args = parser.parse_args()
+
+    warm_up()
+
+    print(f"mpcc SIMD backend: {mpcc.simd_backend()}, "
+          f"numba threads: {os.environ.get('NUMBA_NUM_THREADS', 'all')}")
+    print(f"{'function':<26}{'n':>9}{'threads':>9}{'mpcc (s)':>12}{'stumpy (s)':>12}{'speedup':>9}")
+
+    results = []
+    for name, n, num_threads, ours, theirs in cases(args.sizes, args.m, args.threads):
+        ours_s = best_time(ours, args.repeat)
+        theirs_s = best_time(theirs, args.repeat)
+        print(f"{name:<26}{n:>9}{num_threads:>9}{ours_s:>12.4f}{theirs_s:>12.4f}{theirs_s / ours_s:>8.1f}x")
+        results.append({"function": name, "n": n, "m": args.m, "num_threads": num_threads,
+                        "mpcc_s": ours_s, "stumpy_s": theirs_s})
+
+    if args.json:
+        with open(args.json, "w") as f:
+            json.dump(results, f, indent=2)
+
+
+if __name__ == "__main__":
+    main()
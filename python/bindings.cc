@@ -1,109 +1,1497 @@
 #include <nanobind/nanobind.h>
 #include <nanobind/ndarray.h>
+#include <nanobind/stl/optional.h>
+#include <nanobind/stl/pair.h>
+#include <nanobind/stl/string.h>
+#include <nanobind/stl/vector.h>
+#include <mutex>
+#include <stdexcept>
 #include <xtensor/containers/xadapt.hpp>
 #include <xtensor/containers/xtensor.hpp>
 
+#include "core/anytime_matrix_profile.h"
+#include "core/batch_matrix_profile.h"
+#ifdef MPCC_WITH_CUDA
+#include "core/cuda_matrix_profile.h"
+#endif
+#include "core/instrumentation.h"
+#include "core/mapped_matrix_profile.h"
 #include "core/matrix_profile.h"
+#include "core/motifs.h"
+#include "core/multidim_matrix_profile.h"
+#include "core/pan_matrix_profile.h"
+#include "core/profile_codec.h"
+#include "core/streaming.h"
+#include "core/tiled_matrix_profile.h"
+#include "core/workspace.h"
 
 namespace nb = nanobind;
 
-using InputArray      = nb::ndarray<double,  nb::ndim<1>, nb::c_contig, nb::device::cpu>;
-using OutputArray     = nb::ndarray<nb::numpy, double,  nb::ndim<1>>;
-using OutputArrayInt64= nb::ndarray<nb::numpy, int64_t, nb::ndim<1>>;
+// Every search and matrix profile function is bound for float64 and float32 inputs (T = double, float).
+// Inputs and out= arrays may have any stride; see stridedInput and adaptStrided.
+template <class T>
+using InputArrayT     = nb::ndarray<const T, nb::ndim<1>, nb::device::cpu>;
+template <class T, size_t Ndim = 1>
+using WritableArrayT  = nb::ndarray<T, nb::ndim<Ndim>, nb::device::cpu>;
+template <class T>
+using InputMatrixT    = nb::ndarray<const T, nb::ndim<2>, nb::device::cpu>;
+template <class T, size_t Ndim = 1>
+using OutputArrayT    = nb::ndarray<nb::numpy, T, nb::ndim<Ndim>>;
+template <class T>
+using ViewArrayT      = nb::ndarray<nb::numpy, const T, nb::ndim<1>>;
 
-NB_MODULE(mpcc_py, m) {
-    m.doc() = "MPCC Python bindings";
+using OutputArrayInt64= OutputArrayT<int64_t>;
 
-    m.def("similarity_search", [](InputArray sequence, InputArray query) -> OutputArray {
-        const size_t n = sequence.shape(0);
-        const size_t m = query.shape(0);
+// 1-D xtensor adaptor over n elements spaced stride elements apart (stride >= 0), without copying. The core
+// uses unit-stride data in place and gathers any other stride itself, outside the GIL.
+template <class P>
+static auto adaptStrided(P* data, size_t n, std::ptrdiff_t stride) {
+    const size_t extent = n == 0 ? 0 : (n - 1) * static_cast<size_t>(stride) + 1;
+    return xt::adapt(data, extent, xt::no_ownership(), std::vector<size_t>{n}, std::vector<std::ptrdiff_t>{stride});
+}
+
+// 2-D counterpart of adaptStrided over an array whose strides are known to be non-negative.
+template <class Array>
+static auto adaptStrided2D(const Array& array) {
+    const size_t rows = array.shape(0);
+    const size_t cols = array.shape(1);
+    const size_t extent = (rows == 0 || cols == 0) ? 0
+        : (rows - 1) * static_cast<size_t>(array.stride(0)) + (cols - 1) * static_cast<size_t>(array.stride(1)) + 1;
+    return xt::adapt(array.data(), extent, xt::no_ownership(), std::vector<size_t>{rows, cols},
+                     std::vector<std::ptrdiff_t>{array.stride(0), array.stride(1)});
+}
+
+// A 1-D input as (data, size, stride). Arrays with a negative stride (a[::-1]) are the one case an adaptor
+// over the array's own buffer cannot express, so only those are copied, into copy.
+template <class T>
+struct StridedInput {
+    const T*       data;
+    size_t         size;
+    std::ptrdiff_t stride;
+    std::vector<T> copy;
+
+    auto adapt() const { return adaptStrided(data, size, stride); }
+};
+
+template <class T>
+static StridedInput<T> stridedInput(const InputArrayT<T>& array) {
+    StridedInput<T> in{array.data(), array.shape(0), static_cast<std::ptrdiff_t>(array.stride(0)), {}};
+    if (in.stride < 0) {
+        in.copy.resize(in.size);
+        for (size_t i = 0; i < in.size; i++) in.copy[i] = in.data[static_cast<std::ptrdiff_t>(i) * in.stride];
+        in.data   = in.copy.data();
+        in.stride = 1;
+    }
+    return in;
+}
+
+template <class T>
+static constexpr const char* dtypeName() {
+    if constexpr (std::is_same_v<T, float>)       return "float32";
+    else if constexpr (std::is_same_v<T, double>) return "float64";
+    else                                          return "int64";
+}
+
+// The caller-provided output array passed as out, which must already have element type T, be writable and
+// Ndim-dimensional. It is never converted, since the results would then land in a temporary copy.
+template <class T, size_t Ndim = 1>
+static WritableArrayT<T, Ndim> outputArray(nb::handle out, const char* name) {
+    WritableArrayT<T, Ndim> array;
+    if (!nb::try_cast(out, array, /*convert=*/false)) {
+        throw nb::type_error((std::string(name) + " must be a writable " + std::to_string(Ndim) + "-D " +
+                              dtypeName<T>() + " array").c_str());
+    }
+    for (size_t d = 0; d < Ndim; d++) {
+        if (array.stride(d) < 0) {
+            throw nb::value_error((std::string(name) + " must not have a negative stride").c_str());
+        }
+    }
+    return array;
+}
+
+// Wrap a span of internal storage as a read-only numpy array without copying. The caller must tie the
+// array's lifetime to the owning object (rv_policy::reference_internal).
+template <class T>
+static ViewArrayT<T> viewOf(std::span<const T> values) {
+    size_t shape[1] = {values.size()};
+    return ViewArrayT<T>(values.data(), 1, shape, nb::handle());
+}
 
-        if (m > n) {
+// Translate a non-success similarity search status into the matching Python exception.
+[[noreturn]] static void throwSimilaritySearchError(MPCC::SimilaritySearchStatus status) {
+    switch (status) {
+        case MPCC::SimilaritySearchStatus::SequenceNotOneDimensional:
+            throw nb::value_error("sequence must be 1-dimensional");
+        case MPCC::SimilaritySearchStatus::QueryNotOneDimensional:
+            throw nb::value_error("query must be 1-dimensional");
+        case MPCC::SimilaritySearchStatus::DistanceNotOneDimensional:
+            throw nb::value_error("distance must be 1-dimensional");
+        case MPCC::SimilaritySearchStatus::QueriesNotTwoDimensional:
+            throw nb::value_error("queries must be 2-dimensional");
+        case MPCC::SimilaritySearchStatus::DistanceNotTwoDimensional:
+            throw nb::value_error("distance must be 2-dimensional");
+        case MPCC::SimilaritySearchStatus::QueryLongerThanSequence:
             throw nb::value_error("query must not be longer than sequence");
+        case MPCC::SimilaritySearchStatus::DistanceWrongSize:
+            throw nb::value_error("distance has wrong size");
+        case MPCC::SimilaritySearchStatus::StatsMismatch:
+            throw nb::value_error("stats were not computed for this sequence length and query length");
+        case MPCC::SimilaritySearchStatus::IndexNotOneDimensional:
+            throw nb::value_error("index must be 1-dimensional");
+        case MPCC::SimilaritySearchStatus::IndexWrongSize:
+            throw nb::value_error("index has wrong size");
+        default:
+            throw nb::value_error("similarity search failed");
+    }
+}
+
+// Run the given similarity search over the sequence, writing the distance profile into out when one is given
+// (and returning it) or else into a new array owned by Python.
+template <class T, class Search>
+static nb::object computeSimilaritySearch(InputArrayT<T> sequence, InputArrayT<T> query, nb::handle out,
+                                          Search search) {
+    const size_t n = sequence.shape(0);
+    const size_t m = query.shape(0);
+
+    if (m > n) {
+        throw nb::value_error("query must not be longer than sequence");
+    }
+
+    const auto seq_in = stridedInput(sequence);
+    const auto qry_in = stridedInput(query);
+    auto seq = seq_in.adapt();
+    auto qry = qry_in.adapt();
+
+    const size_t out_size = n - m + 1;
+    if (!out.is_none()) {
+        auto out_array = outputArray<T>(out, "out");
+        auto dist = adaptStrided(out_array.data(), out_array.shape(0), out_array.stride(0));
+
+        MPCC::SimilaritySearchStatus status;
+        {
+            nb::gil_scoped_release release;
+            status = search(seq, qry, dist);
         }
+        if (status != MPCC::SimilaritySearchStatus::Success) throwSimilaritySearchError(status);
+        return nb::borrow(out);
+    }
+
+    // Allocate the output array and adapt it to an xtensor view.
+    T*   dist_data = new T[out_size];
+    auto dist = xt::adapt(dist_data, out_size, xt::no_ownership(), std::vector<size_t>{out_size});
+
+    MPCC::SimilaritySearchStatus status;
+    {
+        nb::gil_scoped_release release;
+        status = search(seq, qry, dist);
+    }
+
+    if (status != MPCC::SimilaritySearchStatus::Success) {
+        delete[] dist_data;
+        throwSimilaritySearchError(status);
+    }
+
+    // Transfer ownership of dist_data to Python via a capsule.
+    size_t shape[1] = {out_size};
+    return nb::cast(OutputArrayT<T>(
+        dist_data,
+        1,
+        shape,
+        nb::capsule(dist_data, [](void* p) noexcept { delete[] static_cast<T*>(p); })
+    ));
+}
+
+// Translate a non-success matrix profile status into the matching Python exception.
+[[noreturn]] static void throwMatrixProfileError(MPCC::MatrixProfileStatus status) {
+    switch (status) {
+        case MPCC::MatrixProfileStatus::SequenceNotOneDimensional:
+            throw nb::value_error("sequence must be 1-dimensional");
+        case MPCC::MatrixProfileStatus::SubsequenceLengthZero:
+            throw nb::value_error("m must be greater than 0");
+        case MPCC::MatrixProfileStatus::SubsequenceLongerThanSequence:
+            throw nb::value_error("m must not be larger than sequence length");
+        case MPCC::MatrixProfileStatus::DistanceWrongSize:
+            throw nb::value_error("distance has wrong size");
+        case MPCC::MatrixProfileStatus::IndexWrongSize:
+            throw nb::value_error("index has wrong size");
+        case MPCC::MatrixProfileStatus::SimilaritySearchFailed:
+            throw nb::value_error("similarity search failed");
+        case MPCC::MatrixProfileStatus::ReferenceNotOneDimensional:
+            throw nb::value_error("reference sequence must be 1-dimensional");
+        case MPCC::MatrixProfileStatus::SubsequenceLongerThanReference:
+            throw nb::value_error("m must not be larger than reference sequence length");
+        case MPCC::MatrixProfileStatus::StatsMismatch:
+            throw nb::value_error("stats were not computed for this sequence length and m");
+        case MPCC::MatrixProfileStatus::DistanceNotTwoDimensional:
+            throw nb::value_error("distance must be 2-dimensional");
+        case MPCC::MatrixProfileStatus::IndexNotTwoDimensional:
+            throw nb::value_error("index must be 2-dimensional");
+        case MPCC::MatrixProfileStatus::SequenceNotTwoDimensional:
+            throw nb::value_error("sequences must be 2-dimensional");
+        case MPCC::MatrixProfileStatus::FileError:
+            PyErr_SetString(PyExc_OSError, "could not open, create or map a file");
+            throw nb::python_error();
+        case MPCC::MatrixProfileStatus::UnsupportedFileFormat:
+            throw nb::value_error("file is not a 1-dimensional float64/float32 series in the given format");
+        case MPCC::MatrixProfileStatus::TileOutOfRange:
+            throw nb::value_error("tile ranges must be (begin, end) pairs within the n - m + 1 subsequences");
+        case MPCC::MatrixProfileStatus::BatchOffsetsInvalid:
+            throw nb::value_error("offsets must be non-decreasing positions within values");
+        case MPCC::MatrixProfileStatus::EncodedProfileInvalid:
+            throw nb::value_error("data is not an encoded matrix profile (bad magic, version, encoding or length)");
+        case MPCC::MatrixProfileStatus::IndexNotEncodable:
+            throw nb::value_error("mpi has consecutive indices more than 2^31 - 1 apart");
+        case MPCC::MatrixProfileStatus::DeviceError:
+            throw std::runtime_error("CUDA backend failed (no device, out of device memory, or too many "
+                                     "subsequences)");
+        default:
+            throw nb::value_error("matrix profile failed");
+    }
+}
+
+// Run fn(mp, mpi) without the GIL. With out=(distances, indices) the results are written into those arrays,
+// which are returned; otherwise profile_len-long outputs are allocated and handed to Python.
+template <class T, class Fn>
+static nb::object runMatrixProfile(size_t profile_len, nb::handle out, Fn fn) {
+    if (!out.is_none()) {
+        if (!nb::isinstance<nb::tuple>(out) || nb::len(out) != 2) {
+            throw nb::type_error("out must be a (distances, indices) tuple");
+        }
+        auto mp_array  = outputArray<T>(out[0], "out[0]");
+        auto mpi_array = outputArray<int64_t>(out[1], "out[1]");
+        auto mp_  = adaptStrided(mp_array.data(),  mp_array.shape(0),  mp_array.stride(0));
+        auto mpi_ = adaptStrided(mpi_array.data(), mpi_array.shape(0), mpi_array.stride(0));
+
+        MPCC::MatrixProfileStatus status;
+        {
+            nb::gil_scoped_release release;
+            status = fn(mp_, mpi_);
+        }
+        if (status != MPCC::MatrixProfileStatus::Success) throwMatrixProfileError(status);
+        return nb::borrow(out);
+    }
+
+    T*       mp_data  = new T[profile_len];
+    int64_t* mpi_data = new int64_t[profile_len];
+
+    auto mp_  = xt::adapt(mp_data,  profile_len, xt::no_ownership(), std::vector<size_t>{profile_len});
+    auto mpi_ = xt::adapt(mpi_data, profile_len, xt::no_ownership(), std::vector<size_t>{profile_len});
+
+    MPCC::MatrixProfileStatus status;
+    {
+        nb::gil_scoped_release release;
+        status = fn(mp_, mpi_);
+    }
+
+    if (status != MPCC::MatrixProfileStatus::Success) {
+        delete[] mp_data;
+        delete[] mpi_data;
+        throwMatrixProfileError(status);
+    }
+
+    size_t shape[1] = {profile_len};
+
+    auto mp_out = OutputArrayT<T>(
+        mp_data, 1, shape,
+        nb::capsule(mp_data,  [](void* p) noexcept { delete[] static_cast<T*      >(p); })
+    );
+    auto mpi_out = OutputArrayInt64(
+        mpi_data, 1, shape,
+        nb::capsule(mpi_data, [](void* p) noexcept { delete[] static_cast<int64_t*>(p); })
+    );
+
+    return nb::make_tuple(mp_out, mpi_out);
+}
+
+// runMatrixProfile for the engines that also produce left and right profiles: fn(mp, mpi, left_mp, left_mpi,
+// right_mp, right_mpi) runs without the GIL, and out, if given, is the six-tuple of those arrays in that order.
+template <class T, class Fn>
+static nb::object runLeftRightProfile(size_t profile_len, nb::handle out, Fn fn) {
+    if (!out.is_none()) {
+        if (!nb::isinstance<nb::tuple>(out) || nb::len(out) != 6) {
+            throw nb::type_error("out must be a (distances, indices, left_distances, left_indices, "
+                                 "right_distances, right_indices) tuple");
+        }
+        auto mp_array   = outputArray<T>(out[0], "out[0]");
+        auto mpi_array  = outputArray<int64_t>(out[1], "out[1]");
+        auto lmp_array  = outputArray<T>(out[2], "out[2]");
+        auto lmpi_array = outputArray<int64_t>(out[3], "out[3]");
+        auto rmp_array  = outputArray<T>(out[4], "out[4]");
+        auto rmpi_array = outputArray<int64_t>(out[5], "out[5]");
+        auto mp_   = adaptStrided(mp_array.data(),   mp_array.shape(0),   mp_array.stride(0));
+        auto mpi_  = adaptStrided(mpi_array.data(),  mpi_array.shape(0),  mpi_array.stride(0));
+        auto lmp_  = adaptStrided(lmp_array.data(),  lmp_array.shape(0),  lmp_array.stride(0));
+        auto lmpi_ = adaptStrided(lmpi_array.data(), lmpi_array.shape(0), lmpi_array.stride(0));
+        auto rmp_  = adaptStrided(rmp_array.data(),  rmp_array.shape(0),  rmp_array.stride(0));
+        auto rmpi_ = adaptStrided(rmpi_array.data(), rmpi_array.shape(0), rmpi_array.stride(0));
+
+        MPCC::MatrixProfileStatus status;
+        {
+            nb::gil_scoped_release release;
+            status = fn(mp_, mpi_, lmp_, lmpi_, rmp_, rmpi_);
+        }
+        if (status != MPCC::MatrixProfileStatus::Success) throwMatrixProfileError(status);
+        return nb::borrow(out);
+    }
+
+    // Overall, left and right profiles, allocated here and handed to Python.
+    T*       mp_data[3];
+    int64_t* mpi_data[3];
+    for (size_t p = 0; p < 3; p++) {
+        mp_data[p]  = new T[profile_len];
+        mpi_data[p] = new int64_t[profile_len];
+    }
+
+    const auto adapt = [profile_len](auto* data) {
+        return xt::adapt(data, profile_len, xt::no_ownership(), std::vector<size_t>{profile_len});
+    };
+    auto mp_   = adapt(mp_data[0]);
+    auto mpi_  = adapt(mpi_data[0]);
+    auto lmp_  = adapt(mp_data[1]);
+    auto lmpi_ = adapt(mpi_data[1]);
+    auto rmp_  = adapt(mp_data[2]);
+    auto rmpi_ = adapt(mpi_data[2]);
+
+    MPCC::MatrixProfileStatus status;
+    {
+        nb::gil_scoped_release release;
+        status = fn(mp_, mpi_, lmp_, lmpi_, rmp_, rmpi_);
+    }
+
+    if (status != MPCC::MatrixProfileStatus::Success) {
+        for (size_t p = 0; p < 3; p++) {
+            delete[] mp_data[p];
+            delete[] mpi_data[p];
+        }
+        throwMatrixProfileError(status);
+    }
+
+    size_t shape[1] = {profile_len};
+
+    nb::object arrays[6];
+    for (size_t p = 0; p < 3; p++) {
+        arrays[2 * p] = nb::cast(OutputArrayT<T>(
+            mp_data[p], 1, shape,
+            nb::capsule(mp_data[p],  [](void* ptr) noexcept { delete[] static_cast<T*      >(ptr); })
+        ));
+        arrays[2 * p + 1] = nb::cast(OutputArrayInt64(
+            mpi_data[p], 1, shape,
+            nb::capsule(mpi_data[p], [](void* ptr) noexcept { delete[] static_cast<int64_t*>(ptr); })
+        ));
+    }
+
+    return nb::make_tuple(arrays[0], arrays[1], arrays[2], arrays[3], arrays[4], arrays[5]);
+}
 
-        // Adapt the input numpy arrays to xtensor views (zero-copy).
-        auto seq = xt::adapt(sequence.data(), n, xt::no_ownership(), std::vector<size_t>{n});
-        auto qry = xt::adapt(query.data(),    m, xt::no_ownership(), std::vector<size_t>{m});
+// Run the given self-join matrix profile engine over the sequence.
+template <class T, class Engine>
+static nb::object computeMatrixProfile(InputArrayT<T> sequence, size_t m, nb::handle out, Engine engine) {
+    const size_t n = sequence.shape(0);
 
-        // Allocate the output array and adapt it to an xtensor view.
-        const size_t out_size  = n - m + 1;
-        double*      dist_data = new double[out_size];
-        auto dist = xt::adapt(dist_data, out_size, xt::no_ownership(), std::vector<size_t>{out_size});
+    if (m == 0) throw nb::value_error("m must be greater than 0");
+    if (m > n)  throw nb::value_error("m must not be larger than sequence length");
 
-        const auto status = MPCC::similaritySearch(seq, qry, dist);
+    const auto seq_in = stridedInput(sequence);
+    auto seq = seq_in.adapt();
+
+    return runMatrixProfile<T>(n - m + 1, out, [&](auto& mp, auto& mpi) { return engine(seq, m, mp, mpi); });
+}
+
+// Run the given self-join engine with its left and right profiles over the sequence.
+template <class T, class Engine>
+static nb::object computeLeftRightProfile(InputArrayT<T> sequence, size_t m, nb::handle out, Engine engine) {
+    const size_t n = sequence.shape(0);
+
+    if (m == 0) throw nb::value_error("m must be greater than 0");
+    if (m > n)  throw nb::value_error("m must not be larger than sequence length");
+
+    const auto seq_in = stridedInput(sequence);
+    auto seq = seq_in.adapt();
+
+    return runLeftRightProfile<T>(n - m + 1, out, [&](auto&... outputs) { return engine(seq, m, outputs...); });
+}
+
+// matrix_profile_batch over the ragged buffer seq (an adaptor over values) holding the series at offsets:
+// the profiles of every series in one (distances, indices) pair of arrays, plus the int64 offsets of each
+// profile in them. The offsets are checked here, before the outputs are sized from them.
+template <class T, class Seq>
+static nb::object runBatch(const Seq& seq, const std::vector<size_t>& offsets, size_t m, size_t num_threads) {
+    if (m == 0) throw nb::value_error("m must be greater than 0");
+    if (offsets.empty() || offsets.back() > seq.size()) {
+        throwMatrixProfileError(MPCC::MatrixProfileStatus::BatchOffsetsInvalid);
+    }
+    for (size_t s = 0; s + 1 < offsets.size(); s++) {
+        if (offsets[s + 1] < offsets[s]) throwMatrixProfileError(MPCC::MatrixProfileStatus::BatchOffsetsInvalid);
+        if (offsets[s + 1] - offsets[s] < m) {
+            throw nb::value_error(("series " + std::to_string(s) + " is shorter than m").c_str());
+        }
+    }
+
+    const std::vector<size_t> profile_offsets = MPCC::batchProfileOffsets(offsets, m);
+    const size_t total = profile_offsets.back();
+
+    T*       mp_data  = new T[total];
+    int64_t* mpi_data = new int64_t[total];
+    auto mp_  = xt::adapt(mp_data,  total, xt::no_ownership(), std::vector<size_t>{total});
+    auto mpi_ = xt::adapt(mpi_data, total, xt::no_ownership(), std::vector<size_t>{total});
+
+    MPCC::MatrixProfileStatus status;
+    {
+        nb::gil_scoped_release release;
+        status = MPCC::matrixProfileBatch(seq, std::span<const size_t>(offsets), m, mp_, mpi_, num_threads);
+    }
+    if (status != MPCC::MatrixProfileStatus::Success) {
+        delete[] mp_data;
+        delete[] mpi_data;
+        throwMatrixProfileError(status);
+    }
+
+    int64_t* offsets_data = new int64_t[profile_offsets.size()];
+    for (size_t s = 0; s < profile_offsets.size(); s++) offsets_data[s] = static_cast<int64_t>(profile_offsets[s]);
+
+    size_t shape[1]         = {total};
+    size_t offsets_shape[1] = {profile_offsets.size()};
+    auto mp_out = OutputArrayT<T>(
+        mp_data, 1, shape,
+        nb::capsule(mp_data,      [](void* p) noexcept { delete[] static_cast<T*      >(p); })
+    );
+    auto mpi_out = OutputArrayInt64(
+        mpi_data, 1, shape,
+        nb::capsule(mpi_data,     [](void* p) noexcept { delete[] static_cast<int64_t*>(p); })
+    );
+    auto offsets_out = OutputArrayInt64(
+        offsets_data, 1, offsets_shape,
+        nb::capsule(offsets_data, [](void* p) noexcept { delete[] static_cast<int64_t*>(p); })
+    );
+    return nb::make_tuple(mp_out, mpi_out, offsets_out);
+}
+
+// Whether device selects the CUDA backend. "cuda" is only accepted by builds that link //core:cuda.
+static bool onCuda(const std::string& device) {
+    if (device == "cpu") return false;
+    if (device != "cuda") throw nb::value_error("device must be 'cpu' or 'cuda'");
+#ifndef MPCC_WITH_CUDA
+    throw std::runtime_error("mpcc was built without CUDA support; rebuild with --@rules_cuda//cuda:enable=True");
+#endif
+    return true;
+}
+
+// A self-join matrix profile on the CUDA diagonal backend, which matches every CPU self-join engine up to
+// the float32 rounding of its neighbor selection (see matrixProfileDiagonalCuda).
+template <class T>
+static nb::object computeOnCuda(InputArrayT<T> sequence, size_t m, const MPCC::BasicSequenceStats<T>* stats,
+                                nb::handle out, bool left_right, MPCC::ProfileStats* timings,
+                                MPCC::FixedExclusion exclusion) {
+    if (left_right || timings) throw nb::value_error("left_right and timings are not supported with device='cuda'");
+#ifdef MPCC_WITH_CUDA
+    return computeMatrixProfile<T>(sequence, m, out, [stats, exclusion](auto& seq, size_t m, auto& mp, auto& mpi) {
+        return stats ? MPCC::matrixProfileDiagonalCuda(seq, m, *stats, mp, mpi, 0, exclusion)
+                     : MPCC::matrixProfileDiagonalCuda(seq, m, mp, mpi, 0, exclusion);
+    });
+#else
+    (void)sequence, (void)m, (void)stats, (void)out, (void)exclusion;
+    throw std::runtime_error("mpcc was built without CUDA support");
+#endif
+}
+
+// The exclusion policy of a self-join for its exclusion_zone argument, floor(m/4) when None.
+static MPCC::FixedExclusion selfJoinExclusion(std::optional<size_t> exclusion_zone, size_t m) {
+    return MPCC::FixedExclusion{exclusion_zone.value_or(m / 4)};
+}
+
+// The Workspace behind mpcc.Workspace. Its calls run on the process-wide pool, and since they release the GIL,
+// calls from different Python threads sharing one take turns on its lock.
+struct PyWorkspace {
+    PyWorkspace() : workspace(MPCC::ThreadPool::shared()) {}
+
+    MPCC::Workspace workspace;
+    std::mutex      lock;
+};
+
+// The core workspace of a workspace= argument for the duration of one call: nullptr for None, otherwise the
+// workspace, held exclusively until the lease goes out of scope.
+struct WorkspaceLease {
+    explicit WorkspaceLease(PyWorkspace* workspace)
+        : lock(workspace ? std::unique_lock<std::mutex>(workspace->lock) : std::unique_lock<std::mutex>()),
+          get(workspace ? &workspace->workspace : nullptr) {}
+
+    std::unique_lock<std::mutex> lock;
+    MPCC::Workspace*             get;
+};
+
+// Call fn(instr) with MPCC::Instrumented recording into timings, or with the no-op policy when timings is
+// None, so uninstrumented calls run exactly the code they would without the option.
+template <class Fn>
+static auto withInstrumentation(MPCC::ProfileStats* timings, Fn&& fn) {
+    return timings ? fn(MPCC::Instrumented(*timings)) : fn(MPCC::NoInstrumentation{});
+}
+
+// merge_profiles for distances of type T: mp and mpi are written in place, so they are never converted, while
+// the partial profile may be anything convertible to T and int64.
+template <class T>
+static void mergeProfilesInto(nb::handle mp, nb::handle mpi, nb::handle partial_mp, nb::handle partial_mpi,
+                              size_t offset) {
+    auto mp_array  = outputArray<T>(mp, "mp");
+    auto mpi_array = outputArray<int64_t>(mpi, "mpi");
+    auto mp_  = adaptStrided(mp_array.data(),  mp_array.shape(0),  mp_array.stride(0));
+    auto mpi_ = adaptStrided(mpi_array.data(), mpi_array.shape(0), mpi_array.stride(0));
+
+    InputArrayT<T>       pmp_array;
+    InputArrayT<int64_t> pmpi_array;
+    if (!nb::try_cast(partial_mp, pmp_array)) {
+        throw nb::type_error((std::string("partial_mp must be a 1-D ") + dtypeName<T>() + " array").c_str());
+    }
+    if (!nb::try_cast(partial_mpi, pmpi_array)) throw nb::type_error("partial_mpi must be a 1-D int64 array");
+    const auto pmp_in  = stridedInput(pmp_array);
+    const auto pmpi_in = stridedInput(pmpi_array);
+    auto pmp  = pmp_in.adapt();
+    auto pmpi = pmpi_in.adapt();
+
+    MPCC::MatrixProfileStatus status;
+    {
+        nb::gil_scoped_release release;
+        status = MPCC::mergeProfiles(mp_, mpi_, pmp, pmpi, offset);
+    }
+    if (status != MPCC::MatrixProfileStatus::Success) throwMatrixProfileError(status);
+}
+
+// find_motifs / find_discords for distances of type T, as a list of ProfileMatch.
+template <class T, class Find>
+static nb::list findMatches(const InputArrayT<T>& mp_array, const InputArrayT<int64_t>& mpi_array, size_t k,
+                            size_t exclusion, Find find) {
+    const auto mp_in  = stridedInput(mp_array);
+    const auto mpi_in = stridedInput(mpi_array);
+    auto mp  = mp_in.adapt();
+    auto mpi = mpi_in.adapt();
+
+    std::vector<MPCC::ProfileMatch> matches;
+    MPCC::MatrixProfileStatus status;
+    {
+        nb::gil_scoped_release release;
+        status = find(mp, mpi, k, exclusion, matches);
+    }
+    if (status != MPCC::MatrixProfileStatus::Success) throwMatrixProfileError(status);
+
+    nb::list result;
+    for (const auto& match : matches) result.append(nb::cast(match));
+    return result;
+}
+
+// The module-level find_motifs and find_discords: float32 profiles are read as they are, anything else as
+// float64.
+template <class Find>
+static void bindFindMatches(nb::module_& m, const char* name, const char* docstring, Find find) {
+    m.def(name, [find](nb::handle mp, InputArrayT<int64_t> mpi, size_t k, size_t exclusion) {
+        InputArrayT<float> as_float32;
+        if (nb::try_cast(mp, as_float32, /*convert=*/false)) {
+            return findMatches<float>(as_float32, mpi, k, exclusion, find);
+        }
+        InputArrayT<double> as_float64;
+        if (!nb::try_cast(mp, as_float64)) throw nb::type_error("mp must be a 1-D float64 or float32 array");
+        return findMatches<double>(as_float64, mpi, k, exclusion, find);
+    }, nb::arg("mp"), nb::arg("mpi"), nb::arg("k"), nb::arg("exclusion"), docstring);
+}
+
+// encode_profile for distances of type T.
+template <class T>
+static nb::bytes encodeProfileBytes(const InputArrayT<T>& mp_array, const InputArrayT<int64_t>& mpi_array, size_t m,
+                                    MPCC::ProfileEncoding encoding) {
+    const auto mp_in  = stridedInput(mp_array);
+    const auto mpi_in = stridedInput(mpi_array);
+    auto mp  = mp_in.adapt();
+    auto mpi = mpi_in.adapt();
+
+    std::vector<uint8_t> bytes;
+    MPCC::MatrixProfileStatus status;
+    {
+        nb::gil_scoped_release release;
+        status = MPCC::encodeProfile(mp, mpi, m, encoding, bytes);
+    }
+    if (status == MPCC::MatrixProfileStatus::DistanceWrongSize) throw nb::value_error("mp and mpi differ in length");
+    if (status != MPCC::MatrixProfileStatus::Success) throwMatrixProfileError(status);
+    return nb::bytes(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+}
+
+// Docstring for a binding: the float32 overloads carry a short note rather than repeating the float64 text.
+template <class T>
+static const char* doc(const char* float64_doc, const char* float32_doc) {
+    return std::is_same_v<T, float> ? float32_doc : float64_doc;
+}
+
+// StreamingMatrixProfile.append over an array of either precision and any stride. The stream keeps double
+// samples, so contiguous float64 input goes in as one span and anything else is converted sample by sample.
+// The GIL stays held: the stream is a Python object that other threads may append to or hold views of.
+template <class T>
+static void appendSamples(MPCC::StreamingMatrixProfile& self, const InputArrayT<T>& values) {
+    const T*             data   = values.data();
+    const size_t         n      = values.shape(0);
+    const std::ptrdiff_t stride = values.stride(0);
+
+    if constexpr (std::is_same_v<T, double>) {
+        if (stride == 1) return self.append(std::span<const double>(data, n));
+    }
+    for (size_t i = 0; i < n; i++) self.append(static_cast<double>(data[static_cast<std::ptrdiff_t>(i) * stride]));
+}
+
+// Bind SequenceStats and every search and matrix profile function for inputs of type T.
+template <class T>
+static void bindPrecision(nb::module_& m, const char* stats_name) {
+    using Stats = MPCC::BasicSequenceStats<T>;
+
+    nb::class_<Stats>(m, stats_name,
+        doc<T>("Per-window mean and standard deviation of a sequence, precomputed for one or more subsequence "
+               "lengths. Pass it as stats= to the searches and matrix profile functions to skip recomputing "
+               "them on every call against the same sequence.",
+               "SequenceStats for float32 sequences, stored in single precision. Pass it as stats= to the "
+               "float32 searches and matrix profile functions."))
+        .def("__init__", [](Stats* self, InputArrayT<T> sequence, std::vector<size_t> lengths) {
+            const size_t n = sequence.shape(0);
+            for (const size_t len : lengths) {
+                if (len == 0) throw nb::value_error("subsequence lengths must be greater than 0");
+                if (len > n)  throw nb::value_error("subsequence lengths must not be larger than sequence length");
+            }
+            const auto seq_in = stridedInput(sequence);
+            auto seq = seq_in.adapt();
+            nb::gil_scoped_release release;
+            new (self) Stats(seq, std::span<const size_t>(lengths));
+        }, nb::arg("sequence"), nb::arg("lengths"))
+        .def("__init__", [](Stats* self, InputArrayT<T> sequence, size_t m) {
+            const size_t n = sequence.shape(0);
+            if (m == 0) throw nb::value_error("m must be greater than 0");
+            if (m > n)  throw nb::value_error("m must not be larger than sequence length");
+            const auto seq_in = stridedInput(sequence);
+            auto seq = seq_in.adapt();
+            nb::gil_scoped_release release;
+            new (self) Stats(seq, m);
+        }, nb::arg("sequence"), nb::arg("m"))
+        .def_prop_ro("sequence_length", &Stats::sequenceLength)
+        .def_prop_ro("lengths",         &Stats::lengths,
+            "Precomputed subsequence lengths, in ascending order.")
+        .def("__contains__", &Stats::contains, nb::arg("m"))
+        .def("mean", [](const Stats& self, size_t m) {
+            if (!self.contains(m)) throw nb::value_error("no statistics for this subsequence length");
+            return viewOf(self.mean(m));
+        }, nb::arg("m"), nb::rv_policy::reference_internal,
+           "Read-only view of the mean of every length-m window.")
+        .def("stddev", [](const Stats& self, size_t m) {
+            if (!self.contains(m)) throw nb::value_error("no statistics for this subsequence length");
+            return viewOf(self.stddev(m));
+        }, nb::arg("m"), nb::rv_policy::reference_internal,
+           "Read-only view of the standard deviation of every length-m window.");
+
+    m.def("similarity_search",
+          [](InputArrayT<T> sequence, InputArrayT<T> query, const Stats* stats, nb::handle out) -> nb::object {
+        return computeSimilaritySearch<T>(sequence, query, out, [stats](auto& seq, auto& qry, auto& dist) {
+            return stats ? MPCC::similaritySearch(seq, qry, *stats, dist)
+                         : MPCC::similaritySearch(seq, qry, dist);
+        });
+    }, nb::arg("sequence"), nb::arg("query"), nb::arg("stats").none() = nb::none(), nb::arg("out").none() = nb::none(),
+       doc<T>("Compute the z-normalized distance profile of query over sequence. Pass "
+              "stats=SequenceStats(sequence, len(query)) to reuse the window statistics across calls, and "
+              "out= a preallocated float64 array of length len(sequence) - len(query) + 1 to write the result "
+              "into it (and return it) instead of allocating. Inputs and out may be strided; the GIL is "
+              "released while searching.",
+              "float32 overload: searches in single precision and returns float32 distances. stats must "
+              "be a SequenceStatsFloat32."));
+
+    m.def("similarity_search_mass",
+          [](InputArrayT<T> sequence, InputArrayT<T> query, const Stats* stats, nb::handle out) -> nb::object {
+        return computeSimilaritySearch<T>(sequence, query, out, [stats](auto& seq, auto& qry, auto& dist) {
+            return stats ? MPCC::similaritySearchMass(seq, qry, *stats, dist)
+                         : MPCC::similaritySearchMass(seq, qry, dist);
+        });
+    }, nb::arg("sequence"), nb::arg("query"), nb::arg("stats").none() = nb::none(), nb::arg("out").none() = nb::none(),
+       doc<T>("Compute the z-normalized distance profile of query over sequence using MASS, which gets all "
+              "sliding dot products from one FFT convolution (O(n log n)).",
+              "float32 overload: the FFT convolution runs in double, the distances are computed and "
+              "returned as float32."));
+
+    m.def("similarity_search_auto",
+          [](InputArrayT<T> sequence, InputArrayT<T> query, const Stats* stats, nb::handle out) -> nb::object {
+        return computeSimilaritySearch<T>(sequence, query, out, [stats](auto& seq, auto& qry, auto& dist) {
+            return stats ? MPCC::similaritySearchAuto(seq, qry, *stats, dist)
+                         : MPCC::similaritySearchAuto(seq, qry, dist);
+        });
+    }, nb::arg("sequence"), nb::arg("query"), nb::arg("stats").none() = nb::none(), nb::arg("out").none() = nb::none(),
+       doc<T>("Compute the z-normalized distance profile of query over sequence, choosing between the direct "
+              "and FFT-based (MASS) searches based on the sequence and query lengths.",
+              "float32 overload: searches in single precision and returns float32 distances."));
+
+    m.def("similarity_search_batch",
+          [](InputArrayT<T> sequence, InputMatrixT<T> queries, const Stats* stats, size_t num_threads,
+             nb::handle out) -> nb::object {
+        const size_t n = sequence.shape(0);
+        const size_t k = queries.shape(0);
+        const size_t w = queries.shape(1);
+        if (w > n) throw nb::value_error("queries must not be longer than sequence");
 
+        const auto seq_in = stridedInput(sequence);
+        auto seq = seq_in.adapt();
+
+        // Queries are small next to the sequence, so any layout but C order is copied into it.
+        const bool c_order = (k <= 1 || queries.stride(0) == static_cast<int64_t>(w))
+                          && (w <= 1 || queries.stride(1) == 1);
+        std::vector<T> query_copy;
+        const T* query_data = queries.data();
+        if (!c_order) {
+            query_copy.resize(k * w);
+            for (size_t j = 0; j < k; j++) {
+                for (size_t t = 0; t < w; t++) query_copy[j * w + t] = queries(j, t);
+            }
+            query_data = query_copy.data();
+        }
+        auto qrys = xt::adapt(query_data, k * w, xt::no_ownership(), std::vector<size_t>{k, w});
+
+        auto search = [&](auto& dist) {
+            nb::gil_scoped_release release;
+            return stats ? MPCC::similaritySearchBatch(seq, qrys, *stats, dist, num_threads)
+                         : MPCC::similaritySearchBatch(seq, qrys, dist, num_threads);
+        };
+
+        const size_t profile_len = n - w + 1;
+        if (!out.is_none()) {
+            auto out_array = outputArray<T, 2>(out, "out");
+            auto dist = adaptStrided2D(out_array);
+            const auto status = search(dist);
+            if (status != MPCC::SimilaritySearchStatus::Success) throwSimilaritySearchError(status);
+            return nb::borrow(out);
+        }
+
+        T*   dist_data = new T[k * profile_len];
+        auto dist = xt::adapt(dist_data, k * profile_len, xt::no_ownership(), std::vector<size_t>{k, profile_len});
+        const auto status = search(dist);
         if (status != MPCC::SimilaritySearchStatus::Success) {
             delete[] dist_data;
-            switch (status) {
-                case MPCC::SimilaritySearchStatus::SequenceNotOneDimensional:
-                    throw nb::value_error("sequence must be 1-dimensional");
-                case MPCC::SimilaritySearchStatus::QueryNotOneDimensional:
-                    throw nb::value_error("query must be 1-dimensional");
-                case MPCC::SimilaritySearchStatus::DistanceNotOneDimensional:
-                    throw nb::value_error("distance must be 1-dimensional");
-                case MPCC::SimilaritySearchStatus::QueryLongerThanSequence:
-                    throw nb::value_error("query must not be longer than sequence");
-                case MPCC::SimilaritySearchStatus::DistanceWrongSize:
-                    throw nb::value_error("distance has wrong size");
-                default:
-                    throw nb::value_error("similarity search failed");
-            }
+            throwSimilaritySearchError(status);
         }
 
-        // Transfer ownership of dist_data to Python via a capsule.
-        size_t shape[1] = {out_size};
-        return OutputArray(
-            dist_data,
-            1,
-            shape,
-            nb::capsule(dist_data, [](void* p) noexcept { delete[] static_cast<double*>(p); })
-        );
-    }, nb::arg("sequence"), nb::arg("query"),
-       "Compute the z-normalized distance profile of query over sequence.");
+        size_t shape[2] = {k, profile_len};
+        return nb::cast(OutputArrayT<T, 2>(
+            dist_data, 2, shape,
+            nb::capsule(dist_data, [](void* p) noexcept { delete[] static_cast<T*>(p); })
+        ));
+    }, nb::arg("sequence"), nb::arg("queries"), nb::arg("stats").none() = nb::none(), nb::arg("num_threads") = 1,
+       nb::arg("out").none() = nb::none(),
+       doc<T>("Search every row of queries (k x m) over sequence at once. Returns a k x (n - m + 1) array "
+              "whose row j equals similarity_search(sequence, queries[j]), bit for bit, computed with shared "
+              "window statistics and cache-blocked dot products. out= takes a preallocated k x (n - m + 1) "
+              "float64 array; num_threads=0 uses one thread per hardware thread.",
+              "float32 overload: searches in single precision and returns float32 distances."));
 
-    m.def("matrix_profile_naive", [](InputArray sequence, size_t m) -> nb::tuple {
+    m.def("similarity_search_top_k",
+          [](InputArrayT<T> sequence, InputArrayT<T> query, size_t k, std::optional<size_t> exclusion,
+             const Stats* stats) {
         const size_t n = sequence.shape(0);
+        const size_t w = query.shape(0);
+        if (w > n) throw nb::value_error("query must not be longer than sequence");
+
+        const auto seq_in = stridedInput(sequence);
+        const auto qry_in = stridedInput(query);
+        auto seq = seq_in.adapt();
+        auto qry = qry_in.adapt();
+        const size_t zone = exclusion.value_or(w / 4);
+
+        T*       dist_data  = new T[k];
+        int64_t* index_data = new int64_t[k];
+        auto dist  = xt::adapt(dist_data,  k, xt::no_ownership(), std::vector<size_t>{k});
+        auto index = xt::adapt(index_data, k, xt::no_ownership(), std::vector<size_t>{k});
 
+        MPCC::SimilaritySearchStatus status;
+        {
+            nb::gil_scoped_release release;
+            status = stats ? MPCC::similaritySearchTopK(seq, qry, k, zone, *stats, dist, index)
+                           : MPCC::similaritySearchTopK(seq, qry, k, zone, dist, index);
+        }
+        if (status != MPCC::SimilaritySearchStatus::Success) {
+            delete[] dist_data;
+            delete[] index_data;
+            throwSimilaritySearchError(status);
+        }
+
+        // Unfilled slots (-1) are always at the end; only the matches found are returned.
+        size_t found = 0;
+        while (found < k && index_data[found] >= 0) found++;
+
+        size_t shape[1] = {found};
+        auto dist_out = OutputArrayT<T>(
+            dist_data, 1, shape,
+            nb::capsule(dist_data,  [](void* p) noexcept { delete[] static_cast<T*      >(p); })
+        );
+        auto index_out = OutputArrayInt64(
+            index_data, 1, shape,
+            nb::capsule(index_data, [](void* p) noexcept { delete[] static_cast<int64_t*>(p); })
+        );
+        return nb::make_tuple(dist_out, index_out);
+    }, nb::arg("sequence"), nb::arg("query"), nb::arg("k"), nb::arg("exclusion").none() = nb::none(),
+       nb::arg("stats").none() = nb::none(),
+       doc<T>("Find the k windows of sequence nearest to query without building the full distance profile. "
+              "Returns (distances, indices) in ascending order of distance, chosen greedily so that any two "
+              "matches are more than exclusion windows apart (default floor(len(query)/4), as in the matrix "
+              "profiles); fewer than k are returned if the sequence runs out of such windows. The distances "
+              "equal those of similarity_search. Windows are abandoned early once they cannot make the list.",
+              "float32 overload: searches in single precision and returns float32 distances."));
+
+    m.def("matrix_profile_naive",
+          [](InputArrayT<T> sequence, size_t m, size_t num_threads, const Stats* stats,
+             nb::handle out, const std::string& device, std::optional<size_t> exclusion_zone,
+             PyWorkspace* workspace) -> nb::object {
+        const MPCC::FixedExclusion exclusion = selfJoinExclusion(exclusion_zone, m);
+        if (onCuda(device)) return computeOnCuda<T>(sequence, m, stats, out, false, nullptr, exclusion);
+        const auto engine = [num_threads, stats, exclusion, workspace](auto& seq, size_t m, auto& mp, auto& mpi) {
+            const WorkspaceLease ws(workspace);
+            return stats ? MPCC::matrixProfileNaive(seq, m, *stats, mp, mpi, num_threads, {}, exclusion, ws.get)
+                         : MPCC::matrixProfileNaive(seq, m, mp, mpi, num_threads, {}, exclusion, ws.get);
+        };
+        return computeMatrixProfile<T>(sequence, m, out, engine);
+    }, nb::arg("sequence"), nb::arg("m"), nb::arg("num_threads") = 1, nb::arg("stats").none() = nb::none(),
+       nb::arg("out").none() = nb::none(), nb::arg("device") = "cpu",
+       nb::arg("exclusion_zone").none() = nb::none(), nb::arg("workspace").none() = nb::none(),
+       doc<T>("Compute the full matrix profile naively (O(n^2)). "
+              "Returns (distances, indices) where distances[i] is the z-normalized distance from "
+              "subsequence i to its nearest non-trivial neighbor and indices[i] is that neighbor's "
+              "starting position. Neighbors within exclusion_zone of i (default floor(m/4)) are trivial "
+              "matches and never chosen; pass exclusion_zone=math.ceil(m/4) for stumpy's zone. "
+              "num_threads=0 uses one thread per hardware thread. Pass out=(distances, indices), "
+              "preallocated float64 and int64 arrays of length n - m + 1, to write the result into them "
+              "instead of allocating; the same applies to every matrix profile function. device='cuda' "
+              "computes the profile on the GPU with the CUDA diagonal backend (in builds with CUDA support, "
+              "see cuda_available()), choosing neighbors by float32-rounded distance: distances agree with "
+              "the CPU to float32 rounding, and near-tied neighbors may get a different index; the same "
+              "holds for matrix_profile_stomp and matrix_profile_diagonal. Pass "
+              "workspace=Workspace() to reuse its scratch memory across calls, here and in "
+              "matrix_profile_stomp, matrix_profile_diagonal and matrix_profile_ab_join.",
+              "float32 overload: computed in single precision; returns float32 distances and int64 "
+              "indices."));
+
+    m.def("matrix_profile_stomp",
+          [](InputArrayT<T> sequence, size_t m, size_t num_threads, const Stats* stats,
+             nb::handle out, bool left_right, MPCC::ProfileStats* timings,
+             const std::string& device, std::optional<size_t> exclusion_zone,
+             PyWorkspace* workspace) -> nb::object {
+        const MPCC::FixedExclusion exclusion = selfJoinExclusion(exclusion_zone, m);
+        if (onCuda(device)) return computeOnCuda<T>(sequence, m, stats, out, left_right, timings, exclusion);
+        const auto engine = [num_threads, stats, timings, exclusion, workspace](auto& seq, size_t m, auto&... outputs) {
+            const WorkspaceLease ws(workspace);
+            return withInstrumentation(timings, [&](auto instr) {
+                return stats ? MPCC::matrixProfileStomp(seq, m, *stats, outputs..., num_threads, {}, instr, exclusion,
+                                                        ws.get)
+                             : MPCC::matrixProfileStomp(seq, m, outputs..., num_threads, {}, instr, exclusion, ws.get);
+            });
+        };
+        return left_right ? computeLeftRightProfile<T>(sequence, m, out, engine)
+                          : computeMatrixProfile<T>(sequence, m, out, engine);
+    }, nb::arg("sequence"), nb::arg("m"), nb::arg("num_threads") = 1, nb::arg("stats").none() = nb::none(),
+       nb::arg("out").none() = nb::none(), nb::arg("left_right") = false,
+       nb::arg("timings").none() = nb::none(), nb::arg("device") = "cpu",
+       nb::arg("exclusion_zone").none() = nb::none(), nb::arg("workspace").none() = nb::none(),
+       doc<T>("Compute the full matrix profile with STOMP (O(n^2)), reusing each row's sliding dot "
+              "products to derive the next. Returns (distances, indices) with the same semantics as "
+              "matrix_profile_naive. With left_right=True it returns (distances, indices, left_distances, "
+              "left_indices, right_distances, right_indices), adding each subsequence's nearest neighbor "
+              "before and after its exclusion zone (-1 where there is none) at no extra cost; out is then "
+              "the six-tuple of those arrays. Pass timings=ProfileStats() to have the run's per-phase "
+              "times, row counts and per-thread work recorded into it.",
+              "float32 overload: computed in single precision; returns float32 distances and int64 "
+              "indices."));
+
+    m.def("matrix_profile_diagonal",
+          [](InputArrayT<T> sequence, size_t m, size_t num_threads, const Stats* stats,
+             nb::handle out, bool left_right, MPCC::ProfileStats* timings,
+             const std::string& device, std::optional<size_t> exclusion_zone,
+             PyWorkspace* workspace) -> nb::object {
+        const MPCC::FixedExclusion exclusion = selfJoinExclusion(exclusion_zone, m);
+        if (onCuda(device)) return computeOnCuda<T>(sequence, m, stats, out, left_right, timings, exclusion);
+        const auto engine = [num_threads, stats, timings, exclusion, workspace](auto& seq, size_t m, auto&... outputs) {
+            const WorkspaceLease ws(workspace);
+            return withInstrumentation(timings, [&](auto instr) {
+                return stats
+                    ? MPCC::matrixProfileDiagonal(seq, m, *stats, outputs..., num_threads, {}, instr, exclusion, ws.get)
+                    : MPCC::matrixProfileDiagonal(seq, m, outputs..., num_threads, {}, instr, exclusion, ws.get);
+            });
+        };
+        return left_right ? computeLeftRightProfile<T>(sequence, m, out, engine)
+                          : computeMatrixProfile<T>(sequence, m, out, engine);
+    }, nb::arg("sequence"), nb::arg("m"), nb::arg("num_threads") = 1, nb::arg("stats").none() = nb::none(),
+       nb::arg("out").none() = nb::none(), nb::arg("left_right") = false,
+       nb::arg("timings").none() = nb::none(), nb::arg("device") = "cpu",
+       nb::arg("exclusion_zone").none() = nb::none(), nb::arg("workspace").none() = nb::none(),
+       doc<T>("Compute the full matrix profile by sweeping diagonals of the distance matrix in parallel "
+              "(SCRIMP-style, O(n^2)). Returns (distances, indices) with the same semantics as "
+              "matrix_profile_naive; the output is bit-identical for every num_threads. left_right=True "
+              "adds the left and right profiles from the same sweep, and timings=ProfileStats() records "
+              "the run's timings, as for matrix_profile_stomp.",
+              "float32 overload: computed in single precision (the diagonal sums are carried in "
+              "double); returns float32 distances and int64 indices."));
+
+    m.def("matrix_profile_anytime",
+          [](InputArrayT<T> sequence, size_t m, double fraction, std::optional<double> time_budget, bool prescrimp,
+             uint64_t seed, size_t num_threads, nb::object callback, const Stats* stats,
+             nb::handle out) -> nb::object {
+        const size_t n = sequence.shape(0);
         if (m == 0) throw nb::value_error("m must be greater than 0");
         if (m > n)  throw nb::value_error("m must not be larger than sequence length");
 
-        auto seq = xt::adapt(sequence.data(), n, xt::no_ownership(), std::vector<size_t>{n});
+        const auto seq_in = stridedInput(sequence);
+        auto seq = seq_in.adapt();
 
+        MPCC::AnytimeOptions options;
+        options.fraction       = fraction;
+        options.time_budget_ms = time_budget ? *time_budget * 1000.0 : 0.0;
+        options.prescrimp      = prescrimp;
+        options.seed           = seed;
+
+        // The callback sees the result arrays themselves, so they exist before the computation starts.
         const size_t profile_len = n - m + 1;
+        nb::object mp_obj, mpi_obj;
+        if (!out.is_none()) {
+            if (!nb::isinstance<nb::tuple>(out) || nb::len(out) != 2) {
+                throw nb::type_error("out must be a (distances, indices) tuple");
+            }
+            mp_obj  = nb::borrow(out[0]);
+            mpi_obj = nb::borrow(out[1]);
+        } else {
+            T*       mp_data  = new T[profile_len];
+            int64_t* mpi_data = new int64_t[profile_len];
+            size_t shape[1] = {profile_len};
+            mp_obj = nb::cast(OutputArrayT<T>(
+                mp_data, 1, shape,
+                nb::capsule(mp_data,  [](void* p) noexcept { delete[] static_cast<T*      >(p); })
+            ));
+            mpi_obj = nb::cast(OutputArrayInt64(
+                mpi_data, 1, shape,
+                nb::capsule(mpi_data, [](void* p) noexcept { delete[] static_cast<int64_t*>(p); })
+            ));
+        }
+        auto mp_array  = outputArray<T>(mp_obj, "out[0]");
+        auto mpi_array = outputArray<int64_t>(mpi_obj, "out[1]");
+        auto mp_  = adaptStrided(mp_array.data(),  mp_array.shape(0),  mp_array.stride(0));
+        auto mpi_ = adaptStrided(mpi_array.data(), mpi_array.shape(0), mpi_array.stride(0));
+
+        // The core calls back on this thread with the GIL released. An exception raised by the callback
+        // stops the computation and is re-raised once it has returned.
+        std::optional<nb::python_error> callback_error;
+        MPCC::AnytimeCallback on_update;
+        if (!callback.is_none()) {
+            on_update = [&](size_t done, size_t total) {
+                nb::gil_scoped_acquire acquire;
+                try {
+                    const nb::object keep_going = callback(mp_obj, mpi_obj, done, total);
+                    return keep_going.is_none() || nb::cast<bool>(keep_going);
+                } catch (nb::python_error& e) {
+                    callback_error.emplace(std::move(e));
+                    return false;
+                }
+            };
+        }
+
+        MPCC::MatrixProfileStatus status;
+        {
+            nb::gil_scoped_release release;
+            status = stats ? MPCC::matrixProfileAnytime(seq, m, *stats, mp_, mpi_, options, num_threads, on_update)
+                           : MPCC::matrixProfileAnytime(seq, m, mp_, mpi_, options, num_threads, on_update);
+        }
+        if (callback_error) throw std::move(*callback_error);
+        if (status != MPCC::MatrixProfileStatus::Success) throwMatrixProfileError(status);
+        return out.is_none() ? nb::object(nb::make_tuple(mp_obj, mpi_obj)) : nb::borrow(out);
+    }, nb::arg("sequence"), nb::arg("m"), nb::arg("fraction") = 1.0, nb::arg("time_budget").none() = nb::none(),
+       nb::arg("prescrimp") = true, nb::arg("seed") = 0, nb::arg("num_threads") = 1,
+       nb::arg("callback").none() = nb::none(), nb::arg("stats").none() = nb::none(),
+       nb::arg("out").none() = nb::none(),
+       doc<T>("Compute an approximate matrix profile that refines the longer it runs (SCRIMP++): an optional "
+              "PreSCRIMP pass, then diagonals of the distance matrix in a random order given by seed. Stops "
+              "after fraction of the diagonals or time_budget seconds, whichever comes first. "
+              "callback(distances, indices, done, total) is called with the current approximation after "
+              "PreSCRIMP and after each round of diagonals; returning False stops early. Returns "
+              "(distances, indices) like matrix_profile_diagonal, which it equals (up to rounding) when run "
+              "to completion.",
+              "float32 overload: computed in single precision; returns float32 distances and int64 "
+              "indices."));
+
+    m.def("matrix_profile_ab_join",
+          [](InputArrayT<T> sequence_a, InputArrayT<T> sequence_b, size_t m, size_t num_threads,
+             const Stats* stats_a, const Stats* stats_b, nb::handle out,
+             std::optional<size_t> exclusion_zone, PyWorkspace* workspace,
+             MPCC::ProfileStats* timings) -> nb::object {
+        const size_t n_a = sequence_a.shape(0);
+        const size_t n_b = sequence_b.shape(0);
+
+        if (m == 0)   throw nb::value_error("m must be greater than 0");
+        if (m > n_a)  throw nb::value_error("m must not be larger than sequence length");
+        if (m > n_b)  throw nb::value_error("m must not be larger than reference sequence length");
+
+        const auto a_in = stridedInput(sequence_a);
+        const auto b_in = stridedInput(sequence_b);
+        auto seq_a = a_in.adapt();
+        auto seq_b = b_in.adapt();
+
+        // Without exclusion_zone every neighbor counts; with it, the join excludes |i - j| <= exclusion_zone as
+        // a self-join would, for sequence_b overlapping or equal to sequence_a.
+        const auto join = [&](auto& mp, auto& mpi, auto exclusion) {
+            const WorkspaceLease ws(workspace);
+            return withInstrumentation(timings, [&](auto instr) {
+                if (!stats_a && !stats_b) {
+                    return MPCC::matrixProfileABJoin(seq_a, seq_b, m, mp, mpi, num_threads, {}, instr, exclusion,
+                                                     ws.get);
+                }
+
+                // Compute whichever side was not supplied.
+                const Stats own_a = stats_a ? Stats() : Stats(seq_a, m);
+                const Stats own_b = stats_b ? Stats() : Stats(seq_b, m);
+                return MPCC::matrixProfileABJoin(seq_a, seq_b, m, stats_a ? *stats_a : own_a,
+                                                 stats_b ? *stats_b : own_b, mp, mpi, num_threads, {}, instr,
+                                                 exclusion, ws.get);
+            });
+        };
+        return runMatrixProfile<T>(n_a - m + 1, out, [&](auto& mp, auto& mpi) {
+            return exclusion_zone ? join(mp, mpi, MPCC::FixedExclusion{*exclusion_zone})
+                                  : join(mp, mpi, MPCC::NoExclusion{});
+        });
+    }, nb::arg("sequence_a"), nb::arg("sequence_b"), nb::arg("m"), nb::arg("num_threads") = 1,
+       nb::arg("stats_a").none() = nb::none(), nb::arg("stats_b").none() = nb::none(),
+       nb::arg("out").none() = nb::none(), nb::arg("exclusion_zone").none() = nb::none(),
+       nb::arg("workspace").none() = nb::none(), nb::arg("timings").none() = nb::none(),
+       doc<T>("Compute the AB-join matrix profile (O(n_a * n_b)). Returns (distances, indices) where "
+              "distances[i] is the z-normalized distance from subsequence i of sequence_a to its nearest "
+              "neighbor in sequence_b and indices[i] is that neighbor's starting position in sequence_b. "
+              "There is no exclusion zone unless exclusion_zone is given, in which case neighbors j with "
+              "|i - j| <= exclusion_zone are skipped, as in a self-join. timings=ProfileStats() records "
+              "the run's timings, as for matrix_profile_stomp.",
+              "float32 overload: computed in single precision; returns float32 distances and int64 "
+              "indices. Both sequences must be float32."));
+
+    m.def("matrix_profile_discords",
+          [](InputArrayT<T> sequence, size_t m, size_t k, size_t exclusion, size_t num_threads,
+             const Stats* stats) -> nb::object {
+        std::vector<MPCC::ProfileMatch> discords;
+        const auto engine = [&](auto& seq, size_t m, auto& mp, auto& mpi) {
+            return stats ? MPCC::matrixProfileDiscords(seq, m, *stats, k, exclusion, mp, mpi, discords, num_threads)
+                         : MPCC::matrixProfileDiscords(seq, m, k, exclusion, mp, mpi, discords, num_threads);
+        };
+        const nb::tuple profile = nb::borrow<nb::tuple>(computeMatrixProfile<T>(sequence, m, nb::none(), engine));
+        nb::list result;
+        for (const auto& discord : discords) result.append(nb::cast(discord));
+        return nb::make_tuple(profile[0], profile[1], result);
+    }, nb::arg("sequence"), nb::arg("m"), nb::arg("k"), nb::arg("exclusion"), nb::arg("num_threads") = 1,
+       nb::arg("stats").none() = nb::none(),
+       doc<T>("matrix_profile_stomp that also finds the top-k discords during the sweep, each row's nearest "
+              "neighbor going into a bounded heap as soon as its row completes. Returns (distances, indices, "
+              "discords), with discords the list of ProfileMatch that find_discords(distances, indices, k, "
+              "exclusion) would return.",
+              "float32 overload: computed in single precision; returns float32 distances."));
+
+    m.def("matrix_profile_batch",
+          [](std::vector<InputArrayT<T>> series, size_t m, size_t num_threads) -> nb::object {
+        // One ragged buffer for the whole batch, gathered while the GIL still protects the arrays.
+        std::vector<size_t> offsets{0};
+        for (const auto& s : series) offsets.push_back(offsets.back() + s.shape(0));
+        std::vector<T> values(offsets.back());
+        for (size_t s = 0; s < series.size(); s++) {
+            const auto in = stridedInput(series[s]);
+            for (size_t i = 0; i < in.size; i++) {
+                values[offsets[s] + i] = in.data[static_cast<std::ptrdiff_t>(i) * in.stride];
+            }
+        }
+        auto seq = xt::adapt(values.data(), values.size(), xt::no_ownership(), std::vector<size_t>{values.size()});
+        return runBatch<T>(seq, offsets, m, num_threads);
+    }, nb::arg("series"), nb::arg("m"), nb::arg("num_threads") = 0,
+       doc<T>("Compute the self-join matrix profiles of many independent series in one call. series is a list "
+              "of 1-D arrays of any lengths >= m. Returns (distances, indices, offsets): the profiles of all "
+              "series back to back in two arrays, profile s being distances[offsets[s]:offsets[s + 1]] with "
+              "indices within series s. Each series is one task on a persistent work-stealing thread pool "
+              "(num_threads=0 uses every hardware thread) and matches matrix_profile_diagonal(series[s], m) "
+              "exactly.",
+              "float32 overload: every series must be float32; returns float32 distances."));
+
+    m.def("matrix_profile_batch",
+          [](InputArrayT<T> values, InputArrayT<int64_t> offsets, size_t m, size_t num_threads) -> nb::object {
+        std::vector<size_t> series_offsets(offsets.shape(0));
+        for (size_t s = 0; s < series_offsets.size(); s++) {
+            const int64_t offset = offsets.data()[static_cast<std::ptrdiff_t>(s) * offsets.stride(0)];
+            if (offset < 0) throwMatrixProfileError(MPCC::MatrixProfileStatus::BatchOffsetsInvalid);
+            series_offsets[s] = static_cast<size_t>(offset);
+        }
+        const auto seq_in = stridedInput(values);
+        auto seq = seq_in.adapt();
+        return runBatch<T>(seq, series_offsets, m, num_threads);
+    }, nb::arg("values"), nb::arg("offsets"), nb::arg("m"), nb::arg("num_threads") = 0,
+       doc<T>("matrix_profile_batch over series stored back to back in one array: series s is "
+              "values[offsets[s]:offsets[s + 1]], with offsets an int64 array of count + 1 non-decreasing "
+              "positions. Nothing is copied. Returns (distances, indices, offsets) as above.",
+              "float32 overload: values must be float32."));
+
+    m.def("matrix_profile_tile",
+          [](InputArrayT<T> sequence, size_t m, std::pair<size_t, size_t> rows, std::pair<size_t, size_t> cols,
+             size_t num_threads, const Stats* stats, nb::handle out) -> nb::object {
+        const size_t n = sequence.shape(0);
+        if (m == 0) throw nb::value_error("m must be greater than 0");
+        if (m > n)  throw nb::value_error("m must not be larger than sequence length");
+
+        const MPCC::ProfileTile tile{rows.first, rows.second, cols.first, cols.second};
+        if (!tile.fits(n - m + 1, n - m + 1)) throwMatrixProfileError(MPCC::MatrixProfileStatus::TileOutOfRange);
+
+        const auto seq_in = stridedInput(sequence);
+        auto seq = seq_in.adapt();
+
+        return runMatrixProfile<T>(tile.rows(), out, [&](auto& mp, auto& mpi) {
+            return stats ? MPCC::matrixProfileTile(seq, m, *stats, tile, mp, mpi, num_threads)
+                         : MPCC::matrixProfileTile(seq, m, tile, mp, mpi, num_threads);
+        });
+    }, nb::arg("sequence"), nb::arg("m"), nb::arg("rows"), nb::arg("cols"), nb::arg("num_threads") = 1,
+       nb::arg("stats").none() = nb::none(), nb::arg("out").none() = nb::none(),
+       doc<T>("Compute the partial self-join matrix profile of one block of the distance matrix: for each "
+              "subsequence i in rows = (begin, end), its nearest neighbor among the subsequences in cols = "
+              "(begin, end), with the exclusion zone floor(m/4) of matrix_profile_naive. Returns (distances, "
+              "indices) of length end - begin; indices are absolute and -1 where every column is excluded. "
+              "Tiles are independent, so they can be computed on different processes or machines (e.g. as "
+              "Dask or Ray tasks) and reassembled with merge_profiles; merging every tile of a grid "
+              "reproduces matrix_profile_naive up to rounding. Pass stats= computed once for the whole "
+              "sequence to avoid recomputing them per tile.",
+              "float32 overload: computed in single precision; returns float32 distances and int64 "
+              "indices."));
+
+    m.def("matrix_profile_ab_join_tile",
+          [](InputArrayT<T> sequence_a, InputArrayT<T> sequence_b, size_t m, std::pair<size_t, size_t> rows,
+             std::pair<size_t, size_t> cols, size_t num_threads, const Stats* stats_a, const Stats* stats_b,
+             nb::handle out) -> nb::object {
+        const size_t n_a = sequence_a.shape(0);
+        const size_t n_b = sequence_b.shape(0);
+        if (m == 0)  throw nb::value_error("m must be greater than 0");
+        if (m > n_a) throw nb::value_error("m must not be larger than sequence length");
+        if (m > n_b) throw nb::value_error("m must not be larger than reference sequence length");
+
+        const MPCC::ProfileTile tile{rows.first, rows.second, cols.first, cols.second};
+        if (!tile.fits(n_a - m + 1, n_b - m + 1)) throwMatrixProfileError(MPCC::MatrixProfileStatus::TileOutOfRange);
+
+        const auto a_in = stridedInput(sequence_a);
+        const auto b_in = stridedInput(sequence_b);
+        auto seq_a = a_in.adapt();
+        auto seq_b = b_in.adapt();
+
+        return runMatrixProfile<T>(tile.rows(), out, [&](auto& mp, auto& mpi) {
+            if (!stats_a && !stats_b) return MPCC::matrixProfileABJoinTile(seq_a, seq_b, m, tile, mp, mpi, num_threads);
+
+            const Stats own_a = stats_a ? Stats() : Stats(seq_a, m);
+            const Stats own_b = stats_b ? Stats() : Stats(seq_b, m);
+            return MPCC::matrixProfileABJoinTile(seq_a, seq_b, m, stats_a ? *stats_a : own_a,
+                                                 stats_b ? *stats_b : own_b, tile, mp, mpi, num_threads);
+        });
+    }, nb::arg("sequence_a"), nb::arg("sequence_b"), nb::arg("m"), nb::arg("rows"), nb::arg("cols"),
+       nb::arg("num_threads") = 1, nb::arg("stats_a").none() = nb::none(), nb::arg("stats_b").none() = nb::none(),
+       nb::arg("out").none() = nb::none(),
+       doc<T>("Compute the partial AB-join matrix profile of one block of the distance matrix: for each "
+              "subsequence of sequence_a in rows = (begin, end), its nearest neighbor among the subsequences "
+              "of sequence_b in cols = (begin, end). There is no exclusion zone. Indices are absolute "
+              "positions in sequence_b; merging every tile of a grid with merge_profiles reproduces "
+              "matrix_profile_ab_join up to rounding.",
+              "float32 overload: computed in single precision; returns float32 distances and int64 "
+              "indices. Both sequences must be float32."));
 
-        double*  mp_data  = new double[profile_len];
-        int64_t* mpi_data = new int64_t[profile_len];
+    m.def("matrix_profile_multidim",
+          [](InputMatrixT<T> sequences, size_t m, bool time_major, size_t num_threads,
+             nb::handle out) -> nb::object {
+        const size_t d = sequences.shape(time_major ? 1 : 0);
+        const size_t n = sequences.shape(time_major ? 0 : 1);
+        if (m == 0) throw nb::value_error("m must be greater than 0");
+        if (m > n)  throw nb::value_error("m must not be larger than sequence length");
 
-        auto mp_  = xt::adapt(mp_data,  profile_len, xt::no_ownership(), std::vector<size_t>{profile_len});
-        auto mpi_ = xt::adapt(mpi_data, profile_len, xt::no_ownership(), std::vector<size_t>{profile_len});
+        // Any non-negative strides are read in place; reversed views are copied, as for 1-D inputs.
+        std::vector<T> copy;
+        InputMatrixT<T> input = sequences;
+        if (sequences.stride(0) < 0 || sequences.stride(1) < 0) {
+            const size_t rows = sequences.shape(0), cols = sequences.shape(1);
+            copy.resize(rows * cols);
+            for (size_t r = 0; r < rows; r++) {
+                for (size_t c = 0; c < cols; c++) copy[r * cols + c] = sequences(r, c);
+            }
+            size_t shape[2] = {rows, cols};
+            input = InputMatrixT<T>(copy.data(), 2, shape, nb::handle());
+        }
+        auto seq = adaptStrided2D(input);
+        const auto layout = time_major ? MPCC::ChannelLayout::TimeMajor : MPCC::ChannelLayout::ChannelMajor;
+
+        auto compute = [&](auto& mp, auto& mpi) {
+            nb::gil_scoped_release release;
+            return MPCC::matrixProfileMultidim(seq, m, mp, mpi, layout, num_threads);
+        };
+
+        if (!out.is_none()) {
+            if (!nb::isinstance<nb::tuple>(out) || nb::len(out) != 2) {
+                throw nb::type_error("out must be a (distances, indices) tuple");
+            }
+            auto mp_array  = outputArray<T, 2>(out[0], "out[0]");
+            auto mpi_array = outputArray<int64_t, 2>(out[1], "out[1]");
+            auto mp_  = adaptStrided2D(mp_array);
+            auto mpi_ = adaptStrided2D(mpi_array);
+            const auto status = compute(mp_, mpi_);
+            if (status != MPCC::MatrixProfileStatus::Success) throwMatrixProfileError(status);
+            return nb::borrow(out);
+        }
 
-        const auto status = MPCC::matrixProfileNaive(seq, m, mp_, mpi_);
+        const size_t profile_len = n - m + 1;
+        T*       mp_data  = new T[d * profile_len];
+        int64_t* mpi_data = new int64_t[d * profile_len];
+        auto mp_  = xt::adapt(mp_data,  d * profile_len, xt::no_ownership(), std::vector<size_t>{d, profile_len});
+        auto mpi_ = xt::adapt(mpi_data, d * profile_len, xt::no_ownership(), std::vector<size_t>{d, profile_len});
 
+        const auto status = compute(mp_, mpi_);
         if (status != MPCC::MatrixProfileStatus::Success) {
             delete[] mp_data;
             delete[] mpi_data;
-            switch (status) {
-                case MPCC::MatrixProfileStatus::SequenceNotOneDimensional:
-                    throw nb::value_error("sequence must be 1-dimensional");
-                case MPCC::MatrixProfileStatus::SubsequenceLengthZero:
-                    throw nb::value_error("m must be greater than 0");
-                case MPCC::MatrixProfileStatus::SubsequenceLongerThanSequence:
-                    throw nb::value_error("m must not be larger than sequence length");
-                case MPCC::MatrixProfileStatus::DistanceWrongSize:
-                    throw nb::value_error("distance has wrong size");
-                case MPCC::MatrixProfileStatus::IndexWrongSize:
-                    throw nb::value_error("index has wrong size");
-                case MPCC::MatrixProfileStatus::SimilaritySearchFailed:
-                    throw nb::value_error("similarity search failed");
-                default:
-                    throw nb::value_error("matrix profile failed");
+            throwMatrixProfileError(status);
+        }
+
+        size_t shape[2] = {d, profile_len};
+        auto mp_out = OutputArrayT<T, 2>(
+            mp_data, 2, shape,
+            nb::capsule(mp_data,  [](void* p) noexcept { delete[] static_cast<T*      >(p); })
+        );
+        auto mpi_out = OutputArrayT<int64_t, 2>(
+            mpi_data, 2, shape,
+            nb::capsule(mpi_data, [](void* p) noexcept { delete[] static_cast<int64_t*>(p); })
+        );
+        return nb::make_tuple(mp_out, mpi_out);
+    }, nb::arg("sequences"), nb::arg("m"), nb::arg("time_major") = false, nb::arg("num_threads") = 1,
+       nb::arg("out").none() = nb::none(),
+       doc<T>("Compute the multidimensional matrix profile (mSTAMP) of a (d, n) array with one channel per row, "
+              "or (n, d) with time_major=True. Returns (distances, indices) of shape (d, n - m + 1): row k-1 "
+              "is the k-dimensional profile, built per column from the k smallest per-channel distances "
+              "(root mean square), as in stumpy.mstump. The exclusion zone is floor(m/4).",
+              "float32 overload: computed in single precision; returns float32 distances and int64 "
+              "indices."));
+
+    m.def("pan_matrix_profile",
+          [](InputArrayT<T> sequence, std::vector<size_t> lengths, size_t num_threads, nb::object on_row,
+             const Stats* stats, nb::handle out) -> nb::object {
+        const size_t n = sequence.shape(0);
+        for (const size_t len : lengths) {
+            if (len == 0) throw nb::value_error("lengths must be greater than 0");
+            if (len > n)  throw nb::value_error("lengths must not be larger than sequence length");
+        }
+
+        const auto seq_in = stridedInput(sequence);
+        auto seq = seq_in.adapt();
+        const std::span<const size_t> lens(lengths);
+
+        // on_row sees the result arrays themselves, so they exist before the computation starts.
+        const size_t rows = lengths.size();
+        const size_t cols = rows ? n - *std::min_element(lengths.begin(), lengths.end()) + 1 : 0;
+        nb::object mp_obj, mpi_obj;
+        if (!out.is_none()) {
+            if (!nb::isinstance<nb::tuple>(out) || nb::len(out) != 2) {
+                throw nb::type_error("out must be a (distances, indices) tuple");
+            }
+            mp_obj  = nb::borrow(out[0]);
+            mpi_obj = nb::borrow(out[1]);
+        } else {
+            T*       mp_data  = new T[rows * cols];
+            int64_t* mpi_data = new int64_t[rows * cols];
+            size_t shape[2] = {rows, cols};
+            mp_obj = nb::cast(OutputArrayT<T, 2>(
+                mp_data, 2, shape,
+                nb::capsule(mp_data,  [](void* p) noexcept { delete[] static_cast<T*      >(p); })
+            ));
+            mpi_obj = nb::cast(OutputArrayT<int64_t, 2>(
+                mpi_data, 2, shape,
+                nb::capsule(mpi_data, [](void* p) noexcept { delete[] static_cast<int64_t*>(p); })
+            ));
+        }
+        auto mp_array  = outputArray<T, 2>(mp_obj, "out[0]");
+        auto mpi_array = outputArray<int64_t, 2>(mpi_obj, "out[1]");
+        auto mp_  = adaptStrided2D(mp_array);
+        auto mpi_ = adaptStrided2D(mpi_array);
+
+        // As for matrix_profile_anytime: the core calls back on this thread with the GIL released, and an
+        // exception raised by on_row stops the computation and is re-raised once it has returned.
+        std::optional<nb::python_error> callback_error;
+        MPCC::PanProfileCallback on_row_done;
+        if (!on_row.is_none()) {
+            on_row_done = [&](size_t row, size_t done, size_t total) {
+                nb::gil_scoped_acquire acquire;
+                try {
+                    const nb::object keep_going = on_row(mp_obj, mpi_obj, row, done, total);
+                    return keep_going.is_none() || nb::cast<bool>(keep_going);
+                } catch (nb::python_error& e) {
+                    callback_error.emplace(std::move(e));
+                    return false;
+                }
+            };
+        }
+
+        MPCC::MatrixProfileStatus status;
+        {
+            nb::gil_scoped_release release;
+            status = stats ? MPCC::panMatrixProfile(seq, lens, *stats, mp_, mpi_, num_threads, on_row_done)
+                           : MPCC::panMatrixProfile(seq, lens, mp_, mpi_, num_threads, on_row_done);
+        }
+        if (callback_error) throw std::move(*callback_error);
+        if (status != MPCC::MatrixProfileStatus::Success) throwMatrixProfileError(status);
+        return out.is_none() ? nb::object(nb::make_tuple(mp_obj, mpi_obj)) : nb::borrow(out);
+    }, nb::arg("sequence"), nb::arg("lengths"), nb::arg("num_threads") = 1, nb::arg("on_row").none() = nb::none(),
+       nb::arg("stats").none() = nb::none(), nb::arg("out").none() = nb::none(),
+       doc<T>("Compute the self-join matrix profile for every subsequence length in lengths at once (the pan "
+              "matrix profile), sharing the window statistics and the dot products along each diagonal across "
+              "lengths. Returns (distances, indices) of shape (len(lengths), n - min(lengths) + 1); row r "
+              "matches matrix_profile_diagonal(sequence, lengths[r]) up to rounding in its first "
+              "n - lengths[r] + 1 columns and is padded with inf and -1. Rows are computed coarse to fine "
+              "(the median length first, then the quartiles, and so on); on_row(distances, indices, row, done, "
+              "total) is called with the result arrays as each row completes, and returning False stops early, "
+              "leaving the remaining rows at inf and -1. stats must hold every length; out= takes a "
+              "preallocated (distances, indices) pair of that shape.",
+              "float32 overload: computed in single precision; returns float32 distances and int64 "
+              "indices."));
+}
+
+NB_MODULE(mpcc_py, m) {
+    m.doc() = "MPCC Python bindings";
+
+    m.def("simd_backend", []() { return std::string(MPCC::simdBackend()); },
+       "Name of the SIMD kernel backend selected for this CPU: avx512, avx2, neon, or scalar.");
+
+    m.def("cuda_available", []() {
+#ifdef MPCC_WITH_CUDA
+        return MPCC::cudaAvailable();
+#else
+        return false;
+#endif
+    }, "Whether device='cuda' can be used: mpcc was built with CUDA support and a CUDA device is present.");
+
+    nb::class_<MPCC::ProfileStats>(m, "ProfileStats",
+        "Timings of one matrix profile run, filled in by passing it as timings= to matrix_profile_stomp, "
+        "matrix_profile_diagonal or matrix_profile_ab_join. Phase times are summed over threads, so with several threads they exceed "
+        "wall_seconds; the per-thread busy_seconds show how evenly the work was spread.")
+        .def(nb::init<>())
+        .def_ro("wall_seconds", &MPCC::ProfileStats::wall_seconds)
+        .def_prop_ro("phase_seconds", [](const MPCC::ProfileStats& self) {
+            nb::dict phases;
+            for (size_t p = 0; p < MPCC::kNumPhases; p++) {
+                const auto phase = static_cast<MPCC::Phase>(p);
+                phases[MPCC::phaseName(phase)] = self.phaseSeconds(phase);
+            }
+            return phases;
+        }, "Seconds per phase (stats, centering, dot_products, distances, neighbor_scan, diagonals, reduction).")
+        .def_prop_ro("rows",      &MPCC::ProfileStats::rows,      "Distance-matrix rows swept (STOMP).")
+        .def_prop_ro("diagonals", &MPCC::ProfileStats::diagonals, "Diagonals swept (diagonal engine).")
+        .def_prop_ro("threads", [](const MPCC::ProfileStats& self) {
+            nb::list threads;
+            for (const auto& t : self.threads) {
+                nb::dict thread;
+                thread["busy_seconds"] = t.busy_seconds;
+                thread["tasks"]        = t.tasks;
+                thread["rows"]         = t.rows;
+                thread["diagonals"]    = t.diagonals;
+                threads.append(thread);
             }
+            return threads;
+        }, "Per-thread busy_seconds, tasks, rows and diagonals; entry 0 is the calling thread.")
+        .def("chrome_trace", &MPCC::ProfileStats::chromeTrace,
+            "The run's row blocks, diagonal tiles and serial phases as Chrome trace event JSON, for "
+            "chrome://tracing or ui.perfetto.dev.");
+
+    nb::class_<PyWorkspace>(m, "Workspace",
+        "Reusable scratch memory for matrix_profile_naive, matrix_profile_stomp, matrix_profile_diagonal and "
+        "matrix_profile_ab_join. Pass the same one as workspace= to repeated calls: after the first, the "
+        "computation itself allocates nothing, whatever num_threads is, since multi-threaded calls run on a "
+        "persistent process-wide pool; pass out= as well to reuse the result arrays. Buffers grow to the "
+        "largest call seen; max_n and num_threads size them up front for series of up to max_n values. "
+        "Results equal those computed without a workspace. Calls sharing a workspace from several Python "
+        "threads take turns.")
+        .def("__init__", [](PyWorkspace* self, size_t max_n, size_t num_threads) {
+            new (self) PyWorkspace();
+            self->workspace.reserve(max_n, num_threads);
+        }, nb::arg("max_n") = 0, nb::arg("num_threads") = 1)
+        .def_prop_ro("nbytes", [](const PyWorkspace& self) { return self.workspace.capacityBytes(); },
+            "Bytes held by the scratch buffers.");
+
+    nb::class_<MPCC::ProfileMatch>(m, "ProfileMatch",
+        "A motif or discord: subsequence index, its nearest neighbor (the matrix profile index) and the "
+        "distance between them.")
+        .def_ro("index",    &MPCC::ProfileMatch::index)
+        .def_ro("neighbor", &MPCC::ProfileMatch::neighbor)
+        .def_ro("distance", &MPCC::ProfileMatch::distance)
+        .def("__repr__", [](const MPCC::ProfileMatch& self) {
+            return "ProfileMatch(index=" + std::to_string(self.index) + ", neighbor=" + std::to_string(self.neighbor)
+                 + ", distance=" + std::to_string(self.distance) + ")";
+        });
+
+    bindFindMatches(m, "find_motifs",
+        "The top-k motifs of a matrix profile (mp, mpi) as a list of ProfileMatch, smallest distance first "
+        "with ties to the lowest index. Each pick rules out every subsequence within exclusion of it and of "
+        "its neighbor, so a motif pair is reported once. Entries with index -1 or a non-finite distance are "
+        "never picked. One pass over mp with a bounded heap rather than k argmin-and-mask passes.",
+        [](auto& mp, auto& mpi, size_t k, size_t exclusion, auto& matches) {
+            return MPCC::findMotifs(mp, mpi, k, exclusion, matches);
+        });
+    bindFindMatches(m, "find_discords",
+        "The top-k discords of a matrix profile (mp, mpi) as a list of ProfileMatch, largest distance first "
+        "with ties to the lowest index, each pick ruling out every subsequence within exclusion of it. "
+        "Entries with a non-finite distance are never picked.",
+        [](auto& mp, auto& mpi, size_t k, size_t exclusion, auto& matches) {
+            return MPCC::findDiscords(mp, mpi, k, exclusion, matches);
+        });
+
+    m.def("merge_profiles",
+          [](nb::handle mp, nb::handle mpi, nb::handle partial_mp, nb::handle partial_mpi, size_t offset) {
+        WritableArrayT<float> as_float32;
+        if (nb::try_cast(mp, as_float32, /*convert=*/false)) {
+            mergeProfilesInto<float>(mp, mpi, partial_mp, partial_mpi, offset);
+        } else {
+            mergeProfilesInto<double>(mp, mpi, partial_mp, partial_mpi, offset);
+        }
+        return nb::make_tuple(nb::borrow(mp), nb::borrow(mpi));
+    }, nb::arg("mp"), nb::arg("mpi"), nb::arg("partial_mp"), nb::arg("partial_mpi"), nb::arg("offset") = 0,
+       "Min-reduce a partial profile (such as a matrix_profile_tile result) into mp and mpi in place: entry "
+       "offset + r takes (partial_mp[r], partial_mpi[r]) if that neighbor is nearer, ties going to the lower "
+       "index, and partial entries with index -1 are skipped. mp is a writable float64 or float32 array and "
+       "mpi a writable int64 array; start from np.full(n - m + 1, np.inf) and np.full(n - m + 1, -1). Tiles "
+       "may be merged in any order. Returns (mp, mpi).");
+
+    m.def("encode_profile",
+          [](nb::handle mp, InputArrayT<int64_t> mpi, size_t m, const std::string& encoding) {
+        MPCC::ProfileEncoding profile_encoding;
+        if (encoding == "uint16")       profile_encoding = MPCC::ProfileEncoding::UInt16;
+        else if (encoding == "float16") profile_encoding = MPCC::ProfileEncoding::Float16;
+        else throw nb::value_error("encoding must be 'uint16' or 'float16'");
+
+        InputArrayT<float> as_float32;
+        if (nb::try_cast(mp, as_float32, /*convert=*/false)) {
+            return encodeProfileBytes<float>(as_float32, mpi, m, profile_encoding);
         }
+        InputArrayT<double> as_float64;
+        if (!nb::try_cast(mp, as_float64)) throw nb::type_error("mp must be a 1-D float64 or float32 array");
+        return encodeProfileBytes<double>(as_float64, mpi, m, profile_encoding);
+    }, nb::arg("mp"), nb::arg("mpi"), nb::arg("m"), nb::arg("encoding") = "uint16",
+       "Serialize a matrix profile (mp, mpi) of subsequence length m in 6 bytes per entry instead of 16: "
+       "indices as exact int32 deltas and distances as uint16 fixed point on [0, 2 sqrt(m)] (absolute error "
+       "at most sqrt(m) / 65534, inf kept as 'no neighbor'), or as float16 with encoding='float16' (relative "
+       "error at most 2^-11). Returns bytes; decode_profile and decodeProfile in web/lib/profile.js read them "
+       "back. The delta-encoded indices are mostly small and repetitive, so the bytes also compress well.");
 
-        size_t shape[1] = {profile_len};
+    m.def("decode_profile", [](nb::bytes data) {
+        const std::span<const uint8_t> bytes(static_cast<const uint8_t*>(data.data()), data.size());
 
-        auto mp_out = OutputArray(
+        MPCC::EncodedProfileHeader header;
+        const auto header_status = MPCC::decodeProfileHeader(bytes, header);
+        if (header_status != MPCC::MatrixProfileStatus::Success) throwMatrixProfileError(header_status);
+
+        const size_t length   = header.length;
+        double*      mp_data  = new double[length];
+        int64_t*     mpi_data = new int64_t[length];
+        auto mp_  = xt::adapt(mp_data,  length, xt::no_ownership(), std::vector<size_t>{length});
+        auto mpi_ = xt::adapt(mpi_data, length, xt::no_ownership(), std::vector<size_t>{length});
+
+        MPCC::MatrixProfileStatus status;
+        {
+            nb::gil_scoped_release release;
+            status = MPCC::decodeProfile(bytes, mp_, mpi_);
+        }
+        if (status != MPCC::MatrixProfileStatus::Success) {
+            delete[] mp_data;
+            delete[] mpi_data;
+            throwMatrixProfileError(status);
+        }
+
+        size_t shape[1] = {length};
+        auto mp_out = OutputArrayT<double>(
             mp_data, 1, shape,
             nb::capsule(mp_data,  [](void* p) noexcept { delete[] static_cast<double* >(p); })
         );
@@ -111,11 +1499,98 @@ NB_MODULE(mpcc_py, m) {
             mpi_data, 1, shape,
             nb::capsule(mpi_data, [](void* p) noexcept { delete[] static_cast<int64_t*>(p); })
         );
+        return nb::make_tuple(mp_out, mpi_out, header.m);
+    }, nb::arg("data"),
+       "Decode bytes written by encode_profile. Returns (distances, indices, m) as float64 and int64 arrays, "
+       "distances rounded as they were encoded.");
 
-        return nb::make_tuple(mp_out, mpi_out);
-    }, nb::arg("sequence"), nb::arg("m"),
-       "Compute the full matrix profile naively (O(n^2)). "
-       "Returns (distances, indices) where distances[i] is the z-normalized distance from "
-       "subsequence i to its nearest non-trivial neighbor and indices[i] is that neighbor's "
-       "starting position. The exclusion zone is floor(m/4) on each side of the diagonal.");
+    // float64 first: nanobind tries overloads in registration order, so inputs that need converting (lists,
+    // integer arrays) land on the float64 overloads and only genuine float32 arrays take the float32 ones.
+    bindPrecision<double>(m, "SequenceStats");
+    bindPrecision<float>(m, "SequenceStatsFloat32");
+
+    m.def("matrix_profile_mapped",
+          [](const std::string& path, size_t m, const std::string& mp_path, const std::string& mpi_path,
+             const std::string& format, size_t num_threads, std::optional<size_t> exclusion_zone) {
+        MPCC::MappedFormat fmt;
+        if (format == "auto")         fmt = MPCC::MappedFormat::Auto;
+        else if (format == "float64") fmt = MPCC::MappedFormat::Float64;
+        else if (format == "float32") fmt = MPCC::MappedFormat::Float32;
+        else if (format == "npy")     fmt = MPCC::MappedFormat::Npy;
+        else throw nb::value_error("format must be 'auto', 'float64', 'float32' or 'npy'");
+
+        MPCC::MatrixProfileStatus status;
+        {
+            nb::gil_scoped_release release;
+            status = MPCC::matrixProfileMapped(path, m, mp_path, mpi_path, fmt, num_threads, {},
+                                               selfJoinExclusion(exclusion_zone, m));
+        }
+        if (status != MPCC::MatrixProfileStatus::Success) throwMatrixProfileError(status);
+    }, nb::arg("path"), nb::arg("m"), nb::arg("mp_path"), nb::arg("mpi_path"), nb::arg("format") = "auto",
+       nb::arg("num_threads") = 1, nb::arg("exclusion_zone").none() = nb::none(),
+       "Compute the self-join matrix profile of a series stored in a file without loading it into memory. "
+       "The input (a 1-D float64/float32 .npy file, or raw float64 or float32 values with format='float64' "
+       "or 'float32'; 'auto' detects .npy and otherwise reads raw float64) is memory-mapped and processed in "
+       "tiles, and the n - m + 1 float64 distances and int64 indices are written through mappings of mp_path "
+       "and mpi_path. Output paths ending in .npy get a .npy header, so np.load(mp_path, mmap_mode='r') "
+       "opens them in place; others are raw. exclusion_zone is as for matrix_profile_stomp. Matches "
+       "matrix_profile_diagonal with the same exclusion_zone up to rounding.");
+
+    nb::class_<MPCC::StreamingMatrixProfile>(m, "StreamingMatrixProfile",
+        "Incrementally maintained self-join matrix profile for a streaming series (STAMPI). Each "
+        "appended sample updates the profile in O(n). With window=W only the latest W samples are kept "
+        "and memory stays O(W); indices are absolute stream positions and the first retained "
+        "subsequence is `offset`. exclusion_zone is as for matrix_profile_stomp.")
+        .def("__init__", [](MPCC::StreamingMatrixProfile* self, size_t m, size_t window,
+                            std::optional<size_t> exclusion_zone) {
+            if (m == 0) throw nb::value_error("m must be greater than 0");
+            if (window != 0 && window < m) throw nb::value_error("window must be 0 or at least m");
+            new (self) MPCC::StreamingMatrixProfile(m, window, selfJoinExclusion(exclusion_zone, m));
+        }, nb::arg("m"), nb::arg("window") = 0, nb::arg("exclusion_zone").none() = nb::none())
+        .def("append", [](MPCC::StreamingMatrixProfile& self, double value) {
+            self.append(value);
+        }, nb::arg("value"), "Append one sample.")
+        .def("append", &appendSamples<double>, nb::arg("values"),
+            "Append several samples in order, from a 1-D float64 or float32 array of any stride.")
+        .def("append", &appendSamples<float>, nb::arg("values"),
+            "float32 overload: the samples are widened to float64, in which the profile is kept.")
+        .def("reserve", &MPCC::StreamingMatrixProfile::reserve, nb::arg("n"),
+            "Reserve storage for n samples so appends up to that length do not move the profile views of an "
+            "unbounded stream. A windowed stream compacts its storage once per window of appends, which moves "
+            "the views regardless.")
+        .def_prop_ro("m",             &MPCC::StreamingMatrixProfile::subsequenceLength)
+        .def_prop_ro("window",        &MPCC::StreamingMatrixProfile::window)
+        .def_prop_ro("offset",        &MPCC::StreamingMatrixProfile::offset,
+            "Absolute index of the first retained sample and subsequence.")
+        .def_prop_ro("total_samples", &MPCC::StreamingMatrixProfile::totalSamples)
+        .def("__len__", &MPCC::StreamingMatrixProfile::size)
+        .def_prop_ro("sequence", [](const MPCC::StreamingMatrixProfile& self) {
+            return viewOf(self.sequence());
+        }, nb::rv_policy::reference_internal,
+           "Read-only zero-copy view of the retained samples.")
+        .def_prop_ro("mp", [](const MPCC::StreamingMatrixProfile& self) {
+            return viewOf(self.profile());
+        }, nb::rv_policy::reference_internal,
+           "Read-only zero-copy view of the current matrix profile. The view aliases internal storage: "
+           "take a copy if it must survive a later append (unless reserve() covered that append and the "
+           "stream is unbounded; a windowed stream moves its storage when it compacts).")
+        .def_prop_ro("mpi", [](const MPCC::StreamingMatrixProfile& self) {
+            return viewOf(self.profileIndex());
+        }, nb::rv_policy::reference_internal,
+           "Read-only zero-copy view of the current matrix profile index (-1 where no neighbor exists "
+           "yet). Same lifetime rules as mp.")
+        .def_prop_ro("left_mp", [](const MPCC::StreamingMatrixProfile& self) {
+            return viewOf(self.leftProfile());
+        }, nb::rv_policy::reference_internal,
+           "Read-only view of the left matrix profile (nearest neighbor that starts earlier).")
+        .def_prop_ro("left_mpi", [](const MPCC::StreamingMatrixProfile& self) {
+            return viewOf(self.leftProfileIndex());
+        }, nb::rv_policy::reference_internal)
+        .def_prop_ro("right_mp", [](const MPCC::StreamingMatrixProfile& self) {
+            return viewOf(self.rightProfile());
+        }, nb::rv_policy::reference_internal,
+           "Read-only view of the right matrix profile (nearest neighbor that starts later).")
+        .def_prop_ro("right_mpi", [](const MPCC::StreamingMatrixProfile& self) {
+            return viewOf(self.rightProfileIndex());
+        }, nb::rv_policy::reference_internal);
 }
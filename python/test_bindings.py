@@ -1,5 +1,9 @@
 """Tests verifying similarity_search against stumpy as the source of truth."""
 
+import json
+import math
+import os
+import tempfile
 import unittest
 
 import numpy as np
@@ -83,6 +87,189 @@ class TestSimilaritySearch(unittest.TestCase):
         with self.assertRaises(ValueError):
             mpcc.similarity_search(sequence, query)
 
+    def test_kernel_tail_lengths(self):
+        """Query and profile lengths that are not multiples of the SIMD width match stumpy.mass."""
+        rng = np.random.default_rng(21)
+        for n, m in ((67, 3), (130, 17), (259, 9)):
+            sequence = rng.standard_normal(n)
+            query    = rng.standard_normal(m)
+
+            np.testing.assert_allclose(
+                mpcc.similarity_search(sequence, query), stumpy.mass(query, sequence), rtol=1e-6)
+
+    def test_simd_backend(self):
+        """The selected SIMD backend is one of the known kernel sets."""
+        self.assertIn(mpcc.simd_backend(), {"avx512", "avx2", "neon", "scalar"})
+
+
+class TestSimilaritySearchMass(unittest.TestCase):
+
+    def test_matches_stumpy(self):
+        """FFT-based distance profile matches stumpy.mass."""
+        rng = np.random.default_rng(42)
+        sequence = rng.standard_normal(1000)
+        query    = rng.standard_normal(100)
+
+        result   = mpcc.similarity_search_mass(sequence, query)
+        expected = stumpy.mass(query, sequence)
+
+        np.testing.assert_allclose(result, expected, rtol=1e-6)
+
+    def test_matches_direct(self):
+        """MASS agrees with the direct search, including for non-power-of-two lengths."""
+        rng = np.random.default_rng(5)
+        sequence = rng.standard_normal(1025)
+        query    = rng.standard_normal(37)
+
+        result   = mpcc.similarity_search_mass(sequence, query)
+        expected = mpcc.similarity_search(sequence, query)
+
+        np.testing.assert_allclose(result, expected, rtol=1e-6)
+
+    def test_matches_direct_long_sequence(self):
+        """The FFT stays accurate for transforms of 2**21 points: its twiddle factors carry no accumulated
+        rounding, so MASS agrees with the direct search far more tightly than the loose tolerances above."""
+        rng = np.random.default_rng(6)
+        sequence = rng.standard_normal(2 ** 20 + 12345)
+        query    = rng.standard_normal(64)
+
+        result   = mpcc.similarity_search_mass(sequence, query)
+        expected = mpcc.similarity_search(sequence, query)
+
+        np.testing.assert_allclose(result, expected, rtol=1e-11)
+
+    def test_query_same_length_as_sequence(self):
+        """Single-window case gives one distance value."""
+        rng = np.random.default_rng(7)
+        sequence = rng.standard_normal(20)
+        query    = rng.standard_normal(20)
+
+        result   = mpcc.similarity_search_mass(sequence, query)
+        expected = stumpy.mass(query, sequence)
+
+        self.assertEqual(result.shape, (1,))
+        np.testing.assert_allclose(result, expected, rtol=1e-6)
+
+    def test_auto_matches_direct(self):
+        """The automatic choice agrees with the direct search for short and long queries."""
+        rng = np.random.default_rng(11)
+        sequence = rng.standard_normal(4096)
+
+        for m in (8, 512):
+            query = rng.standard_normal(m)
+            np.testing.assert_allclose(
+                mpcc.similarity_search_auto(sequence, query),
+                mpcc.similarity_search(sequence, query),
+                rtol=1e-6,
+            )
+
+    def test_query_longer_than_sequence_raises(self):
+        """ValueError is raised when query is longer than sequence."""
+        with self.assertRaises(ValueError):
+            mpcc.similarity_search_mass(np.ones(5), np.ones(10))
+
+
+class TestSimilaritySearchBatch(unittest.TestCase):
+
+    def test_matches_single_searches(self):
+        """Each row equals the single-query search exactly, for any thread count."""
+        rng = np.random.default_rng(40)
+        sequence = rng.standard_normal(3000)
+        queries  = np.stack([rng.standard_normal(48) for _ in range(25)])
+
+        expected = np.stack([mpcc.similarity_search(sequence, q) for q in queries])
+        for num_threads in (1, 4):
+            result = mpcc.similarity_search_batch(sequence, queries, num_threads=num_threads)
+            self.assertEqual(result.shape, (25, len(sequence) - 48 + 1))
+            np.testing.assert_array_equal(result, expected)
+
+    def test_matches_stumpy(self):
+        rng = np.random.default_rng(41)
+        sequence = rng.standard_normal(500)
+        queries  = np.stack([sequence[i:i + 20] for i in (0, 100, 333)])
+
+        result = mpcc.similarity_search_batch(sequence, queries)
+        for row, query in zip(result, queries):
+            np.testing.assert_allclose(row, stumpy.mass(query, sequence), rtol=1e-6, atol=1e-6)
+
+    def test_stats_out_and_layout(self):
+        """stats=, out= and Fortran-ordered queries give the same result."""
+        rng = np.random.default_rng(42)
+        sequence = rng.standard_normal(800)
+        queries  = rng.standard_normal((6, 30))
+        expected = mpcc.similarity_search_batch(sequence, queries)
+
+        out    = np.empty_like(expected)
+        result = mpcc.similarity_search_batch(sequence, np.asfortranarray(queries),
+                                              stats=mpcc.SequenceStats(sequence, 30), out=out)
+        self.assertIs(result, out)
+        np.testing.assert_array_equal(out, expected)
+
+    def test_errors(self):
+        sequence = np.random.default_rng(43).standard_normal(100)
+        with self.assertRaises(ValueError):
+            mpcc.similarity_search_batch(sequence, np.zeros((2, 101)))
+        with self.assertRaises(ValueError):
+            mpcc.similarity_search_batch(sequence, np.zeros((2, 10)), out=np.empty((3, 91)))
+
+
+class TestSimilaritySearchTopK(unittest.TestCase):
+
+    @staticmethod
+    def greedy_top_k(profile, k, exclusion):
+        """Reference: repeatedly take the nearest window and mask its exclusion zone."""
+        profile = profile.copy()
+        indices = []
+        while len(indices) < k and np.isfinite(profile).any():
+            i = int(np.argmin(profile))
+            indices.append(i)
+            profile[max(0, i - exclusion):i + exclusion + 1] = np.inf
+        return np.array(indices, dtype=np.int64)
+
+    def test_matches_full_search(self):
+        rng = np.random.default_rng(44)
+        sequence = rng.standard_normal(4000)
+        query    = sequence[1234:1234 + 64] + 0.01 * rng.standard_normal(64)
+        profile  = mpcc.similarity_search(sequence, query)
+
+        for k, exclusion in ((1, 0), (5, 16), (20, 64)):
+            distances, indices = mpcc.similarity_search_top_k(sequence, query, k, exclusion=exclusion)
+            expected = self.greedy_top_k(profile, k, exclusion)
+            np.testing.assert_array_equal(indices, expected)
+            np.testing.assert_array_equal(distances, profile[expected])
+        self.assertEqual(mpcc.similarity_search_top_k(sequence, query, 1)[1][0], 1234)
+
+    def test_default_exclusion_and_stats(self):
+        rng = np.random.default_rng(45)
+        sequence = rng.standard_normal(600)
+        query    = rng.standard_normal(40)
+        profile  = mpcc.similarity_search(sequence, query)
+
+        distances, indices = mpcc.similarity_search_top_k(sequence, query, 8,
+                                                          stats=mpcc.SequenceStats(sequence, 40))
+        np.testing.assert_array_equal(indices, self.greedy_top_k(profile, 8, 40 // 4))
+        np.testing.assert_array_equal(distances, profile[indices])
+
+    def test_fewer_matches_than_k(self):
+        sequence = np.random.default_rng(46).standard_normal(50)
+        distances, indices = mpcc.similarity_search_top_k(sequence, sequence[:10], 10, exclusion=20)
+        self.assertLess(len(indices), 10)
+        self.assertEqual(len(distances), len(indices))
+        self.assertEqual(indices.dtype, np.int64)
+
+    def test_exclusion_past_profile(self):
+        rng = np.random.default_rng(47)
+        sequence = rng.standard_normal(300)
+        query    = rng.standard_normal(20)
+        profile  = mpcc.similarity_search(sequence, query)
+
+        # Any exclusion at least the profile length leaves only the single best match, including one large
+        # enough to overflow the retained-window count if it were not clamped.
+        for exclusion in (len(profile), 10 ** 12, 2 ** 63, 2 ** 64 - 1):
+            distances, indices = mpcc.similarity_search_top_k(sequence, query, 3, exclusion=exclusion)
+            np.testing.assert_array_equal(indices, [np.argmin(profile)])
+            np.testing.assert_array_equal(distances, [profile.min()])
+
 
 class TestMatrixProfileNaive(unittest.TestCase):
 
@@ -165,5 +352,1173 @@ class TestMatrixProfileNaive(unittest.TestCase):
             mpcc.matrix_profile_naive(sequence, 20)
 
 
+class TestMatrixProfileStomp(unittest.TestCase):
+
+    def test_distances_match_stumpy(self):
+        """STOMP distances match stumpy.stump on a typical sequence."""
+        rng = np.random.default_rng(42)
+        sequence = rng.standard_normal(200).astype(np.float64)
+        m = 20
+
+        mp, _ = mpcc.matrix_profile_stomp(sequence, m)
+        expected = stumpy.stump(sequence, m)
+
+        np.testing.assert_allclose(mp, expected[:, 0].astype(np.float64), rtol=1e-5)
+
+    def test_matches_naive(self):
+        """STOMP produces the same profile and indices as the naive implementation."""
+        rng = np.random.default_rng(3)
+        sequence = rng.standard_normal(300).astype(np.float64)
+        m = 16
+
+        mp_naive, mpi_naive = mpcc.matrix_profile_naive(sequence, m)
+        mp_stomp, mpi_stomp = mpcc.matrix_profile_stomp(sequence, m)
+
+        np.testing.assert_allclose(mp_stomp, mp_naive, rtol=1e-8, atol=1e-10)
+        np.testing.assert_array_equal(mpi_stomp, mpi_naive)
+
+    def test_left_right_match_stumpy(self):
+        """The left and right indices match stumpy.stump, and the overall profile is their closer side."""
+        rng = np.random.default_rng(12)
+        sequence = rng.standard_normal(300).astype(np.float64)
+        m = 20
+
+        mp, mpi, left_mp, left_mpi, right_mp, right_mpi = mpcc.matrix_profile_stomp(sequence, m, left_right=True)
+        expected = stumpy.stump(sequence, m)
+
+        np.testing.assert_array_equal(left_mpi,  expected[:, 2].astype(np.int64))
+        np.testing.assert_array_equal(right_mpi, expected[:, 3].astype(np.int64))
+        np.testing.assert_array_equal(mp, np.minimum(left_mp, right_mp))
+        plain_mp, plain_mpi = mpcc.matrix_profile_stomp(sequence, m)
+        np.testing.assert_array_equal(mp,  plain_mp)
+        np.testing.assert_array_equal(mpi, plain_mpi)
+        self.assertTrue(np.isinf(left_mp[0]) and left_mpi[0] == -1)
+        self.assertTrue(np.isinf(right_mp[-1]) and right_mpi[-1] == -1)
+
+    def test_output_shapes_and_dtypes(self):
+        """Both outputs have shape (n - m + 1,) with float64 distances and int64 indices."""
+        n, m = 80, 12
+        sequence = np.random.default_rng(0).standard_normal(n).astype(np.float64)
+
+        mp, mpi = mpcc.matrix_profile_stomp(sequence, m)
+
+        self.assertEqual(mp.shape,  (n - m + 1,))
+        self.assertEqual(mpi.shape, (n - m + 1,))
+        self.assertEqual(mp.dtype,  np.float64)
+        self.assertEqual(mpi.dtype, np.int64)
+
+    def test_m_zero_raises(self):
+        """ValueError is raised when m is 0."""
+        with self.assertRaises(ValueError):
+            mpcc.matrix_profile_stomp(np.ones(20, dtype=np.float64), 0)
+
+    def test_m_larger_than_n_raises(self):
+        """ValueError is raised when m is larger than the sequence length."""
+        with self.assertRaises(ValueError):
+            mpcc.matrix_profile_stomp(np.ones(10, dtype=np.float64), 20)
+
+
+class TestMatrixProfileDiagonal(unittest.TestCase):
+
+    def test_distances_match_stumpy(self):
+        """Diagonal engine distances match stumpy.stump on a typical sequence."""
+        rng = np.random.default_rng(42)
+        sequence = rng.standard_normal(200).astype(np.float64)
+        m = 20
+
+        mp, _ = mpcc.matrix_profile_diagonal(sequence, m)
+        expected = stumpy.stump(sequence, m)
+
+        np.testing.assert_allclose(mp, expected[:, 0].astype(np.float64), rtol=1e-5)
+
+    def test_matches_naive(self):
+        """The diagonal sweep agrees with the naive implementation, including indices."""
+        rng = np.random.default_rng(3)
+        sequence = rng.standard_normal(300).astype(np.float64)
+        m = 16
+
+        mp_naive, mpi_naive = mpcc.matrix_profile_naive(sequence, m)
+        mp_diag,  mpi_diag  = mpcc.matrix_profile_diagonal(sequence, m)
+
+        np.testing.assert_allclose(mp_diag, mp_naive, rtol=1e-8, atol=1e-10)
+        np.testing.assert_array_equal(mpi_diag, mpi_naive)
+
+    def test_thread_count_is_deterministic(self):
+        """Results are bit-identical regardless of the thread count."""
+        rng = np.random.default_rng(8)
+        sequence = rng.standard_normal(2000).astype(np.float64)
+        m = 32
+
+        mp_serial, mpi_serial = mpcc.matrix_profile_diagonal(sequence, m, num_threads=1)
+        for num_threads in (2, 3, 8, 0):
+            mp, mpi = mpcc.matrix_profile_diagonal(sequence, m, num_threads=num_threads)
+            np.testing.assert_array_equal(mp,  mp_serial)
+            np.testing.assert_array_equal(mpi, mpi_serial)
+
+    def test_left_right_matches_stomp(self):
+        """The left and right profiles from the diagonal sweep match STOMP's, on any thread count."""
+        rng = np.random.default_rng(13)
+        sequence = rng.standard_normal(1500).astype(np.float64)
+        m = 24
+
+        mp, mpi = mpcc.matrix_profile_diagonal(sequence, m)
+        expected = mpcc.matrix_profile_stomp(sequence, m, left_right=True)
+        for num_threads in (1, 3):
+            result = mpcc.matrix_profile_diagonal(sequence, m, num_threads=num_threads, left_right=True)
+            np.testing.assert_array_equal(result[0], mp)
+            np.testing.assert_array_equal(result[1], mpi)
+            for actual, wanted in zip(result[2:], expected[2:]):
+                np.testing.assert_allclose(actual, wanted, rtol=1e-8, atol=1e-10)
+
+        out = tuple(np.empty(len(mp), dtype=dtype) for dtype in (np.float64, np.int64) * 3)
+        self.assertIs(mpcc.matrix_profile_diagonal(sequence, m, out=out, left_right=True), out)
+        np.testing.assert_array_equal(out[3], expected[3])
+        with self.assertRaises(TypeError):
+            mpcc.matrix_profile_diagonal(sequence, m, out=out[:2], left_right=True)
+
+    def test_timings(self):
+        """timings= records the run without changing its result, and exports a Chrome trace."""
+        rng = np.random.default_rng(14)
+        sequence = rng.standard_normal(3000).astype(np.float64)
+        m = 32
+
+        mp, mpi = mpcc.matrix_profile_diagonal(sequence, m, num_threads=2)
+        timings = mpcc.ProfileStats()
+        result = mpcc.matrix_profile_diagonal(sequence, m, num_threads=2, timings=timings)
+        np.testing.assert_array_equal(result[0], mp)
+        np.testing.assert_array_equal(result[1], mpi)
+
+        self.assertGreater(timings.wall_seconds, 0)
+        self.assertEqual(timings.diagonals, len(mp) - (m // 4 + 1))
+        self.assertEqual(len(timings.threads), 2)
+        self.assertGreater(timings.phase_seconds["diagonals"], 0)
+        self.assertLessEqual(sum(t["busy_seconds"] for t in timings.threads), 2 * timings.wall_seconds)
+        events = json.loads(timings.chrome_trace())["traceEvents"]
+        self.assertIn("diagonal tile", {e["name"] for e in events})
+
+        mpcc.matrix_profile_stomp(sequence, m, timings=timings)
+        self.assertEqual(timings.rows, len(mp))
+        self.assertEqual(timings.diagonals, 0)
+        self.assertGreater(timings.phase_seconds["dot_products"], 0)
+
+        reference = rng.standard_normal(2000)
+        expected = mpcc.matrix_profile_ab_join(sequence, reference, m, num_threads=2)
+        result = mpcc.matrix_profile_ab_join(sequence, reference, m, num_threads=2, timings=timings)
+        np.testing.assert_array_equal(result[0], expected[0])
+        np.testing.assert_array_equal(result[1], expected[1])
+        self.assertEqual(timings.rows, len(mp))
+        self.assertEqual(len(timings.threads), 2)
+        self.assertGreater(timings.phase_seconds["stats"], 0)
+
+    @unittest.skipUnless(mpcc.cuda_available(), "built without CUDA support or no CUDA device")
+    def test_cuda_matches_cpu(self):
+        """Distances match the CPU; an index may differ only on a tie to float32 rounding."""
+        sequence = np.cumsum(np.random.default_rng(15).standard_normal(5000))
+        m = 40
+        expected_mp, expected_mpi = mpcc.matrix_profile_diagonal(sequence, m)
+        for fn in (mpcc.matrix_profile_naive, mpcc.matrix_profile_stomp, mpcc.matrix_profile_diagonal):
+            mp, mpi = fn(sequence, m, device="cuda")
+            same = mpi == expected_mpi
+            self.assertGreater(same.mean(), 0.99)
+            np.testing.assert_allclose(mp[same], expected_mp[same], rtol=1e-7, atol=1e-7)
+
+            # Where the device picked another neighbor, it is at most about a float32 ulp farther.
+            np.testing.assert_allclose(mp[~same], expected_mp[~same], rtol=2.5e-7, atol=1e-7)
+            self.assertTrue((np.abs(mpi[~same] - np.flatnonzero(~same)) > m // 4).all())
+
+        mp, _ = mpcc.matrix_profile_diagonal(sequence.astype(np.float32), 40, device="cuda")
+        self.assertEqual(mp.dtype, np.float32)
+        np.testing.assert_allclose(mp, expected_mp, rtol=1e-2, atol=1e-2)
+
+    def test_device_argument(self):
+        sequence = np.random.default_rng(16).standard_normal(200)
+        with self.assertRaises(ValueError):
+            mpcc.matrix_profile_diagonal(sequence, 16, device="tpu")
+        if not mpcc.cuda_available():
+            with self.assertRaises(RuntimeError):
+                mpcc.matrix_profile_diagonal(sequence, 16, device="cuda")
+
+    def test_stomp_and_naive_threads_are_deterministic(self):
+        """The row-parallel engines also give identical results across thread counts."""
+        rng = np.random.default_rng(9)
+        sequence = rng.standard_normal(2500).astype(np.float64)
+        m = 24
+
+        for engine in (mpcc.matrix_profile_stomp, mpcc.matrix_profile_naive):
+            mp_serial, mpi_serial = engine(sequence, m, num_threads=1)
+            mp, mpi = engine(sequence, m, num_threads=4)
+            np.testing.assert_array_equal(mp,  mp_serial)
+            np.testing.assert_array_equal(mpi, mpi_serial)
+
+    def test_m_larger_than_n_raises(self):
+        """ValueError is raised when m is larger than the sequence length."""
+        with self.assertRaises(ValueError):
+            mpcc.matrix_profile_diagonal(np.ones(10, dtype=np.float64), 20)
+
+
+class TestMatrixProfileAnytime(unittest.TestCase):
+
+    def test_complete_run_matches_diagonal(self):
+        """Without PreSCRIMP a complete run is bit-identical to the diagonal engine; with it, up to rounding."""
+        rng = np.random.default_rng(60)
+        sequence = rng.standard_normal(1200)
+        expected, expected_idx = mpcc.matrix_profile_diagonal(sequence, 32)
+
+        mp, mpi = mpcc.matrix_profile_anytime(sequence, 32, prescrimp=False, num_threads=3)
+        np.testing.assert_array_equal(mp, expected)
+        np.testing.assert_array_equal(mpi, expected_idx)
+
+        mp, mpi = mpcc.matrix_profile_anytime(sequence, 32, seed=3)
+        np.testing.assert_allclose(mp, expected, rtol=1e-8, atol=1e-8)
+        np.testing.assert_array_equal(mpi, expected_idx)
+
+    def test_partial_run_is_an_upper_bound(self):
+        """A partial profile never undercuts the exact one, and is reproducible for a given seed."""
+        rng = np.random.default_rng(61)
+        sequence = rng.standard_normal(2000)
+        expected, _ = mpcc.matrix_profile_diagonal(sequence, 40)
+
+        mp, mpi = mpcc.matrix_profile_anytime(sequence, 40, fraction=0.05, seed=11)
+        self.assertTrue(np.all(mp >= expected - 1e-8))
+        self.assertTrue(np.all(mpi >= 0))
+
+        again, again_idx = mpcc.matrix_profile_anytime(sequence, 40, fraction=0.05, seed=11, num_threads=4)
+        np.testing.assert_array_equal(again, mp)
+        np.testing.assert_array_equal(again_idx, mpi)
+
+    def test_callback_reports_and_stops(self):
+        rng = np.random.default_rng(62)
+        sequence = rng.standard_normal(3000)
+        updates = []
+
+        def on_update(distances, indices, done, total):
+            updates.append((done, total, np.isfinite(distances).mean()))
+            return len(updates) < 3
+
+        mp, _ = mpcc.matrix_profile_anytime(sequence, 50, callback=on_update)
+        self.assertEqual(len(updates), 3)
+        self.assertEqual(updates[0][0], 0)
+        self.assertLess(updates[-1][0], updates[-1][1])
+        self.assertEqual(np.isfinite(mp).mean(), updates[-1][2])
+
+    def test_callback_exception_propagates(self):
+        sequence = np.random.default_rng(63).standard_normal(500)
+
+        def on_update(distances, indices, done, total):
+            raise RuntimeError("stop")
+
+        with self.assertRaises(RuntimeError):
+            mpcc.matrix_profile_anytime(sequence, 20, callback=on_update)
+
+
+class TestMatrixProfileABJoin(unittest.TestCase):
+
+    def test_distances_match_stumpy(self):
+        """AB-join distances and indices match stumpy.stump with a second series."""
+        rng = np.random.default_rng(42)
+        sequence_a = rng.standard_normal(200).astype(np.float64)
+        sequence_b = rng.standard_normal(300).astype(np.float64)
+        m = 20
+
+        mp, mpi = mpcc.matrix_profile_ab_join(sequence_a, sequence_b, m)
+        expected = stumpy.stump(sequence_a, m, sequence_b, ignore_trivial=False)
+
+        np.testing.assert_allclose(mp, expected[:, 0].astype(np.float64), rtol=1e-5)
+        np.testing.assert_array_equal(mpi, expected[:, 1].astype(np.int64))
+
+    def test_matches_similarity_search(self):
+        """Each entry is the minimum of the subsequence's distance profile over sequence_b."""
+        rng = np.random.default_rng(5)
+        sequence_a = rng.standard_normal(1500).astype(np.float64)
+        sequence_b = rng.standard_normal(1200).astype(np.float64)
+        m = 16
+
+        mp, mpi = mpcc.matrix_profile_ab_join(sequence_a, sequence_b, m, num_threads=3)
+
+        for i in range(0, len(mp), 97):
+            profile = mpcc.similarity_search(sequence_b, sequence_a[i:i + m])
+            self.assertAlmostEqual(mp[i], profile.min(), places=8)
+            self.assertEqual(mpi[i], np.argmin(profile))
+
+    def test_output_shapes(self):
+        """Outputs have one entry per subsequence of sequence_a."""
+        rng = np.random.default_rng(0)
+        mp, mpi = mpcc.matrix_profile_ab_join(rng.standard_normal(80), rng.standard_normal(30), 12)
+
+        self.assertEqual(mp.shape,  (80 - 12 + 1,))
+        self.assertEqual(mpi.shape, (80 - 12 + 1,))
+        self.assertTrue(np.all((mpi >= 0) & (mpi < 30 - 12 + 1)))
+
+    def test_m_larger_than_reference_raises(self):
+        """ValueError is raised when m is larger than either sequence."""
+        with self.assertRaises(ValueError):
+            mpcc.matrix_profile_ab_join(np.ones(50, dtype=np.float64), np.ones(10, dtype=np.float64), 20)
+        with self.assertRaises(ValueError):
+            mpcc.matrix_profile_ab_join(np.ones(10, dtype=np.float64), np.ones(50, dtype=np.float64), 20)
+
+
+class TestExclusionZone(unittest.TestCase):
+
+    def test_ceil_zone_matches_stumpy(self):
+        """exclusion_zone=ceil(m/4) reproduces stumpy.stump, distances and indices, for every engine."""
+        rng = np.random.default_rng(8)
+        sequence = rng.standard_normal(400).astype(np.float64)
+        m = 18
+        expected = stumpy.stump(sequence, m)
+
+        for engine in (mpcc.matrix_profile_naive, mpcc.matrix_profile_stomp, mpcc.matrix_profile_diagonal):
+            mp, mpi = engine(sequence, m, exclusion_zone=math.ceil(m / 4))
+            np.testing.assert_allclose(mp, expected[:, 0].astype(np.float64), rtol=1e-5)
+            np.testing.assert_array_equal(mpi, expected[:, 1].astype(np.int64))
+
+    def test_default_is_floor_quarter(self):
+        """Omitting exclusion_zone is the same as passing floor(m/4)."""
+        sequence = np.random.default_rng(2).standard_normal(300)
+        m = 18
+
+        for engine in (mpcc.matrix_profile_naive, mpcc.matrix_profile_stomp, mpcc.matrix_profile_diagonal):
+            default_mp, default_mpi = engine(sequence, m)
+            mp, mpi = engine(sequence, m, exclusion_zone=m // 4)
+            np.testing.assert_array_equal(mp, default_mp)
+            np.testing.assert_array_equal(mpi, default_mpi)
+
+    def test_wide_zone_matches_similarity_search(self):
+        """Each entry is the minimum of the distance profile outside |i - j| <= exclusion_zone."""
+        sequence = np.random.default_rng(4).standard_normal(500)
+        m, zone = 16, 40
+
+        mp, mpi = mpcc.matrix_profile_diagonal(sequence, m, num_threads=2, exclusion_zone=zone)
+        _, _, left_mp, left_mpi, right_mp, right_mpi = mpcc.matrix_profile_stomp(
+            sequence, m, left_right=True, exclusion_zone=zone)
+
+        for i in range(0, len(mp), 23):
+            profile = mpcc.similarity_search(sequence, sequence[i:i + m])
+            profile[max(i - zone, 0):i + zone + 1] = np.inf
+            self.assertAlmostEqual(mp[i], profile.min(), places=6)
+            self.assertEqual(mpi[i], np.argmin(profile))
+            self.assertTrue(left_mpi[i] == -1 or left_mpi[i] < i - zone)
+            self.assertTrue(right_mpi[i] == -1 or right_mpi[i] > i + zone)
+            self.assertAlmostEqual(mp[i], min(left_mp[i], right_mp[i]), places=6)
+
+    def test_ab_join_of_a_series_with_itself(self):
+        """An AB-join with exclusion_zone equals the self-join; without it every subsequence finds itself."""
+        sequence = np.random.default_rng(6).standard_normal(300)
+        m = 20
+
+        mp, mpi = mpcc.matrix_profile_ab_join(sequence, sequence, m, exclusion_zone=m // 4)
+        expected_mp, expected_mpi = mpcc.matrix_profile_naive(sequence, m)
+        np.testing.assert_allclose(mp, expected_mp, rtol=1e-6, atol=1e-6)
+        np.testing.assert_array_equal(mpi, expected_mpi)
+
+        _, mpi = mpcc.matrix_profile_ab_join(sequence, sequence, m)
+        np.testing.assert_array_equal(mpi, np.arange(len(sequence) - m + 1))
+
+
+class TestMatrixProfileTile(unittest.TestCase):
+
+    def test_merged_tiles_match_naive(self):
+        sequence = np.random.default_rng(75).standard_normal(1200) + 50
+        m = 24
+        profile_len = len(sequence) - m + 1
+        expected_mp, expected_mpi = mpcc.matrix_profile_naive(sequence, m)
+        stats = mpcc.SequenceStats(sequence, m)
+
+        mp, mpi = np.full(profile_len, np.inf), np.full(profile_len, -1)
+        bounds = list(range(0, profile_len, 400)) + [profile_len]
+        tiles = [((r0, r1), (c0, c1)) for r0, r1 in zip(bounds, bounds[1:]) for c0, c1 in zip(bounds, bounds[1:])]
+        for rows, cols in reversed(tiles):
+            partial_mp, partial_mpi = mpcc.matrix_profile_tile(sequence, m, rows, cols, stats=stats)
+            self.assertEqual(len(partial_mp), rows[1] - rows[0])
+            self.assertIs(mpcc.merge_profiles(mp, mpi, partial_mp, partial_mpi, offset=rows[0])[0], mp)
+
+        np.testing.assert_allclose(mp, expected_mp, rtol=1e-8, atol=1e-8)
+        np.testing.assert_array_equal(mpi, expected_mpi)
+
+    def test_ab_join_tiles_match_ab_join(self):
+        rng = np.random.default_rng(76)
+        a, b = rng.standard_normal(700), rng.standard_normal(500)
+        m = 16
+        expected_mp, expected_mpi = mpcc.matrix_profile_ab_join(a, b, m)
+
+        mp, mpi = np.full(len(a) - m + 1, np.inf), np.full(len(a) - m + 1, -1)
+        for c0 in range(0, len(b) - m + 1, 200):
+            cols = (c0, min(c0 + 200, len(b) - m + 1))
+            mpcc.merge_profiles(mp, mpi, *mpcc.matrix_profile_ab_join_tile(a, b, m, (0, len(a) - m + 1), cols))
+
+        np.testing.assert_allclose(mp, expected_mp, rtol=1e-8, atol=1e-8)
+        np.testing.assert_array_equal(mpi, expected_mpi)
+
+    def test_exclusion_and_errors(self):
+        sequence = np.random.default_rng(77).standard_normal(100)
+        # Columns 0 and 1 are inside the exclusion zone (m/4 = 1) of rows 0 and 1.
+        mp, mpi = mpcc.matrix_profile_tile(sequence, 4, (0, 4), (0, 2))
+        np.testing.assert_array_equal(mpi[:2], [-1, -1])
+        self.assertTrue(np.isinf(mp[:2]).all())
+        self.assertEqual(mpi[2], 0)
+
+        with self.assertRaises(ValueError):
+            mpcc.matrix_profile_tile(sequence, 4, (90, 100), (0, 10))
+        with self.assertRaises(ValueError):
+            mpcc.matrix_profile_tile(sequence, 4, (5, 4), (0, 10))
+        with self.assertRaises(ValueError):
+            mpcc.merge_profiles(np.full(5, np.inf), np.full(5, -1), mp, mpi, offset=2)
+        with self.assertRaises(TypeError):
+            mpcc.merge_profiles(np.full(10, np.inf), np.full(10, -1.0), mp, mpi)
+
+
+class TestMatrixProfileBatch(unittest.TestCase):
+
+    def setUp(self):
+        rng = np.random.default_rng(81)
+        # Uneven lengths, so the pool has to balance unequal tasks.
+        self.series = [np.cumsum(rng.standard_normal(n)) for n in (40, 700, 16, 2500, 300, 1200)]
+        self.m = 16
+
+    def check(self, mp, mpi, offsets):
+        self.assertEqual(mp.dtype, np.float64)
+        self.assertEqual(mpi.dtype, np.int64)
+        self.assertEqual(len(offsets), len(self.series) + 1)
+        self.assertEqual(offsets[-1], len(mp))
+        for s, series in enumerate(self.series):
+            expected_mp, expected_mpi = mpcc.matrix_profile_diagonal(series, self.m)
+            np.testing.assert_array_equal(mp[offsets[s]:offsets[s + 1]], expected_mp)
+            np.testing.assert_array_equal(mpi[offsets[s]:offsets[s + 1]], expected_mpi)
+
+    def test_list_matches_diagonal(self):
+        for num_threads in (1, 4, 0):
+            self.check(*mpcc.matrix_profile_batch(self.series, self.m, num_threads=num_threads))
+
+    def test_ragged_matches_list(self):
+        values = np.concatenate(self.series)
+        offsets = np.cumsum([0] + [len(series) for series in self.series]).astype(np.int64)
+        self.check(*mpcc.matrix_profile_batch(values, offsets, self.m, num_threads=3))
+
+    def test_float32(self):
+        series = [s.astype(np.float32) for s in self.series]
+        mp, mpi, offsets = mpcc.matrix_profile_batch(series, self.m)
+        self.assertEqual(mp.dtype, np.float32)
+        expected_mp, expected_mpi = mpcc.matrix_profile_diagonal(series[3], self.m)
+        np.testing.assert_array_equal(mp[offsets[3]:offsets[4]], expected_mp)
+        np.testing.assert_array_equal(mpi[offsets[3]:offsets[4]], expected_mpi)
+
+    def test_errors(self):
+        with self.assertRaises(ValueError):
+            mpcc.matrix_profile_batch(self.series, 41)
+        with self.assertRaises(ValueError):
+            mpcc.matrix_profile_batch(self.series, 0)
+        values = np.zeros(100)
+        for offsets in ([0, 50, 40, 100], [0, 50, 101], [], [0, -1]):
+            with self.assertRaises(ValueError):
+                mpcc.matrix_profile_batch(values, np.array(offsets, dtype=np.int64), 8)
+
+
+class TestMotifsAndDiscords(unittest.TestCase):
+
+    @staticmethod
+    def greedy(mp, mpi, k, exclusion, motifs):
+        """Repeated argmin (motifs) or argmax (discords) with the picks' zones masked out."""
+        mp = np.array(mp, dtype=np.float64)
+        valid = np.isfinite(mp) & ((mpi >= 0) if motifs else True)
+        picks = []
+        while len(picks) < k and valid.any():
+            i = int(np.flatnonzero(valid)[np.argmin(mp[valid]) if motifs else np.argmax(mp[valid])])
+            picks.append((i, int(mpi[i]), mp[i]))
+            for c in ((i, mpi[i]) if motifs else (i,)):
+                valid[max(0, c - exclusion):c + exclusion + 1] = False
+        return picks
+
+    def test_match_greedy_reference(self):
+        sequence = np.cumsum(np.random.default_rng(91).standard_normal(3000))
+        mp, mpi = mpcc.matrix_profile_diagonal(sequence, 32)
+        for k, exclusion in ((1, 8), (5, 8), (10, 32), (50, 100)):
+            motifs = mpcc.find_motifs(mp, mpi, k, exclusion)
+            discords = mpcc.find_discords(mp, mpi, k, exclusion)
+            self.assertEqual([(m.index, m.neighbor, m.distance) for m in motifs],
+                             self.greedy(mp, mpi, k, exclusion, motifs=True))
+            self.assertEqual([(d.index, d.neighbor, d.distance) for d in discords],
+                             self.greedy(mp, mpi, k, exclusion, motifs=False))
+
+    def test_float32_and_missing_neighbors(self):
+        sequence = np.random.default_rng(92).standard_normal(500).astype(np.float32)
+        mp, mpi = mpcc.matrix_profile_diagonal(sequence, 16)
+        mp[10], mpi[10] = np.inf, -1
+        discords = mpcc.find_discords(mp, mpi, 3, 16)
+        self.assertNotIn(10, [d.index for d in discords])
+        motifs = mpcc.find_motifs(mp, mpi, 500, 0)
+        self.assertNotIn(10, [m.index for m in motifs])
+        self.assertEqual(mpcc.find_motifs(mp, mpi, 0, 4), [])
+
+    def test_discords_during_sweep(self):
+        # A noisy sine with a burst of noise at 1200..1240: the top discord must overlap the burst.
+        rng = np.random.default_rng(93)
+        sequence = np.sin(2 * np.pi * np.arange(2000) / 50) + 0.05 * rng.standard_normal(2000)
+        sequence[1200:1240] = rng.standard_normal(40)
+        expected_mp, expected_mpi = mpcc.matrix_profile_stomp(sequence, 40)
+        expected = mpcc.find_discords(expected_mp, expected_mpi, 3, 40)
+        for num_threads in (1, 4):
+            mp, mpi, discords = mpcc.matrix_profile_discords(sequence, 40, 3, 40, num_threads=num_threads)
+            np.testing.assert_array_equal(mp, expected_mp)
+            np.testing.assert_array_equal(mpi, expected_mpi)
+            self.assertEqual([(d.index, d.distance) for d in discords], [(d.index, d.distance) for d in expected])
+        self.assertTrue(1160 < discords[0].index < 1240)
+
+    def test_errors(self):
+        with self.assertRaises(ValueError):
+            mpcc.find_motifs(np.zeros(10), np.zeros(9, dtype=np.int64), 1, 0)
+        with self.assertRaises(ValueError):
+            mpcc.matrix_profile_discords(np.zeros(10), 11, 1, 0)
+
+
+class TestProfileCodec(unittest.TestCase):
+
+    def setUp(self):
+        sequence = np.random.default_rng(12).standard_normal(2000)
+        self.m = 32
+        self.mp, self.mpi = mpcc.matrix_profile_diagonal(sequence, self.m)
+        self.mp[5], self.mpi[5] = np.inf, -1
+
+    def test_uint16_round_trip(self):
+        """uint16 distances are within sqrt(m) / 65534 and indices are exact; 6 bytes per entry."""
+        data = mpcc.encode_profile(self.mp, self.mpi, self.m)
+        self.assertEqual(len(data), 24 + 6 * len(self.mp))
+
+        mp, mpi, m = mpcc.decode_profile(data)
+        self.assertEqual(m, self.m)
+        np.testing.assert_array_equal(mpi, self.mpi)
+        self.assertTrue(np.isinf(mp[5]))
+        finite = np.isfinite(self.mp)
+        self.assertLessEqual(np.abs(mp[finite] - self.mp[finite]).max(), np.sqrt(self.m) / 65534 * (1 + 1e-9))
+
+    def test_float16_matches_numpy(self):
+        """float16 distances round exactly as numpy's float16 conversion does."""
+        mp, mpi, _ = mpcc.decode_profile(mpcc.encode_profile(self.mp, self.mpi, self.m, encoding="float16"))
+        np.testing.assert_array_equal(mp, self.mp.astype(np.float16).astype(np.float64))
+        np.testing.assert_array_equal(mpi, self.mpi)
+
+    def test_float32_profile(self):
+        """float32 profiles encode to the same bytes as their float64 values."""
+        mp32 = self.mp.astype(np.float32)
+        self.assertEqual(mpcc.encode_profile(mp32, self.mpi, self.m, encoding="float16"),
+                         mpcc.encode_profile(mp32.astype(np.float64), self.mpi, self.m, encoding="float16"))
+
+    def test_invalid_data_raises(self):
+        """Truncated or foreign bytes, mismatched inputs and unknown encodings raise ValueError."""
+        data = mpcc.encode_profile(self.mp, self.mpi, self.m)
+        with self.assertRaises(ValueError):
+            mpcc.decode_profile(data[:-1])
+        with self.assertRaises(ValueError):
+            mpcc.decode_profile(b"NUMPY" + data[5:])
+        with self.assertRaises(ValueError):
+            mpcc.encode_profile(self.mp, self.mpi[:-1], self.m)
+        with self.assertRaises(ValueError):
+            mpcc.encode_profile(self.mp, self.mpi, self.m, encoding="int8")
+
+
+class TestWorkspace(unittest.TestCase):
+
+    def test_results_match_without_workspace(self):
+        """Every engine gives bit-identical results with a workspace, reused across engines, sizes and dtypes."""
+        rng = np.random.default_rng(13)
+        workspace = mpcc.Workspace()
+        for n, dtype, threads in ((600, np.float64, 1), (900, np.float64, 3), (700, np.float32, 2)):
+            sequence = (rng.standard_normal(n) + 100).astype(dtype)
+            for engine in (mpcc.matrix_profile_naive, mpcc.matrix_profile_stomp, mpcc.matrix_profile_diagonal):
+                expected_mp, expected_mpi = engine(sequence, 24, num_threads=threads)
+                mp, mpi = engine(sequence, 24, num_threads=threads, workspace=workspace)
+                np.testing.assert_array_equal(mp, expected_mp)
+                np.testing.assert_array_equal(mpi, expected_mpi)
+
+            expected = mpcc.matrix_profile_diagonal(sequence, 24, left_right=True)
+            for result, want in zip(mpcc.matrix_profile_diagonal(sequence, 24, left_right=True, workspace=workspace),
+                                    expected):
+                np.testing.assert_array_equal(result, want)
+
+            other = rng.standard_normal(n // 2).astype(dtype)
+            expected_mp, expected_mpi = mpcc.matrix_profile_ab_join(sequence, other, 24, num_threads=threads)
+            mp, mpi = mpcc.matrix_profile_ab_join(sequence, other, 24, num_threads=threads, workspace=workspace)
+            np.testing.assert_array_equal(mp, expected_mp)
+            np.testing.assert_array_equal(mpi, expected_mpi)
+
+    def test_reserve_and_reuse(self):
+        """max_n sizes the buffers up front, and same-sized calls with out= leave them as they are."""
+        workspace = mpcc.Workspace(max_n=1000, num_threads=2)
+        reserved = workspace.nbytes
+        self.assertGreater(reserved, 0)
+
+        sequence = np.random.default_rng(14).standard_normal(1000)
+        out = (np.empty(1000 - 32 + 1), np.empty(1000 - 32 + 1, dtype=np.int64))
+        for _ in range(3):
+            mpcc.matrix_profile_stomp(sequence, 32, num_threads=2, out=out, workspace=workspace)
+            mpcc.matrix_profile_diagonal(sequence, 32, num_threads=2, out=out, workspace=workspace)
+        self.assertEqual(workspace.nbytes, reserved)
+
+        expected_mp, expected_mpi = mpcc.matrix_profile_diagonal(sequence, 32)
+        np.testing.assert_array_equal(out[0], expected_mp)
+        np.testing.assert_array_equal(out[1], expected_mpi)
+
+
+class TestMatrixProfileMultidim(unittest.TestCase):
+
+    def test_matches_stumpy(self):
+        rng = np.random.default_rng(70)
+        sequences = rng.standard_normal((4, 600))
+        sequences[1] += np.sin(np.arange(600) / 10)
+        m = 20
+
+        mp, mpi = mpcc.matrix_profile_multidim(sequences, m)
+        expected_mp, expected_mpi = stumpy.mstump(sequences, m)
+
+        self.assertEqual(mp.shape, (4, 600 - m + 1))
+        np.testing.assert_allclose(mp, expected_mp, rtol=1e-5, atol=1e-6)
+        np.testing.assert_array_equal(mpi, expected_mpi)
+
+    def test_single_channel_matches_stomp(self):
+        sequence = np.random.default_rng(71).standard_normal(800)
+        mp, mpi = mpcc.matrix_profile_multidim(sequence[np.newaxis, :], 16)
+        expected_mp, expected_mpi = mpcc.matrix_profile_stomp(sequence, 16)
+        np.testing.assert_allclose(mp[0], expected_mp, rtol=1e-10, atol=1e-10)
+        np.testing.assert_array_equal(mpi[0], expected_mpi)
+
+    def test_layouts_threads_and_out(self):
+        """Time-major input, other strides, threads and out= all give the same result."""
+        rng = np.random.default_rng(72)
+        sequences = rng.standard_normal((6, 1500))
+        expected_mp, expected_mpi = mpcc.matrix_profile_multidim(sequences, 24)
+
+        # The channels are sorted per column, so their order does not matter: a reversed view works too.
+        for variant, time_major in ((sequences.T.copy(), True), (np.asfortranarray(sequences), False),
+                                    (sequences[::-1], False)):
+            mp, mpi = mpcc.matrix_profile_multidim(variant, 24, time_major=time_major, num_threads=3)
+            np.testing.assert_array_equal(mp, expected_mp)
+            np.testing.assert_array_equal(mpi, expected_mpi)
+
+        out = (np.empty_like(expected_mp), np.empty_like(expected_mpi))
+        self.assertIs(mpcc.matrix_profile_multidim(sequences, 24, out=out), out)
+        np.testing.assert_array_equal(out[0], expected_mp)
+
+    def test_errors(self):
+        with self.assertRaises(ValueError):
+            mpcc.matrix_profile_multidim(np.zeros((3, 10)), 11)
+        with self.assertRaises(ValueError):
+            mpcc.matrix_profile_multidim(np.zeros((3, 10)), 0)
+
+
+class TestMatrixProfileMapped(unittest.TestCase):
+
+    def setUp(self):
+        self.dir = tempfile.TemporaryDirectory()
+        self.addCleanup(self.dir.cleanup)
+
+    def path(self, name):
+        return os.path.join(self.dir.name, name)
+
+    def test_npy_matches_diagonal(self):
+        # Long enough for several tiles per side, so tile edges and the merge across tiles are covered.
+        sequence = np.cumsum(np.random.default_rng(73).standard_normal(10000))
+        np.save(self.path("series.npy"), sequence)
+        expected_mp, expected_mpi = mpcc.matrix_profile_diagonal(sequence, 32)
+
+        for num_threads in (1, 4):
+            mpcc.matrix_profile_mapped(self.path("series.npy"), 32, self.path("mp.npy"), self.path("mpi.npy"),
+                                       num_threads=num_threads)
+            mp = np.load(self.path("mp.npy"), mmap_mode="r")
+            mpi = np.load(self.path("mpi.npy"), mmap_mode="r")
+            self.assertEqual(mp.dtype, np.float64)
+            self.assertEqual(mpi.dtype, np.int64)
+            np.testing.assert_allclose(mp, expected_mp, rtol=1e-7, atol=1e-7)
+            np.testing.assert_array_equal(mpi, expected_mpi)
+            del mp, mpi
+
+    def test_exclusion_zone_matches_diagonal(self):
+        # 5000 is wider than a tile, so whole tiles fall inside the zone.
+        sequence = np.cumsum(np.random.default_rng(75).standard_normal(10000))
+        np.save(self.path("series.npy"), sequence)
+        for zone in (2, 5000):
+            expected_mp, expected_mpi = mpcc.matrix_profile_diagonal(sequence, 16, exclusion_zone=zone)
+            mpcc.matrix_profile_mapped(self.path("series.npy"), 16, self.path("mp.npy"), self.path("mpi.npy"),
+                                       num_threads=2, exclusion_zone=zone)
+            np.testing.assert_allclose(np.load(self.path("mp.npy")), expected_mp, rtol=1e-7, atol=1e-7)
+            np.testing.assert_array_equal(np.load(self.path("mpi.npy")), expected_mpi)
+
+    def test_raw_float32(self):
+        sequence = np.random.default_rng(74).standard_normal(3000).astype(np.float32)
+        sequence.tofile(self.path("series.f32"))
+        expected_mp, expected_mpi = mpcc.matrix_profile_diagonal(sequence.astype(np.float64), 20)
+
+        mpcc.matrix_profile_mapped(self.path("series.f32"), 20, self.path("mp.bin"), self.path("mpi.bin"),
+                                   format="float32")
+        mp = np.fromfile(self.path("mp.bin"), dtype=np.float64)
+        mpi = np.fromfile(self.path("mpi.bin"), dtype=np.int64)
+        np.testing.assert_allclose(mp, expected_mp, rtol=1e-7, atol=1e-7)
+        np.testing.assert_array_equal(mpi, expected_mpi)
+
+    def test_errors(self):
+        with self.assertRaises(OSError):
+            mpcc.matrix_profile_mapped(self.path("missing.npy"), 8, self.path("mp"), self.path("mpi"))
+        np.save(self.path("matrix.npy"), np.zeros((4, 100)))
+        with self.assertRaises(ValueError):
+            mpcc.matrix_profile_mapped(self.path("matrix.npy"), 8, self.path("mp"), self.path("mpi"))
+        np.save(self.path("short.npy"), np.zeros(10))
+        with self.assertRaises(ValueError):
+            mpcc.matrix_profile_mapped(self.path("short.npy"), 11, self.path("mp"), self.path("mpi"))
+        with self.assertRaises(ValueError):
+            mpcc.matrix_profile_mapped(self.path("short.npy"), 4, self.path("mp"), self.path("mpi"), format="csv")
+
+
+class TestPanMatrixProfile(unittest.TestCase):
+
+    def test_rows_match_diagonal(self):
+        """Each row is the single-length profile, padded with inf and -1 past its own length."""
+        rng = np.random.default_rng(50)
+        sequence = rng.standard_normal(1500)
+        lengths  = [24, 8, 16, 40, 12, 9, 32]
+
+        mp, mpi = mpcc.pan_matrix_profile(sequence, lengths, num_threads=3)
+        self.assertEqual(mp.shape,  (len(lengths), len(sequence) - 8 + 1))
+        self.assertEqual(mpi.shape, mp.shape)
+        self.assertEqual(mpi.dtype, np.int64)
+
+        for row, m in enumerate(lengths):
+            profile_len = len(sequence) - m + 1
+            expected, expected_idx = mpcc.matrix_profile_diagonal(sequence, m)
+            np.testing.assert_allclose(mp[row, :profile_len], expected, rtol=1e-8, atol=1e-8)
+            np.testing.assert_array_equal(mpi[row, :profile_len], expected_idx)
+            self.assertTrue(np.all(np.isinf(mp[row, profile_len:])))
+            self.assertTrue(np.all(mpi[row, profile_len:] == -1))
+
+    def test_matches_stumpy(self):
+        rng = np.random.default_rng(51)
+        sequence = rng.standard_normal(400)
+
+        mp, mpi = mpcc.pan_matrix_profile(sequence, [10, 20])
+        expected = stumpy.stump(sequence, 20)
+        np.testing.assert_allclose(mp[1, :len(expected)], expected[:, 0].astype(np.float64), rtol=1e-5)
+
+    def test_threads_stats_and_out(self):
+        """Thread count, stats= and out= do not change the result."""
+        rng = np.random.default_rng(52)
+        sequence = rng.standard_normal(900)
+        lengths  = [6, 11, 30]
+        expected_mp, expected_mpi = mpcc.pan_matrix_profile(sequence, lengths)
+
+        out = (np.empty_like(expected_mp), np.empty_like(expected_mpi))
+        result = mpcc.pan_matrix_profile(sequence, lengths, num_threads=4,
+                                         stats=mpcc.SequenceStats(sequence, lengths), out=out)
+        self.assertIs(result, out)
+        np.testing.assert_array_equal(out[0], expected_mp)
+        np.testing.assert_array_equal(out[1], expected_mpi)
+
+    def test_on_row_reports_and_stops(self):
+        """on_row sees each row as it completes, coarse to fine, and returning False stops early."""
+        rng = np.random.default_rng(54)
+        sequence = rng.standard_normal(700)
+        lengths  = [8, 12, 16, 20, 24, 28, 32]
+        expected_mp, expected_mpi = mpcc.pan_matrix_profile(sequence, lengths)
+
+        reported = []
+        def on_row(mp, mpi, row, done, total):
+            np.testing.assert_array_equal(mp[row], expected_mp[row])
+            np.testing.assert_array_equal(mpi[row], expected_mpi[row])
+            reported.append((row, done, total))
+        mp, mpi = mpcc.pan_matrix_profile(sequence, lengths, num_threads=2, on_row=on_row)
+        self.assertEqual(sorted(row for row, _, _ in reported), list(range(len(lengths))))
+        self.assertEqual([done for _, done, _ in reported], list(range(1, len(lengths) + 1)))
+        self.assertEqual(reported[0][0], 3)  # The median length comes first.
+        np.testing.assert_array_equal(mp, expected_mp)
+
+        reported.clear()
+        mp, mpi = mpcc.pan_matrix_profile(sequence, lengths, on_row=lambda *args: reported.append(args) or False)
+        self.assertEqual(len(reported), 1)
+        unfinished = [row for row in range(len(lengths)) if row != reported[0][2]]
+        self.assertTrue(np.all(np.isinf(mp[unfinished])))
+        self.assertTrue(np.all(mpi[unfinished] == -1))
+
+    def test_on_row_exception_propagates(self):
+        sequence = np.random.default_rng(55).standard_normal(300)
+
+        def on_row(mp, mpi, row, done, total):
+            raise RuntimeError("stop")
+        with self.assertRaises(RuntimeError):
+            mpcc.pan_matrix_profile(sequence, [10, 20], on_row=on_row)
+
+    def test_errors(self):
+        sequence = np.random.default_rng(53).standard_normal(100)
+        with self.assertRaises(ValueError):
+            mpcc.pan_matrix_profile(sequence, [10, 0])
+        with self.assertRaises(ValueError):
+            mpcc.pan_matrix_profile(sequence, [10, 101])
+        with self.assertRaises(ValueError):
+            mpcc.pan_matrix_profile(sequence, [10, 20], stats=mpcc.SequenceStats(sequence, 10))
+
+
+class TestSequenceStats(unittest.TestCase):
+
+    def test_window_statistics(self):
+        """mean(m) and stddev(m) hold the population statistics of every length-m window."""
+        rng = np.random.default_rng(1)
+        sequence = rng.standard_normal(200)
+        stats = mpcc.SequenceStats(sequence, [8, 20])
+
+        self.assertEqual(stats.lengths, [8, 20])
+        self.assertEqual(stats.sequence_length, 200)
+        self.assertIn(20, stats)
+        self.assertNotIn(12, stats)
+
+        windows = np.lib.stride_tricks.sliding_window_view(sequence, 20)
+        np.testing.assert_allclose(stats.mean(20),   windows.mean(axis=1), atol=1e-12)
+        np.testing.assert_allclose(stats.stddev(20), windows.std(axis=1),  atol=1e-10)
+
+    def test_searches_match_without_stats(self):
+        """Passing stats gives exactly the same distance profiles as recomputing them."""
+        rng = np.random.default_rng(2)
+        sequence = rng.standard_normal(500)
+        m = 16
+        stats = mpcc.SequenceStats(sequence, m)
+
+        for i in (0, 123, len(sequence) - m):
+            query = sequence[i:i + m]
+            for search in (mpcc.similarity_search, mpcc.similarity_search_mass, mpcc.similarity_search_auto):
+                np.testing.assert_array_equal(search(sequence, query, stats=stats), search(sequence, query))
+
+    def test_matrix_profiles_match_without_stats(self):
+        """Every engine gives the same profile and indices with precomputed stats."""
+        rng = np.random.default_rng(3)
+        sequence = rng.standard_normal(400)
+        other    = rng.standard_normal(250)
+        m = 12
+        stats = mpcc.SequenceStats(sequence, m)
+
+        for engine in (mpcc.matrix_profile_naive, mpcc.matrix_profile_stomp, mpcc.matrix_profile_diagonal):
+            mp, mpi = engine(sequence, m, stats=stats)
+            mp_ref, mpi_ref = engine(sequence, m)
+            np.testing.assert_array_equal(mp,  mp_ref)
+            np.testing.assert_array_equal(mpi, mpi_ref)
+
+        mp, mpi = mpcc.matrix_profile_ab_join(sequence, other, m, stats_a=stats)
+        mp_ref, mpi_ref = mpcc.matrix_profile_ab_join(sequence, other, m)
+        np.testing.assert_array_equal(mp,  mp_ref)
+        np.testing.assert_array_equal(mpi, mpi_ref)
+
+    def test_mismatched_stats_raise(self):
+        """ValueError is raised when the stats do not cover the sequence or subsequence length."""
+        sequence = np.random.default_rng(4).standard_normal(100)
+        stats = mpcc.SequenceStats(sequence, 10)
+
+        with self.assertRaises(ValueError):
+            mpcc.similarity_search(sequence, sequence[:12], stats=stats)
+        with self.assertRaises(ValueError):
+            mpcc.matrix_profile_stomp(sequence[:50], 10, stats=stats)
+        with self.assertRaises(ValueError):
+            stats.mean(12)
+
+
+class TestNumericalStability(unittest.TestCase):
+
+    def test_large_offset_is_shift_invariant(self):
+        """A large DC offset does not change the distances, as z-normalization requires."""
+        rng = np.random.default_rng(6)
+        base = np.sin(np.arange(3000) * 0.05) + 0.05 * rng.standard_normal(3000)
+        shifted = base + 6.7e6
+        m = 32
+
+        np.testing.assert_allclose(mpcc.similarity_search(shifted, shifted[100:100 + m]),
+                                   mpcc.similarity_search(base, base[100:100 + m]), atol=1e-6)
+        np.testing.assert_allclose(mpcc.similarity_search_mass(shifted, shifted[100:100 + m]),
+                                   mpcc.similarity_search_mass(base, base[100:100 + m]), atol=1e-6)
+        for engine in (mpcc.matrix_profile_stomp, mpcc.matrix_profile_diagonal):
+            mp_shifted, _ = engine(shifted, m)
+            mp_base, _    = engine(base, m)
+            np.testing.assert_allclose(mp_shifted, mp_base, atol=1e-5)
+
+    def test_flat_windows_match_stumpy(self):
+        """Constant windows follow stumpy: 0 to other constant windows and sqrt(m) to the rest."""
+        rng = np.random.default_rng(7)
+        sequence = rng.standard_normal(300)
+        sequence[100:160] = 3.0
+        m = 16
+
+        mp, _ = mpcc.matrix_profile_stomp(sequence, m)
+        expected = stumpy.stump(sequence, m)
+        self.assertFalse(np.isnan(mp).any())
+        np.testing.assert_allclose(mp, expected[:, 0].astype(np.float64), rtol=1e-5, atol=1e-6)
+
+        distances = mpcc.similarity_search(sequence, sequence[110:110 + m])
+        self.assertEqual(distances[120], 0.0)
+        self.assertAlmostEqual(distances[0], np.sqrt(m))
+
+    def test_flat_windows_after_long_varying_data(self):
+        """A constant segment after thousands of varying samples is still exactly flat, whatever the offset."""
+        rng = np.random.default_rng(8)
+        for offset in (0.0, 1e3, 6.7e6):
+            sequence = np.concatenate([offset + 1000 * rng.standard_normal(5000), np.full(600, offset + 2.5)])
+            for m in (1, 8, 64):
+                flat = slice(5000, len(sequence) - m + 1)
+                self.assertTrue((mpcc.SequenceStats(sequence, m).stddev(m)[flat] == 0).all())
+
+                # Flat windows are 0 from each other, away from the edge of the segment and the exclusion zone.
+                interior = slice(5000, len(sequence) - 2 * m)
+                for engine in (mpcc.matrix_profile_stomp, mpcc.matrix_profile_diagonal):
+                    mp, _ = engine(sequence, m)
+                    np.testing.assert_array_equal(mp[interior], 0.0)
+
+                stream = mpcc.StreamingMatrixProfile(m)
+                stream.append(sequence)
+                np.testing.assert_array_equal(np.asarray(stream.mp)[interior], 0.0)
+
+
+class TestFloat32(unittest.TestCase):
+
+    def test_searches_return_float32(self):
+        """float32 inputs are searched in single precision and match the float64 result closely."""
+        rng = np.random.default_rng(20)
+        sequence = rng.standard_normal(1000)
+        query    = sequence[200:232]
+
+        for search in (mpcc.similarity_search, mpcc.similarity_search_mass, mpcc.similarity_search_auto):
+            result = search(sequence.astype(np.float32), query.astype(np.float32))
+            self.assertEqual(result.dtype, np.float32)
+            np.testing.assert_allclose(result, search(sequence, query), rtol=1e-3, atol=1e-2)
+
+    def test_matrix_profiles_return_float32(self):
+        """Every engine accepts float32 and agrees with the float64 profile."""
+        rng = np.random.default_rng(21)
+        sequence = rng.standard_normal(600)
+        other    = rng.standard_normal(300)
+        m = 20
+
+        for engine in (mpcc.matrix_profile_naive, mpcc.matrix_profile_stomp, mpcc.matrix_profile_diagonal):
+            mp, mpi = engine(sequence.astype(np.float32), m)
+            self.assertEqual(mp.dtype,  np.float32)
+            self.assertEqual(mpi.dtype, np.int64)
+            mp_ref, _ = engine(sequence, m)
+            np.testing.assert_allclose(mp, mp_ref, rtol=1e-3, atol=1e-2)
+
+        mp, _ = mpcc.matrix_profile_ab_join(sequence.astype(np.float32), other.astype(np.float32), m)
+        self.assertEqual(mp.dtype, np.float32)
+        mp_ref, _ = mpcc.matrix_profile_ab_join(sequence, other, m)
+        np.testing.assert_allclose(mp, mp_ref, rtol=1e-3, atol=1e-2)
+
+    def test_float32_stats(self):
+        """SequenceStatsFloat32 stores float32 statistics and is accepted by the float32 overloads."""
+        rng = np.random.default_rng(22)
+        sequence = rng.standard_normal(400).astype(np.float32)
+        m = 16
+        stats = mpcc.SequenceStatsFloat32(sequence, m)
+
+        self.assertEqual(stats.mean(m).dtype, np.float32)
+        np.testing.assert_array_equal(mpcc.similarity_search(sequence, sequence[:m], stats=stats),
+                                      mpcc.similarity_search(sequence, sequence[:m]))
+        mp, _ = mpcc.matrix_profile_stomp(sequence, m, stats=stats)
+        np.testing.assert_array_equal(mp, mpcc.matrix_profile_stomp(sequence, m)[0])
+
+    def test_other_inputs_use_float64(self):
+        """Lists and integer arrays still go through the float64 overloads."""
+        self.assertEqual(mpcc.similarity_search(list(range(20)), [0.0, 1.0, 0.5]).dtype, np.float64)
+        self.assertEqual(mpcc.matrix_profile_stomp(np.arange(30), 5)[0].dtype, np.float64)
+
+
+class TestOutputArraysAndStrides(unittest.TestCase):
+
+    def test_similarity_search_out(self):
+        """out= receives the distance profile and is returned as-is."""
+        rng = np.random.default_rng(30)
+        sequence = rng.standard_normal(500)
+        query    = sequence[100:132]
+
+        out    = np.empty(len(sequence) - len(query) + 1)
+        result = mpcc.similarity_search(sequence, query, out=out)
+        self.assertIs(result, out)
+        np.testing.assert_allclose(out, mpcc.similarity_search(sequence, query))
+
+    def test_matrix_profile_out(self):
+        """out=(distances, indices) receives the profile for every engine, including the AB-join."""
+        rng = np.random.default_rng(31)
+        sequence = rng.standard_normal(300)
+        m = 16
+
+        for fn in (mpcc.matrix_profile_naive, mpcc.matrix_profile_stomp, mpcc.matrix_profile_diagonal):
+            out = (np.empty(len(sequence) - m + 1), np.empty(len(sequence) - m + 1, dtype=np.int64))
+            mp, mpi = fn(sequence, m, out=out)
+            self.assertIs(mp, out[0])
+            self.assertIs(mpi, out[1])
+            expected_mp, expected_mpi = fn(sequence, m)
+            np.testing.assert_allclose(mp, expected_mp)
+            np.testing.assert_array_equal(mpi, expected_mpi)
+
+        other = rng.standard_normal(200)
+        out = (np.empty(len(sequence) - m + 1), np.empty(len(sequence) - m + 1, dtype=np.int64))
+        mpcc.matrix_profile_ab_join(sequence, other, m, out=out)
+        np.testing.assert_allclose(out[0], mpcc.matrix_profile_ab_join(sequence, other, m)[0])
+
+    def test_strided_out(self):
+        """A strided out= is written in place."""
+        rng = np.random.default_rng(32)
+        sequence = rng.standard_normal(400)
+        query    = sequence[50:70]
+
+        backing = np.zeros(2 * (len(sequence) - len(query) + 1))
+        mpcc.similarity_search(sequence, query, out=backing[::2])
+        np.testing.assert_allclose(backing[::2], mpcc.similarity_search(sequence, query))
+        np.testing.assert_array_equal(backing[1::2], 0.0)
+
+    def test_bad_out_raises(self):
+        """out= must already be the right dtype and size; it is never converted."""
+        sequence = np.random.default_rng(33).standard_normal(100)
+        query    = sequence[:10]
+
+        with self.assertRaises(TypeError):
+            mpcc.similarity_search(sequence, query, out=np.empty(91, dtype=np.int64))
+        with self.assertRaises(ValueError):
+            mpcc.similarity_search(sequence, query, out=np.empty(90))
+        with self.assertRaises(TypeError):
+            mpcc.matrix_profile_naive(sequence, 10, out=np.empty(91))
+        with self.assertRaises(TypeError):
+            mpcc.matrix_profile_naive(sequence, 10, out=(np.empty(91), np.empty(91)))
+
+    def test_strided_inputs(self):
+        """Strided, reversed and read-only inputs match their contiguous copies."""
+        rng = np.random.default_rng(34)
+        backing = rng.standard_normal(1200)
+        m = 24
+
+        read_only = backing[:600].copy()
+        read_only.flags.writeable = False
+
+        for sequence in (backing[::2], backing[::-2], read_only):
+            contiguous = np.ascontiguousarray(sequence)
+            query      = sequence[100:100 + m]
+            np.testing.assert_allclose(mpcc.similarity_search(sequence, query),
+                                       mpcc.similarity_search(contiguous, contiguous[100:100 + m]))
+            mp, mpi = mpcc.matrix_profile_stomp(sequence, m)
+            expected_mp, expected_mpi = mpcc.matrix_profile_stomp(contiguous, m)
+            np.testing.assert_allclose(mp, expected_mp)
+            np.testing.assert_array_equal(mpi, expected_mpi)
+
+
+class TestStreamingMatrixProfile(unittest.TestCase):
+
+    def test_matches_batch(self):
+        """After appending a whole series, the streaming profile equals the batch profile."""
+        rng = np.random.default_rng(12)
+        sequence = rng.standard_normal(300)
+        m = 16
+
+        stream = mpcc.StreamingMatrixProfile(m)
+        stream.append(sequence[:100])
+        for value in sequence[100:]:
+            stream.append(float(value))
+
+        mp, mpi = mpcc.matrix_profile_naive(sequence, m)
+
+        self.assertEqual(len(stream), len(sequence) - m + 1)
+        np.testing.assert_allclose(stream.mp, mp, rtol=1e-8, atol=1e-10)
+        np.testing.assert_array_equal(stream.mpi, mpi)
+
+    def test_exclusion_zone(self):
+        """exclusion_zone widens the zone as it does for the batch engines."""
+        sequence = np.random.default_rng(16).standard_normal(300)
+        m = 16
+
+        for zone in (0, 30):
+            stream = mpcc.StreamingMatrixProfile(m, exclusion_zone=zone)
+            stream.append(sequence)
+            mp, mpi = mpcc.matrix_profile_stomp(sequence, m, exclusion_zone=zone)
+            np.testing.assert_allclose(stream.mp, mp, rtol=1e-8, atol=1e-10)
+            np.testing.assert_array_equal(stream.mpi, mpi)
+
+    def test_incremental_prefixes(self):
+        """Every intermediate profile matches the batch profile of the prefix seen so far."""
+        rng = np.random.default_rng(13)
+        sequence = rng.standard_normal(120)
+        m = 10
+
+        stream = mpcc.StreamingMatrixProfile(m)
+        stream.append(sequence[:40])
+        for end in range(41, len(sequence) + 1, 13):
+            stream.append(sequence[len(stream) + m - 1:end])
+            mp, _ = mpcc.matrix_profile_naive(sequence[:end], m)
+            np.testing.assert_allclose(stream.mp, mp, rtol=1e-8, atol=1e-10)
+
+    def test_strided_and_float32_append(self):
+        """Strided views and float32 arrays append the same samples as a contiguous float64 copy."""
+        rng = np.random.default_rng(15)
+        base = rng.standard_normal(400)
+        m = 12
+
+        for values in (base[::2], base[::-3], base.astype(np.float32)[1::2]):
+            expected = mpcc.StreamingMatrixProfile(m)
+            expected.append(np.ascontiguousarray(values, dtype=np.float64))
+            stream = mpcc.StreamingMatrixProfile(m)
+            stream.append(values)
+            np.testing.assert_array_equal(stream.sequence, expected.sequence)
+            np.testing.assert_array_equal(stream.mp, expected.mp)
+            np.testing.assert_array_equal(stream.mpi, expected.mpi)
+
+    def test_views_are_zero_copy_and_read_only(self):
+        """Profile views alias the stream's storage and cannot be written to."""
+        stream = mpcc.StreamingMatrixProfile(8)
+        stream.append(np.random.default_rng(14).standard_normal(64))
+
+        view = stream.mp
+        self.assertFalse(view.flags.writeable)
+        self.assertFalse(view.flags.owndata)
+        self.assertEqual(stream.sequence.shape, (64,))
+        self.assertEqual(view.shape, (64 - 8 + 1,))
+
+    def test_short_stream_is_empty(self):
+        """No profile exists until m samples have arrived."""
+        stream = mpcc.StreamingMatrixProfile(10)
+        stream.append(np.ones(9))
+
+        self.assertEqual(len(stream), 0)
+        self.assertEqual(stream.mp.shape, (0,))
+
+    def test_m_zero_raises(self):
+        """ValueError is raised when m is 0."""
+        with self.assertRaises(ValueError):
+            mpcc.StreamingMatrixProfile(0)
+
+    def test_window_matches_batch_of_retained_samples(self):
+        """A windowed stream always equals the batch profile of its last `window` samples."""
+        rng = np.random.default_rng(15)
+        sequence = rng.standard_normal(400)
+        m, window = 12, 90
+
+        stream = mpcc.StreamingMatrixProfile(m, window=window)
+        for end in range(50, len(sequence) + 1, 17):
+            stream.append(sequence[stream.total_samples:end])
+
+            start = max(0, end - window)
+            mp, mpi = mpcc.matrix_profile_naive(sequence[start:end], m)
+
+            self.assertEqual(stream.offset, start)
+            np.testing.assert_array_equal(stream.sequence, sequence[start:end])
+            np.testing.assert_allclose(stream.mp, mp, rtol=1e-7, atol=1e-9)
+            np.testing.assert_array_equal(stream.mpi, np.where(mpi >= 0, mpi + start, -1))
+
+    def test_window_bounds_storage(self):
+        """However long the stream runs, a windowed stream retains at most `window` samples."""
+        stream = mpcc.StreamingMatrixProfile(8, window=64)
+        stream.append(np.random.default_rng(16).standard_normal(5000))
+
+        self.assertEqual(len(stream.sequence), 64)
+        self.assertEqual(len(stream), 64 - 8 + 1)
+        self.assertEqual(stream.offset, 5000 - 64)
+
+    def test_left_right_profiles(self):
+        """The overall profile is the closer of the left and right profiles."""
+        stream = mpcc.StreamingMatrixProfile(10, window=100)
+        stream.append(np.random.default_rng(17).standard_normal(300))
+
+        np.testing.assert_array_equal(stream.mp, np.minimum(stream.left_mp, stream.right_mp))
+        self.assertTrue(np.all((stream.left_mpi == -1) | (stream.left_mpi < stream.offset + np.arange(len(stream)))))
+        self.assertTrue(np.all((stream.right_mpi == -1) | (stream.right_mpi > stream.offset + np.arange(len(stream)))))
+
+    def test_window_shorter_than_m_raises(self):
+        """ValueError is raised when the window cannot hold one subsequence."""
+        with self.assertRaises(ValueError):
+            mpcc.StreamingMatrixProfile(10, window=5)
+
+
 if __name__ == "__main__":
     unittest.main()
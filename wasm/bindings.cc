@@ -1,100 +1,761 @@
 #include <emscripten/bind.h>
 #include <emscripten/val.h>
 
+#include <algorithm>
+#include <array>
 #include <cstdint>
 #include <stdexcept>
+#include <string>
+#include <type_traits>
 #include <vector>
 
 #include <xtensor/containers/xadapt.hpp>
 
+#include "core/anytime_matrix_profile.h"
+#include "core/instrumentation.h"
 #include "core/matrix_profile.h"
+#include "core/motifs.h"
+#include "core/multidim_matrix_profile.h"
+#include "core/workspace.h"
 
 using namespace emscripten;
 
-// Accepts any JS array-like (Array or TypedArray) and returns a Float64Array
-// of the z-normalized distance profile of query over sequence.
-static val similarity_search(val sequence_val, val query_val) {
+// Every function is bound in double precision and, with an F32 suffix, in single precision (T = float),
+// which takes and returns Float32Array distances.
+template <class T>
+static val typed_array_class() {
+    return val::global(std::is_same_v<T, float> ? "Float32Array" : "Float64Array");
+}
+
+// Non-owning 1-D xtensor view of n values at data.
+template <class T>
+static auto adapt_1d(T* data, size_t n) {
+    return xt::adapt(data, n, xt::no_ownership(), std::vector<size_t>{n});
+}
+
+// A fixed-length array that lives in the WASM heap, bound as Float64Buffer, Float32Buffer and Int32Buffer.
+// JS fills it through view(), a typed array over the module memory, and passes the buffer itself to the
+// *Into functions, which read their inputs from and write their results to such buffers in place, so
+// repeated calls copy nothing across the JS boundary. Growing the heap detaches existing views, so take a
+// fresh view() after any call that may allocate. Owned by JS; call .delete() when done.
+template <class T>
+class HeapBuffer {
+public:
+    explicit HeapBuffer(size_t size) : data_(size) {}
+
+    size_t size() const { return data_.size(); }
+    T*     data()       { return data_.data(); }
+
+    val view() { return val(typed_memory_view(data_.size(), data_.data())); }
+
+private:
+    std::vector<T> data_;
+};
+
+static void throw_on_failure(MPCC::SimilaritySearchStatus status) {
+    switch (status) {
+        case MPCC::SimilaritySearchStatus::Success:
+            return;
+        case MPCC::SimilaritySearchStatus::QueryLongerThanSequence:
+            throw std::invalid_argument("query must not be longer than sequence");
+        case MPCC::SimilaritySearchStatus::DistanceWrongSize:
+            throw std::invalid_argument("distances must have length n - m + 1");
+        case MPCC::SimilaritySearchStatus::StatsMismatch:
+            throw std::invalid_argument("stats were not computed for this sequence length and query length");
+        default:
+            throw std::runtime_error("similarity search failed");
+    }
+}
+
+static void throw_on_failure(MPCC::MatrixProfileStatus status) {
+    switch (status) {
+        case MPCC::MatrixProfileStatus::Success:
+            return;
+        case MPCC::MatrixProfileStatus::SubsequenceLengthZero:
+            throw std::invalid_argument("m must be greater than 0");
+        case MPCC::MatrixProfileStatus::SubsequenceLongerThanSequence:
+            throw std::invalid_argument("m must not be larger than sequence length");
+        case MPCC::MatrixProfileStatus::SubsequenceLongerThanReference:
+            throw std::invalid_argument("m must not be larger than reference sequence length");
+        case MPCC::MatrixProfileStatus::DistanceWrongSize:
+            throw std::invalid_argument("distances must have length n - m + 1");
+        case MPCC::MatrixProfileStatus::IndexWrongSize:
+            throw std::invalid_argument("indices must have length n - m + 1");
+        default:
+            throw std::runtime_error("matrix profile computation failed");
+    }
+}
+
+// The similarity searches, as function objects so each can be bound over JS arrays and heap buffers alike.
+struct Search {
+    template <class S, class Q, class D>
+    MPCC::SimilaritySearchStatus operator()(S& seq, Q& qry, D& dist) const {
+        return MPCC::similaritySearch(seq, qry, dist);
+    }
+};
+
+struct SearchMass {
+    template <class S, class Q, class D>
+    MPCC::SimilaritySearchStatus operator()(S& seq, Q& qry, D& dist) const {
+        return MPCC::similaritySearchMass(seq, qry, dist);
+    }
+};
+
+struct SearchAuto {
+    template <class S, class Q, class D>
+    MPCC::SimilaritySearchStatus operator()(S& seq, Q& qry, D& dist) const {
+        return MPCC::similaritySearchAuto(seq, qry, dist);
+    }
+};
+
+template <class T>
+struct SearchWithStats {
+    const MPCC::BasicSequenceStats<T>& stats;
+
+    template <class S, class Q, class D>
+    MPCC::SimilaritySearchStatus operator()(S& seq, Q& qry, D& dist) const {
+        return MPCC::similaritySearch(seq, qry, stats, dist);
+    }
+};
+
+// Runs search over the n values of seq and m values of qry, writing the distance profile to the dist_len
+// values of dist (which must be n-m+1).
+template <class T, class SearchFn>
+static void run_similarity_search(T* seq, size_t n, T* qry, size_t m, T* dist, size_t dist_len, SearchFn search) {
+    auto seq_xt  = adapt_1d(seq,  n);
+    auto qry_xt  = adapt_1d(qry,  m);
+    auto dist_xt = adapt_1d(dist, dist_len);
+    throw_on_failure(search(seq_xt, qry_xt, dist_xt));
+}
+
+// Runs the given similarity search over any JS array-like (Array or TypedArray) sequence and query,
+// returning a Float64Array (Float32Array for T = float) of the z-normalized distance profile of query over
+// sequence.
+template <class T, class SearchFn>
+static val compute_similarity_search(val sequence_val, val query_val, SearchFn search) {
     // convertJSArrayToNumberVector does a bulk typed-array copy when possible,
     // falling back to element-wise conversion for plain JS Arrays.
-    std::vector<double> seq = convertJSArrayToNumberVector<double>(sequence_val);
-    std::vector<double> qry = convertJSArrayToNumberVector<double>(query_val);
+    std::vector<T> seq = convertJSArrayToNumberVector<T>(sequence_val);
+    std::vector<T> qry = convertJSArrayToNumberVector<T>(query_val);
 
     const size_t n = seq.size();
     const size_t m = qry.size();
 
     if (m > n) throw std::invalid_argument("query must not be longer than sequence");
 
-    const size_t out_size = n - m + 1;
+    std::vector<T> dist(n - m + 1);
+    run_similarity_search(seq.data(), n, qry.data(), m, dist.data(), dist.size(), search);
 
-    auto seq_xt  = xt::adapt(seq.data(),  n,        xt::no_ownership(), std::vector<size_t>{n});
-    auto qry_xt  = xt::adapt(qry.data(),  m,        xt::no_ownership(), std::vector<size_t>{m});
+    // Copy the result into a new JS typed array and return it.
+    return typed_array_class<T>().new_(typed_memory_view(dist.size(), dist.data()));
+}
 
-    std::vector<double> dist(out_size);
-    auto dist_xt = xt::adapt(dist.data(), out_size, xt::no_ownership(), std::vector<size_t>{out_size});
+template <class T, class SearchFn>
+static val similarity_search(val sequence_val, val query_val) {
+    return compute_similarity_search<T>(sequence_val, query_val, SearchFn{});
+}
+
+// Like similarity_search, but over heap buffers, writing into distances (length n-m+1).
+template <class T, class SearchFn>
+static void similarity_search_into(HeapBuffer<T>& sequence, HeapBuffer<T>& query, HeapBuffer<T>& distances) {
+    run_similarity_search(sequence.data(), sequence.size(), query.data(), query.size(),
+                          distances.data(), distances.size(), SearchFn{});
+}
+
+// Precomputes window statistics of sequence for every subsequence length in lengths_val (a JS number or
+// array of numbers). Owned by JS; call .delete() when done.
+template <class T>
+static MPCC::BasicSequenceStats<T>* make_sequence_stats(val sequence_val, val lengths_val) {
+    std::vector<T> seq = convertJSArrayToNumberVector<T>(sequence_val);
+    std::vector<size_t> lengths = lengths_val.isNumber()
+        ? std::vector<size_t>{lengths_val.as<size_t>()}
+        : convertJSArrayToNumberVector<size_t>(lengths_val);
 
-    const auto status = MPCC::similaritySearch(seq_xt, qry_xt, dist_xt);
-    if (status != MPCC::SimilaritySearchStatus::Success) {
-        switch (status) {
-            case MPCC::SimilaritySearchStatus::QueryLongerThanSequence:
-                throw std::invalid_argument("query must not be longer than sequence");
-            default:
-                throw std::runtime_error("similarity search failed");
-        }
+    for (const size_t m : lengths) {
+        if (m == 0)          throw std::invalid_argument("subsequence lengths must be greater than 0");
+        if (m > seq.size())  throw std::invalid_argument("subsequence lengths must not be larger than sequence length");
     }
 
-    // Copy the result into a new JS Float64Array and return it.
-    return val::global("Float64Array").new_(typed_memory_view(out_size, dist.data()));
+    auto seq_xt = adapt_1d(seq.data(), seq.size());
+    return new MPCC::BasicSequenceStats<T>(seq_xt, std::span<const size_t>(lengths));
+}
+
+template <class T>
+static val similarity_search_with_stats(val sequence_val, val query_val, const MPCC::BasicSequenceStats<T>& stats) {
+    return compute_similarity_search<T>(sequence_val, query_val, SearchWithStats<T>{stats});
+}
+
+template <class T>
+static void similarity_search_with_stats_into(
+    HeapBuffer<T>& sequence, HeapBuffer<T>& query, const MPCC::BasicSequenceStats<T>& stats, HeapBuffer<T>& distances
+) {
+    run_similarity_search(sequence.data(), sequence.size(), query.data(), query.size(),
+                          distances.data(), distances.size(), SearchWithStats<T>{stats});
 }
 
 // Returned by matrixProfileNaive as a JS object with two typed-array fields.
 struct MatrixProfileResult {
-    val distances;  // Float64Array: z-normalized distance to nearest non-trivial neighbor
+    val distances;  // Float64Array (Float32Array from *F32): z-normalized distance to nearest non-trivial neighbor
     val indices;    // Int32Array:   starting index of that neighbor (-1 if none)
 };
 
-// Accepts any JS array-like sequence and a subsequence length m.
-// Returns { distances: Float64Array, indices: Int32Array } of length n-m+1.
-static MatrixProfileResult matrix_profile_naive(val sequence_val, size_t m) {
-    std::vector<double> seq = convertJSArrayToNumberVector<double>(sequence_val);
+// Whether this build was linked with pthreads (the mpcc_wasm_threaded target).
+static bool threads_enabled() {
+#ifdef __EMSCRIPTEN_PTHREADS__
+    return true;
+#else
+    return false;
+#endif
+}
+
+// Name of the kernel backend compiled into this build: "simd128" for the -msimd128 variants, else "scalar".
+static std::string simd_backend() {
+    return MPCC::simdBackend();
+}
+
+// The number of threads a request can actually use. Without pthreads std::thread cannot start, so everything
+// runs on the calling thread. With pthreads the worker pool is sized to navigator.hardwareConcurrency, and a
+// thread beyond it would wait for a worker that the blocked caller can never start, so requests are capped.
+static size_t usable_threads(size_t num_threads) {
+    if (!threads_enabled()) return 1;
+    return std::min(MPCC::resolveThreadCount(num_threads), MPCC::resolveThreadCount(0));
+}
+
+// Wraps an optional JS function(done, total) as a core progress callback. The core only calls it on the
+// calling thread, which owns the JS state even in the pthreads build.
+static MPCC::ProgressCallback progress_callback(val on_progress) {
+    if (on_progress.isUndefined() || on_progress.isNull()) return {};
+    return [on_progress](size_t done, size_t total) {
+        on_progress(static_cast<double>(done), static_cast<double>(total));
+    };
+}
+
+// The self-join engines, as function objects so each can be bound over JS arrays and heap buffers alike. The
+// *Into functions may pass a Workspace (bound as Workspace, without a pool: pthread builds only have so many
+// threads to hand out), so heap-buffer calls repeated with one allocate nothing on a single thread.
+struct Naive {
+    template <class S, class D, class I>
+    MPCC::MatrixProfileStatus operator()(S& seq, size_t m, D& mp, I& mpi, size_t num_threads,
+                                         const MPCC::ProgressCallback& progress,
+                                         MPCC::Workspace* workspace = nullptr) const {
+        return MPCC::matrixProfileNaive(seq, m, mp, mpi, num_threads, progress, MPCC::QuarterExclusion{}, workspace);
+    }
+};
+
+struct Stomp {
+    template <class S, class D, class I, class Instr = MPCC::NoInstrumentation>
+    MPCC::MatrixProfileStatus operator()(S& seq, size_t m, D& mp, I& mpi, size_t num_threads,
+                                         const MPCC::ProgressCallback& progress,
+                                         MPCC::Workspace* workspace = nullptr, Instr instr = {}) const {
+        return MPCC::matrixProfileStomp(seq, m, mp, mpi, num_threads, progress, instr, MPCC::QuarterExclusion{},
+                                        workspace);
+    }
+};
+
+struct Diagonal {
+    template <class S, class D, class I, class Instr = MPCC::NoInstrumentation>
+    MPCC::MatrixProfileStatus operator()(S& seq, size_t m, D& mp, I& mpi, size_t num_threads,
+                                         const MPCC::ProgressCallback& progress,
+                                         MPCC::Workspace* workspace = nullptr, Instr instr = {}) const {
+        return MPCC::matrixProfileDiagonal(seq, m, mp, mpi, num_threads, progress, instr, MPCC::QuarterExclusion{},
+                                           workspace);
+    }
+};
+
+// Runs engine over the n values of seq, writing the profile to the profile_len values of mp and mpi.
+template <class T, class Engine>
+static void run_matrix_profile(T* seq, size_t n, size_t m, T* mp, int32_t* mpi, size_t profile_len,
+                               size_t num_threads, val on_progress, Engine engine,
+                               MPCC::Workspace* workspace = nullptr) {
+    auto seq_xt = adapt_1d(seq, n);
+    auto mp_xt  = adapt_1d(mp,  profile_len);
+    auto mpi_xt = adapt_1d(mpi, profile_len);
+    throw_on_failure(engine(seq_xt, m, mp_xt, mpi_xt, usable_threads(num_threads), progress_callback(on_progress),
+                            workspace));
+}
+
+// Runs the given matrix profile engine over any JS array-like sequence with subsequence length m, copying
+// the results into a { distances, indices } object of length n-m+1. The matrix profile functions take
+// (..., numThreads, onProgress); numThreads = 0 uses every core the build can use.
+template <class T, class Engine>
+static MatrixProfileResult matrix_profile(val sequence_val, size_t m, size_t num_threads, val on_progress) {
+    std::vector<T> seq = convertJSArrayToNumberVector<T>(sequence_val);
+    const size_t n = seq.size();
+
+    if (m == 0) throw std::invalid_argument("m must be greater than 0");
+    if (m > n)  throw std::invalid_argument("m must not be larger than sequence length");
+
+    const size_t profile_len = n - m + 1;
+    std::vector<T>       mp(profile_len);
+    std::vector<int32_t> mpi(profile_len);
+    run_matrix_profile(seq.data(), n, m, mp.data(), mpi.data(), profile_len, num_threads, on_progress, Engine{});
+
+    // Copy results into new JS typed arrays before the C++ vectors are freed.
+    return {
+        typed_array_class<T>().new_(typed_memory_view(profile_len, mp.data())),
+        val::global("Int32Array").new_(typed_memory_view(profile_len, mpi.data())),
+    };
+}
+
+// ProfileStats as a plain JS object: { wallMs, phasesMs: { stats, centering, ... }, rows, diagonals,
+// threads: [{ busyMs, tasks, rows, diagonals }], chromeTrace }, with chromeTrace the Chrome trace JSON string.
+static val profile_stats_object(const MPCC::ProfileStats& stats) {
+    val phases = val::object();
+    for (size_t p = 0; p < MPCC::kNumPhases; p++) {
+        const auto phase = static_cast<MPCC::Phase>(p);
+        phases.set(MPCC::phaseName(phase), stats.phaseSeconds(phase) * 1e3);
+    }
+
+    val threads = val::array();
+    for (const auto& t : stats.threads) {
+        val thread = val::object();
+        thread.set("busyMs",    t.busy_seconds * 1e3);
+        thread.set("tasks",     static_cast<double>(t.tasks));
+        thread.set("rows",      static_cast<double>(t.rows));
+        thread.set("diagonals", static_cast<double>(t.diagonals));
+        threads.call<void>("push", thread);
+    }
+
+    val out = val::object();
+    out.set("wallMs",      stats.wall_seconds * 1e3);
+    out.set("phasesMs",    phases);
+    out.set("rows",        static_cast<double>(stats.rows()));
+    out.set("diagonals",   static_cast<double>(stats.diagonals()));
+    out.set("threads",     threads);
+    out.set("chromeTrace", stats.chromeTrace());
+    return out;
+}
+
+// matrix_profile with instrumentation: returns { distances, indices, timings }, with timings as described for
+// profile_stats_object.
+template <class T, class Engine>
+static val matrix_profile_profiled(val sequence_val, size_t m, size_t num_threads, val on_progress) {
+    std::vector<T> seq = convertJSArrayToNumberVector<T>(sequence_val);
     const size_t n = seq.size();
 
     if (m == 0) throw std::invalid_argument("m must be greater than 0");
     if (m > n)  throw std::invalid_argument("m must not be larger than sequence length");
 
     const size_t profile_len = n - m + 1;
+    std::vector<T>       mp(profile_len);
+    std::vector<int32_t> mpi(profile_len);
+
+    auto seq_xt = adapt_1d(seq.data(), n);
+    auto mp_xt  = adapt_1d(mp.data(),  profile_len);
+    auto mpi_xt = adapt_1d(mpi.data(), profile_len);
+
+    MPCC::ProfileStats stats;
+    throw_on_failure(Engine{}(seq_xt, m, mp_xt, mpi_xt, usable_threads(num_threads), progress_callback(on_progress),
+                              nullptr, MPCC::Instrumented(stats)));
+
+    val out = val::object();
+    out.set("distances", typed_array_class<T>().new_(typed_memory_view(profile_len, mp.data())));
+    out.set("indices",   val::global("Int32Array").new_(typed_memory_view(profile_len, mpi.data())));
+    out.set("timings",   profile_stats_object(stats));
+    return out;
+}
+
+// Like matrix_profile, but over heap buffers, writing into distances and indices (length n-m+1).
+template <class T, class Engine>
+static void matrix_profile_into(HeapBuffer<T>& sequence, size_t m, HeapBuffer<T>& distances,
+                                HeapBuffer<int32_t>& indices, size_t num_threads, val on_progress) {
+    if (indices.size() != distances.size()) throw std::invalid_argument("indices must have length n - m + 1");
+
+    run_matrix_profile(sequence.data(), sequence.size(), m, distances.data(), indices.data(), distances.size(),
+                       num_threads, on_progress, Engine{});
+}
+
+// matrix_profile_into taking its scratch memory from workspace.
+template <class T, class Engine>
+static void matrix_profile_with_workspace_into(HeapBuffer<T>& sequence, size_t m, HeapBuffer<T>& distances,
+                                               HeapBuffer<int32_t>& indices, size_t num_threads, val on_progress,
+                                               MPCC::Workspace& workspace) {
+    if (indices.size() != distances.size()) throw std::invalid_argument("indices must have length n - m + 1");
+
+    run_matrix_profile(sequence.data(), sequence.size(), m, distances.data(), indices.data(), distances.size(),
+                       num_threads, on_progress, Engine{}, &workspace);
+}
+
+// The original two-argument form of each self-join function: one thread, no progress.
+template <MatrixProfileResult (*Fn)(val, size_t, size_t, val)>
+static MatrixProfileResult single_threaded(val sequence_val, size_t m) {
+    return Fn(sequence_val, m, 1, val::undefined());
+}
+
+template <class T, void (*Fn)(HeapBuffer<T>&, size_t, HeapBuffer<T>&, HeapBuffer<int32_t>&, size_t, val)>
+static void single_threaded_into(HeapBuffer<T>& sequence, size_t m, HeapBuffer<T>& distances,
+                                 HeapBuffer<int32_t>& indices) {
+    Fn(sequence, m, distances, indices, 1, val::undefined());
+}
+
+// AB-join of the n_a values of a against the n_b values of b, writing the profile (length n_a-m+1, indices
+// into b) to mp and mpi.
+template <class T, class Instr = MPCC::NoInstrumentation>
+static void run_ab_join(T* a, size_t n_a, T* b, size_t n_b, size_t m, T* mp, int32_t* mpi, size_t profile_len,
+                        size_t num_threads, val on_progress, MPCC::Workspace* workspace = nullptr,
+                        Instr instr = {}) {
+    auto a_xt   = adapt_1d(a,   n_a);
+    auto b_xt   = adapt_1d(b,   n_b);
+    auto mp_xt  = adapt_1d(mp,  profile_len);
+    auto mpi_xt = adapt_1d(mpi, profile_len);
+    throw_on_failure(MPCC::matrixProfileABJoin(a_xt, b_xt, m, mp_xt, mpi_xt, usable_threads(num_threads),
+                                               progress_callback(on_progress), instr, MPCC::NoExclusion{},
+                                               workspace));
+}
+
+// AB-join of sequence_a against sequence_b. Returns { distances, indices } of length n_a-m+1, where
+// indices point into sequence_b.
+template <class T>
+static MatrixProfileResult matrix_profile_ab_join(
+    val sequence_a_val, val sequence_b_val, size_t m, size_t num_threads, val on_progress
+) {
+    std::vector<T> seq_a = convertJSArrayToNumberVector<T>(sequence_a_val);
+    std::vector<T> seq_b = convertJSArrayToNumberVector<T>(sequence_b_val);
+    const size_t n_a = seq_a.size();
+    const size_t n_b = seq_b.size();
+
+    if (m == 0)  throw std::invalid_argument("m must be greater than 0");
+    if (m > n_a) throw std::invalid_argument("m must not be larger than sequence length");
+    if (m > n_b) throw std::invalid_argument("m must not be larger than reference sequence length");
+
+    const size_t profile_len = n_a - m + 1;
+    std::vector<T>       mp(profile_len);
+    std::vector<int32_t> mpi(profile_len);
+    run_ab_join(seq_a.data(), n_a, seq_b.data(), n_b, m, mp.data(), mpi.data(), profile_len, num_threads,
+                on_progress);
+
+    return {
+        typed_array_class<T>().new_(typed_memory_view(profile_len, mp.data())),
+        val::global("Int32Array").new_(typed_memory_view(profile_len, mpi.data())),
+    };
+}
+
+// matrix_profile_ab_join with instrumentation: returns { distances, indices, timings }, as
+// matrix_profile_profiled does.
+template <class T>
+static val matrix_profile_ab_join_profiled(
+    val sequence_a_val, val sequence_b_val, size_t m, size_t num_threads, val on_progress
+) {
+    std::vector<T> seq_a = convertJSArrayToNumberVector<T>(sequence_a_val);
+    std::vector<T> seq_b = convertJSArrayToNumberVector<T>(sequence_b_val);
+    const size_t n_a = seq_a.size();
+    const size_t n_b = seq_b.size();
+
+    if (m == 0)  throw std::invalid_argument("m must be greater than 0");
+    if (m > n_a) throw std::invalid_argument("m must not be larger than sequence length");
+    if (m > n_b) throw std::invalid_argument("m must not be larger than reference sequence length");
+
+    const size_t profile_len = n_a - m + 1;
+    std::vector<T>       mp(profile_len);
+    std::vector<int32_t> mpi(profile_len);
+
+    MPCC::ProfileStats stats;
+    run_ab_join(seq_a.data(), n_a, seq_b.data(), n_b, m, mp.data(), mpi.data(), profile_len, num_threads,
+                on_progress, nullptr, MPCC::Instrumented(stats));
+
+    val out = val::object();
+    out.set("distances", typed_array_class<T>().new_(typed_memory_view(profile_len, mp.data())));
+    out.set("indices",   val::global("Int32Array").new_(typed_memory_view(profile_len, mpi.data())));
+    out.set("timings",   profile_stats_object(stats));
+    return out;
+}
+
+template <class T>
+static MatrixProfileResult matrix_profile_ab_join_single_threaded(val sequence_a_val, val sequence_b_val, size_t m) {
+    return matrix_profile_ab_join<T>(sequence_a_val, sequence_b_val, m, 1, val::undefined());
+}
+
+template <class T>
+static void matrix_profile_ab_join_into(HeapBuffer<T>& sequence_a, HeapBuffer<T>& sequence_b, size_t m,
+                                        HeapBuffer<T>& distances, HeapBuffer<int32_t>& indices,
+                                        size_t num_threads, val on_progress) {
+    if (indices.size() != distances.size()) throw std::invalid_argument("indices must have length n - m + 1");
+
+    run_ab_join(sequence_a.data(), sequence_a.size(), sequence_b.data(), sequence_b.size(), m,
+                distances.data(), indices.data(), distances.size(), num_threads, on_progress);
+}
+
+template <class T>
+static void matrix_profile_ab_join_with_workspace_into(HeapBuffer<T>& sequence_a, HeapBuffer<T>& sequence_b, size_t m,
+                                                       HeapBuffer<T>& distances, HeapBuffer<int32_t>& indices,
+                                                       size_t num_threads, val on_progress,
+                                                       MPCC::Workspace& workspace) {
+    if (indices.size() != distances.size()) throw std::invalid_argument("indices must have length n - m + 1");
+
+    run_ab_join(sequence_a.data(), sequence_a.size(), sequence_b.data(), sequence_b.size(), m,
+                distances.data(), indices.data(), distances.size(), num_threads, on_progress, &workspace);
+}
+
+template <class T>
+static void matrix_profile_ab_join_single_threaded_into(HeapBuffer<T>& sequence_a, HeapBuffer<T>& sequence_b,
+                                                        size_t m, HeapBuffer<T>& distances,
+                                                        HeapBuffer<int32_t>& indices) {
+    matrix_profile_ab_join_into<T>(sequence_a, sequence_b, m, distances, indices, 1, val::undefined());
+}
+
+// Multidimensional (mSTAMP) profile of channels, a JS array of d equally long array-likes. Returns
+// { distances, indices } of length d * (n-m+1), row-major: entries [(k-1) * (n-m+1), k * (n-m+1)) hold the
+// k-dimensional profile.
+template <class T>
+static MatrixProfileResult matrix_profile_multidim(val channels, size_t m, size_t num_threads, val on_progress) {
+    const size_t d = channels["length"].as<size_t>();
+    std::vector<T> samples;
+    size_t n = 0;
+    for (size_t c = 0; c < d; c++) {
+        const std::vector<T> channel = convertJSArrayToNumberVector<T>(channels[c]);
+        if (c == 0) n = channel.size();
+        if (channel.size() != n) throw std::invalid_argument("channels must all have the same length");
+        samples.insert(samples.end(), channel.begin(), channel.end());
+    }
+
+    if (m == 0) throw std::invalid_argument("m must be greater than 0");
+    if (m > n)  throw std::invalid_argument("m must not be larger than sequence length");
+
+    const size_t profile_len = n - m + 1;
+    std::vector<T>       mp(d * profile_len);
+    std::vector<int32_t> mpi(d * profile_len);
+
+    const std::array<size_t, 2> shape{d, n}, profile_shape{d, profile_len};
+    const auto seq_xt = xt::adapt(samples.data(), samples.size(), xt::no_ownership(), shape);
+    auto       mp_xt  = xt::adapt(mp.data(),  mp.size(),  xt::no_ownership(), profile_shape);
+    auto       mpi_xt = xt::adapt(mpi.data(), mpi.size(), xt::no_ownership(), profile_shape);
+    throw_on_failure(MPCC::matrixProfileMultidim(seq_xt, m, mp_xt, mpi_xt, MPCC::ChannelLayout::ChannelMajor,
+                                                 usable_threads(num_threads), progress_callback(on_progress)));
 
-    auto seq_xt = xt::adapt(seq.data(), n, xt::no_ownership(), std::vector<size_t>{n});
+    return {
+        typed_array_class<T>().new_(typed_memory_view(mp.size(), mp.data())),
+        val::global("Int32Array").new_(typed_memory_view(mpi.size(), mpi.data())),
+    };
+}
 
-    std::vector<double>  mp_data(profile_len);
-    std::vector<int32_t> mpi_data(profile_len);
+template <class T>
+static MatrixProfileResult matrix_profile_multidim_single_threaded(val channels, size_t m) {
+    return matrix_profile_multidim<T>(channels, m, 1, val::undefined());
+}
+
+// Reads the optional { fraction, timeBudgetMs, prescrimp, seed } object of matrixProfileAnytime; missing
+// fields keep the core defaults.
+static MPCC::AnytimeOptions anytime_options(val options) {
+    MPCC::AnytimeOptions out;
+    if (options.isUndefined() || options.isNull()) return out;
 
-    auto mp_xt  = xt::adapt(mp_data.data(),  profile_len, xt::no_ownership(), std::vector<size_t>{profile_len});
-    auto mpi_xt = xt::adapt(mpi_data.data(), profile_len, xt::no_ownership(), std::vector<size_t>{profile_len});
+    if (const val v = options["fraction"];     !v.isUndefined()) out.fraction       = v.as<double>();
+    if (const val v = options["timeBudgetMs"]; !v.isUndefined()) out.time_budget_ms = v.as<double>();
+    if (const val v = options["prescrimp"];    !v.isUndefined()) out.prescrimp      = v.as<bool>();
+    if (const val v = options["seed"];         !v.isUndefined()) out.seed = static_cast<uint64_t>(v.as<double>());
+    return out;
+}
+
+// Anytime (SCRIMP++) self-join over any JS array-like sequence. onUpdate(distances, indices, done, total) is
+// called with the current approximation after PreSCRIMP and after each round of diagonals, as typed-array
+// views into the WASM heap that are only valid during the call (copy them to keep them); returning false
+// stops early. Returns { distances, indices } of length n-m+1 holding the last approximation.
+template <class T>
+static MatrixProfileResult matrix_profile_anytime(val sequence_val, size_t m, val options, size_t num_threads,
+                                                  val on_update) {
+    std::vector<T> seq = convertJSArrayToNumberVector<T>(sequence_val);
+    const size_t n = seq.size();
+
+    if (m == 0) throw std::invalid_argument("m must be greater than 0");
+    if (m > n)  throw std::invalid_argument("m must not be larger than sequence length");
 
-    const auto status = MPCC::matrixProfileNaive(seq_xt, m, mp_xt, mpi_xt);
-    if (status != MPCC::MatrixProfileStatus::Success) {
-        switch (status) {
-            case MPCC::MatrixProfileStatus::SubsequenceLengthZero:
-                throw std::invalid_argument("m must be greater than 0");
-            case MPCC::MatrixProfileStatus::SubsequenceLongerThanSequence:
-                throw std::invalid_argument("m must not be larger than sequence length");
-            default:
-                throw std::runtime_error("matrix profile computation failed");
-        }
+    const size_t profile_len = n - m + 1;
+    std::vector<T>       mp(profile_len);
+    std::vector<int32_t> mpi(profile_len);
+
+    MPCC::AnytimeCallback callback;
+    if (!on_update.isUndefined() && !on_update.isNull()) {
+        callback = [&](size_t done, size_t total) {
+            const val keep_going = on_update(val(typed_memory_view(profile_len, mp.data())),
+                                             val(typed_memory_view(profile_len, mpi.data())),
+                                             static_cast<double>(done), static_cast<double>(total));
+            return !keep_going.strictlyEquals(val(false));
+        };
     }
 
-    // Copy results into new JS typed arrays before the C++ vectors are freed.
+    auto seq_xt = adapt_1d(seq.data(), n);
+    auto mp_xt  = adapt_1d(mp.data(),  profile_len);
+    auto mpi_xt = adapt_1d(mpi.data(), profile_len);
+    throw_on_failure(MPCC::matrixProfileAnytime(seq_xt, m, mp_xt, mpi_xt, anytime_options(options),
+                                                usable_threads(num_threads), callback));
+
     return {
-        val::global("Float64Array").new_(typed_memory_view(profile_len, mp_data.data())),
-        val::global("Int32Array").new_(typed_memory_view(profile_len, mpi_data.data())),
+        typed_array_class<T>().new_(typed_memory_view(profile_len, mp.data())),
+        val::global("Int32Array").new_(typed_memory_view(profile_len, mpi.data())),
     };
 }
 
+// ProfileMatch list as a JS array of { index, neighbor, distance }.
+static val profile_matches_array(const std::vector<MPCC::ProfileMatch>& matches) {
+    val out = val::array();
+    for (const auto& match : matches) {
+        val entry = val::object();
+        entry.set("index",    static_cast<double>(match.index));
+        entry.set("neighbor", static_cast<double>(match.neighbor));
+        entry.set("distance", match.distance);
+        out.call<void>("push", entry);
+    }
+    return out;
+}
+
+// The top-k motifs (kDiscords false) or discords of a { distances, indices } profile, as a JS array of
+// { index, neighbor, distance } best first; picks are at least exclusion + 1 subsequences apart.
+template <class T, bool kDiscords>
+static val find_matches(val distances_val, val indices_val, size_t k, size_t exclusion) {
+    std::vector<T>       mp  = convertJSArrayToNumberVector<T>(distances_val);
+    std::vector<int32_t> mpi = convertJSArrayToNumberVector<int32_t>(indices_val);
+    if (mpi.size() != mp.size()) throw std::invalid_argument("indices must have the length of distances");
+
+    auto mp_xt  = adapt_1d(mp.data(),  mp.size());
+    auto mpi_xt = adapt_1d(mpi.data(), mpi.size());
+    std::vector<MPCC::ProfileMatch> matches;
+    throw_on_failure(kDiscords ? MPCC::findDiscords(mp_xt, mpi_xt, k, exclusion, matches)
+                               : MPCC::findMotifs(mp_xt, mpi_xt, k, exclusion, matches));
+    return profile_matches_array(matches);
+}
+
+// matrixProfileStomp that also finds the top-k discords during the sweep: returns { distances, indices,
+// discords }, with discords as find_matches returns them.
+template <class T>
+static val matrix_profile_discords(val sequence_val, size_t m, size_t k, size_t exclusion, size_t num_threads,
+                                   val on_progress) {
+    std::vector<T> seq = convertJSArrayToNumberVector<T>(sequence_val);
+    const size_t n = seq.size();
+
+    if (m == 0) throw std::invalid_argument("m must be greater than 0");
+    if (m > n)  throw std::invalid_argument("m must not be larger than sequence length");
+
+    const size_t profile_len = n - m + 1;
+    std::vector<T>       mp(profile_len);
+    std::vector<int32_t> mpi(profile_len);
+
+    auto seq_xt = adapt_1d(seq.data(), n);
+    auto mp_xt  = adapt_1d(mp.data(),  profile_len);
+    auto mpi_xt = adapt_1d(mpi.data(), profile_len);
+
+    std::vector<MPCC::ProfileMatch> discords;
+    throw_on_failure(MPCC::matrixProfileDiscords(seq_xt, m, k, exclusion, mp_xt, mpi_xt, discords,
+                                                 usable_threads(num_threads), progress_callback(on_progress)));
+
+    val out = val::object();
+    out.set("distances", typed_array_class<T>().new_(typed_memory_view(profile_len, mp.data())));
+    out.set("indices",   val::global("Int32Array").new_(typed_memory_view(profile_len, mpi.data())));
+    out.set("discords",  profile_matches_array(discords));
+    return out;
+}
+
+template <class T>
+static void bind_heap_buffer(const char* name) {
+    class_<HeapBuffer<T>>(name)
+        .template constructor<size_t>()
+        .function("size", &HeapBuffer<T>::size)
+        .function("view", &HeapBuffer<T>::view);
+}
+
 EMSCRIPTEN_BINDINGS(mpcc) {
     value_object<MatrixProfileResult>("MatrixProfileResult")
         .field("distances", &MatrixProfileResult::distances)
         .field("indices",   &MatrixProfileResult::indices);
 
-    function("similaritySearch",   &similarity_search);
-    function("matrixProfileNaive", &matrix_profile_naive);
+    class_<MPCC::SequenceStats>("SequenceStats")
+        .constructor(&make_sequence_stats<double>, allow_raw_pointers())
+        .function("sequenceLength", &MPCC::SequenceStats::sequenceLength)
+        .function("contains",       &MPCC::SequenceStats::contains);
+
+    class_<MPCC::SequenceStatsF32>("SequenceStatsF32")
+        .constructor(&make_sequence_stats<float>, allow_raw_pointers())
+        .function("sequenceLength", &MPCC::SequenceStatsF32::sequenceLength)
+        .function("contains",       &MPCC::SequenceStatsF32::contains);
+
+    bind_heap_buffer<double>("Float64Buffer");
+    bind_heap_buffer<float>("Float32Buffer");
+    bind_heap_buffer<int32_t>("Int32Buffer");
+
+    // Scratch memory for the *Into matrix profile functions, passed as their last argument after onProgress.
+    // reserve(maxN, numThreads) sizes it up front. Owned by JS; call .delete() when done.
+    class_<MPCC::Workspace>("Workspace")
+        .constructor<>()
+        .function("reserve",       &MPCC::Workspace::reserve)
+        .function("capacityBytes", &MPCC::Workspace::capacityBytes);
+
+    function("simdBackend",                  &simd_backend);
+    function("threadsEnabled",               &threads_enabled);
+
+    function("similaritySearch",             &similarity_search<double, Search>);
+    function("similaritySearch",             &similarity_search_with_stats<double>);
+    function("similaritySearchMass",         &similarity_search<double, SearchMass>);
+    function("similaritySearchAuto",         &similarity_search<double, SearchAuto>);
+    function("matrixProfileNaive",           &single_threaded<&matrix_profile<double, Naive>>);
+    function("matrixProfileNaive",           &matrix_profile<double, Naive>);
+    function("matrixProfileStomp",           &single_threaded<&matrix_profile<double, Stomp>>);
+    function("matrixProfileStomp",           &matrix_profile<double, Stomp>);
+    function("matrixProfileDiagonal",        &single_threaded<&matrix_profile<double, Diagonal>>);
+    function("matrixProfileDiagonal",        &matrix_profile<double, Diagonal>);
+    function("matrixProfileStompProfiled",   &matrix_profile_profiled<double, Stomp>);
+    function("matrixProfileDiagonalProfiled", &matrix_profile_profiled<double, Diagonal>);
+    function("matrixProfileABJoin",          &matrix_profile_ab_join_single_threaded<double>);
+    function("matrixProfileABJoin",          &matrix_profile_ab_join<double>);
+    function("matrixProfileABJoinProfiled",  &matrix_profile_ab_join_profiled<double>);
+    function("matrixProfileAnytime",         &matrix_profile_anytime<double>);
+    function("matrixProfileMultidim",        &matrix_profile_multidim_single_threaded<double>);
+    function("matrixProfileMultidim",        &matrix_profile_multidim<double>);
+    function("matrixProfileDiscords",        &matrix_profile_discords<double>);
+    function("findMotifs",                   &find_matches<double, false>);
+    function("findDiscords",                 &find_matches<double, true>);
+
+    function("similaritySearchInto",         &similarity_search_into<double, Search>);
+    function("similaritySearchInto",         &similarity_search_with_stats_into<double>);
+    function("similaritySearchMassInto",     &similarity_search_into<double, SearchMass>);
+    function("similaritySearchAutoInto",     &similarity_search_into<double, SearchAuto>);
+    function("matrixProfileNaiveInto",       &single_threaded_into<double, &matrix_profile_into<double, Naive>>);
+    function("matrixProfileNaiveInto",       &matrix_profile_into<double, Naive>);
+    function("matrixProfileNaiveInto",       &matrix_profile_with_workspace_into<double, Naive>);
+    function("matrixProfileStompInto",       &single_threaded_into<double, &matrix_profile_into<double, Stomp>>);
+    function("matrixProfileStompInto",       &matrix_profile_into<double, Stomp>);
+    function("matrixProfileStompInto",       &matrix_profile_with_workspace_into<double, Stomp>);
+    function("matrixProfileDiagonalInto",    &single_threaded_into<double, &matrix_profile_into<double, Diagonal>>);
+    function("matrixProfileDiagonalInto",    &matrix_profile_into<double, Diagonal>);
+    function("matrixProfileDiagonalInto",    &matrix_profile_with_workspace_into<double, Diagonal>);
+    function("matrixProfileABJoinInto",      &matrix_profile_ab_join_single_threaded_into<double>);
+    function("matrixProfileABJoinInto",      &matrix_profile_ab_join_into<double>);
+    function("matrixProfileABJoinInto",      &matrix_profile_ab_join_with_workspace_into<double>);
+
+    function("similaritySearchF32",          &similarity_search<float, Search>);
+    function("similaritySearchF32",          &similarity_search_with_stats<float>);
+    function("similaritySearchMassF32",      &similarity_search<float, SearchMass>);
+    function("similaritySearchAutoF32",      &similarity_search<float, SearchAuto>);
+    function("matrixProfileNaiveF32",        &single_threaded<&matrix_profile<float, Naive>>);
+    function("matrixProfileNaiveF32",        &matrix_profile<float, Naive>);
+    function("matrixProfileStompF32",        &single_threaded<&matrix_profile<float, Stomp>>);
+    function("matrixProfileStompF32",        &matrix_profile<float, Stomp>);
+    function("matrixProfileDiagonalF32",     &single_threaded<&matrix_profile<float, Diagonal>>);
+    function("matrixProfileDiagonalF32",     &matrix_profile<float, Diagonal>);
+    function("matrixProfileStompProfiledF32",    &matrix_profile_profiled<float, Stomp>);
+    function("matrixProfileDiagonalProfiledF32", &matrix_profile_profiled<float, Diagonal>);
+    function("matrixProfileABJoinF32",       &matrix_profile_ab_join_single_threaded<float>);
+    function("matrixProfileABJoinF32",       &matrix_profile_ab_join<float>);
+    function("matrixProfileABJoinProfiledF32",   &matrix_profile_ab_join_profiled<float>);
+    function("matrixProfileAnytimeF32",      &matrix_profile_anytime<float>);
+    function("matrixProfileMultidimF32",     &matrix_profile_multidim_single_threaded<float>);
+    function("matrixProfileMultidimF32",     &matrix_profile_multidim<float>);
+    function("matrixProfileDiscordsF32",     &matrix_profile_discords<float>);
+    function("findMotifsF32",                &find_matches<float, false>);
+    function("findDiscordsF32",              &find_matches<float, true>);
+
+    function("similaritySearchIntoF32",      &similarity_search_into<float, Search>);
+    function("similaritySearchIntoF32",      &similarity_search_with_stats_into<float>);
+    function("similaritySearchMassIntoF32",  &similarity_search_into<float, SearchMass>);
+    function("similaritySearchAutoIntoF32",  &similarity_search_into<float, SearchAuto>);
+    function("matrixProfileNaiveIntoF32",    &single_threaded_into<float, &matrix_profile_into<float, Naive>>);
+    function("matrixProfileNaiveIntoF32",    &matrix_profile_into<float, Naive>);
+    function("matrixProfileNaiveIntoF32",    &matrix_profile_with_workspace_into<float, Naive>);
+    function("matrixProfileStompIntoF32",    &single_threaded_into<float, &matrix_profile_into<float, Stomp>>);
+    function("matrixProfileStompIntoF32",    &matrix_profile_into<float, Stomp>);
+    function("matrixProfileStompIntoF32",    &matrix_profile_with_workspace_into<float, Stomp>);
+    function("matrixProfileDiagonalIntoF32", &single_threaded_into<float, &matrix_profile_into<float, Diagonal>>);
+    function("matrixProfileDiagonalIntoF32", &matrix_profile_into<float, Diagonal>);
+    function("matrixProfileDiagonalIntoF32", &matrix_profile_with_workspace_into<float, Diagonal>);
+    function("matrixProfileABJoinIntoF32",   &matrix_profile_ab_join_single_threaded_into<float>);
+    function("matrixProfileABJoinIntoF32",   &matrix_profile_ab_join_into<float>);
+    function("matrixProfileABJoinIntoF32",   &matrix_profile_ab_join_with_workspace_into<float>);
 }
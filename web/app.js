@@ -2,9 +2,10 @@ import { html }                   from 'htm/preact';
 import { render }                  from 'preact';
 import { useState, useEffect }     from 'preact/hooks';
 import { parseFile }               from './lib/parser.js';
+import { decodeProfile }           from './lib/profile.js';
 import {
   loadWasm,
-  computeMatrixProfile,
+  computeMatrixProfileAnytime,
   computeSimilaritySearch,
   findMotifIndex,
 } from './lib/wasm.js';
@@ -37,7 +38,27 @@ function App() {
       });
   }, []);
 
+  // A precomputed profile (.mpcp, from mpcc.encode_profile) of the selected series is shown as if it had just
+  // been computed, and sets m to the one it was computed with.
+  async function handleProfileFile(file) {
+    try {
+      const profile = decodeProfile(await file.arrayBuffer());
+      if (!series) throw new Error('Load the series before its precomputed profile');
+      if (profile.distances.length !== series.length - profile.m + 1) {
+        throw new Error(`Profile does not match the selected series (${profile.distances.length} values for `
+          + `m=${profile.m}, expected ${series.length - profile.m + 1})`);
+      }
+      setM(profile.m);
+      setMatrixProfile({ distances: profile.distances, indices: profile.indices });
+      setSimilaritySearch(null);
+      setStatus({ type: 'success', message: `Loaded precomputed profile — m=${profile.m}` });
+    } catch (err) {
+      setStatus({ type: 'error', message: err.message });
+    }
+  }
+
   async function handleFile(file) {
+    if (file.name.toLowerCase().endsWith('.mpcp')) return handleProfileFile(file);
     setStatus({ type: 'busy', message: 'Parsing…' });
     try {
       const parsed = await parseFile(file);
@@ -61,7 +82,7 @@ function App() {
     setSimilaritySearch(null);
   }
 
-  function handleCompute() {
+  async function handleCompute() {
     if (isNaN(m) || m < 4) {
       setStatus({ type: 'error', message: 'm must be ≥ 4' });
       return;
@@ -77,25 +98,29 @@ function App() {
     setStatus({ type: 'busy', message: msg });
     setComputing(true);
 
-    // Yield to the browser so the spinner renders before WASM blocks the thread.
-    setTimeout(() => {
-      try {
-        const result    = computeMatrixProfile(wasm, series, m);
-        const motifIdx  = findMotifIndex(result.distances);
-        const profileLen = result.distances.length.toLocaleString();
-        const doneMsg   = motifIdx >= 0
-          ? `Done — m=${m}, ${profileLen} values · min distance ${result.distances[motifIdx].toFixed(4)}`
-          : `Done — m=${m}, ${profileLen} values`;
-
-        setMatrixProfile(result);
-        setSimilaritySearch(null);
-        setStatus({ type: 'success', message: doneMsg });
-      } catch (err) {
-        setStatus({ type: 'error', message: err.message });
-      } finally {
-        setComputing(false);
-      }
-    }, 20);
+    // The computation runs in a worker with the anytime engine, so the UI stays responsive and shows an
+    // approximate profile almost immediately, refining it until the exact one arrives.
+    try {
+      const result = await computeMatrixProfileAnytime(series, m, {
+        onUpdate: (approximate, done, total) => {
+          setMatrixProfile(approximate);
+          setStatus({ type: 'busy', message: `Refining… ${Math.floor((100 * done) / total)}%` });
+        },
+      });
+      const motifIdx  = findMotifIndex(result.distances);
+      const profileLen = result.distances.length.toLocaleString();
+      const doneMsg   = motifIdx >= 0
+        ? `Done — m=${m}, ${profileLen} values · min distance ${result.distances[motifIdx].toFixed(4)}`
+        : `Done — m=${m}, ${profileLen} values`;
+
+      setMatrixProfile(result);
+      setSimilaritySearch(null);
+      setStatus({ type: 'success', message: doneMsg });
+    } catch (err) {
+      setStatus({ type: 'error', message: err.message });
+    } finally {
+      setComputing(false);
+    }
   }
 
   function handlePointClick(idx) {
@@ -11,7 +11,7 @@ const UploadIcon = () => html`
 `;
 
 // Drag-and-drop / click-to-browse file upload zone.
-// onFile(File) is called when the user selects or drops a file.
+// onFile(File) is called when the user selects or drops a file: a series, or a precomputed profile (.mpcp).
 export function FileUpload({ onFile }) {
   function handleDragOver(e) {
     e.preventDefault();
@@ -43,7 +43,7 @@ export function FileUpload({ onFile }) {
     >
       <${UploadIcon} />
       Upload CSV / JSON
-      <input type="file" accept=".csv,.json,.tsv,.txt" onChange=${handleChange} />
+      <input type="file" accept=".csv,.json,.tsv,.txt,.mpcp" onChange=${handleChange} />
     </label>
   `;
 }
@@ -0,0 +1,42 @@
+// Picks and loads the best MPCC WASM build the browser can run.
+//
+// Builds are tried best first, and ones that were not copied into web/ (see copy_wasm.sh) are skipped:
+//   mpcc_wasm_threaded_simd_base, mpcc_wasm_threaded_base   pthreads; only inside a cross-origin isolated worker
+//   mpcc_wasm_simd_base                                     SIMD128 kernels
+//   mpcc_wasm_base                                          scalar; runs everywhere
+
+// A module whose one function returns i8x16.popcnt(i8x16.splat(0)). Engines without SIMD128 fail to validate it.
+const SIMD_PROBE = new Uint8Array([
+  0, 97, 115, 109, 1, 0, 0, 0, 1, 5, 1, 96, 0, 1, 123, 3, 2, 1, 0, 10, 10, 1, 8, 0, 65, 0, 253, 15, 253, 98, 11,
+]);
+
+export function simdSupported() {
+  try {
+    return WebAssembly.validate(SIMD_PROBE);
+  } catch {
+    return false;
+  }
+}
+
+// threaded: whether pthreads builds may be used. They need SharedArrayBuffer and must not run on the UI
+// thread, since the parallel engines block their caller.
+export async function loadModule({ threaded = false } = {}) {
+  const simd = simdSupported();
+  const candidates = [
+    threaded && simd && 'mpcc_wasm_threaded_simd_base',
+    threaded && 'mpcc_wasm_threaded_base',
+    simd && 'mpcc_wasm_simd_base',
+    'mpcc_wasm_base',
+  ].filter(Boolean);
+
+  for (const name of candidates.slice(0, -1)) {
+    try {
+      const { default: initMPCC } = await import(`../${name}.js`);
+      return await initMPCC();
+    } catch (err) {
+      console.warn(`MPCC build ${name} unavailable, trying the next one:`, err);
+    }
+  }
+  const { default: initMPCC } = await import(`../${candidates.at(-1)}.js`);
+  return initMPCC();
+}
@@ -0,0 +1,88 @@
+// Decoder for precomputed matrix profiles in the compact format of core/profile_codec.h (written by
+// mpcc.encode_profile), so the playground can show a stored profile instead of computing it in WASM.
+//
+// Layout, little-endian: "MPCP", version 1, distance encoding (0 float16, 1 uint16), 2 reserved bytes,
+// uint64 m, uint64 length, then length int32 index deltas and length uint16 distances.
+
+const HEADER_SIZE   = 24;
+const FLOAT16       = 0;
+const UINT16        = 1;
+const NO_NEIGHBOR   = 0xffff;
+const QUANTIZED_MAX = 65534;
+
+function halfToFloat(h) {
+  const sign     = h & 0x8000 ? -1 : 1;
+  const exponent = (h >> 10) & 0x1f;
+  const mantissa = h & 0x3ff;
+  if (exponent === 0)    return sign * mantissa * 2 ** -24;
+  if (exponent === 0x1f) return mantissa ? NaN : sign * Infinity;
+  return sign * (1024 + mantissa) * 2 ** (exponent - 25);
+}
+
+// Every half-precision value, so decoding a float16 profile is one lookup per entry.
+let halfTable = null;
+
+function getHalfTable() {
+  if (halfTable) return halfTable;
+  halfTable = new Float32Array(0x10000);
+  for (let h = 0; h < 0x10000; h++) halfTable[h] = halfToFloat(h);
+  return halfTable;
+}
+
+// Decodes an ArrayBuffer (or a typed array or DataView over one) holding an encoded profile. Returns
+// { distances: Float32Array, indices: Int32Array, m }, the shape computeMatrixProfile returns plus the
+// subsequence length; entries without a neighbor have distance Infinity and index -1. Throws on anything
+// that is not a complete version 1 profile.
+export function decodeProfile(data) {
+  const bytes = ArrayBuffer.isView(data)
+    ? new Uint8Array(data.buffer, data.byteOffset, data.byteLength)
+    : new Uint8Array(data);
+  if (bytes.length < HEADER_SIZE) throw new Error('Profile file is truncated');
+
+  const header = new DataView(bytes.buffer, bytes.byteOffset, HEADER_SIZE);
+  const magic  = String.fromCharCode(bytes[0], bytes[1], bytes[2], bytes[3]);
+  if (magic !== 'MPCP') throw new Error('Not an MPCC profile file');
+  if (bytes[4] !== 1)   throw new Error(`Unsupported profile version ${bytes[4]}`);
+
+  const encoding = bytes[5];
+  if (encoding !== FLOAT16 && encoding !== UINT16) throw new Error(`Unknown distance encoding ${encoding}`);
+
+  const m      = Number(header.getBigUint64(8, true));
+  const length = Number(header.getBigUint64(16, true));
+  if (m === 0 || bytes.length !== HEADER_SIZE + 6 * length) throw new Error('Profile file is truncated or corrupt');
+
+  // Typed array views need aligned offsets, so a buffer sliced at an unaligned position is copied once. They
+  // read the platform's byte order, which is little-endian wherever browsers run.
+  const aligned = bytes.byteOffset % 4 === 0 ? bytes : bytes.slice();
+  const deltas  = new Int32Array(aligned.buffer, aligned.byteOffset + HEADER_SIZE, length);
+  const encoded = new Uint16Array(aligned.buffer, aligned.byteOffset + HEADER_SIZE + 4 * length, length);
+
+  const indices = new Int32Array(length);
+  let index = 0;
+  for (let i = 0; i < length; i++) {
+    index += deltas[i];
+    indices[i] = index;
+  }
+
+  const distances = new Float32Array(length);
+  if (encoding === FLOAT16) {
+    const table = getHalfTable();
+    for (let i = 0; i < length; i++) distances[i] = table[encoded[i]];
+  } else {
+    const scale = (2 * Math.sqrt(m)) / QUANTIZED_MAX;
+    for (let i = 0; i < length; i++) {
+      const q = encoded[i];
+      distances[i] = q === NO_NEIGHBOR ? Infinity : q * scale;
+    }
+  }
+
+  return { distances, indices, m };
+}
+
+// Fetches and decodes a precomputed profile, e.g. one served next to its series. Servers compressing the
+// response (the delta-encoded indices compress well) are handled transparently by fetch.
+export async function fetchProfile(url) {
+  const response = await fetch(url);
+  if (!response.ok) throw new Error(`Could not load profile: ${response.status} ${response.statusText}`);
+  return decodeProfile(await response.arrayBuffer());
+}
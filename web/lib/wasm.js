@@ -1,11 +1,12 @@
 // WASM module loading and Matrix Profile computation.
 
+import { loadModule } from './modules.js';
+
 let instance = null;
 
 export async function loadWasm() {
   if (instance) return instance;
-  const { default: initMPCC } = await import('../mpcc_wasm_base.js');
-  instance = await initMPCC();
+  instance = await loadModule();
   return instance;
 }
 
@@ -14,12 +15,125 @@ export function computeMatrixProfile(wasm, series, m) {
   return wasm.matrixProfileNaive(series, m);
 }
 
-// Returns Float64Array of distances from the query subsequence to every position in series.
-// queryIdx is clamped so the query never overruns the end of the series.
-export function computeSimilaritySearch(wasm, series, queryIdx, m) {
+// Multidimensional (mSTAMP) matrix profile of several equally long series, e.g. the columns parseFile
+// returns for a multi-column CSV. Returns one { distances, indices } per k = 1..allSeries.length, where entry
+// k-1 is the k-dimensional profile; the arrays are views into one buffer per field.
+export function computeMultidimMatrixProfile(wasm, allSeries, m) {
+  const { distances, indices } = wasm.matrixProfileMultidim(allSeries.map(s => s.values), m);
+  const profileLen = distances.length / allSeries.length;
+  return allSeries.map((_, k) => ({
+    distances: distances.subarray(k * profileLen, (k + 1) * profileLen),
+    indices:   indices.subarray(k * profileLen, (k + 1) * profileLen),
+  }));
+}
+
+// Matrix profiles computed in a Web Worker (see worker.js), keyed by request id until they settle.
+let worker = null;
+let nextRequestId = 0;
+const pendingRequests = new Map();
+
+function getWorker() {
+  if (worker) return worker;
+  worker = new Worker(new URL('./worker.js', import.meta.url), { type: 'module' });
+  worker.onmessage = ({ data }) => {
+    const request = pendingRequests.get(data.id);
+    if (!request) return;
+    if (data.type === 'progress') {
+      request.onProgress?.(data.done, data.total);
+      return;
+    }
+    if (data.type === 'update') {
+      request.onUpdate?.(data.result, data.done, data.total);
+      return;
+    }
+    pendingRequests.delete(data.id);
+    if (data.type === 'result') request.resolve(data.result);
+    else request.reject(new Error(data.message));
+  };
+  // A worker that fails to load or crashes takes every outstanding request with it; the next call starts
+  // a fresh one.
+  worker.onerror = event => {
+    for (const request of pendingRequests.values()) request.reject(new Error(event.message || 'MPCC worker failed'));
+    pendingRequests.clear();
+    worker.terminate();
+    worker = null;
+  };
+  return worker;
+}
+
+// Like computeMatrixProfile, but runs off the main thread, on every core when the page is cross-origin
+// isolated and the threaded build is present. Resolves to { distances, indices }; onProgress(done, total)
+// is called as the computation advances.
+export function computeMatrixProfileAsync(series, m, { onProgress } = {}) {
+  return new Promise((resolve, reject) => {
+    const id = nextRequestId++;
+    pendingRequests.set(id, { resolve, reject, onProgress });
+    getWorker().postMessage({ id, op: 'matrixProfile', series, m });
+  });
+}
+
+// Like computeMatrixProfileAsync, but with the anytime (SCRIMP++) engine: onUpdate({ distances, indices },
+// done, total) receives a usable approximation within milliseconds and then progressively refined ones,
+// and the promise resolves to the final profile. options may set fraction, timeBudgetMs, prescrimp and
+// seed (see AnytimeOptions); by default the profile is computed exactly.
+export function computeMatrixProfileAnytime(series, m, { onUpdate, ...options } = {}) {
+  return new Promise((resolve, reject) => {
+    const id = nextRequestId++;
+    pendingRequests.set(id, { resolve, reject, onUpdate });
+    getWorker().postMessage({ id, op: 'matrixProfileAnytime', series, m, options });
+  });
+}
+
+// The most recently searched series, copied once into the WASM heap together with its window statistics
+// and the query and distance buffers for its m, so a click copies only the m query values in and (unless it
+// asks for a view) the distances out. Builds that predate heap buffers fall back to passing the JS arrays on
+// every call.
+let searchCache = { series: null, m: 0, sequence: null, stats: null, query: null, distances: null };
+
+function releaseSearchBuffers(...buffers) {
+  for (const buffer of buffers) buffer?.delete();
+}
+
+function searchBuffers(wasm, series, m) {
+  if (searchCache.series !== series) {
+    const { sequence, stats, query, distances } = searchCache;
+    releaseSearchBuffers(sequence, stats, query, distances);
+    const heapSeries = new wasm.Float64Buffer(series.length);
+    heapSeries.view().set(series);
+    searchCache = { series, m: 0, sequence: heapSeries, stats: null, query: null, distances: null };
+  }
+  if (searchCache.m !== m) {
+    const { stats, query, distances } = searchCache;
+    releaseSearchBuffers(stats, query, distances);
+    searchCache.m         = m;
+    searchCache.stats     = new wasm.SequenceStats(searchCache.sequence.view(), m);
+    searchCache.query     = new wasm.Float64Buffer(m);
+    searchCache.distances = new wasm.Float64Buffer(series.length - m + 1);
+  }
+  return searchCache;
+}
+
+// Like computeSimilaritySearch, but with heap buffers the distances are a view into the WASM heap, valid
+// only until the next search or until any WASM allocation grows memory (which detaches it). Use it to read
+// the distances straight away; anything kept, such as app state, should come from computeSimilaritySearch.
+export function computeSimilaritySearchView(wasm, series, queryIdx, m) {
   const clampedIdx = Math.max(0, Math.min(queryIdx, series.length - m));
   const query = series.slice(clampedIdx, clampedIdx + m);
-  return { distances: wasm.similaritySearch(series, query), queryIdx: clampedIdx };
+  if (!wasm.Float64Buffer) {
+    return { distances: wasm.similaritySearch(series, query), queryIdx: clampedIdx };
+  }
+
+  const buffers = searchBuffers(wasm, series, m);
+  buffers.query.view().set(query);
+  wasm.similaritySearchInto(buffers.sequence, buffers.query, buffers.stats, buffers.distances);
+  return { distances: buffers.distances.view(), queryIdx: clampedIdx };
+}
+
+// Returns Float64Array of distances from the query subsequence to every position in series, owned by JS.
+// queryIdx is clamped so the query never overruns the end of the series.
+export function computeSimilaritySearch(wasm, series, queryIdx, m) {
+  const result = computeSimilaritySearchView(wasm, series, queryIdx, m);
+  return wasm.Float64Buffer ? { ...result, distances: result.distances.slice() } : result;
 }
 
 // Returns the index of the minimum finite value in a distance array, or -1 if none.
@@ -31,3 +145,17 @@ export function findMotifIndex(distances) {
   }
   return motifIdx;
 }
+
+// The top-k motifs of a { distances, indices } profile as [{ index, neighbor, distance }], best first, in one
+// pass in WASM. Each pick rules out every subsequence within exclusion of it and of its neighbor.
+export function findMotifs(wasm, { distances, indices }, k, exclusion) {
+  const find = distances instanceof Float32Array ? wasm.findMotifsF32 : wasm.findMotifs;
+  return find(distances, indices, k, exclusion);
+}
+
+// The top-k discords of a { distances, indices } profile as [{ index, neighbor, distance }], farthest first,
+// each pick ruling out every subsequence within exclusion of it.
+export function findDiscords(wasm, { distances, indices }, k, exclusion) {
+  const find = distances instanceof Float32Array ? wasm.findDiscordsF32 : wasm.findDiscords;
+  return find(distances, indices, k, exclusion);
+}
@@ -0,0 +1,74 @@
+// Web Worker hosting an MPCC module, so long matrix profile computations never block the UI thread.
+//
+// Messages in:  { id, op: 'matrixProfile', series, m }
+//               { id, op: 'matrixProfileAnytime', series, m, options }
+// Messages out: { id, type: 'progress', done, total }
+//               { id, type: 'update', result: { distances, indices }, done, total }   (anytime only)
+//               { id, type: 'result', result: { distances, indices } }   (buffers are transferred)
+//               { id, type: 'error', message }
+//
+// The pthreads build needs SharedArrayBuffer, which browsers only provide to cross-origin isolated pages
+// (COOP: same-origin, COEP: require-corp). Without it, or without that build, the single-threaded module
+// is used; it still runs here rather than on the UI thread.
+
+import { loadModule } from './modules.js';
+
+let modulePromise = null;
+
+function loadWorkerModule() {
+  modulePromise ??= loadModule({ threaded: self.crossOriginIsolated });
+  return modulePromise;
+}
+
+// Runs the parallel (diagonal) engine on every core the build can use. Progress is forwarded once per
+// percent, since the engine may report far more often than that. Builds that predate threadsEnabled only
+// have the two-argument naive engine.
+function matrixProfile(wasm, id, series, m) {
+  if (typeof wasm.threadsEnabled !== 'function') return wasm.matrixProfileNaive(series, m);
+
+  let lastPercent = -1;
+  return wasm.matrixProfileDiagonal(series, m, 0, (done, total) => {
+    const percent = Math.floor((100 * done) / total);
+    if (percent === lastPercent) return;
+    lastPercent = percent;
+    self.postMessage({ id, type: 'progress', done, total });
+  });
+}
+
+// Minimum time between two approximations posted by matrixProfileAnytime. Each one copies the whole profile,
+// and the engine finishes rounds of diagonals far more often than a plot can usefully redraw.
+const UPDATE_INTERVAL_MS = 100;
+
+// Runs the anytime (SCRIMP++) engine, posting a copy of the current approximation at most once per
+// UPDATE_INTERVAL_MS. The first approximation (after PreSCRIMP) is always posted, since that is the one
+// that makes the profile usable within milliseconds. Builds that predate matrixProfileAnytime fall back to
+// the exact engine.
+function matrixProfileAnytime(wasm, id, series, m, options) {
+  if (typeof wasm.matrixProfileAnytime !== 'function') return matrixProfile(wasm, id, series, m);
+
+  let lastPost = -Infinity;
+  return wasm.matrixProfileAnytime(series, m, options ?? {}, 0, (distances, indices, done, total) => {
+    const now = performance.now();
+    if (now - lastPost < UPDATE_INTERVAL_MS || done === total) return true;
+    lastPost = now;
+    const result = { distances: distances.slice(), indices: indices.slice() };
+    self.postMessage({ id, type: 'update', result, done, total }, [result.distances.buffer, result.indices.buffer]);
+    return true;
+  });
+}
+
+const operations = { matrixProfile, matrixProfileAnytime };
+
+self.onmessage = async ({ data }) => {
+  const { id, op } = data;
+  try {
+    const wasm = await loadWorkerModule();
+    const run = operations[op];
+    if (!run) throw new Error(`unknown operation: ${op}`);
+
+    const result = run(wasm, id, data.series, data.m, data.options);
+    self.postMessage({ id, type: 'result', result }, [result.distances.buffer, result.indices.buffer]);
+  } catch (err) {
+    self.postMessage({ id, type: 'error', message: err?.message ?? String(err) });
+  }
+};